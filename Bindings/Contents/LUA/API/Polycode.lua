@@ -31,7 +31,7 @@ require "Polycode/Mesh"
 require "Polycode/VertexBuffer"
 require "Polycode/PolycodeModule"
 require "Polycode/ObjectEntry"
-require "Polycode/Particle"
+require "Polycode/ParticleSimulation"
 require "Polycode/ScreenParticleEmitter"
 require "Polycode/SceneParticleEmitter"
 require "Polycode/ParticleEmitter"
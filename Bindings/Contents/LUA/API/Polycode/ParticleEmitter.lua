@@ -159,6 +159,10 @@ function ParticleEmitter:enablePerlin(val)
 	local retVal = Polycore.ParticleEmitter_enablePerlin(self.__ptr, val)
 end
 
+function ParticleEmitter:setPerlinModSize(size)
+	local retVal = Polycore.ParticleEmitter_setPerlinModSize(self.__ptr, size)
+end
+
 function ParticleEmitter:setBillboardMode(mode)
 	local retVal = Polycore.ParticleEmitter_setBillboardMode(self.__ptr, mode)
 end
@@ -184,20 +188,29 @@ function ParticleEmitter:Trigger()
 	local retVal =  Polycore.ParticleEmitter_Trigger(self.__ptr)
 end
 
-function ParticleEmitter:resetParticle(particle)
-	local retVal = Polycore.ParticleEmitter_resetParticle(self.__ptr, particle.__ptr)
-end
-
-function ParticleEmitter:setPerlinModSize(size)
-	local retVal = Polycore.ParticleEmitter_setPerlinModSize(self.__ptr, size)
+function ParticleEmitter:resetParticle(index)
+	local retVal = Polycore.ParticleEmitter_resetParticle(self.__ptr, index)
 end
 
 function ParticleEmitter:setParticleCount(count)
 	local retVal = Polycore.ParticleEmitter_setParticleCount(self.__ptr, count)
 end
 
-function ParticleEmitter:addParticleBody(particleBody)
-	local retVal = Polycore.ParticleEmitter_addParticleBody(self.__ptr, particleBody.__ptr)
+function ParticleEmitter:getParticleCount()
+	local retVal =  Polycore.ParticleEmitter_getParticleCount(self.__ptr)
+	return retVal
+end
+
+function ParticleEmitter:getParticleSimulation()
+	local retVal =  Polycore.ParticleEmitter_getParticleSimulation(self.__ptr)
+	if retVal == nil then return nil end
+	if Polycore.__ptr_lookup[retVal] ~= nil then
+		return Polycore.__ptr_lookup[retVal]
+	else
+		Polycore.__ptr_lookup[retVal] = ParticleSimulation("__skip_ptr__")
+		Polycore.__ptr_lookup[retVal].__ptr = retVal
+		return Polycore.__ptr_lookup[retVal]
+	end
 end
 
 function ParticleEmitter:getBaseMatrix()
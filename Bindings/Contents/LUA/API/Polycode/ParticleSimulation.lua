@@ -0,0 +1,58 @@
+class "ParticleSimulation"
+
+
+
+
+
+
+
+function ParticleSimulation:ParticleSimulation(...)
+	for k,v in pairs(arg) do
+		if type(v) == "table" then
+			if v.__ptr ~= nil then
+				arg[k] = v.__ptr
+			end
+		end
+	end
+	if self.__ptr == nil and arg[1] ~= "__skip_ptr__" then
+		self.__ptr = Polycore.ParticleSimulation(unpack(arg))
+		Polycore.__ptr_lookup[self.__ptr] = self
+	end
+end
+
+function ParticleSimulation:setCount(count)
+	local retVal = Polycore.ParticleSimulation_setCount(self.__ptr, count)
+end
+
+function ParticleSimulation:getCount()
+	local retVal =  Polycore.ParticleSimulation_getCount(self.__ptr)
+	return retVal
+end
+
+function ParticleSimulation:integrate(count, elapsed, timeStep, gravity, rotationSpeed, planar)
+	local retVal = Polycore.ParticleSimulation_integrate(self.__ptr, count, elapsed, timeStep, gravity.__ptr, rotationSpeed, planar)
+end
+
+function ParticleSimulation:setMeshTemplate(mesh)
+	local retVal = Polycore.ParticleSimulation_setMeshTemplate(self.__ptr, mesh.__ptr)
+end
+
+function ParticleSimulation:buildQuadStream(count, right, up, baseSize, followPath)
+	local retVal = Polycore.ParticleSimulation_buildQuadStream(self.__ptr, count, right.__ptr, up.__ptr, baseSize, followPath)
+end
+
+function ParticleSimulation:buildMeshStream(count, billboard, followPath, right, up)
+	local retVal = Polycore.ParticleSimulation_buildMeshStream(self.__ptr, count, billboard, followPath, right.__ptr, up.__ptr)
+end
+
+function ParticleSimulation:getStreamVertexCount()
+	local retVal =  Polycore.ParticleSimulation_getStreamVertexCount(self.__ptr)
+	return retVal
+end
+
+
+
+function ParticleSimulation:__delete()
+	Polycore.__ptr_lookup[self.__ptr] = nil
+	Polycore.delete_ParticleSimulation(self.__ptr)
+end
@@ -40,10 +40,6 @@ function SceneParticleEmitter:getEmitter()
 	end
 end
 
-function SceneParticleEmitter:addParticleBody(particleBody)
-	local retVal = Polycore.SceneParticleEmitter_addParticleBody(self.__ptr, particleBody.__ptr)
-end
-
 function SceneParticleEmitter:getBaseMatrix()
 	local retVal =  Polycore.SceneParticleEmitter_getBaseMatrix(self.__ptr)
 	if retVal == nil then return nil end
@@ -60,6 +56,10 @@ function SceneParticleEmitter:Update()
 	local retVal =  Polycore.SceneParticleEmitter_Update(self.__ptr)
 end
 
+function SceneParticleEmitter:Render()
+	local retVal =  Polycore.SceneParticleEmitter_Render(self.__ptr)
+end
+
 
 
 function SceneParticleEmitter:__delete()
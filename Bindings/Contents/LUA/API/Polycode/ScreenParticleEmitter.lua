@@ -40,10 +40,6 @@ function ScreenParticleEmitter:getEmitter()
 	end
 end
 
-function ScreenParticleEmitter:addParticleBody(particleBody)
-	local retVal = Polycore.ScreenParticleEmitter_addParticleBody(self.__ptr, particleBody.__ptr)
-end
-
 function ScreenParticleEmitter:getBaseMatrix()
 	local retVal =  Polycore.ScreenParticleEmitter_getBaseMatrix(self.__ptr)
 	if retVal == nil then return nil end
@@ -60,6 +56,10 @@ function ScreenParticleEmitter:Update()
 	local retVal =  Polycore.ScreenParticleEmitter_Update(self.__ptr)
 end
 
+function ScreenParticleEmitter:Render()
+	local retVal =  Polycore.ScreenParticleEmitter_Render(self.__ptr)
+end
+
 
 
 function ScreenParticleEmitter:__delete()
@@ -4369,171 +4369,100 @@ static int Polycore_delete_ObjectEntry(lua_State *L) {
 	return 0;
 }
 
-static int Polycore_Particle_get_velVector(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushlightuserdata(L, &inst->velVector);
-	return 1;
-}
-
-static int Polycore_Particle_get_dirVector(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushlightuserdata(L, &inst->dirVector);
-	return 1;
-}
-
-static int Polycore_Particle_get_deviation(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushlightuserdata(L, &inst->deviation);
-	return 1;
-}
-
-static int Polycore_Particle_get_life(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushnumber(L, inst->life);
-	return 1;
-}
-
-static int Polycore_Particle_get_lifespan(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushnumber(L, inst->lifespan);
-	return 1;
-}
-
-static int Polycore_Particle_get_brightnessDeviation(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushnumber(L, inst->brightnessDeviation);
-	return 1;
-}
-
-static int Polycore_Particle_get_perlinPosX(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushnumber(L, inst->perlinPosX);
-	return 1;
-}
-
-static int Polycore_Particle_get_perlinPosY(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushnumber(L, inst->perlinPosY);
-	return 1;
-}
-
-static int Polycore_Particle_get_perlinPosZ(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	lua_pushnumber(L, inst->perlinPosZ);
+static int Polycore_ParticleSimulation(lua_State *L) {
+	ParticleSimulation *inst = new ParticleSimulation();
+	lua_pushlightuserdata(L, (void*)inst);
 	return 1;
 }
 
-static int Polycore_Particle_set_life(lua_State *L) {
+static int Polycore_ParticleSimulation_setCount(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	Number param = lua_tonumber(L, 2);
-	inst->life = param;
-	return 0;
-}
-
-static int Polycore_Particle_set_lifespan(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	Number param = lua_tonumber(L, 2);
-	inst->lifespan = param;
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
+	luaL_checktype(L, 2, LUA_TNUMBER);
+	unsigned int count = lua_tointeger(L, 2);
+	inst->setCount(count);
 	return 0;
 }
 
-static int Polycore_Particle_set_brightnessDeviation(lua_State *L) {
+static int Polycore_ParticleSimulation_getCount(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	Number param = lua_tonumber(L, 2);
-	inst->brightnessDeviation = param;
-	return 0;
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
+	lua_pushinteger(L, inst->getCount());
+	return 1;
 }
 
-static int Polycore_Particle_set_perlinPosX(lua_State *L) {
+static int Polycore_ParticleSimulation_integrate(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	Number param = lua_tonumber(L, 2);
-	inst->perlinPosX = param;
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
+	luaL_checktype(L, 2, LUA_TNUMBER);
+	unsigned int count = lua_tointeger(L, 2);
+	luaL_checktype(L, 3, LUA_TNUMBER);
+	Number elapsed = lua_tonumber(L, 3);
+	luaL_checktype(L, 4, LUA_TNUMBER);
+	Number timeStep = lua_tonumber(L, 4);
+	luaL_checktype(L, 5, LUA_TLIGHTUSERDATA);
+	const Vector3 & gravity = *( Vector3 *)lua_topointer(L, 5);
+	luaL_checktype(L, 6, LUA_TNUMBER);
+	Number rotationSpeed = lua_tonumber(L, 6);
+	luaL_checktype(L, 7, LUA_TBOOLEAN);
+	bool planar = lua_toboolean(L, 7);
+	inst->integrate(count, elapsed, timeStep, gravity, rotationSpeed, planar);
 	return 0;
 }
 
-static int Polycore_Particle_set_perlinPosY(lua_State *L) {
+static int Polycore_ParticleSimulation_setMeshTemplate(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	Number param = lua_tonumber(L, 2);
-	inst->perlinPosY = param;
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
+	luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
+	Mesh * mesh = (Mesh *)lua_topointer(L, 2);
+	inst->setMeshTemplate(mesh);
 	return 0;
 }
 
-static int Polycore_Particle_set_perlinPosZ(lua_State *L) {
+static int Polycore_ParticleSimulation_buildQuadStream(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	Number param = lua_tonumber(L, 2);
-	inst->perlinPosZ = param;
-	return 0;
-}
-
-static int Polycore_Particle(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TNUMBER);
-	int particleType = lua_tointeger(L, 1);
-	luaL_checktype(L, 2, LUA_TBOOLEAN);
-	bool isScreenParticle = lua_toboolean(L, 2);
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
+	luaL_checktype(L, 2, LUA_TNUMBER);
+	unsigned int count = lua_tointeger(L, 2);
 	luaL_checktype(L, 3, LUA_TLIGHTUSERDATA);
-	Material * material = (Material *)lua_topointer(L, 3);
+	const Vector3 & right = *( Vector3 *)lua_topointer(L, 3);
 	luaL_checktype(L, 4, LUA_TLIGHTUSERDATA);
-	Texture * texture = (Texture *)lua_topointer(L, 4);
-	luaL_checktype(L, 5, LUA_TLIGHTUSERDATA);
-	Mesh * particleMesh = (Mesh *)lua_topointer(L, 5);
-	Particle *inst = new Particle(particleType, isScreenParticle, material, texture, particleMesh);
-	lua_pushlightuserdata(L, (void*)inst);
-	return 1;
-}
-
-static int Polycore_Particle_Reset(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	luaL_checktype(L, 2, LUA_TBOOLEAN);
-	bool continuious = lua_toboolean(L, 2);
-	inst->Reset(continuious);
+	const Vector3 & up = *( Vector3 *)lua_topointer(L, 4);
+	luaL_checktype(L, 5, LUA_TNUMBER);
+	Number baseSize = lua_tonumber(L, 5);
+	luaL_checktype(L, 6, LUA_TBOOLEAN);
+	bool followPath = lua_toboolean(L, 6);
+	inst->buildQuadStream(count, right, up, baseSize, followPath);
 	return 0;
 }
 
-static int Polycore_Particle_createSceneParticle(lua_State *L) {
+static int Polycore_ParticleSimulation_buildMeshStream(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
 	luaL_checktype(L, 2, LUA_TNUMBER);
-	int particleType = lua_tointeger(L, 2);
-	luaL_checktype(L, 3, LUA_TLIGHTUSERDATA);
-	Material * material = (Material *)lua_topointer(L, 3);
-	luaL_checktype(L, 4, LUA_TLIGHTUSERDATA);
-	Mesh * particleMesh = (Mesh *)lua_topointer(L, 4);
-	inst->createSceneParticle(particleType, material, particleMesh);
+	unsigned int count = lua_tointeger(L, 2);
+	luaL_checktype(L, 3, LUA_TBOOLEAN);
+	bool billboard = lua_toboolean(L, 3);
+	luaL_checktype(L, 4, LUA_TBOOLEAN);
+	bool followPath = lua_toboolean(L, 4);
+	luaL_checktype(L, 5, LUA_TLIGHTUSERDATA);
+	const Vector3 & right = *( Vector3 *)lua_topointer(L, 5);
+	luaL_checktype(L, 6, LUA_TLIGHTUSERDATA);
+	const Vector3 & up = *( Vector3 *)lua_topointer(L, 6);
+	inst->buildMeshStream(count, billboard, followPath, right, up);
 	return 0;
 }
 
-static int Polycore_Particle_createScreenParticle(lua_State *L) {
+static int Polycore_ParticleSimulation_getStreamVertexCount(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
-	luaL_checktype(L, 2, LUA_TNUMBER);
-	int particleType = lua_tointeger(L, 2);
-	luaL_checktype(L, 3, LUA_TLIGHTUSERDATA);
-	Texture * texture = (Texture *)lua_topointer(L, 3);
-	luaL_checktype(L, 4, LUA_TLIGHTUSERDATA);
-	Mesh * particleMesh = (Mesh *)lua_topointer(L, 4);
-	inst->createScreenParticle(particleType, texture, particleMesh);
-	return 0;
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
+	lua_pushinteger(L, inst->getStreamVertexCount());
+	return 1;
 }
 
-static int Polycore_delete_Particle(lua_State *L) {
+static int Polycore_delete_ParticleSimulation(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	Particle *inst = (Particle*)lua_topointer(L, 1);
+	ParticleSimulation *inst = (ParticleSimulation*)lua_topointer(L, 1);
 	delete inst;
 	return 0;
 }
@@ -4586,15 +4515,6 @@ static int Polycore_ScreenParticleEmitter_getEmitter(lua_State *L) {
 	return 1;
 }
 
-static int Polycore_ScreenParticleEmitter_addParticleBody(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	ScreenParticleEmitter *inst = (ScreenParticleEmitter*)lua_topointer(L, 1);
-	luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
-	Entity * particleBody = (Entity *)lua_topointer(L, 2);
-	inst->addParticleBody(particleBody);
-	return 0;
-}
-
 static int Polycore_ScreenParticleEmitter_getBaseMatrix(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	ScreenParticleEmitter *inst = (ScreenParticleEmitter*)lua_topointer(L, 1);
@@ -4611,6 +4531,13 @@ static int Polycore_ScreenParticleEmitter_Update(lua_State *L) {
 	return 0;
 }
 
+static int Polycore_ScreenParticleEmitter_Render(lua_State *L) {
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+	ScreenParticleEmitter *inst = (ScreenParticleEmitter*)lua_topointer(L, 1);
+	inst->Render();
+	return 0;
+}
+
 static int Polycore_delete_ScreenParticleEmitter(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	ScreenParticleEmitter *inst = (ScreenParticleEmitter*)lua_topointer(L, 1);
@@ -4620,7 +4547,7 @@ static int Polycore_delete_ScreenParticleEmitter(lua_State *L) {
 
 static int Polycore_SceneParticleEmitter(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TSTRING);
-	String imageFile = String(lua_tostring(L, 1));
+	String materialName = String(lua_tostring(L, 1));
 	luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
 	Scene * particleParentScene = (Scene *)lua_topointer(L, 2);
 	luaL_checktype(L, 3, LUA_TNUMBER);
@@ -4649,7 +4576,7 @@ static int Polycore_SceneParticleEmitter(lua_State *L) {
 	} else {
 		emitter = NULL;
 	}
-	SceneParticleEmitter *inst = new SceneParticleEmitter(imageFile, particleParentScene, particleType, emitterType, lifespan, numParticles, direction, gravity, deviation, particleMesh, emitter);
+	SceneParticleEmitter *inst = new SceneParticleEmitter(materialName, particleParentScene, particleType, emitterType, lifespan, numParticles, direction, gravity, deviation, particleMesh, emitter);
 	lua_pushlightuserdata(L, (void*)inst);
 	return 1;
 }
@@ -4666,15 +4593,6 @@ static int Polycore_SceneParticleEmitter_getEmitter(lua_State *L) {
 	return 1;
 }
 
-static int Polycore_SceneParticleEmitter_addParticleBody(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	SceneParticleEmitter *inst = (SceneParticleEmitter*)lua_topointer(L, 1);
-	luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
-	Entity * particleBody = (Entity *)lua_topointer(L, 2);
-	inst->addParticleBody(particleBody);
-	return 0;
-}
-
 static int Polycore_SceneParticleEmitter_getBaseMatrix(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	SceneParticleEmitter *inst = (SceneParticleEmitter*)lua_topointer(L, 1);
@@ -4691,6 +4609,13 @@ static int Polycore_SceneParticleEmitter_Update(lua_State *L) {
 	return 0;
 }
 
+static int Polycore_SceneParticleEmitter_Render(lua_State *L) {
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+	SceneParticleEmitter *inst = (SceneParticleEmitter*)lua_topointer(L, 1);
+	inst->Render();
+	return 0;
+}
+
 static int Polycore_delete_SceneParticleEmitter(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	SceneParticleEmitter *inst = (SceneParticleEmitter*)lua_topointer(L, 1);
@@ -4929,6 +4854,15 @@ static int Polycore_ParticleEmitter_enablePerlin(lua_State *L) {
 	return 0;
 }
 
+static int Polycore_ParticleEmitter_setPerlinModSize(lua_State *L) {
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+	ParticleEmitter *inst = (ParticleEmitter*)lua_topointer(L, 1);
+	luaL_checktype(L, 2, LUA_TNUMBER);
+	Number size = lua_tonumber(L, 2);
+	inst->setPerlinModSize(size);
+	return 0;
+}
+
 static int Polycore_ParticleEmitter_setBillboardMode(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	ParticleEmitter *inst = (ParticleEmitter*)lua_topointer(L, 1);
@@ -4980,20 +4914,11 @@ static int Polycore_ParticleEmitter_Trigger(lua_State *L) {
 }
 
 static int Polycore_ParticleEmitter_resetParticle(lua_State *L) {
-	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
-	ParticleEmitter *inst = (ParticleEmitter*)lua_topointer(L, 1);
-	luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
-	Particle * particle = (Particle *)lua_topointer(L, 2);
-	inst->resetParticle(particle);
-	return 0;
-}
-
-static int Polycore_ParticleEmitter_setPerlinModSize(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	ParticleEmitter *inst = (ParticleEmitter*)lua_topointer(L, 1);
 	luaL_checktype(L, 2, LUA_TNUMBER);
-	Number size = lua_tonumber(L, 2);
-	inst->setPerlinModSize(size);
+	unsigned int index = lua_tointeger(L, 2);
+	inst->resetParticle(index);
 	return 0;
 }
 
@@ -5006,13 +4931,23 @@ static int Polycore_ParticleEmitter_setParticleCount(lua_State *L) {
 	return 0;
 }
 
-static int Polycore_ParticleEmitter_addParticleBody(lua_State *L) {
+static int Polycore_ParticleEmitter_getParticleCount(lua_State *L) {
 	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
 	ParticleEmitter *inst = (ParticleEmitter*)lua_topointer(L, 1);
-	luaL_checktype(L, 2, LUA_TLIGHTUSERDATA);
-	Entity * particleBody = (Entity *)lua_topointer(L, 2);
-	inst->addParticleBody(particleBody);
-	return 0;
+	lua_pushinteger(L, inst->getParticleCount());
+	return 1;
+}
+
+static int Polycore_ParticleEmitter_getParticleSimulation(lua_State *L) {
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+	ParticleEmitter *inst = (ParticleEmitter*)lua_topointer(L, 1);
+	void *ptrRetVal = (void*)inst->getParticleSimulation();
+	if(ptrRetVal == NULL) {
+		lua_pushnil(L);
+	} else {
+		lua_pushlightuserdata(L, ptrRetVal);
+	}
+	return 1;
 }
 
 static int Polycore_ParticleEmitter_getBaseMatrix(lua_State *L) {
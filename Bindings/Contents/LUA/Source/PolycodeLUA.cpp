@@ -472,37 +472,26 @@ int luaopen_Polycode(lua_State *L) {
 		{"ObjectEntry", Polycore_ObjectEntry},
 		{"ObjectEntry_addChild", Polycore_ObjectEntry_addChild},
 		{"delete_ObjectEntry", Polycore_delete_ObjectEntry},
-		{"Particle_get_velVector", Polycore_Particle_get_velVector},
-		{"Particle_get_dirVector", Polycore_Particle_get_dirVector},
-		{"Particle_get_deviation", Polycore_Particle_get_deviation},
-		{"Particle_get_life", Polycore_Particle_get_life},
-		{"Particle_get_lifespan", Polycore_Particle_get_lifespan},
-		{"Particle_get_brightnessDeviation", Polycore_Particle_get_brightnessDeviation},
-		{"Particle_get_perlinPosX", Polycore_Particle_get_perlinPosX},
-		{"Particle_get_perlinPosY", Polycore_Particle_get_perlinPosY},
-		{"Particle_get_perlinPosZ", Polycore_Particle_get_perlinPosZ},
-		{"Particle_set_life", Polycore_Particle_set_life},
-		{"Particle_set_lifespan", Polycore_Particle_set_lifespan},
-		{"Particle_set_brightnessDeviation", Polycore_Particle_set_brightnessDeviation},
-		{"Particle_set_perlinPosX", Polycore_Particle_set_perlinPosX},
-		{"Particle_set_perlinPosY", Polycore_Particle_set_perlinPosY},
-		{"Particle_set_perlinPosZ", Polycore_Particle_set_perlinPosZ},
-		{"Particle", Polycore_Particle},
-		{"Particle_Reset", Polycore_Particle_Reset},
-		{"Particle_createSceneParticle", Polycore_Particle_createSceneParticle},
-		{"Particle_createScreenParticle", Polycore_Particle_createScreenParticle},
-		{"delete_Particle", Polycore_delete_Particle},
+		{"ParticleSimulation", Polycore_ParticleSimulation},
+		{"ParticleSimulation_setCount", Polycore_ParticleSimulation_setCount},
+		{"ParticleSimulation_getCount", Polycore_ParticleSimulation_getCount},
+		{"ParticleSimulation_integrate", Polycore_ParticleSimulation_integrate},
+		{"ParticleSimulation_setMeshTemplate", Polycore_ParticleSimulation_setMeshTemplate},
+		{"ParticleSimulation_buildQuadStream", Polycore_ParticleSimulation_buildQuadStream},
+		{"ParticleSimulation_buildMeshStream", Polycore_ParticleSimulation_buildMeshStream},
+		{"ParticleSimulation_getStreamVertexCount", Polycore_ParticleSimulation_getStreamVertexCount},
+		{"delete_ParticleSimulation", Polycore_delete_ParticleSimulation},
 		{"ScreenParticleEmitter", Polycore_ScreenParticleEmitter},
 		{"ScreenParticleEmitter_getEmitter", Polycore_ScreenParticleEmitter_getEmitter},
-		{"ScreenParticleEmitter_addParticleBody", Polycore_ScreenParticleEmitter_addParticleBody},
 		{"ScreenParticleEmitter_getBaseMatrix", Polycore_ScreenParticleEmitter_getBaseMatrix},
 		{"ScreenParticleEmitter_Update", Polycore_ScreenParticleEmitter_Update},
+		{"ScreenParticleEmitter_Render", Polycore_ScreenParticleEmitter_Render},
 		{"delete_ScreenParticleEmitter", Polycore_delete_ScreenParticleEmitter},
 		{"SceneParticleEmitter", Polycore_SceneParticleEmitter},
 		{"SceneParticleEmitter_getEmitter", Polycore_SceneParticleEmitter_getEmitter},
-		{"SceneParticleEmitter_addParticleBody", Polycore_SceneParticleEmitter_addParticleBody},
 		{"SceneParticleEmitter_getBaseMatrix", Polycore_SceneParticleEmitter_getBaseMatrix},
 		{"SceneParticleEmitter_Update", Polycore_SceneParticleEmitter_Update},
+		{"SceneParticleEmitter_Render", Polycore_SceneParticleEmitter_Render},
 		{"delete_SceneParticleEmitter", Polycore_delete_SceneParticleEmitter},
 		{"ParticleEmitter_get_particleSpeedMod", Polycore_ParticleEmitter_get_particleSpeedMod},
 		{"ParticleEmitter_get_brightnessDeviation", Polycore_ParticleEmitter_get_brightnessDeviation},
@@ -532,6 +521,7 @@ int luaopen_Polycode(lua_State *L) {
 		{"ParticleEmitter_setDepthTest", Polycore_ParticleEmitter_setDepthTest},
 		{"ParticleEmitter_setAlphaTest", Polycore_ParticleEmitter_setAlphaTest},
 		{"ParticleEmitter_enablePerlin", Polycore_ParticleEmitter_enablePerlin},
+		{"ParticleEmitter_setPerlinModSize", Polycore_ParticleEmitter_setPerlinModSize},
 		{"ParticleEmitter_setBillboardMode", Polycore_ParticleEmitter_setBillboardMode},
 		{"ParticleEmitter_enableEmitter", Polycore_ParticleEmitter_enableEmitter},
 		{"ParticleEmitter_emitterEnabled", Polycore_ParticleEmitter_emitterEnabled},
@@ -539,9 +529,9 @@ int luaopen_Polycode(lua_State *L) {
 		{"ParticleEmitter_setAllAtOnce", Polycore_ParticleEmitter_setAllAtOnce},
 		{"ParticleEmitter_Trigger", Polycore_ParticleEmitter_Trigger},
 		{"ParticleEmitter_resetParticle", Polycore_ParticleEmitter_resetParticle},
-		{"ParticleEmitter_setPerlinModSize", Polycore_ParticleEmitter_setPerlinModSize},
 		{"ParticleEmitter_setParticleCount", Polycore_ParticleEmitter_setParticleCount},
-		{"ParticleEmitter_addParticleBody", Polycore_ParticleEmitter_addParticleBody},
+		{"ParticleEmitter_getParticleCount", Polycore_ParticleEmitter_getParticleCount},
+		{"ParticleEmitter_getParticleSimulation", Polycore_ParticleEmitter_getParticleSimulation},
 		{"ParticleEmitter_getBaseMatrix", Polycore_ParticleEmitter_getBaseMatrix},
 		{"ParticleEmitter_updateEmitter", Polycore_ParticleEmitter_updateEmitter},
 		{"delete_ParticleEmitter", Polycore_delete_ParticleEmitter},
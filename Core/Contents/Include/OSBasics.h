@@ -30,7 +30,7 @@
 	#include <windows.h>
 #else
 	#include <dirent.h> 
-	#include <sys/types.h>s
+	#include <sys/types.h>
 	#include <sys/stat.h>
 #endif
 
@@ -77,6 +77,10 @@ class _PolyExport OSBasics {
 		static int close(OSFILE *file);
 		static size_t read( void * ptr, size_t size, size_t count, OSFILE * stream );	
 		static size_t write( const void * ptr, size_t size, size_t count, OSFILE * stream );
+		
+		// Number values are stored as doubles on disk, so files don't depend on POLYCODE_SINGLE_PRECISION
+		static size_t readNumbers(Number *values, size_t count, OSFILE *stream);
+		static void writeNumbers(const Number *values, size_t count, OSFILE *stream);
 		static int seek(OSFILE * stream, long int offset, int origin );
 		static long tell(OSFILE * stream);
 	
@@ -0,0 +1,179 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyVector3.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	class Camera;
+
+	/**
+	* Axis aligned bounding box.
+	*/
+	class _PolyExport AABB {
+		public:
+			AABB();
+			AABB(const Vector3 &min, const Vector3 &max);
+			
+			/**
+			* Returns true if the other box is completely inside this one.
+			*/
+			bool contains(const AABB &other) const;
+			
+			/**
+			* Returns true if the two boxes overlap.
+			*/
+			bool overlaps(const AABB &other) const;
+			
+			/**
+			* Returns the surface area of the box. Used as the cost metric when building the tree.
+			*/
+			Number getSurfaceArea() const;
+			
+			/**
+			* Returns the smallest box containing both boxes.
+			*/
+			static AABB merge(const AABB &a, const AABB &b);
+			
+			/**
+			* Minimum corner.
+			*/
+			Vector3 min;
+			
+			/**
+			* Maximum corner.
+			*/			
+			Vector3 max;
+	};
+
+	class _PolyExport AABBTreeNode {
+		public:
+			AABBTreeNode();
+			
+			bool isLeaf() const { return child1 == -1; }
+			
+			AABB aabb;
+			void *userData;
+			int parent;
+			int child1;
+			int child2;
+			int height;
+	};
+	
+	/**
+	* Dynamic bounding volume hierarchy. Every proxy is stored in the tree with a slightly enlarged ("fat") box, so small movements don't require the tree to be touched at all. When a proxy moves out of its fat box, it is reinserted and the tree is rebalanced with tree rotations, which keeps queries logarithmic in the number of proxies.
+	*/
+	class _PolyExport AABBTree {
+		public:
+			AABBTree();
+			~AABBTree();
+			
+			/**
+			* Adds a new proxy to the tree.
+			* @param aabb Bounding box of the proxy.
+			* @param userData Pointer returned by queries that hit the proxy.
+			* @return Proxy id.
+			*/
+			int createProxy(const AABB &aabb, void *userData);
+			
+			/**
+			* Removes a proxy from the tree.
+			* @param proxyID Proxy id returned by createProxy()
+			*/
+			void destroyProxy(int proxyID);
+			
+			/**
+			* Updates the bounding box of a proxy. The tree is only modified if the new box is no longer inside the proxy's fat box.
+			* @param proxyID Proxy id returned by createProxy()
+			* @param aabb New bounding box of the proxy.
+			* @return True if the proxy was reinserted.
+			*/
+			bool moveProxy(int proxyID, const AABB &aabb);
+			
+			/**
+			* Returns true if the id refers to a live proxy.
+			*/
+			bool isProxy(int proxyID) const;
+			
+			void *getUserData(int proxyID) const;
+			const AABB &getFatAABB(int proxyID) const;
+			
+			/**
+			* Returns the number of proxy slots. Proxy ids are always smaller than this.
+			*/
+			int getProxyCapacity() const;
+			
+			int getNumProxies() const;
+			
+			/**
+			* Returns the height of the tree.
+			*/
+			int getHeight() const;
+			
+			/**
+			* Appends the user data of all proxies whose fat boxes are inside or intersect the camera's frustum. The camera's frustum planes need to be built first.
+			* @param camera Camera to test against.
+			* @param results Vector to add the results to.
+			*/
+			void queryFrustum(Camera *camera, vector<void*> &results) const;
+			
+			/**
+			* Appends the user data of all proxies whose fat boxes overlap the specified box.
+			* @param aabb Box to test against.
+			* @param results Vector to add the results to.
+			*/
+			void queryAABB(const AABB &aabb, vector<void*> &results) const;
+			
+			/**
+			* Removes all proxies from the tree.
+			*/
+			void clear();
+			
+			/**
+			* Amount each proxy box is enlarged by, as a fraction of its size. Defaults to 0.1.
+			*/
+			Number proxyMargin;
+			
+		protected:
+		
+			int allocateNode();
+			void freeNode(int nodeID);
+			
+			void insertLeaf(int leaf);
+			void removeLeaf(int leaf);
+			void refitFrom(int nodeID);
+			int balance(int nodeID);
+			
+			void addSubtree(int nodeID, vector<void*> &results) const;
+		
+			vector<AABBTreeNode> nodes;
+			vector<int> freeNodes;
+			int root;
+			int numProxies;
+	};
+}
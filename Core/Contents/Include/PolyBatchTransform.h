@@ -0,0 +1,145 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyString.h"
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+
+namespace Polycode {
+
+	class AABB;
+
+	/**
+	* Transforms arrays of points, normals and bounding boxes in one call. Points and normals are read from and written to strided float arrays, so they can work directly on a Mesh vertex stream (use Mesh::VERTEX_STREAM_STRIDE as the stride and offset the pointer to the attribute). Input and output may be the same array if they use the same stride.
+	*
+	* Each function has a scalar, an SSE and an AVX implementation. The fastest one the CPU supports is picked the first time a transform is done, and can be overridden with setPath(). On CPUs other than x86 only the scalar path exists.
+	*/
+	class _PolyExport BatchTransform {
+		public:
+		
+			/**
+			* Transforms points by a matrix, including its translation.
+			* @param matrix Transform matrix.
+			* @param input First input point.
+			* @param inputStride Distance between two input points, in floats.
+			* @param output First output point.
+			* @param outputStride Distance between two output points, in floats.
+			* @param count Number of points.
+			*/
+			static void transformPoints(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count);
+			
+			/**
+			* Transforms each point by its own matrix, for example a blended skinning matrix.
+			* @param matrices One matrix per point.
+			* @param input First input point.
+			* @param inputStride Distance between two input points, in floats.
+			* @param output First output point.
+			* @param outputStride Distance between two output points, in floats.
+			* @param count Number of points.
+			*/
+			static void transformPoints(const Matrix4 *matrices, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count);
+			
+			/**
+			* Transforms directions by the rotation and scale part of a matrix. For matrices with non-uniform scale, pass the inverse transpose to get correct normals.
+			* @param matrix Transform matrix.
+			* @param input First input direction.
+			* @param inputStride Distance between two input directions, in floats.
+			* @param output First output direction.
+			* @param outputStride Distance between two output directions, in floats.
+			* @param count Number of directions.
+			* @param normalize If true, the results are normalized.
+			*/
+			static void transformNormals(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize);
+			
+			/**
+			* Transforms each direction by the rotation and scale part of its own matrix.
+			* @param matrices One matrix per direction.
+			* @param input First input direction.
+			* @param inputStride Distance between two input directions, in floats.
+			* @param output First output direction.
+			* @param outputStride Distance between two output directions, in floats.
+			* @param count Number of directions.
+			* @param normalize If true, the results are normalized.
+			*/
+			static void transformNormals(const Matrix4 *matrices, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize);
+			
+			/**
+			* Transforms bounding boxes and returns the axis aligned boxes enclosing the results.
+			* @param matrix Transform matrix.
+			* @param input Input boxes.
+			* @param output Output boxes. May be the same as input.
+			* @param count Number of boxes.
+			*/
+			static void transformAABBs(const Matrix4 &matrix, const AABB *input, AABB *output, unsigned int count);
+			
+			/**
+			* Transforms each bounding box by its own matrix.
+			* @param matrices One matrix per box.
+			* @param input Input boxes.
+			* @param output Output boxes. May be the same as input.
+			* @param count Number of boxes.
+			*/
+			static void transformAABBs(const Matrix4 *matrices, const AABB *input, AABB *output, unsigned int count);
+			
+			/**
+			* Returns the path the transforms use. See the PATH_* constants.
+			*/
+			static int getPath();
+			
+			/**
+			* Sets the path the transforms use, for example to compare them. A path the CPU does not support falls back to the best one it does.
+			* @param path Path to use. See the PATH_* constants.
+			*/
+			static void setPath(int path);
+			
+			/**
+			* Returns the fastest path the CPU supports.
+			*/
+			static int getBestPath();
+			
+			/**
+			* Returns the name of a path, for logging.
+			* @param path Path to name. See the PATH_* constants.
+			*/
+			static String getPathName(int path);
+			
+			/**
+			* Plain C++ path.
+			*/
+			static const int PATH_SCALAR = 0;
+			
+			/**
+			* SSE2 path, one element at a time.
+			*/
+			static const int PATH_SSE = 1;
+			
+			/**
+			* AVX path, two points or directions at a time. Only used for transforms by a single matrix. Per element matrices and bounding boxes use the SSE code, which is faster for them.
+			*/
+			static const int PATH_AVX = 2;
+			
+		protected:
+		
+			static int path;
+	};
+}
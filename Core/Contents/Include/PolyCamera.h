@@ -46,6 +46,13 @@ namespace Polycode {
 			
 			void buildFrustrumPlanes();
 			
+			/**
+			* Builds the frustum planes from explicit matrices instead of the renderer's current ones, for example to cull on another thread.
+			* @param projection Projection matrix.
+			* @param modelview Modelview matrix, usually the inverse of the camera's transform.
+			*/
+			void buildFrustrumPlanes(const Matrix4 &projection, const Matrix4 &modelview);
+			
 			/**
 			* Checks if the camera can see a sphere.
 			* @param pos Position of the sphere to check.
@@ -63,6 +70,20 @@ namespace Polycode {
 			*/					
 			bool canSee(SceneEntity *entity);
 			
+			/**
+			* Checks an axis aligned bounding box against the camera's frustrum.
+			* @param aabb Box to check, in world space.
+			* @return FRUSTRUM_OUTSIDE if the box can't be seen, FRUSTRUM_INSIDE if it is completely inside the frustrum or FRUSTRUM_INTERSECTS otherwise.
+			*/
+			int classifyAABB(const AABB &aabb);
+			
+			/**
+			* Checks if the camera can see an axis aligned bounding box.
+			* @param aabb Box to check, in world space.
+			* @return Returns true if the box is at least partially within the camera's frustrum.
+			*/
+			bool isAABBInFrustrum(const AABB &aabb);
+			
 			void setOrthoMode(bool mode);
 			bool getOrthoMode();
 			
@@ -111,6 +132,10 @@ namespace Polycode {
 			*/
 			void removePostFilter();
 			
+			static const int FRUSTRUM_OUTSIDE = 0;
+			static const int FRUSTRUM_INTERSECTS = 1;
+			static const int FRUSTRUM_INSIDE = 2;
+			
 		private:
 		
 			Number exposureLevel;
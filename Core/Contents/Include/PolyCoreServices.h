@@ -37,6 +37,7 @@ THE SOFTWARE.
 #include "PolyConfig.h"
 #include "PolyModule.h"
 #include "PolyBasics.h"
+#include "PolyJobSystem.h"
 
 #include <map>
 
@@ -64,6 +65,12 @@ namespace Polycode {
 			*/ 
 			static CoreServices *getInstance();		
 			static void setInstance(CoreServices *_instance);
+			
+			/**
+			* Makes getInstance() return the specified instance on the calling thread. The job system uses this so that jobs see the services of the thread that created it. Safe to call while other threads use getInstance().
+			* @param _instance Instance to use on the calling thread.
+			*/
+			static void setThreadInstance(CoreServices *_instance);
 			static CoreMutex *getRenderMutex();
 			
 			void setRenderer(Renderer *renderer);
@@ -157,6 +164,13 @@ namespace Polycode {
 			* @see Config
 			*/																													
 			Config *getConfig();
+			
+			/**
+			* Returns the job system, which is created with its worker threads the first time this is called. Requires the core to be set.
+			* @return Job system.
+			* @see JobSystem
+			*/
+			JobSystem *getJobSystem();
 		
 			~CoreServices();
 		
@@ -182,6 +196,7 @@ namespace Polycode {
 			ResourceManager *resourceManager;
 			SoundManager *soundManager;
 			FontManager *fontManager;
+			JobSystem *jobSystem;
 			Renderer *renderer;
 	};
 }
\ No newline at end of file
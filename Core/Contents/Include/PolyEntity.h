@@ -28,12 +28,18 @@
 #include "PolyQuaternion.h"
 #include "PolyColor.h"
 #include "PolyRenderer.h"
+#include "PolyAABBTree.h"
+#include "PolyTransformHierarchy.h"
 #include <vector>
 
 using std::vector;
 
 namespace Polycode {
 
+	class RenderQueue;
+	class RenderQueueItem;
+	class SpriteBatch;
+
 	class _PolyExport EntityProp {
 	public:
 		String propName;
@@ -53,7 +59,7 @@ namespace Polycode {
 			*/
 			virtual void Render(){};
 			/**
-			* Main update method. Override this to do your updates before the render cycle.
+			* Main update method. Override this to do your updates before the render cycle. In scenes with parallel updates enabled, this is called on a worker thread and has to follow the rules described for Scene::parallelUpdates.
 			*/			
 			virtual void Update(){};			
 
@@ -61,6 +67,37 @@ namespace Polycode {
 
 			void renderChildren();					
 		
+			/**
+			* Adds the entity and its children to a render queue instead of drawing them right away. Masked and depth only entities depend on what was drawn before them, so the queue is flushed and they are rendered immediately.
+			* @param queue Queue to add to.
+			*/
+			virtual void enqueueForRender(RenderQueue *queue);
+			
+			/**
+			* Fills in the material, texture and mesh the entity is drawn with, so that the render queue can sort by them and bind them itself. Returns false by default, in which case Render() is called and is expected to bind its own state.
+			* @param item Queue item to fill in.
+			* @return True if the render queue should bind the resources and call renderGeometry().
+			*/
+			virtual bool getRenderResources(RenderQueueItem *item) { return false; }
+			
+			/**
+			* Draws the entity's geometry after the render queue has bound the resources returned by getRenderResources().
+			*/
+			virtual void renderGeometry() { Render(); }
+			
+			/**
+			* Draws the entity and its children through a sprite batch. Entities that can add themselves to the batch (see addToSpriteBatch()) are merged with the quads drawn before them, everything else flushes the batch and is rendered as usual, so the drawing order is the same as with transformAndRender().
+			* @param batch Sprite batch to draw through.
+			*/
+			virtual void batchForRender(SpriteBatch *batch);
+			
+			/**
+			* Adds the entity's geometry to a sprite batch, transformed by the current modelview matrix. Returns false by default, in which case the batch is flushed and Render() is called.
+			* @param batch Sprite batch to add to.
+			* @return True if the entity was added to the batch.
+			*/
+			virtual bool addToSpriteBatch(SpriteBatch *batch) { return false; }
+		
 		
 			// ----------------------------------------------------------------------------------------------------------------
 			/** @name Matrix operations.
@@ -91,7 +128,7 @@ namespace Polycode {
 			Matrix4 getTransformMatrix();
 			
 			/** 
-			* Returns the entity's matrix multiplied by its parent's concatenated matrix. This, in effect, returns the entity's actual world transformation.
+			* Returns the entity's matrix multiplied by its parent's concatenated matrix. This, in effect, returns the entity's actual world transformation. The result is cached and only recomputed after the transform of this entity or one of its parents has changed.
 			@return Entity's concatenated matrix.
 			*/
 			Matrix4 getConcatenatedMatrix();
@@ -115,6 +152,28 @@ namespace Polycode {
 			*/						
 			void setTransformByMatrixPure(Matrix4 matrix);	
 			
+			/**
+			* Marks the cached world matrix of this entity and all of its children as out of date. This is called automatically when the transform matrix changes or the entity is reparented.
+			*/
+			void invalidateWorldMatrix();
+			
+			/**
+			* Moves the entity and all of its children into a flattened transform hierarchy. While in a hierarchy, the entity's transform matrix is mirrored into it and getConcatenatedMatrix() returns the world matrix computed by its linear update instead of walking up the parents. This is normally managed by the Scene.
+			@param hierarchy Hierarchy to use or NULL to go back to computing the world matrix from the parent entities.
+			@see Scene::enableTransformHierarchy()
+			*/
+			void setTransformHierarchy(TransformHierarchy *hierarchy);
+			
+			/**
+			* Returns the transform hierarchy the entity is in, or NULL.
+			*/
+			TransformHierarchy *getTransformHierarchy();
+			
+			/**
+			* Returns the id of the entity's node in its transform hierarchy, or -1.
+			*/
+			int getTransformNode();
+			
 			/** Returns the matrix for the entity looking at a location based on a location and an up vector.
 			* @param loc Location to look at.
 			* @param upVector Up vector.
@@ -143,7 +202,7 @@ namespace Polycode {
 			void addChild(Entity *newChild);
 			
 			/**
-			* Removes an entity from the entity's children.
+			* Removes an entity from the entity's children. The removed entity and its children leave the transform hierarchy of their old parent.
 			@param entityToRemove Entity to be removed.
 			*/
 			void removeChild(Entity *entityToRemove);
@@ -159,6 +218,17 @@ namespace Polycode {
 			@return Parent entity of this entity.
 			*/
 			Entity *getParentEntity();
+			
+			/**
+			* Returns the number of children of the entity.
+			*/
+			unsigned int getNumChildren();
+			
+			/**
+			* Returns the child at the specified index.
+			@param index Index of the child.
+			*/
+			Entity *getChildAtIndex(unsigned int index);
 				
 			//@}
 			// ----------------------------------------------------------------------------------------------------------------
@@ -443,6 +513,22 @@ namespace Polycode {
 			*/
 			void setBBoxRadius(Number rad);		
 			
+			/**
+			* Returns true if the entity has a bounding box or bounding box radius of its own and can be frustum culled.
+			*/
+			bool hasCullingBounds();
+			
+			/**
+			* Returns the entity's own bounding box transformed into world space. Children are not included.
+			* @return World space bounding box.
+			*/
+			AABB getWorldAABB();
+			
+			/**
+			* Returns true if the entity's world space bounds may have changed since the last call. Used by the scene to keep its culling tree up to date.
+			*/
+			bool updateCullingBounds();
+			
 					
 
 			//@}			
@@ -560,8 +646,23 @@ namespace Polycode {
 			Vector3 bBox;			
 			bool ignoreParentMatrix;
 			bool isMask;
+			
+			/**
+			* Culling state, maintained by the Scene the entity is in. If renderCulled is true, the entity itself is not rendered. If subtreeCulled is true, neither the entity nor any of its children are rendered.
+			*/
+			bool renderCulled;
+			bool subtreeCulled;
+			
+			/**
+			* Id of the entity's proxy in the scene's culling tree, or -1.
+			*/
+			int cullingProxy;
+			
 		
 		protected:
+		
+			void applyRenderState();
+			
 			vector<Entity*> children;
 
 			Vector3 childCenter;
@@ -576,6 +677,16 @@ namespace Polycode {
 			bool matrixDirty;
 			Matrix4 transformMatrix;
 		
+			bool worldMatrixDirty;
+			Matrix4 worldMatrix;
+			
+			TransformHierarchy *transformHierarchy;
+			int transformNode;
+		
+			bool worldBoundsDirty;
+			Vector3 cullingBBox;
+			Number cullingBBoxRadius;
+		
 			Number matrixAdj;
 			Number pitch;
 			Number yaw;			
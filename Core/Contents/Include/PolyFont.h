@@ -28,6 +28,8 @@ THE SOFTWARE.
 #include "ft2build.h"
 #include FT_FREETYPE_H
 #include "OSBasics.h"
+#include "PolyGlyphCache.h"
+#include <map>
 
 using namespace std;
 
@@ -40,7 +42,16 @@ namespace Polycode {
 			
 			FT_Face getFace();
 			bool isValid();
+			
+			/**
+			* Returns the glyph cache for a pixel size and antialiasing mode, creating it on first use. The cache is owned by the font.
+			* @param size Pixel size.
+			* @param monochrome If true, returns the cache for glyphs rendered without antialiasing.
+			*/
+			GlyphCache *getGlyphCache(int size, bool monochrome);
 		private:
+			std::map<int, GlyphCache*> glyphCaches;
+
 			unsigned char *buffer;
 			bool valid;
 			FT_Face ftFace;
@@ -105,8 +105,6 @@ namespace Polycode {
 		void translate3D(Number x, Number y, Number z);
 		void scale3D(Vector3 *scale);
 		
-		Matrix4 getProjectionMatrix();
-		Matrix4 getModelviewMatrix();		
 		void setModelviewMatrix(Matrix4 m);	
 		void multModelviewMatrix(Matrix4 m);
 		
@@ -132,10 +130,9 @@ namespace Polycode {
 				
 		GLuint defaultFramebuffer, colorRenderbuffer;		
 		
-		Number nearPlane;
-		Number farPlane;
+		void loadProjectionMatrix();
 		
-		GLfloat sceneProjectionMatrix[16];
+		Matrix4 sceneProjectionMatrix;
 		
 		
 	};
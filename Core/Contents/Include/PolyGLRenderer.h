@@ -46,8 +46,19 @@ THE SOFTWARE.
 #include <GL/gl.h>	
 #include <GL/glu.h>	
 #include <GL/glext.h>
+#ifdef _WINDOWS
 #include <GL/wglext.h>
 #endif
+#endif
+
+// fixed function matrix calls matching the precision of Number
+#ifdef POLYCODE_SINGLE_PRECISION
+	#define glLoadMatrixNumber glLoadMatrixf
+	#define glMultMatrixNumber glMultMatrixf
+#else
+	#define glLoadMatrixNumber glLoadMatrixd
+	#define glMultMatrixNumber glMultMatrixd
+#endif
 /*
 #ifdef _WINDOWS 
 #define GL_EXT_framebuffer_object           1
@@ -137,10 +148,17 @@ namespace Polycode {
 		void cullFrontFaces(bool val);
 				
 		void pushRenderDataArray(RenderDataArray *array);
+		void pushInterleavedRenderDataArray(RenderDataArray *array, bool useColors);
 		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
+		void updateRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array);
 		RenderDataArray *createRenderDataArray(int arrayType);
 		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
 		void drawArrays(int drawType);		
+		
+		/**
+		* Draws the pushed arrays once per instance. If GL_ARB_instanced_arrays and GL_ARB_draw_instanced are available and the bound shader program declares an "instanceMatrix" mat4 attribute (and optionally an "instanceColor" vec4 attribute), all instances are drawn with a single instanced call. Otherwise the arrays stay bound and are drawn once per instance transform.
+		*/
+		void drawArraysInstanced(int drawType, const Matrix4 *transforms, const Color *colors, unsigned int numInstances);
 				
 		void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f);
 		void _setOrthoMode();
@@ -180,8 +198,6 @@ namespace Polycode {
 		void translate3D(Number x, Number y, Number z);
 		void scale3D(Vector3 *scale);
 		
-		Matrix4 getProjectionMatrix();
-		Matrix4 getModelviewMatrix();		
 		void setModelviewMatrix(Matrix4 m);	
 		void multModelviewMatrix(Matrix4 m);
 		
@@ -209,13 +225,26 @@ namespace Polycode {
 		
 	protected:
 
+		void updateIndexedRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array);
+		
+		void loadProjectionMatrix();
+		
+		GLenum getDrawMode(int drawType);
+		void drawPushedArrays(GLenum mode);
+		void releasePushedArrays();
+		
+		bool supportsInstancedArrays();
+		bool drawInstancedArrays(GLenum mode, const Matrix4 *transforms, const Color *colors, unsigned int numInstances);
+		
+		int instancedArraysSupport;
+		vector<GLfloat> instanceData;
 		
-		Number nearPlane;
-		Number farPlane;
+		bool textureMatrixLoaded;
 		
 		int verticesToDraw;
+		RenderDataArray *indicesToDraw;
 		
-		GLdouble sceneProjectionMatrix[16];
+		Matrix4 sceneProjectionMatrix;
 	
 		
 	};
@@ -58,8 +58,15 @@ namespace Polycode {
 			
 			void setTextureData(char *data);
 			
+			/**
+			* Returns true if the OpenGL driver can use BC1 and BC3 compressed textures.
+			*/
+			static bool supportsCompression();
+			
 		private:
 			
+			static int compressionSupport;
+			
 			bool glTextureLoaded;
 			GLuint glTextureType;
 			int filteringMode;
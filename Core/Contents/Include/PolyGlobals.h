@@ -29,6 +29,11 @@ THE SOFTWARE.
 
 #define COMPILE_GL_RENDERER
 
+// Use single precision Number values (and with them Vector3, Quaternion and Matrix4) instead of doubles.
+// Matrix4 then uses SSE when the compiler targets it, unless POLYCODE_NO_SSE is defined as well.
+// Can also be defined in the build settings. Everything linking against the library must use the same setting.
+//#define POLYCODE_SINGLE_PRECISION
+
 #ifdef _WINDOWS
 	#define WIN32_LEAN_AND_MEAN
 
@@ -84,7 +89,15 @@ THE SOFTWARE.
 #define PACKET_TYPE_CLIENT_READY 2
 #define PACKET_TYPE_DISONNECT 3
 #define PACKET_TYPE_CLIENT_DATA 4
+#define PACKET_TYPE_WORLD_SNAPSHOT 5
 
 
-typedef double Number;
+#ifdef POLYCODE_SINGLE_PRECISION
+	typedef float Number;
+	#if !defined(POLYCODE_NO_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+		#define POLYCODE_USE_SSE
+	#endif
+#else
+	typedef double Number;
+#endif
 
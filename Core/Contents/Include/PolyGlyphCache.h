@@ -0,0 +1,163 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+#include "PolyString.h"
+#include "PolyGlobals.h"
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include <map>
+#include <vector>
+
+using std::map;
+using std::vector;
+using std::pair;
+
+namespace Polycode {
+
+	/**
+	* Metrics and atlas location of a cached glyph.
+	*/
+	class _PolyExport GlyphInfo {
+		public:
+			GlyphInfo();
+			
+			FT_UInt glyphIndex;
+			int advance;
+			int bitmapLeft;
+			int bitmapTop;
+			int width;
+			int rows;
+			
+			/**
+			* Position of the glyph's coverage bitmap in the atlas.
+			*/
+			int atlasX;
+			int atlasY;
+	};
+	
+	/**
+	* A glyph placed by GlyphCache::layoutText().
+	*/
+	class _PolyExport GlyphPlacement {
+		public:
+			/**
+			* Pen position of the glyph.
+			*/
+			int penX;
+			
+			/**
+			* Cached glyph. Glyphs stay valid for the life of the cache.
+			*/
+			const GlyphInfo *glyph;
+	};
+	
+	/**
+	* Kerning aware layout of a string, as computed by GlyphCache::layoutText().
+	*/
+	class _PolyExport TextLayout {
+		public:
+			TextLayout();
+			
+			vector<GlyphPlacement> glyphs;
+			
+			/**
+			* Final pen position, i.e. the width of the text.
+			*/
+			int width;
+			
+			/**
+			* Largest distance from the baseline to the top of a glyph.
+			*/
+			int maxTop;
+	};
+
+	/**
+	* Glyph cache for one font face at one pixel size and antialiasing mode. Glyphs are rasterized by FreeType the first time they are used. Their metrics are kept in the cache and their coverage bitmaps are packed into a single, growable 8 bit atlas. Kerning pairs are cached as well, so laying out a string that only uses known glyphs doesn't call into FreeType at all.
+	*/
+	class _PolyExport GlyphCache {
+		public:
+			/**
+			* Constructor.
+			* @param face FreeType face to rasterize glyphs from.
+			* @param size Pixel size.
+			* @param monochrome If true, glyphs are rendered without antialiasing and their coverage is either 0 or 255.
+			*/
+			GlyphCache(FT_Face face, int size, bool monochrome);
+			~GlyphCache();
+			
+			/**
+			* Returns the glyph for a character, rasterizing it if it isn't cached yet.
+			*/
+			const GlyphInfo *getGlyph(unsigned int charCode);
+			
+			/**
+			* Returns the kerning between two glyphs in pixels.
+			*/
+			int getKerning(FT_UInt leftGlyph, FT_UInt rightGlyph);
+			
+			/**
+			* Lays out a string. Tabs are replaced by four spaces.
+			* @param text Text to lay out.
+			* @param layout Layout to fill in.
+			*/
+			void layoutText(const String &text, TextLayout *layout);
+			
+			/**
+			* Returns the width of a string in pixels.
+			*/
+			int getTextWidth(const String &text);
+			
+			/**
+			* Returns the coverage bitmap atlas. One byte per pixel, getAtlasWidth() bytes per row.
+			*/
+			const unsigned char *getAtlasData();
+			int getAtlasWidth();
+			int getAtlasHeight();
+			
+			int getSize();
+			bool isMonochrome();
+			
+			static const int INITIAL_ATLAS_SIZE = 256;
+			
+		protected:
+		
+			void addToAtlas(GlyphInfo *info, FT_Bitmap *bitmap);
+			void resizeAtlas(int newWidth, int newHeight);
+		
+			FT_Face face;
+			int size;
+			bool monochrome;
+			bool hasKerning;
+			
+			map<unsigned int, GlyphInfo> glyphs;
+			map<pair<FT_UInt, FT_UInt>, int> kerningPairs;
+			
+			vector<unsigned char> atlas;
+			int atlasWidth;
+			int atlasHeight;
+			int shelfX;
+			int shelfY;
+			int shelfHeight;
+	};
+}
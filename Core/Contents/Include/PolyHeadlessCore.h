@@ -0,0 +1,182 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyString.h"
+#include "PolyGlobals.h"
+#include "PolyCore.h"
+#include "PolyRectangle.h"
+#include "PolyNullRenderer.h"
+#include <vector>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef POLYCODE_OSMESA
+#include <GL/osmesa.h>
+#include "PolyGLRenderer.h"
+#endif
+
+using std::vector;
+
+namespace Polycode {
+
+	class _PolyExport HeadlessMutex : public CoreMutex {
+	public:
+		pthread_mutex_t pMutex;
+	};
+	
+	class HeadlessEvent {
+	public:
+		int eventGroup;
+		int eventCode;
+		int mouseX;
+		int mouseY;
+		PolyKEY keyCode;
+		wchar_t unicodeChar;
+		char mouseButton;
+		static const int INPUT_EVENT = 0;
+	};
+	
+	/**
+	* A core without a window. The headless core runs the full update loop (timers, tweens, scenes, physics) using a monotonic clock and renders with a NullRenderer, or into an offscreen OpenGL context if the framework was built with POLYCODE_OSMESA. Input can be injected from code and is delivered to CoreInput on the next Update(), just like events from a window system would be. Intended for dedicated servers and automated benchmarks.
+	*/
+	class _PolyExport HeadlessCore : public Core {
+	public:
+		
+		/**
+		* Constructor.
+		* @param xRes Horizontal resolution of the renderer.
+		* @param yRes Vertical resolution of the renderer.
+		* @param fullScreen Ignored, kept for compatibility with the other cores.
+		* @param aaLevel Ignored, kept for compatibility with the other cores.
+		* @param frameRate Frame rate that the core will update at. If 0, the core does not sleep between frames.
+		* @param rendererType Renderer to use. Possible values are HeadlessCore::RENDERER_NULL and HeadlessCore::RENDERER_OFFSCREEN.
+		*/
+		HeadlessCore(int xRes, int yRes, bool fullScreen, int aaLevel, int frameRate, int rendererType = RENDERER_NULL);
+		virtual ~HeadlessCore();
+		
+		unsigned int getTicks();
+		bool Update();
+		
+		void setVideoMode(int xRes, int yRes, bool fullScreen, int aaLevel);
+		void resizeTo(int xRes, int yRes);
+		vector<Rectangle> getVideoModes();
+		
+		void setCursor(int cursorType);
+		
+		void createThread(Threaded *target);
+		void lockMutex(CoreMutex *mutex);
+		void unlockMutex(CoreMutex *mutex);
+		CoreMutex *createMutex();
+		
+		/**
+		* Copies the string to an internal clipboard. There is no system clipboard without a window system.
+		*/
+		void copyStringToClipboard(String str);
+		
+		/**
+		* Returns the contents of the internal clipboard.
+		*/
+		String getClipboardString();
+		
+		void createFolder(String folderPath);
+		void copyDiskItem(String itemPath, String destItemPath);
+		void moveDiskItem(String itemPath, String destItemPath);
+		void removeDiskItem(String itemPath);
+		
+		/**
+		* There is no user to pick a folder, always returns an empty string.
+		*/
+		String openFolderPicker();
+		
+		/**
+		* There is no user to pick files, always returns an empty vector.
+		*/
+		vector<string> openFilePicker(vector<CoreFileExtension> extensions, bool allowMultiple);
+		
+		/**
+		* Queues a mouse move. Can be called from any thread, the event is delivered on the next Update().
+		* @param x New horizontal mouse position.
+		* @param y New vertical mouse position.
+		*/
+		void injectMouseMove(int x, int y);
+		
+		/**
+		* Queues a mouse button press or release. Can be called from any thread, the event is delivered on the next Update().
+		* @param mouseButton Mouse button. See CoreInput for button codes.
+		* @param down True for a press, false for a release.
+		*/
+		void injectMouseButton(int mouseButton, bool down);
+		
+		/**
+		* Queues a mouse wheel movement. Can be called from any thread, the event is delivered on the next Update().
+		* @param up True to scroll up, false to scroll down.
+		*/
+		void injectMouseWheel(bool up);
+		
+		/**
+		* Queues a key press or release. Can be called from any thread, the event is delivered on the next Update().
+		* @param keyCode Key code.
+		* @param unicodeChar Unicode character produced by the key.
+		* @param down True for a press, false for a release.
+		*/
+		void injectKey(PolyKEY keyCode, wchar_t unicodeChar, bool down);
+		
+		/**
+		* Returns the renderer type the core was created with. If the offscreen renderer was requested but is not available, this returns RENDERER_NULL.
+		*/
+		int getRendererType() { return rendererType; }
+		
+		/**
+		* Null renderer, nothing is drawn. See NullRenderer.
+		*/
+		static const int RENDERER_NULL = 0;
+		
+		/**
+		* OpenGL renderer drawing into an offscreen buffer. Requires a POLYCODE_OSMESA build.
+		*/
+		static const int RENDERER_OFFSCREEN = 1;
+		
+		void checkEvents();
+		
+		int lastMouseX;
+		int lastMouseY;
+		CoreMutex *eventMutex;
+		vector<HeadlessEvent> headlessEvents;
+		
+	private:
+		
+		void queueEvent(const HeadlessEvent &event);
+		bool createOffscreenContext();
+		void destroyOffscreenContext();
+		
+		int rendererType;
+		bool sleepBetweenFrames;
+		String clipboardString;
+		struct timespec initTime;
+		
+#ifdef POLYCODE_OSMESA
+		OSMesaContext offscreenContext;
+		unsigned char *offscreenBuffer;
+#endif
+	};
+}
@@ -27,10 +27,12 @@ THE SOFTWARE.
 #include "PolyColor.h"
 #include "PolyPerlin.h"
 #include <string>
+#include <vector>
 #include <math.h>
 #include "OSBasics.h"
 
 using std::string;
+using std::vector;
 
 namespace Polycode {
 
@@ -202,6 +204,38 @@ namespace Polycode {
 			
 			void writeBMP(String fileName);
 			
+			/**
+			* Creates the next smaller mipmap level of the image. The new image is half as wide and high (but at least 1 pixel) and has the same type. Color is filtered in linear space and weighted by alpha, so edges of transparent areas do not darken.
+			* @param filter Filter to downsample with. Can be MIPMAP_FILTER_BOX or MIPMAP_FILTER_TENT.
+			* @param gammaCorrect If true, the color values are treated as sRGB and filtered in linear space.
+			* @return The new image. Must be deleted by the caller.
+			*/
+			Image *createMipmap(int filter = MIPMAP_FILTER_BOX, bool gammaCorrect = true);
+			
+			/**
+			* Creates all mipmap levels below the image down to 1x1 pixels. Each level is filtered from the previous one.
+			* @param filter Filter to downsample with. Can be MIPMAP_FILTER_BOX or MIPMAP_FILTER_TENT.
+			* @param gammaCorrect If true, the color values are treated as sRGB and filtered in linear space.
+			* @return The mipmap levels, largest first. The images must be deleted by the caller.
+			*/
+			vector<Image*> createMipmapChain(int filter = MIPMAP_FILTER_BOX, bool gammaCorrect = true);
+			
+			/**
+			* Encodes the image into 4x4 pixel blocks of a block compression format. BC1 (DXT1) stores 4 bits per pixel with 1 bit alpha, BC3 (DXT5) stores 8 bits per pixel with full alpha. Images whose sizes are not multiples of 4 are padded by repeating their edge pixels.
+			* @param format Compression format. Can be COMPRESSION_BC1 or COMPRESSION_BC3.
+			* @param dataSize Receives the size of the compressed data in bytes.
+			* @return The compressed blocks in row order or NULL if the format is not supported. Must be freed by the caller with free().
+			*/
+			char *createCompressedData(int format, unsigned int *dataSize);
+			
+			/**
+			* Returns the size of block compressed data in bytes.
+			* @param width Width of the image.
+			* @param height Height of the image.
+			* @param format Compression format. Can be COMPRESSION_BC1 or COMPRESSION_BC3.
+			*/
+			static unsigned int getCompressedDataSize(unsigned int width, unsigned int height, int format);
+			
 			/**
 			* Returns the width of the image.
 			*/			
@@ -220,10 +254,21 @@ namespace Polycode {
 		
 			static const int IMAGE_RGB = 0;
 			static const int IMAGE_RGBA = 1;
+			
+			static const int MIPMAP_FILTER_BOX = 0;
+			static const int MIPMAP_FILTER_TENT = 1;
+			
+			static const int COMPRESSION_NONE = 0;
+			static const int COMPRESSION_BC1 = 1;
+			static const int COMPRESSION_BC3 = 2;
 		
 		protected:
 		
 			void setPixelType(int type);		
+			
+			void getBlock(unsigned int blockX, unsigned int blockY, unsigned char *block);
+			static void encodeColorBlock(const unsigned char *block, bool allowTransparency, unsigned char *dest);
+			static void encodeAlphaBlock(const unsigned char *block, unsigned char *dest);
 		
 		int imageType;
 		int pixelSize;
@@ -0,0 +1,197 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include <stddef.h>
+#include <vector>
+#include <deque>
+
+using std::vector;
+using std::deque;
+
+namespace Polycode {
+
+	class Core;
+	class CoreMutex;
+	class CoreServices;
+	class JobWorker;
+	class JobWakeup;
+	
+	typedef void (*JobFunction)(void *data);
+
+	/**
+	* Counts unfinished jobs. Every job submitted with a counter increments it and decrements it once the job has finished, so a counter can be used to wait for a whole group of jobs.
+	* @see JobSystem::wait()
+	*/
+	class _PolyExport JobCounter {
+		public:
+			JobCounter();
+			
+			/**
+			* Returns true if all jobs submitted with this counter have finished.
+			*/
+			bool isDone();
+			
+			volatile int count;
+	};
+
+	/**
+	* A unit of work for the JobSystem. Jobs are owned by the caller and need to stay alive until they have finished.
+	*/
+	class _PolyExport Job {
+		public:
+			Job();
+			Job(JobFunction function, void *data);
+			
+			/**
+			* Clears the job's dependencies so that it can be submitted again. Only call this when the job is not queued or running.
+			*/
+			void reset();
+			
+			/**
+			* Function to run. It is called with data as its only argument.
+			*/
+			JobFunction function;
+			void *data;
+			
+			/**
+			* Number of jobs that need to finish before this one can run, plus one until it is submitted. Maintained by the job system.
+			*/
+			volatile int pendingDependencies;
+			
+			/**
+			* Jobs waiting for this one. Maintained by the job system.
+			*/
+			vector<Job*> dependents;
+			
+			/**
+			* Counter the job was submitted with, or NULL.
+			*/
+			JobCounter *counter;
+	};
+
+	/**
+	* Work-stealing job system with a fixed pool of worker threads. Every worker and the thread that created the job system own a queue. Jobs submitted from a thread go to the back of its own queue and are taken from there, while idle threads steal from the front of the other queues, so related jobs tend to stay on one thread and large batches spread out by themselves. Waiting for a counter runs queued jobs on the waiting thread instead of blocking it. Idle workers sleep until a job is queued.
+	*
+	* Thread safety: submit(), addDependency() and wait() may only be called from the thread that created the job system or from inside a running job. Jobs run concurrently with each other and must only touch data that no other job running at the same time writes. CoreServices::getInstance() returns the creating thread's instance inside jobs, but the managers it provides are not thread safe and must only be read from jobs.
+	*/
+	class _PolyExport JobSystem {
+		public:
+			/**
+			* Creates the job system and starts the worker threads.
+			* @param core Core used to create threads and mutexes.
+			* @param numWorkers Number of worker threads. If negative, one less than the number of hardware threads is used, since the creating thread also runs jobs while it waits.
+			*/
+			JobSystem(Core *core, int numWorkers = -1);
+			~JobSystem();
+			
+			/**
+			* Makes a job wait for another job to finish before it runs. Both jobs must not have been submitted yet.
+			* @param job Job that has to wait.
+			* @param dependency Job that has to finish first.
+			*/
+			void addDependency(Job *job, Job *dependency);
+			
+			/**
+			* Queues a job. A job with unfinished dependencies is queued once the last of them finishes.
+			* @param job Job to run.
+			* @param counter Optional counter to track the job with.
+			*/
+			void submit(Job *job, JobCounter *counter = NULL);
+			
+			/**
+			* Runs queued jobs on the calling thread until all jobs submitted with the counter have finished.
+			* @param counter Counter to wait for.
+			*/
+			void wait(JobCounter *counter);
+			
+			/**
+			* Runs one queued job on the calling thread.
+			* @return False if there was no job to run.
+			*/
+			bool runPendingJob();
+			
+			/**
+			* Returns the number of threads that run jobs, including the creating thread.
+			*/
+			int getNumThreads() const;
+			
+			/**
+			* Returns the number of hardware threads of the machine.
+			*/
+			static int getNumHardwareThreads();
+			
+			/**
+			* Atomically adds to an integer and returns the new value. This is a full memory barrier.
+			*/
+			static int atomicAdd(volatile int *value, int amount);
+			
+			/**
+			* Atomically replaces an integer if it still has the expected value. This is a full memory barrier.
+			* @return The value before the operation.
+			*/
+			static int atomicCompareAndSwap(volatile int *value, int expected, int newValue);
+			
+			/**
+			* Gives up the rest of the calling thread's time slice.
+			*/
+			static void yieldThread();
+			
+			/**
+			* Called by the worker threads when they start. Used internally.
+			*/
+			void initWorkerThread(int queueIndex);
+			
+			/**
+			* Called by the worker threads when they stop. Used internally.
+			*/
+			void finishWorkerThread();
+			
+			/**
+			* Blocks an idle worker thread until a job is queued or the worker is stopped. Used internally.
+			*/
+			void waitForJob(JobWorker *worker);
+			
+		protected:
+		
+			int getQueueIndex() const;
+			void pushJob(Job *job);
+			Job *popJob();
+			void runJob(Job *job);
+		
+			Core *core;
+			CoreServices *services;
+			
+			vector<deque<Job*> > queues;
+			vector<CoreMutex*> queueMutexes;
+			volatile int numQueuedJobs;
+			
+			JobWakeup *wakeup;
+			volatile int numSleepingWorkers;
+			
+			vector<JobWorker*> workers;
+			CoreMutex *workerMutex;
+			volatile int numStartedWorkers;
+			volatile int numStoppedWorkers;
+	};
+}
@@ -39,6 +39,7 @@ using namespace std;
 namespace Polycode {
 	
 	class Texture;
+	class TextureAtlas;
 	class SceneRenderTexture;
 	
 	/**
@@ -60,6 +61,18 @@ namespace Polycode {
 			Texture *createTextureFromImage(Image *image, bool clamp=true);
 			Texture *createTextureFromFile(String fileName, bool clamp=true);
 			void deleteTexture(Texture *texture);
+			
+			/**
+			* Registers a texture atlas. createTextureFromFile() returns the atlas region for files packed into a registered atlas instead of loading them into a separate texture. The atlas is not owned by the material manager.
+			* @param atlas Atlas to register.
+			*/
+			void addTextureAtlas(TextureAtlas *atlas);
+			
+			/**
+			* Unregisters a texture atlas.
+			* @param atlas Atlas to unregister.
+			*/
+			void removeTextureAtlas(TextureAtlas *atlas);
 		
 			void reloadTextures();
 			
@@ -80,10 +93,34 @@ namespace Polycode {
 			Material *materialFromXMLNode(TiXmlNode *node);
 			Shader *setShaderFromXMLNode(TiXmlNode *node);
 			Shader *createShaderFromXMLNode(TiXmlNode *node);
+			
+			/**
+			* If true, textures created from images and files get a mipmap chain generated on the CPU. Defaults to false.
+			*/
+			bool generateMipmaps;
+			
+			/**
+			* Filter used to generate mipmaps. Can be Image::MIPMAP_FILTER_BOX or Image::MIPMAP_FILTER_TENT. Defaults to Image::MIPMAP_FILTER_BOX.
+			*/
+			int mipmapFilter;
+			
+			/**
+			* If true, mipmaps are filtered in linear space, treating the image colors as sRGB. Defaults to true.
+			*/
+			bool gammaCorrectMipmaps;
+			
+			/**
+			* Block compression format for textures created from images and files. Can be Image::COMPRESSION_NONE, Image::COMPRESSION_BC1 or Image::COMPRESSION_BC3. Defaults to Image::COMPRESSION_NONE.
+			*/
+			int textureCompression;
 		
 		private:
+		
+			void createTextureLevels(Texture *texture, Image *image);
+			
 			vector<Texture*> textures;
 			vector<Material*> materials;
+			vector<TextureAtlas*> atlases;
 		
 			vector <PolycodeShaderModule*> shaderModules;
 	};
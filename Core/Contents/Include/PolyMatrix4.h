@@ -26,6 +26,10 @@ THE SOFTWARE.
 #include "PolyVector3.h"
 #include <string.h>
 
+#ifdef POLYCODE_USE_SSE
+	#include <xmmintrin.h>
+#endif
+
 namespace Polycode {
 
 	class Vector3;
@@ -92,9 +96,18 @@ namespace Polycode {
 			* @param v2 Vector to rotate.
 			*/			
 			inline Vector3 rotateVector(const Vector3 &v2) {
+#ifdef POLYCODE_USE_SSE
+				__m128 r = _mm_mul_ps(_mm_set1_ps(v2.x), _mm_loadu_ps(m[0]));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v2.y), _mm_loadu_ps(m[1])));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v2.z), _mm_loadu_ps(m[2])));
+				Number v[4];
+				_mm_storeu_ps(v, r);
+				return Vector3(v[0], v[1], v[2]);
+#else
 				return Vector3(v2.x*m[0][0] + v2.y*m[1][0] + v2.z*m[2][0],
 								v2.x*m[0][1] + v2.y*m[1][1] + v2.z*m[2][1],
 								v2.x*m[0][2] + v2.y*m[1][2] + v2.z*m[2][2]);
+#endif
 			}
 			
 			/**
@@ -118,9 +131,19 @@ namespace Polycode {
 
 			inline Vector3 operator * ( const Vector3 &v2 ) const
 			{
+#ifdef POLYCODE_USE_SSE
+				__m128 r = _mm_mul_ps(_mm_set1_ps(v2.x), _mm_loadu_ps(m[0]));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v2.y), _mm_loadu_ps(m[1])));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v2.z), _mm_loadu_ps(m[2])));
+				r = _mm_add_ps(r, _mm_loadu_ps(m[3]));
+				Number v[4];
+				_mm_storeu_ps(v, r);
+				return Vector3(v[0], v[1], v[2]);
+#else
 				return Vector3(v2.x*m[0][0] + v2.y*m[1][0] + v2.z*m[2][0] + m[3][0],
 								v2.x*m[0][1] + v2.y*m[1][1] + v2.z*m[2][1] + m[3][1],
 								v2.x*m[0][2] + v2.y*m[1][2] + v2.z*m[2][2] + m[3][2]);
+#endif
 			}			
 			
 			inline Number* operator [] ( int row ) { return m[row];}
@@ -153,6 +176,21 @@ namespace Polycode {
 			
 			inline Matrix4 operator * (const Matrix4 &m2) const {
            Matrix4 r;
+#ifdef POLYCODE_USE_SSE
+			// each row of the result is a combination of the rows of m2. The matrix is not guaranteed
+			// to be 16 byte aligned, so the loads and stores are unaligned.
+			__m128 row0 = _mm_loadu_ps(m2.m[0]);
+			__m128 row1 = _mm_loadu_ps(m2.m[1]);
+			__m128 row2 = _mm_loadu_ps(m2.m[2]);
+			__m128 row3 = _mm_loadu_ps(m2.m[3]);
+			for(int i=0; i < 4; i++) {
+				__m128 rowResult = _mm_mul_ps(_mm_set1_ps(m[i][0]), row0);
+				rowResult = _mm_add_ps(rowResult, _mm_mul_ps(_mm_set1_ps(m[i][1]), row1));
+				rowResult = _mm_add_ps(rowResult, _mm_mul_ps(_mm_set1_ps(m[i][2]), row2));
+				rowResult = _mm_add_ps(rowResult, _mm_mul_ps(_mm_set1_ps(m[i][3]), row3));
+				_mm_storeu_ps(r.m[i], rowResult);
+			}
+#else
             r.m[0][0] = m[0][0] * m2.m[0][0] + m[0][1] * m2.m[1][0] + m[0][2] * m2.m[2][0] + m[0][3] * m2.m[3][0];
             r.m[0][1] = m[0][0] * m2.m[0][1] + m[0][1] * m2.m[1][1] + m[0][2] * m2.m[2][1] + m[0][3] * m2.m[3][1];
             r.m[0][2] = m[0][0] * m2.m[0][2] + m[0][1] * m2.m[1][2] + m[0][2] * m2.m[2][2] + m[0][3] * m2.m[3][2];
@@ -172,6 +210,7 @@ namespace Polycode {
             r.m[3][1] = m[3][0] * m2.m[0][1] + m[3][1] * m2.m[1][1] + m[3][2] * m2.m[2][1] + m[3][3] * m2.m[3][1];
             r.m[3][2] = m[3][0] * m2.m[0][2] + m[3][1] * m2.m[1][2] + m[3][2] * m2.m[2][2] + m[3][3] * m2.m[3][2];
             r.m[3][3] = m[3][0] * m2.m[0][3] + m[3][1] * m2.m[1][3] + m[3][2] * m2.m[2][3] + m[3][3] * m2.m[3][3];
+#endif
 
             return r;
 
@@ -243,6 +282,11 @@ namespace Polycode {
 
 			}
 
+			/**
+			* Returns the transpose of the matrix.
+			*/
+			Matrix4 transpose() const;
+			
 			/**
 			* Returns the inverse of the matrix.
 			*/
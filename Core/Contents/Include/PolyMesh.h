@@ -23,6 +23,7 @@ THE SOFTWARE.
 #pragma once
 #include "PolyString.h"
 #include <math.h>
+#include <string.h>
 #include "PolyGlobals.h"
 #include "PolyPolygon.h"
 #include "PolyVertex.h"
@@ -53,6 +54,8 @@ namespace Polycode {
 	*/
 	class _PolyExport RenderDataArray {
 	public:		
+		RenderDataArray() { arrayType = 0; stride = 0; size = 0; arrayPtr = NULL; rendererData = NULL; count = 0; capacity = 0; }
+		
 		int arrayType;
 		int stride;
 		int size;
@@ -60,6 +63,11 @@ namespace Polycode {
 		void *rendererData;
 		int count;
 		
+		/**
+		* Number of bytes allocated at arrayPtr. Renderers reuse the allocation when an array is rebuilt with the same or a smaller size.
+		*/
+		unsigned int capacity;
+		
 		/**
 		* Vertex position array.
 		*/
@@ -79,6 +87,16 @@ namespace Polycode {
 		* Vertex texture coordinate array.
 		*/						
 		static const int TEXCOORD_DATA_ARRAY = 3;
+		
+		/**
+		* Vertex index array. Only used by meshes with indexed storage. The size of an index array is the size of a single index in bytes (2 or 4).
+		*/
+		static const int INDEX_DATA_ARRAY = 4;
+		
+		/**
+		* Interleaved position, normal, color and texture coordinate array. The layout is the same as the one of Mesh::getVertexStream(), size is Mesh::VERTEX_STREAM_STRIDE floats per vertex.
+		*/
+		static const int INTERLEAVED_DATA_ARRAY = 5;
 	};
 		
 
@@ -100,8 +118,38 @@ namespace Polycode {
 		float y;
 	} Vector2_struct;
 	
+	/**
+	* Header of a mesh record in the version 2 mesh format. The header is followed by numSections MeshFileSection entries and the section data. All values are stored in the native byte order, and all offsets are relative to the start of the header, so mesh records can be embedded in other files.
+	*/
+	typedef struct {
+		unsigned int magic;
+		unsigned int version;
+		unsigned int meshType;
+		unsigned int faceSize;
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		unsigned int numSections;
+		unsigned int dataSize;
+		unsigned int reserved;
+		Vector3_struct boundsMin;
+		Vector3_struct boundsMax;
+		float radius;
+	} MeshFileHeader;
+	
+	/**
+	* Section table entry of a version 2 mesh record. Section data starts at an offset aligned to Mesh::MESH_FILE_ALIGNMENT bytes, so a mapped mesh record can use its vertex and index data in place.
+	*/
+	typedef struct {
+		unsigned int type;
+		unsigned int offset;
+		unsigned int size;
+		unsigned int reserved;
+	} MeshFileSection;
+	
 	/**
 	* A polygonal mesh. The mesh is assembled from Polygon instances, which in turn contain Vertex instances. This structure is provided for convenience and when the mesh is rendered, it is cached into vertex arrays with no notions of separate polygons. When data in the mesh changes, arrayDirtyMap must be set to true for the appropriate array types (color, position, normal, etc). Available types are defined in RenderDataArray.
+	*
+	* A mesh can also use indexed storage (see useIndexedStorage()). In that mode the vertices are kept in a single interleaved float stream with shared vertices welded together and faces are described by an index buffer. Polygons returned by getPolygon() are then a compatibility view over that storage.
 	*/
 	class _PolyExport Mesh {
 		public:
@@ -122,7 +170,7 @@ namespace Polycode {
 			~Mesh();
 			
 			/**
-			* Adds a polygon to the mesh.
+			* Adds a polygon to the mesh. If the mesh is using indexed storage, it is switched back to polygon storage first.
 			* @param newPolygon Polygon to add.
 			*/
 			void addPolygon(Polygon *newPolygon);
@@ -139,7 +187,16 @@ namespace Polycode {
 			*/			
 			void saveToFile(String fileName);
 
+			/**
+			* Loads a mesh record from an open file. Version 2 records are read straight into indexed storage with a single read per section. Older records are still read polygon by polygon.
+			* @param inFile File to read from. Left positioned after the mesh record.
+			*/
 			void loadFromFile(OSFILE *inFile);
+			
+			/**
+			* Writes the mesh as a version 2 mesh record. Meshes in polygon storage are written without welding their vertices. Meshes with polygons of differing vertex counts can not be described by an index buffer and are written in the old format.
+			* @param outFile File to write to.
+			*/
 			void saveToFile(OSFILE *outFile);
 			
 			/**
@@ -212,6 +269,131 @@ namespace Polycode {
 			*/
 			void useVertexNormals(bool val);
 			
+			/**
+			* Switches the mesh between polygon and indexed storage. Switching an existing mesh to indexed storage welds identical vertices together, switching it back expands the index buffer into polygons again. All polygons must have the same number of vertices to be converted. Setting this on an empty mesh makes the mesh builders (createBox(), createCylinder(), etc.) write directly into the indexed storage.
+			* @param val If true, the mesh will use indexed storage.
+			* @return True if the conversion succeeded, false if not.
+			*/
+			bool useIndexedStorage(bool val);
+			
+			/**
+			* Returns true if the mesh is using indexed storage.
+			*/
+			bool isIndexed() { return indexedStorage; }
+			
+			/**
+			* Merges identical vertices in the indexed vertex stream and remaps the index buffer. Called automatically when converting to indexed storage.
+			*/
+			void weldVertices();
+			
+			/**
+			* Adds a vertex to the indexed vertex stream. 
+			* @param position Vertex position.
+			* @param normal Vertex normal.
+			* @param color Vertex color.
+			* @param texCoord Vertex texture coordinate.
+			* @return Index of the new vertex.
+			*/
+			unsigned int addStreamVertex(const Vector3 &position, const Vector3 &normal, const Color &color, const Vector2 &texCoord);
+			
+			/**
+			* Sets a bone assignment for a vertex in the indexed vertex stream.
+			* @param vertexIndex Index of the vertex in the stream.
+			* @param slot Bone assignment slot, between 0 and MAX_BONE_ASSIGNMENTS-1.
+			* @param boneID Bone ID.
+			* @param weight Bone weight.
+			*/
+			void setStreamBoneAssignment(unsigned int vertexIndex, unsigned int slot, unsigned int boneID, float weight);
+			
+			/**
+			* Picks the bone assignments of a vertex that fit into the vertex stream, strongest weights first.
+			* @param vertex Vertex to read the bone assignments from.
+			* @param boneIDs Receives up to MAX_BONE_ASSIGNMENTS bone IDs.
+			* @param weights Receives the matching bone weights.
+			* @return Number of assignments written.
+			*/
+			static int selectBoneAssignments(Vertex *vertex, unsigned int *boneIDs, float *weights);
+			
+			/**
+			* Appends an index to the index buffer. The index buffer is widened to 32 bits if the index does not fit in 16.
+			* @param index Index to add.
+			*/
+			void addIndex(unsigned int index);
+			
+			/**
+			* Returns the number of vertices in the indexed vertex stream.
+			*/
+			unsigned int getStreamVertexCount();
+			
+			/**
+			* Returns the number of indices in the index buffer.
+			*/
+			unsigned int getIndexCount();
+			
+			/**
+			* Returns an index from the index buffer.
+			* @param i Position in the index buffer.
+			*/
+			unsigned int getIndex(unsigned int i);
+			
+			/**
+			* Returns true if the index buffer uses 32 bit indices, false if it uses 16 bit indices.
+			*/
+			bool hasLargeIndices() { return largeIndices; }
+			
+			/**
+			* Returns a pointer to the index buffer data. The data is either unsigned short or unsigned int, see hasLargeIndices().
+			*/
+			void *getIndexData();
+			
+			/**
+			* Returns a pointer to the interleaved vertex stream. Each vertex is VERTEX_STREAM_STRIDE floats long, see the VERTEX_STREAM_*_OFFSET constants for the layout.
+			* getRadius() and calculateBBox() keep returning the bounds stored in a loaded mesh file until positions are changed through the Mesh, so positions written through this pointer are not reflected in them.
+			*/
+			float *getVertexStream();
+			
+			/**
+			* Returns true if the vertex stream has bone assignments.
+			*/
+			bool hasBoneStream() { return boneWeightStream.size() > 0; }
+			
+			/**
+			* Returns the bone ID stream, MAX_BONE_ASSIGNMENTS ids per vertex.
+			*/
+			unsigned int *getBoneIDStream();
+			
+			/**
+			* Returns the bone weight stream, MAX_BONE_ASSIGNMENTS weights per vertex. Unused slots have a weight of 0.
+			*/
+			float *getBoneWeightStream();
+			
+			/**
+			* Writes changes made to the polygon view of an indexed mesh back into the vertex stream. The renderer calls this when the mesh arrays are flagged dirty, so it only needs to be called manually if the stream is read directly.
+			* Only polygon vertices changed since the last commit are written, and the other polygon vertices sharing their stream vertex are updated to match.
+			*/
+			void commitPolygonView();
+			
+			/**
+			* Writes the attribute used by a render array type from the polygon view back into the vertex stream.
+			* @param arrayType Render array type. See RenderDataArray.
+			*/
+			void commitPolygonView(int arrayType);
+
+			/**
+			* Creates a simplified copy of a triangle or quad mesh. See MeshSimplifier.
+			* @param triangleRatio Fraction of the triangles to keep, between 0 and 1.
+			* @return A new triangle mesh in indexed storage, or NULL if the mesh type can not be simplified. Must be deleted by the caller.
+			*/
+			Mesh *createSimplifiedMesh(Number triangleRatio);
+
+			/**
+			* Creates a chain of simplified copies for level of detail rendering. Each level keeps a fraction of the triangles of the one before it.
+			* @param numLevels Number of levels to create, not counting this mesh.
+			* @param triangleRatio Fraction of the triangles each level keeps of the previous one.
+			* @return The new meshes, from the most to the least detailed. Must be deleted by the caller. Empty if the mesh type can not be simplified.
+			*/
+			vector<Mesh*> createLODChain(unsigned int numLevels, Number triangleRatio = 0.5);
+
 			/**
 			* Sets the vertex buffer for the mesh.
 			* @param buffer New vertex buffer for mesh.
@@ -225,13 +407,13 @@ namespace Polycode {
 			VertexBuffer *getVertexBuffer();		
 			
 			/**
-			* Returns the radius of the mesh (furthest vertex away from origin).
+			* Returns the radius of the mesh (furthest vertex away from origin). For a mesh loaded from a version 2 file, the radius stored in the file is used.
 			* @return Mesh radius.
 			*/			
 			Number getRadius();
 			
 			/**
-			* Recalculates the mesh normals (flat normals only).
+			* Recalculates the mesh normals (flat normals only). On a mesh with indexed storage, face normals are averaged across shared vertices, weighted by face area.
 			*/
 			void calculateNormals();	
 			
@@ -247,7 +429,7 @@ namespace Polycode {
 			void setMeshType(int newType);
 
 			/**
-			* Calculates the mesh bounding box.
+			* Calculates the mesh bounding box. For a mesh loaded from a version 2 file, the bounds stored in the file are used.
 			*/
 			Vector3 calculateBBox();
 
@@ -286,6 +468,76 @@ namespace Polycode {
 			* Point based mesh.
 			*/									
 			static const int POINT_MESH = 5;
+			
+			/**
+			* Number of floats per vertex in the indexed vertex stream.
+			*/
+			static const int VERTEX_STREAM_STRIDE = 12;
+			
+			/**
+			* Offset of the position in a vertex stream entry.
+			*/
+			static const int VERTEX_STREAM_POSITION_OFFSET = 0;
+			
+			/**
+			* Offset of the normal in a vertex stream entry.
+			*/			
+			static const int VERTEX_STREAM_NORMAL_OFFSET = 3;
+			
+			/**
+			* Offset of the color in a vertex stream entry.
+			*/			
+			static const int VERTEX_STREAM_COLOR_OFFSET = 6;
+			
+			/**
+			* Offset of the texture coordinate in a vertex stream entry.
+			*/			
+			static const int VERTEX_STREAM_TEXCOORD_OFFSET = 10;
+			
+			/**
+			* Maximum number of bone assignments per vertex in indexed storage.
+			*/
+			static const int MAX_BONE_ASSIGNMENTS = 4;
+			
+			/**
+			* Magic number at the start of a version 2 mesh record ("PMSH").
+			*/
+			static const unsigned int MESH_FILE_MAGIC = 0x48534D50;
+			
+			/**
+			* Current mesh file version.
+			*/
+			static const unsigned int MESH_FILE_VERSION = 2;
+			
+			/**
+			* Alignment of the sections in a mesh record in bytes.
+			*/
+			static const unsigned int MESH_FILE_ALIGNMENT = 16;
+			
+			/**
+			* Mesh file section with the interleaved vertex stream, VERTEX_STREAM_STRIDE floats per vertex.
+			*/
+			static const unsigned int MESH_SECTION_VERTICES = 0;
+			
+			/**
+			* Mesh file section with 16 bit indices.
+			*/
+			static const unsigned int MESH_SECTION_INDICES16 = 1;
+			
+			/**
+			* Mesh file section with 32 bit indices.
+			*/
+			static const unsigned int MESH_SECTION_INDICES32 = 2;
+			
+			/**
+			* Mesh file section with MAX_BONE_ASSIGNMENTS bone IDs per vertex.
+			*/
+			static const unsigned int MESH_SECTION_BONE_IDS = 3;
+			
+			/**
+			* Mesh file section with MAX_BONE_ASSIGNMENTS bone weights per vertex.
+			*/
+			static const unsigned int MESH_SECTION_BONE_WEIGHTS = 4;
 		
 			/**
 			* Render array dirty map. If any of these are flagged as dirty, the renderer will rebuild them from the mesh data. See RenderDataArray for types of render arrays.
@@ -305,10 +557,46 @@ namespace Polycode {
 			bool useVertexColors;
 		
 		private:
+		
+		void addBuilderFace(const Number *positions, const Number *texCoords, int numVertices);
+		void finishBuild();
+		
+		void loadLegacyFromFile(OSFILE *inFile, unsigned int meshType);
+		void saveLegacyToFile(OSFILE *outFile);
+		
+		bool buildIndexedStorage();
+		void expandIndexedStorage();
+		void buildPolygonView();
+		void refreshPolygonView();
+		void snapshotPolygonViewCorner(unsigned int corner);
+		int getPolygonViewAttribute(unsigned int corner, int arrayType, float *values);
+		void setPolygonViewAttribute(unsigned int corner, int arrayType, const float *values);
+		static int getStreamAttributeOffset(int arrayType);
+		void clearPolygons();
+		void compactIndices();
+		int getIndexedFaceSize();
+		
+		unsigned int hashStreamVertex(unsigned int index);
+		bool streamVerticesEqual(unsigned int a, unsigned int b);
+		void copyStreamVertex(unsigned int from, unsigned int to);
 					
 		VertexBuffer *vertexBuffer;
 		bool meshHasVertexBuffer;
 		int meshType;
 		vector <Polygon*> polygons;
+		
+		bool indexedStorage;
+		bool polygonViewValid;
+		vector<float> polygonViewStream;
+		bool fileBoundsValid;
+		Vector3 fileBBox;
+		Number fileRadius;
+		bool largeIndices;
+		int indexedFaceSize;
+		vector<float> vertexStream;
+		vector<unsigned int> boneIDStream;
+		vector<float> boneWeightStream;
+		vector<unsigned short> indices16;
+		vector<unsigned int> indices32;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMesh.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	/**
+	* Reduces the triangle count of a mesh with quadric error metric edge collapses. Each collapse moves a vertex onto one of its neighbours, so the remaining vertices keep their original positions, texture coordinates, colors and bone weights. Vertices on texture or normal seams (positions shared by several stream vertices) are never moved, open borders are protected by extra error planes, and skinned vertices only collapse onto vertices with the same dominant bone.
+	*
+	* The simplifier keeps its state between calls, so calling simplify() with decreasing triangle counts produces a chain of levels of detail without starting over for each level.
+	*/
+	class _PolyExport MeshSimplifier {
+		public:
+			/**
+			* Creates a simplifier for a mesh. The mesh is copied and not modified. Quad meshes are split into triangles, other mesh types can not be simplified.
+			* @param mesh Mesh to simplify.
+			*/
+			MeshSimplifier(Mesh *mesh);
+			~MeshSimplifier();
+			
+			/**
+			* Collapses edges until the mesh has at most the target number of triangles or no collapse stays below maxError.
+			* @param targetTriangles Number of triangles to reduce the mesh to.
+			* @return A new triangle mesh in indexed storage. Must be deleted by the caller.
+			*/
+			Mesh *simplify(unsigned int targetTriangles);
+			
+			/**
+			* Returns the current number of triangles.
+			*/
+			unsigned int getTriangleCount();
+			
+			/**
+			* Returns the largest error of the collapses so far, as a sum of squared distances to the original surface.
+			*/
+			Number getError();
+			
+			/**
+			* Returns true if the mesh could be read.
+			*/
+			bool isValid() { return valid; }
+			
+			/**
+			* Collapses with a larger error than this are not done. 0 means no limit. Defaults to 0.
+			*/
+			Number maxError;
+			
+			/**
+			* Weight of the error planes protecting open borders. Defaults to 10.
+			*/
+			Number borderWeight;
+			
+		protected:
+		
+			class Collapse {
+				public:
+					double cost;
+					unsigned int from;
+					unsigned int to;
+					bool operator<(const Collapse &other) const { return cost < other.cost; }
+			};
+		
+			void addStreamData(Mesh *mesh);
+			void buildPositionIDs();
+			void buildQuadrics();
+			void addPlaneQuadric(unsigned int position, double a, double b, double c, double d, double weight);
+			double evaluateQuadric(unsigned int positionA, unsigned int positionB, unsigned int vertex);
+			int getDominantBone(unsigned int vertex);
+			
+			bool simplifyPass(unsigned int targetTriangles);
+			void buildAdjacency();
+			bool canCollapse(unsigned int from, unsigned int to);
+			void collapse(unsigned int from, unsigned int to);
+			void removeCollapsedTriangles();
+			
+			bool valid;
+			double error;
+			
+			vector<float> vertices;
+			vector<unsigned int> boneIDs;
+			vector<float> boneWeights;
+			vector<unsigned int> triangles;
+			vector<bool> triangleRemoved;
+			unsigned int numTriangles;
+			
+			vector<unsigned int> positionIDs;
+			vector<unsigned int> positionVertexCounts;
+			vector<double> quadrics;
+			
+			vector<unsigned int> adjacencyStart;
+			vector<unsigned int> adjacency;
+			vector<bool> positionLocked;
+	};
+}
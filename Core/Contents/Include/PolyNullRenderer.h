@@ -0,0 +1,325 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyString.h"
+#include "PolyLogger.h"
+#include "PolyGlobals.h"
+#include "PolyRenderer.h"
+#include "PolyTexture.h"
+#include "PolyFixedShader.h"
+#include "PolyMatrix4.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	/**
+	* Texture created by the NullRenderer. Holds the texture data in memory, but is never uploaded anywhere.
+	*/
+	class _PolyExport NullTexture : public Texture {
+		public:
+			NullTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, int type);
+			virtual ~NullTexture();
+			
+			void setTextureData(char *data);
+			void recreateFromImageData();
+	};
+	
+	/**
+	* Vertex buffer created by the NullRenderer. Only keeps the vertex count of the mesh it was created for.
+	*/
+	class _PolyExport NullVertexBuffer : public VertexBuffer {
+		public:
+			NullVertexBuffer(Mesh *mesh);
+			virtual ~NullVertexBuffer();
+	};
+	
+	/**
+	* A single entry in the NullRenderer command stream.
+	*/
+	class _PolyExport RenderCommand {
+		public:
+			RenderCommand(int type, int value) : type(type), value(value) {}
+			
+			/**
+			* Command type. See the COMMAND_* constants.
+			*/
+			int type;
+			
+			/**
+			* Command argument. For draw commands this is the number of vertices submitted, for state commands it is the new state value.
+			*/
+			int value;
+			
+			static const int COMMAND_DRAW_ARRAYS = 0;
+			static const int COMMAND_DRAW_VERTEX_BUFFER = 1;
+			static const int COMMAND_BIND_TEXTURE = 2;
+			static const int COMMAND_SET_BLENDING_MODE = 3;
+			static const int COMMAND_DEPTH_TEST = 4;
+			static const int COMMAND_DEPTH_WRITE = 5;
+			static const int COMMAND_DEPTH_FUNCTION = 6;
+			static const int COMMAND_BACKFACE_CULLING = 7;
+			static const int COMMAND_CULL_FRONT_FACES = 8;
+			static const int COMMAND_ALPHA_TEST = 9;
+			static const int COMMAND_PUSH_MATRIX = 10;
+			static const int COMMAND_POP_MATRIX = 11;
+			static const int COMMAND_LOAD_MATRIX = 12;
+			static const int COMMAND_APPLY_MATERIAL = 13;
+			static const int COMMAND_CLEAR_SHADER = 14;
+			static const int COMMAND_CLEAR = 15;
+			static const int COMMAND_BIND_FRAMEBUFFER = 16;
+			static const int COMMAND_SET_ORTHO_MODE = 17;
+			static const int COMMAND_SET_PERSPECTIVE_MODE = 18;
+			static const int COMMAND_DRAW_ARRAYS_INSTANCED = 19;
+	};
+	
+	/**
+	* Per frame render counters. The *Changes counters only count actual state changes, setting a state to its current value is not counted. The *Calls counters count every call, so the difference between the two is the number of redundant state calls.
+	*/
+	class _PolyExport RenderFrameStats {
+		public:
+			RenderFrameStats();
+			
+			/**
+			* Resets all counters to 0.
+			*/
+			void reset();
+			
+			/**
+			* Number of drawArrays(), drawArraysInstanced() and drawVertexBuffer() calls.
+			*/
+			unsigned int drawCalls;
+			
+			/**
+			* Number of vertices submitted by draw calls. For indexed meshes this is the number of indices. Instanced draws count every instance.
+			*/
+			unsigned int verticesSubmitted;
+			
+			/**
+			* Number of texture binds.
+			*/
+			unsigned int textureBinds;
+			
+			/**
+			* Number of setTexture() calls.
+			*/
+			unsigned int textureCalls;
+			
+			/**
+			* Number of blending mode changes.
+			*/
+			unsigned int blendChanges;
+			
+			/**
+			* Number of setBlendingMode() calls.
+			*/
+			unsigned int blendCalls;
+			
+			/**
+			* Number of depth test, depth write and depth function changes.
+			*/
+			unsigned int depthChanges;
+			
+			/**
+			* Number of enableDepthTest(), enableDepthWrite() and setDepthFunction() calls.
+			*/
+			unsigned int depthCalls;
+			
+			/**
+			* Number of backface culling and cull face changes.
+			*/
+			unsigned int cullChanges;
+			
+			/**
+			* Number of enableBackfaceCulling() and cullFrontFaces() calls.
+			*/
+			unsigned int cullCalls;
+			
+			/**
+			* Number of alpha test changes.
+			*/
+			unsigned int alphaTestChanges;
+			
+			/**
+			* Number of enableAlphaTest() calls.
+			*/
+			unsigned int alphaTestCalls;
+			
+			/**
+			* Number of matrix pushes.
+			*/
+			unsigned int matrixPushes;
+			
+			/**
+			* Number of applied materials.
+			*/
+			unsigned int materialChanges;
+	};
+	
+	/**
+	* A renderer that does not draw anything. The NullRenderer implements the whole Renderer interface without a graphics context, tracks the modelview and projection matrices on the CPU and records every draw and state change into a command stream and a set of per frame counters. It can be used to run and profile scene and screen rendering on machines without a display.
+	*/
+	class _PolyExport NullRenderer : public Renderer {
+		
+	public:
+		
+		NullRenderer();
+		virtual ~NullRenderer();
+		
+		void Resize(int xRes, int yRes);
+		void BeginRender();
+		void EndRender();
+		
+		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
+		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, int type=Image::IMAGE_RGBA);
+		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height);
+		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
+		void bindFrameBufferTexture(Texture *texture);
+		void unbindFramebuffers();
+		void renderToTexture(Texture *targetTexture);
+		void renderZBufferToTexture(Texture *targetTexture);
+		
+		void setViewportSize(int w, int h, Number fov=45.0f);
+		void loadIdentity();
+		void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f);
+		void _setOrthoMode();
+		void setPerspectiveMode();
+		
+		void setTexture(Texture *texture);
+		void enableBackfaceCulling(bool val);
+		void setClearColor(Number r, Number g, Number b);
+		void clearScreen();
+		
+		void translate2D(Number x, Number y);
+		void rotate2D(Number angle);
+		void scale2D(Vector2 *scale);
+		
+		void setFOV(Number fov);
+		void setVertexColor(Number r, Number g, Number b, Number a);
+		
+		void pushRenderDataArray(RenderDataArray *array);
+		void pushInterleavedRenderDataArray(RenderDataArray *array, bool useColors);
+		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
+		void updateRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array);
+		RenderDataArray *createRenderDataArray(int arrayType);
+		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
+		void drawArrays(int drawType);
+		void drawArraysInstanced(int drawType, const Matrix4 *transforms, const Color *colors, unsigned int numInstances);
+		
+		void translate3D(Vector3 *position);
+		void translate3D(Number x, Number y, Number z);
+		void scale3D(Vector3 *scale);
+		
+		void pushMatrix();
+		void popMatrix();
+		
+		void setLineSmooth(bool val);
+		void setLineSize(Number lineSize);
+		
+		void enableLighting(bool enable);
+		void enableFog(bool enable);
+		void setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth);
+		
+		void multModelviewMatrix(Matrix4 m);
+		void setModelviewMatrix(Matrix4 m);
+		
+		void setBlendingMode(int blendingMode);
+		void applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex);
+		void clearShader();
+		void setDepthFunction(int depthFunction);
+		
+		void createVertexBufferForMesh(Mesh *mesh);
+		void drawVertexBuffer(VertexBuffer *buffer);
+		
+		void enableDepthTest(bool val);
+		void enableDepthWrite(bool val);
+		void enableAlphaTest(bool val);
+		void clearBuffer(bool colorBuffer, bool depthBuffer);
+		void drawToColorBuffer(bool val);
+		void drawScreenQuad(Number qx, Number qy);
+		void cullFrontFaces(bool val);
+		
+		/**
+		* Always returns false, there is no screen to pick against.
+		*/
+		bool test2DCoordinate(Number x, Number y, Polygon *poly, const Matrix4 &matrix, bool billboardMode);
+		
+		/**
+		* Always returns a zero vector, there is no depth buffer to read back.
+		*/
+		Vector3 Unproject(Number x, Number y);
+		
+		/**
+		* Returns the counters of the last completed frame (between the last BeginRender() and EndRender() calls).
+		*/
+		const RenderFrameStats &getFrameStats() const { return frameStats; }
+		
+		/**
+		* Returns the counters of the frame currently being rendered.
+		*/
+		const RenderFrameStats &getCurrentFrameStats() const { return currentStats; }
+		
+		/**
+		* Enables or disables recording of the command stream. Counters are always updated. Recording is enabled by default.
+		* @param val If true, commands are recorded.
+		*/
+		void setCommandRecording(bool val);
+		
+		/**
+		* Returns the number of recorded commands. The command stream is cleared in BeginRender() and stays available after EndRender() until the next frame starts.
+		*/
+		unsigned int getNumCommands() const { return commands.size(); }
+		
+		/**
+		* Returns a recorded command.
+		* @param index Index of the command.
+		*/
+		const RenderCommand &getCommand(unsigned int index) const { return commands[index]; }
+		
+		/**
+		* Returns the number of frames rendered so far.
+		*/
+		unsigned int getFrameCount() const { return frameCount; }
+		
+	protected:
+		
+		void recordCommand(int type, int value);
+		
+		RenderFrameStats currentStats;
+		RenderFrameStats frameStats;
+		vector<RenderCommand> commands;
+		bool recordCommands;
+		unsigned int frameCount;
+		
+		int verticesToDraw;
+		int indicesToDraw;
+		
+		int blendingMode;
+		int depthFunction;
+		bool depthTestEnabled;
+		bool depthWriteEnabled;
+		bool backfaceCullingEnabled;
+		bool alphaTestEnabled;
+	};
+}
@@ -20,41 +20,132 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
+
 #pragma once
 #include "PolyString.h"
 #include "PolyGlobals.h"
-#include "PolySceneEntity.h"
-#include "PolyScreenShape.h"
-#include "PolyScenePrimitive.h"
-#include "PolyCoreServices.h"
+#include "PolyVector3.h"
+#include "PolyMesh.h"
+#include <vector>
 
+using std::vector;
 
 namespace Polycode {
 
+	/**
+	* Particle types used by the particle emitters.
+	*/
 	class _PolyExport Particle {
 		public:
-			Particle(int particleType, bool isScreenParticle, Material *material, Texture *texture, Mesh *particleMesh);
-			~Particle();
-			void Reset(bool continuious);
+			/**
+			* Camera facing textured quad.
+			*/
+			static const int BILLBOARD_PARTICLE = 0;
 			
-			void createSceneParticle(int particleType, Material *material, Mesh *particleMesh);
-			void createScreenParticle(int particleType, Texture *texture, Mesh *particleMesh);
-		
-			Entity *particleBody;						
+			/**
+			* Copy of a mesh.
+			*/
+			static const int MESH_PARTICLE = 1;
+	};
+
+	/**
+	* Particle simulation core. All particle state is kept in contiguous float arrays, one per attribute, so that the simulation can run in tight loops without touching any entities. The simulation also writes the particles into a single vertex stream that can be drawn with one draw call.
+	*/
+	class _PolyExport ParticleSimulation {
+		public:
+			ParticleSimulation();
+			~ParticleSimulation();
 			
-			Vector3 velVector;
-			Vector3 dirVector;	
-			Vector3 deviation;		
-			Number life;
-			Number lifespan;
-			Number brightnessDeviation;
-			Number perlinPosX;
-			Number perlinPosY;
-			Number perlinPosZ;
+			/**
+			* Resizes the particle arrays. Existing particles are kept.
+			* @param count New number of particles.
+			*/
+			void setCount(unsigned int count);
 			
-			static Mesh* billboardMesh;
+			/**
+			* Returns the number of particles in the arrays.
+			*/
+			unsigned int getCount();
 			
-			static const int BILLBOARD_PARTICLE = 0;
-			static const int MESH_PARTICLE = 1;
+			/**
+			* Ages and moves the first count particles.
+			* @param count Number of particles to update.
+			* @param elapsed Elapsed time in seconds.
+			* @param timeStep Elapsed time multiplied by the speed modifier, used for movement.
+			* @param gravity Gravity vector.
+			* @param rotationSpeed Rotation speed in degrees per second.
+			* @param planar If true, particles only move and spin in the XY plane.
+			*/
+			void integrate(unsigned int count, Number elapsed, Number timeStep, const Vector3 &gravity, Number rotationSpeed, bool planar);
+			
+			/**
+			* Sets the mesh that is copied for every particle by buildMeshStream().
+			*/
+			void setMeshTemplate(Mesh *mesh);
+			
+			/**
+			* Writes one quad per particle into the vertex stream.
+			* @param count Number of particles to write.
+			* @param right World space right vector of the quads.
+			* @param up World space up vector of the quads.
+			* @param baseSize Size of a particle quad at size 1.
+			* @param followPath If true, the quads are rotated along the particle velocity instead of by their roll.
+			*/
+			void buildQuadStream(unsigned int count, const Vector3 &right, const Vector3 &up, Number baseSize, bool followPath);
+			
+			/**
+			* Writes a transformed copy of the mesh template per particle into the vertex stream.
+			* @param count Number of particles to write.
+			* @param billboard If true, the meshes face the camera instead of using the particle rotation.
+			* @param followPath If true, the meshes are pointed along the particle velocity.
+			* @param right World space camera right vector, used in billboard mode.
+			* @param up World space camera up vector, used in billboard mode.
+			*/
+			void buildMeshStream(unsigned int count, bool billboard, bool followPath, const Vector3 &right, const Vector3 &up);
+			
+			/**
+			* Returns the number of vertices written by the last build call.
+			*/
+			unsigned int getStreamVertexCount();
+			
+			/**
+			* Vertex stream arrays. Positions and normals have 3 floats per vertex, colors 4 and texture coordinates 2.
+			*/
+			vector<float> vertexPositions;
+			vector<float> vertexNormals;
+			vector<float> vertexColors;
+			vector<float> vertexTexCoords;
+			
+			/**
+			* Per particle state.
+			*/
+			vector<float> posX;
+			vector<float> posY;
+			vector<float> posZ;
+			vector<float> velX;
+			vector<float> velY;
+			vector<float> velZ;
+			vector<float> rotX;
+			vector<float> rotY;
+			vector<float> rotZ;
+			vector<float> life;
+			vector<float> size;
+			vector<float> colorR;
+			vector<float> colorG;
+			vector<float> colorB;
+			vector<float> colorA;
+			vector<float> brightness;
+			vector<float> perlinX;
+			vector<float> perlinY;
+			vector<float> perlinZ;
+		
+		protected:
+		
+			unsigned int particleCount;
+			unsigned int streamVertexCount;
+			
+			vector<float> templatePositions;
+			vector<float> templateNormals;
+			vector<float> templateTexCoords;
 	};
-}
\ No newline at end of file
+}
@@ -35,7 +35,7 @@ using std::vector;
 namespace Polycode {
 
 	/** 
-	* Particle emitter base.
+	* Particle emitter base. Particles are not entities; their state lives in a ParticleSimulation and the whole emitter is drawn from a single vertex stream.
 	*/
 	class _PolyExport ParticleEmitter {
 		public:
@@ -111,14 +111,27 @@ namespace Polycode {
 			*/ 																													
 			void Trigger();
 			
-			void resetParticle(Particle *particle);
+			/**
+			* Respawns a particle at the emitter.
+			* @param index Index of the particle.
+			*/
+			void resetParticle(unsigned int index);
 			
 			/**
 			* Changes the particle count in the emitter.
 			*/ 																													
 			void setParticleCount(int count);
+			
+			/**
+			* Returns the number of active particles.
+			*/
+			unsigned int getParticleCount();
+			
+			/**
+			* Returns the particle simulation holding the particle state.
+			*/
+			ParticleSimulation *getParticleSimulation();
 		
-			virtual void addParticleBody(Entity *particleBody) {}
 			virtual Matrix4 getBaseMatrix() {Matrix4 m; return m;}
 		
 			/**
@@ -201,6 +214,10 @@ namespace Polycode {
 		
 		protected:
 		
+			void updateEmitterMatrix();
+			void renderParticles(Renderer *renderer, const Vector3 &right, const Vector3 &up);
+			Number randomUnit();
+		
 			bool isScreenEmitter;
 			Mesh *pMesh;
 		
@@ -208,7 +225,14 @@ namespace Polycode {
 			int emitterType;
 			int particleType;
 			Material *particleMaterial;
+			ShaderBinding *particleShaderOptions;
 			Texture *particleTexture;
+			
+			int particleBlendingMode;
+			bool particleDepthWrite;
+			bool particleDepthTest;
+			bool particleAlphaTest;
+			bool particleBillboardMode;
 		
 			String textureFile;
 		
@@ -221,7 +245,18 @@ namespace Polycode {
 			
 			Number rotationSpeed;
 			Number numParticles;
-			vector<Particle*> particles;
+			ParticleSimulation particles;
+			
+			Matrix4 emitterMatrix;
+			Number emitterPitch;
+			Number emitterYaw;
+			Number emitterRoll;
+			unsigned int randomSeed;
+			
+			RenderDataArray *vertexArray;
+			RenderDataArray *normalArray;
+			RenderDataArray *colorArray;
+			RenderDataArray *texCoordArray;
 			
 			Number emitSpeed;
 			Timer *timer;
@@ -235,7 +270,7 @@ namespace Polycode {
 		/**
 		* Constructor.
 		* @param materialName Name of the material to use for particles.
-		* @param particleParentScene Scene to create particles in.
+		* @param particleParentScene Scene the emitter is in. Particles are simulated in world space and drawn by the emitter itself.
 		* @param particleType Type of particles to create. Can be Particle::BILLBOARD_PARTICLE or Particle::MESH_PARTICLE
 		* @param emitterType Type of emitter to create. Can be ParticleEmitter::CONTINUOUS_EMITTER or ParticleEmitter::TRIGGERED_EMITTER
 		* @param lifespan Lifetime of particles in seconds.
@@ -254,9 +289,9 @@ namespace Polycode {
 		*/ 
 		ParticleEmitter *getEmitter() { return this; }
 		
-		void addParticleBody(Entity *particleBody);
 		Matrix4 getBaseMatrix();
 		void Update();
+		void Render();
 		
 	protected:
 		SceneMesh *emitterMesh;		
@@ -276,9 +311,9 @@ namespace Polycode {
 		*/ 		
 		ParticleEmitter *getEmitter() { return this; }		
 		
-		void addParticleBody(Entity *particleBody);
 		Matrix4 getBaseMatrix();
 		void Update();
+		void Render();
 		
 	protected:
 		ScreenMesh *emitterMesh;		
@@ -0,0 +1,150 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include "PolyColor.h"
+#include <vector>
+#include <map>
+
+using std::vector;
+
+namespace Polycode {
+
+	class Entity;
+	class Renderer;
+	class Material;
+	class ShaderBinding;
+	class Texture;
+	class Mesh;
+
+	/**
+	* A single draw in a RenderQueue. Holds the entity, the modelview matrix it was enqueued with and a copy of the render state it needs.
+	*/
+	class _PolyExport RenderQueueItem {
+		public:
+			RenderQueueItem();
+			
+			Entity *entity;
+			Matrix4 modelviewMatrix;
+			Color color;
+			
+			int blendingMode;
+			bool depthWrite;
+			bool depthTest;
+			bool alphaTest;
+			bool backfaceCulled;
+			bool wireframe;
+			
+			/**
+			* Set to true by Entity::getRenderResources() if the queue should bind the material or texture below before calling Entity::renderGeometry().
+			*/
+			bool hasResources;
+			Material *material;
+			ShaderBinding *localShaderOptions;
+			Texture *texture;
+			Mesh *mesh;
+			
+			/**
+			* Distance from the camera along the view direction.
+			*/
+			Number depth;
+			int pass;
+			
+			/**
+			* Sort state filled in by the queue: the quantized depth and the per frame IDs of the shader, material, texture and mesh.
+			*/
+			unsigned int sortDepth;
+			unsigned int sortIDs[4];
+	};
+	
+	class _PolyExport RenderQueueSortEntry {
+		public:
+			bool operator<(const RenderQueueSortEntry &other) const {
+				if(key != other.key)
+					return key < other.key;
+				return index < other.index;
+			}
+			
+			unsigned long long key;
+			unsigned int index;
+	};
+
+	/**
+	* Deferred, state sorted list of draws. Instead of drawing entities during the scene traversal, the scene adds them to a render queue, which sorts them by a 64 bit key and draws them with only the render state changes between consecutive items.
+	*
+	* Items are split into two passes. Opaque items (depth writing, fully opaque color and normal blending) are drawn first, grouped by shader, material, texture and mesh within coarse front to back depth buckets so that the depth test can reject hidden pixels early. Everything else is drawn afterwards, strictly back to front.
+	*
+	* Shaders, materials, textures and meshes get compact IDs in the order they are first added each frame, counted separately for each kind. The key has room for 255 shaders and 4095 materials, textures and meshes in the opaque pass, and for 63 shaders, 1023 materials and 2047 textures and meshes in the blended pass. If a frame uses more, execute() falls back to a slower sort that compares the full IDs, so the draw order stays the same.
+	*/
+	class _PolyExport RenderQueue {
+		public:
+			RenderQueue();
+			~RenderQueue();
+			
+			/**
+			* Adds an entity to the queue. The entity's render state is copied, so it can change before the queue is executed.
+			* @param entity Entity to add.
+			* @param modelviewMatrix Modelview matrix to draw the entity with.
+			*/
+			void addEntity(Entity *entity, const Matrix4 &modelviewMatrix);
+			
+			/**
+			* Sorts and draws all queued items and clears the queue. The renderer's modelview matrix is restored afterwards.
+			* @param renderer Renderer to draw with.
+			*/
+			void execute(Renderer *renderer);
+			
+			/**
+			* Removes all items without drawing them.
+			*/
+			void clear();
+			
+			unsigned int getNumItems() const { return items.size(); }
+			
+			/**
+			* Returns the number of material and texture binds made by the last execute() call.
+			*/
+			unsigned int getNumResourceChanges() const { return numResourceChanges; }
+			
+			static const int PASS_OPAQUE = 0;
+			static const int PASS_BLENDED = 1;
+			
+		protected:
+		
+			unsigned long long buildSortKey(RenderQueueItem &item);
+			unsigned int getResourceID(int type, void *resource);
+			static unsigned int quantizeDepth(Number depth, int exponentBits, int mantissaBits);
+			
+			static const int RESOURCE_SHADER = 0;
+			static const int RESOURCE_MATERIAL = 1;
+			static const int RESOURCE_TEXTURE = 2;
+			static const int RESOURCE_MESH = 3;
+			
+			vector<RenderQueueItem> items;
+			vector<RenderQueueSortEntry> sortEntries;
+			std::map<void*, unsigned int> resourceIDs[4];
+			bool idOverflow;
+			unsigned int numResourceChanges;
+	};
+}
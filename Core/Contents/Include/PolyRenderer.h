@@ -111,12 +111,34 @@ namespace Polycode {
 		
 		void pushDataArrayForMesh(Mesh *mesh, int arrayType);
 		
+		/**
+		* Pushes the positions, normals, texture coordinates and optionally colors of a mesh as a single interleaved array. The array is rebuilt when any of the mesh's vertex, normal, color or texture coordinate arrays is flagged dirty.
+		* @param mesh Mesh to push.
+		* @param useColors If true, the vertex colors are used as well.
+		*/
+		void pushInterleavedDataArrayForMesh(Mesh *mesh, bool useColors);
+		
 		virtual void pushRenderDataArray(RenderDataArray *array) = 0;
+		virtual void pushInterleavedRenderDataArray(RenderDataArray *array, bool useColors) = 0;
 		virtual RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType) = 0;
+		
+		/**
+		* Refills an existing render array from the mesh data, reusing its allocation if it is large enough.
+		*/
+		virtual void updateRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array) = 0;
 		virtual RenderDataArray *createRenderDataArray(int arrayType) = 0;
 		virtual void setRenderArrayData(RenderDataArray *array, Number *arrayData) = 0;
 		virtual void drawArrays(int drawType) = 0;
 		
+		/**
+		* Draws the currently pushed arrays once per instance and releases them like drawArrays() does. Each instance transform is applied on top of the current modelview matrix.
+		* @param drawType Mesh type to draw the arrays as. See Mesh for available types.
+		* @param transforms Array of numInstances instance transforms.
+		* @param colors Array of numInstances instance colors or NULL to keep the current color.
+		* @param numInstances Number of instances to draw.
+		*/
+		virtual void drawArraysInstanced(int drawType, const Matrix4 *transforms, const Color *colors, unsigned int numInstances) = 0;
+		
 		virtual void translate3D(Vector3 *position) = 0;
 		virtual void translate3D(Number x, Number y, Number z) = 0;
 		virtual void scale3D(Vector3 *scale) = 0;
@@ -187,8 +209,37 @@ namespace Polycode {
 		
 		virtual bool test2DCoordinate(Number x, Number y, Polygon *poly, const Matrix4 &matrix, bool billboardMode) = 0;
 		
-		virtual Matrix4 getProjectionMatrix() = 0;
-		virtual Matrix4 getModelviewMatrix() = 0;
+		/**
+		* Returns the current projection matrix. The renderer keeps its own copy of the projection and modelview stacks, so matrix queries never read state back from the graphics API.
+		*/
+		virtual Matrix4 getProjectionMatrix();
+		
+		/**
+		* Returns the current modelview matrix.
+		*/
+		virtual Matrix4 getModelviewMatrix();
+		
+		/**
+		* Maps a window position and depth back through the current projection and modelview matrices.
+		* @param x Horizontal window position in pixels.
+		* @param y Vertical window position in pixels, from the top of the viewport.
+		* @param depth Window depth, from 0 at the near plane to 1 at the far plane.
+		* @return Position in the space the modelview matrix maps from.
+		*/
+		Vector3 unprojectPoint(Number x, Number y, Number depth);
+		
+		/**
+		* Maps a window position and depth back through the specified projection and modelview matrices.
+		*/
+		Vector3 unprojectPoint(Number x, Number y, Number depth, const Matrix4 &projection, const Matrix4 &modelview);
+		
+		/**
+		* Extracts the six normalized frustum planes from a projection and modelview matrix, in the order right, left, bottom, top, far, near. Since it only works on the matrices passed in, it can be used away from the render thread.
+		* @param projection Projection matrix.
+		* @param modelview Modelview matrix.
+		* @param planes Receives the planes as (a, b, c, d) with a*x + b*y + c*z + d >= 0 on the inside.
+		*/
+		static void extractFrustumPlanes(const Matrix4 &projection, const Matrix4 &modelview, Number planes[6][4]);
 		
 		static const int RENDER_MODE_NORMAL = 0;
 		static const int RENDER_MODE_WIREFRAME = 1;
@@ -262,5 +313,19 @@ namespace Polycode {
 	
 		int xRes;
 		int yRes;
+		
+		void setPerspectiveProjection(Number fov, Number aspect);
+		void setOrthoProjection(Number left, Number right, Number bottom, Number top, Number zNear, Number zFar);
+		
+		Matrix4 modelviewMatrix;
+		Matrix4 projectionMatrix;
+		vector<Matrix4> modelviewStack;
+		vector<Matrix4> projectionStack;
+		
+		Number nearPlane;
+		Number farPlane;
+		
+		int viewportWidth;
+		int viewportHeight;
 	};
 }
\ No newline at end of file
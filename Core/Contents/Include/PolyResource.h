@@ -32,10 +32,14 @@ using std::string;
 
 namespace Polycode {
 
+	class ResourceManager;
+
 	/**
 	* Base class for resources. All resources that are managed by the ResourceManager subclass this.
 	*/
 	class _PolyExport Resource {
+		friend class ResourceManager;
+		
 		public:
 					
 			// ----------------------------------------------------------------------------------------------------------------
@@ -50,6 +54,10 @@ namespace Polycode {
 			
 			String getResourceName();
 			int getResourceType();
+			
+			/**
+			* Renames the resource. If it was added to a ResourceManager, the manager's index is updated, so lookups find it under the new name.
+			*/
 			void setResourceName(String newName);
 			void setResourcePath(String path);
 			String getResourcePath();		
@@ -68,6 +76,11 @@ namespace Polycode {
 			int type;
 			String resourcePath;
 			String name;
+			
+			/**
+			* Manager the resource was added to, or NULL.
+			*/
+			ResourceManager *resourceManager;
 	
 					
 	};
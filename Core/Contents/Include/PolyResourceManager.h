@@ -41,7 +41,12 @@ using std::string;
 namespace Polycode {
 
 	/**
-	* Manages loading and unloading of resources from directories and archives. Should only be accessed via the CoreServices singleton. 
+	* Stable handle to a resource registered with the ResourceManager.
+	*/
+	typedef unsigned int ResourceHandle;
+
+	/**
+	* Manages loading and unloading of resources from directories and archives. Should only be accessed via the CoreServices singleton. Resources are indexed by type and name in a hash table, so lookups take constant time.
 	*/ 
 	class _PolyExport ResourceManager {
 		public:
@@ -49,13 +54,14 @@ namespace Polycode {
 			~ResourceManager();
 			
 			/** 
-			* Adds a new resource.
+			* Adds a new resource. The resource is indexed under its current name and moved in the index when it is renamed. If a resource of the same type and name was added before, lookups will keep returning the earlier one.
 			* @param resource Resource to add.
+			* @return Handle to the resource.
 			*/ 
-			void addResource(Resource *resource);
+			ResourceHandle addResource(Resource *resource);
 			
 			/**
-			* Loads resources from a directory.
+			* Loads resources from a directory. The directory is scanned once, then textures, programs, shaders, cubemaps and materials are created in that order so that later resources can refer to earlier ones. Every material file is parsed once.
 			* @param dirPath Path to directory to load resources from.
 			* @param recursive If true, will recurse into subdirectories.
 			*/
@@ -81,12 +87,55 @@ namespace Polycode {
 			* @param resourceName Name of the resource to request.
 			*/
 			Resource *getResource(int resourceType, String resourceName);
+			
+			/**
+			* Returns the handle of a loaded resource.
+			* @param resourceType Type of resource. See Resource for available resource types.
+			* @param resourceName Name of the resource to request.
+			* @return Handle to the resource or INVALID_RESOURCE_HANDLE if there is no such resource.
+			*/
+			ResourceHandle getResourceHandle(int resourceType, String resourceName);
+			
+			/**
+			* Returns the resource for a handle, or NULL if the handle is invalid.
+			*/
+			Resource *getResourceByHandle(ResourceHandle handle);
+			
+			/**
+			* Moves a resource to its new name in the index. Called by Resource::setResourceName(), so renamed resources are found under their new name.
+			* @param resource Resource that was renamed.
+			* @param oldName Name the resource was indexed under.
+			*/
+			void reindexResource(Resource *resource, const String &oldName);
 		
 			void addShaderModule(PolycodeShaderModule *module);
-		
+			
+			static const ResourceHandle INVALID_RESOURCE_HANDLE = 0xFFFFFFFF;
 		
 		private:
+		
+			void scanDirectory(String dirPath, bool recursive, vector<OSFileEntry> &files);
+			
+			void loadTexture(OSFileEntry entry);
+			void loadPrograms(OSFileEntry entry);
+			void loadShaders(TiXmlDocument *doc);
+			void loadCubemaps(TiXmlDocument *doc);
+			void loadMaterials(TiXmlDocument *doc);
+			void loadOther(OSFileEntry entry);
+			TiXmlDocument *loadMaterialFile(OSFileEntry entry);
+			
+			static unsigned int hashResourceKey(int resourceType, const String &resourceName);
+			void indexResource(ResourceHandle handle);
+			void growIndex();
+			
 			vector <Resource*> resources;
 			vector <PolycodeShaderModule*> shaderModules;
+			
+			/**
+			* Open hashing buckets of resource handles.
+			*/
+			vector< vector<ResourceHandle> > resourceIndex;
+			
+			static const int INITIAL_INDEX_SIZE = 256;
 	};
 }
\ No newline at end of file
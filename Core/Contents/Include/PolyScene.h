@@ -28,15 +28,71 @@ THE SOFTWARE.
 #include "PolyCamera.h"
 #include "PolySceneLight.h"
 #include "PolySceneMesh.h"
+#include "PolyRenderQueue.h"
+#include "PolyJobSystem.h"
 #include <vector>
+#include <map>
 
 using std::vector;
+using std::map;
 
 namespace Polycode {
 		
 	class Camera;
 	class SceneLight;
 	class SceneMesh;
+	class Material;
+	class Texture;
+	
+	/**
+	* Key of a static batch. Static meshes with equal keys are merged into the same batch.
+	*/
+	class _PolyExport StaticBatchKey {
+		public:
+			StaticBatchKey() : material(NULL), texture(NULL), lightmapIndex(0), backfaceCulled(true), alphaTest(false), depthTest(true), depthWrite(true), cellX(0), cellY(0), cellZ(0) {}
+			
+			bool operator < (const StaticBatchKey &other) const;
+			
+			Material *material;
+			Texture *texture;
+			unsigned int lightmapIndex;
+			bool backfaceCulled;
+			bool alphaTest;
+			bool depthTest;
+			bool depthWrite;
+			int cellX;
+			int cellY;
+			int cellZ;
+	};
+	
+	/**
+	* Culling tree change found while updating the scene's entities. Changes are collected first and applied to the tree afterwards, so that collecting them can run in parallel.
+	*/
+	class _PolyExport SceneCullingUpdate {
+		public:
+			Entity *entity;
+			AABB worldAABB;
+			int action;
+			
+			static const int ACTION_NONE = 0;
+			static const int ACTION_CREATE = 1;
+			static const int ACTION_MOVE = 2;
+	};
+	
+	class Scene;
+	
+	/**
+	* Range of a scene's top level entities that is updated by one job when parallel updates are enabled.
+	*/
+	class _PolyExport SceneUpdateBatch {
+		public:
+			Scene *scene;
+			int beginEntity;
+			int endEntity;
+			Job updateJob;
+			Job cullingJob;
+			vector<SceneCullingUpdate> cullingUpdates;
+	};
 	
 	/**
 	* 3D rendering container. The Scene class is the main container for all 3D rendering in Polycode. Scenes are automatically rendered and need only be instantiated to immediately add themselves to the rendering pipeline. A Scene is created with a camera automatically.
@@ -85,6 +141,17 @@ namespace Polycode {
 		*/		
 		void enableFog(bool enable);
 		
+		/**
+		* Enables and disables the flattened transform hierarchy. When enabled, the world matrices of all entities in the scene are kept in a TransformHierarchy and updated in a single linear sweep each frame, which is faster than the recursive per-entity update for scenes with many moving entities. Disabled by default.
+		* @param enable If true, enables the transform hierarchy, if false, disables it.
+		*/
+		void enableTransformHierarchy(bool enable);
+		
+		/**
+		* Returns the scene's transform hierarchy or NULL if it is not enabled.
+		*/
+		TransformHierarchy *getTransformHierarchy();
+		
 		/**
 		* Sets the fog properties for the scene.
 		* @param fogMode Fog falloff mode. (Renderer::FOG_LINEAR, Renderer::FOG_EXP, Renderer::FOG_EXP2).
@@ -116,6 +183,16 @@ namespace Polycode {
 		void Render(Camera *targetCamera = NULL);
 		void RenderDepthOnly(Camera *targetCamera);
 		
+		/**
+		* Brings the scene's culling tree up to date with the world space bounds of all entities and their children. This is called automatically by Render().
+		*/
+		void updateCulling();
+		
+		/**
+		* Returns the number of entities that were visible to the camera in the last render pass.
+		*/
+		int getNumVisibleEntities();
+		
 		static String readString(OSFILE *inFile);
 		void loadScene(String fileName);
 		void generateLightmaps(Number lightMapRes, Number lightMapQuality, int numRadPasses);
@@ -134,6 +211,19 @@ namespace Polycode {
 		int getNumStaticGeometry();
 		SceneMesh *getStaticGeometry(int index);
 		
+		/**
+		* Merges the static geometry into batches to cut down on draw calls. Meshes sharing a material, texture, lightmap page and render state (backface culling, alpha test, depth test and depth write) are pre-transformed into one indexed mesh per grid cell of staticBatchCellSize, so batches can still be culled. Entity colors are baked into the vertex colors. The merged meshes stay in the scene but are hidden, so getStaticGeometry() and collision keep working. Meshes with the entity property "batch" set to "false", hidden meshes, skinned meshes and translucent meshes (alpha below 1, non-default blending or depth write off) are not batched. Called by loadScene() if staticBatching is true.
+		*/
+		void batchStaticGeometry();
+		
+		/**
+		* Removes the static batches and shows the meshes they were built from again.
+		*/
+		void clearStaticBatches();
+		
+		int getNumStaticBatches();
+		SceneMesh *getStaticBatch(int index);
+		
 		virtual void loadCollisionChild(SceneEntity *entity, bool autoCollide=false, int type=0){}
 		
 		int getNumLights();
@@ -173,8 +263,49 @@ namespace Polycode {
 		*/
 		bool enabled;		
 		
+		/**
+		* If set to true, loadScene() batches the static geometry after loading. Defaults to false.
+		*/
+		bool staticBatching;
+		
+		/**
+		* Size of the grid cells static batches are split by. Defaults to 50.
+		*/
+		Number staticBatchCellSize;
+		
+		/**
+		* If set to true, the scene splits its top level entities into batches and runs their Update() calls, matrix updates and culling preparation as jobs on the JobSystem. Defaults to false.
+		*
+		* While this is enabled, Update() overrides of entities in the scene run on worker threads, concurrently with the updates of other top level entities. They may freely change their own entity and its children and read their parents' matrices, but must not touch other top level entities or their subtrees, must not add, remove, reparent or delete entities, dispatch events, use the renderer or load resources, and may only read from the managers of CoreServices. The order in which top level entities are updated is not defined.
+		*/
+		bool parallelUpdates;
+		
 	protected:
 		
+		void updateEntities();
+		void updateEntitiesParallel();
+		static void runUpdateJob(void *data);
+		static void runCullingJob(void *data);
+		
+		void gatherEntityCulling(Entity *entity, vector<SceneCullingUpdate> &updates);
+		void applyCullingUpdates(const vector<SceneCullingUpdate> &updates);
+		void removeStaleCulling();
+		void clearEntityCulling(Entity *entity);
+		void cullForCamera(Camera *camera);
+		void restoreCulling();
+		
+		RenderQueue renderQueue;
+		
+		AABBTree cullingTree;
+		TransformHierarchy *transformHierarchy;
+		vector<unsigned int> cullingStamps;
+		unsigned int cullingStamp;
+		vector<SceneCullingUpdate> cullingUpdates;
+		vector<SceneUpdateBatch> updateBatches;
+		vector<void*> visibleEntities;
+		vector<Entity*> unculledParents;
+		int numVisibleEntities;
+		
 		bool hasLightmaps;
 		
 		vector <SceneLight*> lights;				
@@ -182,6 +313,12 @@ namespace Polycode {
 		vector <SceneMesh*> collisionGeometry;
 		vector <SceneEntity*> customEntities;
 		
+		bool isStaticBatchable(SceneMesh *sceneMesh);
+		SceneMesh *createStaticBatch(const StaticBatchKey &key, vector<SceneMesh*> &sceneMeshes);
+		
+		vector <SceneMesh*> staticBatches;
+		vector <SceneMesh*> batchedGeometry;
+		
 		
 		bool isSceneVirtual;
 		
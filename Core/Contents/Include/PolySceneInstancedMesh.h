@@ -0,0 +1,125 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolySceneMesh.h"
+#include "PolyMatrix4.h"
+#include "PolyColor.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	/**
+	* Draws one mesh many times with a single draw submission. Each instance has its own transform, relative to the instanced mesh, and color. Instances outside of the view frustum are culled before drawing, the rest are handed to Renderer::drawArraysInstanced(), which uses hardware instancing when the renderer and the applied shader support it.
+	*
+	* Instanced meshes are always drawn from the mesh render arrays. Skeletons and vertex buffers are not used.
+	*/
+	class _PolyExport SceneInstancedMesh : public SceneMesh {
+		public:
+			/**
+			* Construct an instanced mesh from an existing Mesh instance.
+			*/
+			SceneInstancedMesh(Mesh *mesh);
+			
+			/**
+			* Construct an instanced mesh from a mesh file.
+			* @param fileName Path to mesh file to load.
+			*/
+			SceneInstancedMesh(String fileName);
+			
+			virtual ~SceneInstancedMesh();
+			
+			void renderGeometry();
+			
+			/**
+			* Adds a new instance.
+			* @param transform Instance transform relative to the instanced mesh.
+			* @param color Instance color. It is multiplied by the combined color of the instanced mesh.
+			* @return Index of the new instance.
+			*/
+			unsigned int addInstance(const Matrix4 &transform, Color color = Color(1.0f,1.0f,1.0f,1.0f));
+			
+			/**
+			* Removes an instance. The last instance is moved into the freed index to keep the instance data packed.
+			* @param index Index of the instance to remove.
+			*/
+			void removeInstance(unsigned int index);
+			
+			/**
+			* Removes all instances.
+			*/
+			void clearInstances();
+			
+			/**
+			* Sets the transform of an instance.
+			*/
+			void setInstanceTransform(unsigned int index, const Matrix4 &transform);
+			
+			/**
+			* Sets the color of an instance.
+			*/
+			void setInstanceColor(unsigned int index, Color color);
+			
+			/**
+			* Returns the transform of an instance.
+			*/
+			Matrix4 getInstanceTransform(unsigned int index);
+			
+			/**
+			* Returns the color of an instance.
+			*/
+			Color getInstanceColor(unsigned int index);
+			
+			/**
+			* Returns the number of instances.
+			*/
+			unsigned int getNumInstances();
+			
+			/**
+			* Returns the number of instances that passed frustum culling the last time the mesh was drawn.
+			*/
+			unsigned int getNumVisibleInstances();
+			
+			/**
+			* Recalculates the instance bounds and the bounding box of the instanced mesh. Call this after changing the vertices of the mesh.
+			*/
+			void updateInstanceBounds();
+			
+		protected:
+		
+			void updateInstanceBound(unsigned int index);
+			void updateGroupBounds();
+		
+			Number meshRadius;
+			
+			vector<Matrix4> instanceTransforms;
+			vector<Color> instanceColors;
+			vector<Number> instanceRadii;
+			
+			vector<Matrix4> visibleTransforms;
+			vector<Color> visibleColors;
+			unsigned int numVisibleInstances;
+	};
+}
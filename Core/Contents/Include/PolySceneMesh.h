@@ -64,6 +64,9 @@ namespace Polycode {
 			
 			void Render();
 			
+			bool getRenderResources(RenderQueueItem *item);
+			void renderGeometry();
+			
 			ShaderBinding *getLocalShaderOptions();
 			
 			/**
@@ -135,6 +138,47 @@ namespace Polycode {
 			* If this is set to true, the mesh will be cached to a hardware vertex buffer if those are available. This can dramatically speed up rendering.
 			*/
 			void cacheToVertexBuffer(bool cache);
+			
+			/**
+			* Adds a simplified mesh that is rendered instead of the main mesh once the mesh covers less than a fraction of the screen height. Levels must be added from the most to the least detailed, with decreasing screen sizes. The mesh is not deleted with the scene mesh.
+			* @param lodMesh Mesh to render at this level.
+			* @param screenSize Fraction of the screen height the bounding sphere must drop below for this level to be used.
+			*/
+			void addLODLevel(Mesh *lodMesh, Number screenSize);
+			
+			/**
+			* Replaces the levels of detail with simplified copies of the main mesh, see Mesh::createLODChain(). The generated meshes are deleted with the scene mesh.
+			* @param numLevels Number of levels to generate.
+			* @param triangleRatio Fraction of the triangles each level keeps of the previous one.
+			* @param firstScreenSize Screen size of the first level, each following level uses half the screen size of the one before it.
+			*/
+			void generateLODLevels(unsigned int numLevels, Number triangleRatio = 0.5, Number firstScreenSize = 0.25);
+			
+			/**
+			* Removes all levels of detail, deleting the generated ones.
+			*/
+			void clearLODLevels();
+			
+			/**
+			* Returns the number of levels of detail, not counting the main mesh.
+			*/
+			unsigned int getNumLODLevels();
+			
+			/**
+			* Returns the mesh of a level of detail.
+			* @param level Level to return, 0 is the main mesh and 1 to getNumLODLevels() are the added levels.
+			*/
+			Mesh *getLODMesh(unsigned int level);
+			
+			/**
+			* Returns the level of detail selected for the last render, 0 being the main mesh.
+			*/
+			unsigned int getCurrentLODLevel() { return currentLODLevel; }
+			
+			/**
+			* Fraction by which the screen size has to move past a level's threshold before the level changes, so meshes right at a threshold do not switch every frame. Defaults to 0.1.
+			*/
+			Number lodHysteresis;
 	
 			unsigned int lightmapIndex;
 			
@@ -143,11 +187,23 @@ namespace Polycode {
 		
 		protected:
 		
+			void updateLODLevel(const Matrix4 &modelviewMatrix);
+			Mesh *getCurrentMesh();
+		
 			bool useVertexBuffer;
 			Mesh *mesh;
 			Texture *texture;
 			Material *material;
 			Skeleton *skeleton;
 			ShaderBinding *localShaderOptions;
+			
+			vector<Mesh*> lodMeshes;
+			vector<Number> lodScreenSizes;
+			vector<bool> lodMeshesOwned;
+			unsigned int currentLODLevel;
+			
+			vector<Matrix4> boneSkinningMatrices;
+			vector<Matrix4> skinningMatrices;
+			vector<float> skinningData;
 	};
 }
\ No newline at end of file
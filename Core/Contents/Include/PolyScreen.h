@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "PolyRenderer.h"
 #include "PolyInputEvent.h"
 #include "PolyCoreServices.h"
+#include "PolySpriteBatch.h"
 #include <vector>
 #include <algorithm>
 #include "PolyScreenEvent.h"
@@ -136,6 +137,16 @@ namespace Polycode {
 		*/
 		bool enabled;
 		
+		/**
+		* If set to true (the default), quads that share a texture and render state are drawn in batches. The drawing order stays the same as without batching.
+		*/
+		bool spriteBatching;
+		
+		/**
+		* Returns the screen's sprite batch.
+		*/
+		SpriteBatch *getSpriteBatch() { return &spriteBatch; }
+		
 	protected:
 		
 		bool useNormalizedCoordinates;
@@ -153,5 +164,7 @@ namespace Polycode {
 		Texture *zBufferSceneTexture;						
 		vector<ShaderBinding*> localShaderOptions;
 		bool _hasFilterShader;
+		
+		SpriteBatch spriteBatch;
 	};
 }
\ No newline at end of file
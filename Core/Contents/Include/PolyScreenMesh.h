@@ -53,6 +53,8 @@ namespace Polycode {
 			
 			void Render();
 			
+			bool addToSpriteBatch(SpriteBatch *batch);
+			
 			/**
 			* Returns the mesh for this screen mesh.
 			* @return The mesh.
@@ -82,6 +84,11 @@ namespace Polycode {
 			*/						
 			void setTexture(Texture *texture);
 			
+			/**
+			* If true (the default), single quad meshes are drawn through the screen's sprite batch instead of Render(). Set this to false in subclasses that do their own drawing in Render().
+			*/
+			bool allowSpriteBatching;
+			
 		protected:
 		
 			Mesh *mesh;
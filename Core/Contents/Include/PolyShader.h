@@ -71,7 +71,7 @@ namespace Polycode {
 		void *data;		
 	} LocalShaderParam;	
 	
-	typedef struct {
+	typedef struct RenderTargetBinding {
 			String id;
 			String name;
 			int mode;
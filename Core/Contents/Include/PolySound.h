@@ -47,8 +47,10 @@ using std::vector;
 
 namespace Polycode {
 	
+	class SoundManager;
+	
 	/**
-	* Loads and plays a sound. This class can load and play an OGG or WAV sound file.
+	* Loads and plays a sound. This class can load and play an OGG or WAV sound file. OGG files can also be streamed, in which case they are decoded in small chunks by the sound manager's stream thread instead of being loaded into memory all at once.
 	*/
 	class _PolyExport Sound {
 	public:
@@ -56,21 +58,38 @@ namespace Polycode {
 		/**
 		* Constructor.
 		* @param fileName Path to an OGG or WAV file to load.
+		* @param streaming If true and the file is an OGG file, stream it from disk instead of decoding it fully on load. Use this for music and other long sounds.
 		*/ 
-		Sound(String fileName);
+		Sound(String fileName, bool streaming=false);
 		~Sound();
 		
 		/**
-		* Play the sound once or in a loop.
+		* Play the sound once or in a loop. Streaming sounds start playing from their current stream position, which is the beginning of the sound unless setOffset() was called.
 		* @param once If this is true, play it once, otherwise, loop.
 		*/
 		void Play(bool loop=false);
 		
 		/**
-		* Stop the sound playback.
+		* Stop the sound playback. This rewinds the sound to its beginning.
 		*/		
 		void Stop();
 		
+		/**
+		* Seeks to a position in the sound.
+		* @param seconds Position to seek to, in seconds from the beginning of the sound.
+		*/
+		void setOffset(Number seconds);
+		
+		/**
+		* Returns true if the sound is streamed from disk.
+		*/
+		bool isStreaming();
+		
+		/**
+		* Refills the processed buffers of a streaming sound. This is called by the sound manager's stream thread with the stream lock held and shouldn't be called directly.
+		*/
+		void updateStream();
+		
 		/**
 		* Sets the volume of this sound.
 		* @param newVolume A Number 0-1, where 0 is no sound and 1 is the loudest.
@@ -102,11 +121,32 @@ namespace Polycode {
 		void soundCheck(bool result, String err);
 		static unsigned long readByte32(const unsigned char buffer[4]);		
 		static unsigned short readByte16(const unsigned char buffer[2]);
+		
+		/**
+		* Number of OpenAL buffers queued on the source of a streaming sound. Each of them holds BUFFER_SIZE bytes of decoded audio.
+		*/
+		static const int STREAM_BUFFER_COUNT = 4;
 
 	private:
 	
+		bool openStream(String fileName);
+		bool fillStreamBuffer(ALuint buffer);
+		void restartStream();
+		void rewindStream();
+	
 		bool isPositional;
 		ALuint soundSource;
 		
+		bool streaming;
+		bool streamPlaying;
+		bool streamLooping;
+		bool streamEnded;
+		OggVorbis_File streamFile;
+		ALenum streamFormat;
+		ALsizei streamFreq;
+		ALuint streamBuffers[STREAM_BUFFER_COUNT];
+		char *streamData;
+		SoundManager *soundManager;
+		
 	};
 }
\ No newline at end of file
@@ -28,9 +28,40 @@
 #include "al.h"
 #include "alc.h"
 #include "PolyVector3.h"
+#include "PolyThreaded.h"
+#include <vector>
 
 namespace Polycode {
 	
+	class Core;
+	class CoreMutex;
+	class Sound;
+	
+	/**
+	* Background thread that keeps the buffer queues of streaming sounds filled. It is created and owned by the SoundManager.
+	*/
+	class _PolyExport SoundStreamThread : public Threaded {
+	public:
+		SoundStreamThread(Core *core, CoreMutex *mutex);
+		
+		void runThread();
+		void updateThread();
+		
+		/**
+		* Streaming sounds serviced by this thread. Only access this with the stream lock held.
+		*/
+		std::vector<Sound*> streams;
+		
+		/**
+		* Time to sleep between updates, in milliseconds.
+		*/
+		static const int UPDATE_INTERVAL = 20;
+		
+	protected:
+		Core *core;
+		CoreMutex *mutex;
+	};
+	
 	/**
 	* Controls global sound settings.
 	*/
@@ -48,9 +79,28 @@ namespace Polycode {
 		*/ 
 		void setGlobalVolume(Number globalVolume);
 		
+		/**
+		* Registers a streaming sound with the stream thread, starting the thread if needed. This is called by Sound and has to be called from the main thread.
+		*/
+		void addStream(Sound *sound);
+		
+		/**
+		* Unregisters a streaming sound. Once this returns, the stream thread will no longer touch the sound.
+		*/
+		void removeStream(Sound *sound);
+		
+		/**
+		* Locks the streams against the stream thread. Streaming sounds hold this lock while they change their buffer queues or decoder state.
+		*/
+		void lockStreams();
+		void unlockStreams();
 		
 	private:
 		
+		Core *core;
+		CoreMutex *streamMutex;
+		SoundStreamThread *streamThread;
+		
 		ALCdevice* device;
 		ALCcontext* context;		
 	};
@@ -0,0 +1,111 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include "PolyColor.h"
+#include "PolyMesh.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	class Entity;
+	class Renderer;
+	class Texture;
+	class Polygon;
+
+	/**
+	* Collects textured quads from 2D entities into a single vertex array and draws them with as few draw calls as possible. Quads are transformed on the CPU and kept in submission order, so the batch only merges neighbouring quads and never changes the drawing order. The batch is flushed whenever the texture, blending mode, depth, alpha test or culling state changes. Quads using regions of the same TextureAtlas page share a batch. The batch is also flushed whenever an entity that can not be batched (for example a masked entity) has to be drawn.
+	*
+	* Screens use a sprite batch automatically, see Screen::spriteBatching.
+	*/
+	class _PolyExport SpriteBatch {
+		public:
+			SpriteBatch();
+			~SpriteBatch();
+			
+			/**
+			* Starts a new frame and resets the per frame counters.
+			* @param renderer Renderer to draw with.
+			*/
+			void begin(Renderer *renderer);
+			
+			/**
+			* Draws the remaining quads. Call at the end of the frame.
+			*/
+			void end();
+			
+			/**
+			* Adds a quad to the batch, flushing the collected quads first if the entity's render state differs from theirs.
+			* @param entity Entity the quad belongs to. Its blending mode, depth, alpha test and backface culling settings are used for the quad.
+			* @param texture Texture to draw the quad with or NULL.
+			* @param transform Transform applied to the quad vertices, usually the current modelview matrix.
+			* @param quad Polygon with the four quad vertices.
+			* @param useVertexColors If true, the vertex colors of the polygon are used instead of color.
+			* @param color Color of the quad.
+			*/
+			void addQuad(Entity *entity, Texture *texture, const Matrix4 &transform, Polygon *quad, bool useVertexColors, const Color &color);
+			
+			/**
+			* Draws the collected quads and empties the batch. The modelview matrix is left untouched.
+			*/
+			void flush();
+			
+			/**
+			* Returns the number of quads waiting to be drawn.
+			*/
+			unsigned int getNumPendingQuads() { return numQuads; }
+			
+			/**
+			* Returns the number of draw calls made by the batch since begin().
+			*/
+			unsigned int getNumFlushes() { return numFlushes; }
+			
+			/**
+			* Returns the number of quads drawn by the batch since begin().
+			*/
+			unsigned int getNumBatchedQuads() { return numBatchedQuads; }
+			
+		protected:
+		
+			bool stateMatches(Entity *entity, Texture *texture);
+			
+			Renderer *renderer;
+			
+			Texture *texture;
+			int blendingMode;
+			bool depthWrite;
+			bool depthTest;
+			bool alphaTest;
+			bool backfaceCulled;
+			
+			vector<float> vertexData;
+			RenderDataArray vertexArray;
+			unsigned int numQuads;
+			
+			unsigned int numFlushes;
+			unsigned int numBatchedQuads;
+	};
+}
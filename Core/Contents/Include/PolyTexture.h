@@ -25,6 +25,10 @@
 #include "PolyGlobals.h"
 #include "PolyResource.h"
 #include "PolyImage.h"
+#include "PolyMatrix4.h"
+#include <vector>
+
+using std::vector;
 
 namespace Polycode {
 
@@ -54,6 +58,74 @@ namespace Polycode {
 			
 			int getWidth();
 			int getHeight();
+			
+			/**
+			* Returns the texture that has to be bound to draw this texture. This is the texture itself, except for texture atlas regions, which return their atlas page.
+			*/
+			virtual Texture *getPageTexture() { return this; }
+			
+			/**
+			* Returns true if this texture is a region of a texture atlas page.
+			*/
+			virtual bool isAtlasRegion() { return false; }
+			
+			/**
+			* Returns the matrix mapping this texture's coordinates to the coordinates of the texture returned by getPageTexture().
+			*/
+			virtual Matrix4 getTexCoordMatrix() { return Matrix4(); }
+			
+			/**
+			* Sets precomputed mipmap levels and recreates the texture. The data is copied.
+			* @param levels Levels below the base level, largest first, as created by Image::createMipmapChain(). Each level must be half the size of the previous one and have the pixel type of the texture.
+			*/
+			void setMipmapLevels(const vector<Image*> &levels);
+			
+			/**
+			* Sets block compressed data for all levels of the texture and recreates it. The data is copied. The uncompressed base level is kept and used if the renderer can not use compressed textures.
+			* @param format Compression format. Can be Image::COMPRESSION_BC1 or Image::COMPRESSION_BC3.
+			* @param levels Compressed data of each level, starting with the base level.
+			* @param levelSizes Size of each level's data in bytes.
+			*/
+			void setCompressedData(int format, const vector<char*> &levels, const vector<unsigned int> &levelSizes);
+			
+			/**
+			* Removes the mipmap levels and compressed data, leaving only the uncompressed base level. Does not recreate the texture.
+			*/
+			void clearLevels();
+			
+			/**
+			* Returns the compression format of the texture. Image::COMPRESSION_NONE if the texture is not compressed.
+			*/
+			int getCompressionFormat();
+			
+			/**
+			* Returns the number of levels of the texture, including the base level.
+			*/
+			unsigned int getNumLevels();
+			
+			/**
+			* Returns the data of a level. Compressed if the texture is compressed.
+			* @param level Index of the level, 0 is the base level.
+			*/
+			char *getLevelData(unsigned int level);
+			
+			/**
+			* Returns the size of a level's data in bytes.
+			* @param level Index of the level, 0 is the base level.
+			*/
+			unsigned int getLevelDataSize(unsigned int level);
+			
+			/**
+			* Returns the width of a level in pixels.
+			* @param level Index of the level, 0 is the base level.
+			*/
+			int getLevelWidth(unsigned int level);
+			
+			/**
+			* Returns the height of a level in pixels.
+			* @param level Index of the level, 0 is the base level.
+			*/
+			int getLevelHeight(unsigned int level);
 		
 			bool clamp;
 		
@@ -66,6 +138,11 @@ namespace Polycode {
 			int height;
 			String resourcePath;
 			char *textureData;
+			
+			int compressionFormat;
+			vector<char*> levelData;
+			vector<unsigned int> levelDataSizes;
+			
 			Number scrollOffsetX;
 			Number scrollOffsetY;
 	};
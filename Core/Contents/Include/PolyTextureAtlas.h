@@ -0,0 +1,215 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyTexture.h"
+#include "PolyImage.h"
+#include "PolyMatrix4.h"
+#include <vector>
+#include <map>
+#include <string>
+
+using std::vector;
+using std::map;
+using std::wstring;
+
+namespace Polycode {
+
+	/**
+	* A rectangular region of a texture atlas page. Atlas regions can be used anywhere a Texture is expected by the fixed function renderer and the screen entities. Their width and height are the ones of the original image and their texture coordinates run from 0 to 1 like on any other texture; the renderer binds the page texture instead and maps the coordinates into the region. Shaders see the whole page and are responsible for their own coordinate mapping.
+	*/
+	class _PolyExport TextureAtlasRegion : public Texture {
+		public:
+			/**
+			* Creates a region on an atlas page.
+			* @param page Page texture.
+			* @param pageIndex Index of the page in its atlas.
+			* @param x Horizontal pixel position of the region on the page.
+			* @param y Vertical pixel position of the region on the page.
+			* @param width Width of the original image.
+			* @param height Height of the original image.
+			* @param rotated If true, the image is stored rotated by 90 degrees and takes up height x width pixels on the page.
+			*/
+			TextureAtlasRegion(Texture *page, unsigned int pageIndex, int x, int y, int width, int height, bool rotated);
+			virtual ~TextureAtlasRegion();
+			
+			/**
+			* Atlas regions do not own any pixels. Update the atlas page instead.
+			*/
+			void setTextureData(char *data);
+			void recreateFromImageData();
+			
+			Texture *getPageTexture();
+			bool isAtlasRegion();
+			Matrix4 getTexCoordMatrix();
+			
+			/**
+			* Returns the index of the region's page in its atlas.
+			*/
+			unsigned int getPageIndex();
+			
+			/**
+			* Returns the horizontal pixel position of the region on the page.
+			*/
+			int getPageX();
+			
+			/**
+			* Returns the vertical pixel position of the region on the page.
+			*/
+			int getPageY();
+			
+			/**
+			* Returns true if the image is stored rotated by 90 degrees on the page.
+			*/
+			bool isRotated();
+			
+		protected:
+			
+			Texture *page;
+			unsigned int pageIndex;
+			int pageX;
+			int pageY;
+			bool rotated;
+			Matrix4 texCoordMatrix;
+	};
+	
+	/**
+	* Node of the binary tree used to pack images into a texture atlas page.
+	*/
+	class _PolyExport TextureAtlasNode {
+		public:
+			TextureAtlasNode(int x, int y, int width, int height);
+			~TextureAtlasNode();
+			
+			/**
+			* Finds a free rectangle of the specified size in the tree and marks it as used.
+			* @return The node of the rectangle or NULL if there is no room left.
+			*/
+			TextureAtlasNode *insert(int width, int height);
+			
+			int x;
+			int y;
+			int width;
+			int height;
+			bool used;
+			TextureAtlasNode *child[2];
+	};
+	
+	/**
+	* Packs many small images into a few large texture pages. Sharing pages lets the renderer draw different images without rebinding textures, so screen entities using atlas regions can be batched together, and only the pages are padded to the hardware's texture size requirements instead of every image.
+	*
+	* Images are added with addImage() or addImageFromFile() and packed when build() is called. Each image is surrounded by padding pixels, which are filled with the image's edge pixels if edge extrusion is enabled, so that filtering never samples a neighbouring image. If rotation is allowed, images that do not fit upright are stored rotated by 90 degrees. Images can be added after a build; the next build() adds them to the existing pages, and regions handed out earlier stay valid.
+	*
+	* Register an atlas with MaterialManager::addTextureAtlas() to have MaterialManager::createTextureFromFile() return atlas regions for the packed files. Screen images, shapes and sprites created from these files then use the atlas without any changes.
+	*/
+	class _PolyExport TextureAtlas {
+		public:
+			/**
+			* Creates an empty atlas.
+			* @param pageWidth Width of the atlas pages in pixels.
+			* @param pageHeight Height of the atlas pages in pixels.
+			* @param padding Number of pixels kept free around each image.
+			* @param extrudeEdges If true, the padding around each image is filled with its edge pixels.
+			* @param allowRotation If true, images may be stored rotated by 90 degrees to fit better.
+			*/
+			TextureAtlas(int pageWidth = 1024, int pageHeight = 1024, int padding = 2, bool extrudeEdges = true, bool allowRotation = true);
+			~TextureAtlas();
+			
+			/**
+			* Adds an image to be packed by the next build(). The image is copied by build() and can be deleted afterwards.
+			* @param name Name to look the region up by.
+			* @param image Image to add. RGB and RGBA images are supported.
+			*/
+			void addImage(String name, Image *image);
+			
+			/**
+			* Loads an image file and adds it to be packed by the next build(). The region is named after the file name.
+			* @param fileName Path to the image file.
+			* @return True if the image was loaded.
+			*/
+			bool addImageFromFile(String fileName);
+			
+			/**
+			* Packs all images added since the last build and uploads the changed pages.
+			*/
+			void build();
+			
+			/**
+			* Returns the region for an image name or NULL if there is none.
+			* @param name Name of the image.
+			*/
+			TextureAtlasRegion *getRegion(const String &name);
+			
+			/**
+			* Returns the number of regions in the atlas.
+			*/
+			unsigned int getNumRegions();
+			
+			/**
+			* Returns the number of pages in the atlas.
+			*/
+			unsigned int getNumPages();
+			
+			/**
+			* Returns a page texture.
+			* @param index Index of the page.
+			*/
+			Texture *getPage(unsigned int index);
+			
+			/**
+			* Returns the pixels of a page.
+			* @param index Index of the page.
+			*/
+			Image *getPageImage(unsigned int index);
+			
+		protected:
+		
+			class PendingImage {
+				public:
+					String name;
+					Image *image;
+					bool ownsImage;
+			};
+			
+			static bool cmpPendingImageSize(const PendingImage &left, const PendingImage &right);
+			
+			TextureAtlasNode *findSpace(int width, int height, unsigned int *pageIndex);
+			void addPage();
+			void copyImage(Image *source, Image *page, int x, int y, bool rotated);
+			void extrudeImageEdges(Image *page, int x, int y, int width, int height);
+		
+			int pageWidth;
+			int pageHeight;
+			int padding;
+			bool extrudeEdges;
+			bool allowRotation;
+			
+			vector<PendingImage> pendingImages;
+			vector<Image*> pageImages;
+			vector<Texture*> pages;
+			vector<TextureAtlasNode*> pageTrees;
+			vector<bool> dirtyPages;
+			map<wstring, TextureAtlasRegion*> regions;
+	};
+}
@@ -0,0 +1,159 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	/**
+	* Topology of a transform hierarchy node. Only used internally by TransformHierarchy.
+	*/
+	class _PolyExport TransformHierarchyNode {
+		public:
+			int parent;
+			int firstChild;
+			int nextSibling;
+			int prevSibling;
+			
+			/**
+			* Position of the node in the flattened arrays, -1 if the node is free.
+			*/
+			int index;
+	};
+
+	/**
+	* Flattened transform hierarchy. Local and world matrices of all nodes are kept in contiguous arrays that are sorted so that every parent comes before its children and every subtree occupies one contiguous range. Changing a local matrix only marks the node, and updateWorldMatrices() then recomputes the world matrices of the marked nodes and their descendants in a single linear sweep over the dirty range, instead of chasing parent and child pointers.
+	*
+	* Node ids are stable. The array order is only rebuilt lazily, before the next update, when a structural change could not keep it sorted.
+	*
+	* setLocalMatrix() may be called from several threads at once as long as they change different nodes. Everything else must not run concurrently with any other call.
+	*/
+	class _PolyExport TransformHierarchy {
+		public:
+			TransformHierarchy();
+			~TransformHierarchy();
+			
+			/**
+			* Adds a new node with an identity local matrix.
+			* @param parentID Id of the parent node or -1 to add a root node.
+			* @return Node id.
+			*/
+			int createNode(int parentID = -1);
+			
+			/**
+			* Removes a node. The children of the node become root nodes.
+			* @param nodeID Node id returned by createNode()
+			*/
+			void destroyNode(int nodeID);
+			
+			/**
+			* Moves a node and its subtree under a different parent.
+			* @param nodeID Node id returned by createNode()
+			* @param parentID Id of the new parent node or -1 to make the node a root node.
+			*/
+			void setParent(int nodeID, int parentID);
+			
+			int getParent(int nodeID) const;
+			
+			/**
+			* Returns true if the id refers to a live node.
+			*/
+			bool isNode(int nodeID) const;
+			
+			/**
+			* Sets the local matrix of a node and marks it and its subtree for update.
+			* @param nodeID Node id returned by createNode()
+			* @param matrix New local matrix.
+			*/
+			void setLocalMatrix(int nodeID, const Matrix4 &matrix);
+			
+			const Matrix4 &getLocalMatrix(int nodeID) const;
+			
+			/**
+			* Returns the world matrix of a node, which is its local matrix multiplied by the world matrix of its parent. Pending changes are applied first.
+			* @param nodeID Node id returned by createNode()
+			*/
+			const Matrix4 &getWorldMatrix(int nodeID);
+			
+			/**
+			* Returns the world matrix of a node as of the last update, without applying pending changes. Unlike getWorldMatrix(), this never runs a sweep, so it is safe to call while other threads are calling setLocalMatrix(). Only check needsUpdate() first when nothing else can be changing the hierarchy.
+			* @param nodeID Node id returned by createNode()
+			*/
+			const Matrix4 &getCachedWorldMatrix(int nodeID) const;
+			
+			/**
+			* Recomputes the world matrices of all nodes that changed since the last update, together with their descendants.
+			*/
+			void updateWorldMatrices();
+			
+			/**
+			* Returns true if there are changes that have not been applied by updateWorldMatrices() yet.
+			*/
+			bool needsUpdate() const;
+			
+			/**
+			* Marks the hierarchy as being changed from several threads. While set, needsUpdate() can not be trusted and nothing may call getWorldMatrix() or updateWorldMatrices(), so readers have to compute world matrices some other way.
+			* @param forbidden True while concurrent changes are running.
+			*/
+			void setSweepForbidden(bool forbidden);
+			
+			bool isSweepForbidden() const;
+			
+			int getNumNodes() const;
+			
+			/**
+			* Removes all nodes.
+			*/
+			void clear();
+			
+		protected:
+		
+			void markDirty(int index);
+			void linkNode(int nodeID, int parentID);
+			void unlinkNode(int nodeID);
+			void rebuildOrder();
+		
+			vector<TransformHierarchyNode> nodes;
+			vector<int> freeNodes;
+			int firstRoot;
+			int numNodes;
+			
+			vector<Matrix4> localMatrices;
+			vector<Matrix4> worldMatrices;
+			vector<int> parentIndices;
+			vector<int> subtreeEnds;
+			vector<int> nodeIDs;
+			vector<char> dirtyFlags;
+			vector<unsigned int> updateStamps;
+			unsigned int updateStamp;
+			
+			volatile int dirtyBegin;
+			volatile int dirtyEnd;
+			bool orderDirty;
+			bool sweepForbidden;
+	};
+}
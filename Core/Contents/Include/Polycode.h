@@ -28,6 +28,10 @@
 #include "PolyObject.h"
 #include "PolyLogger.h"
 #include "PolyConfig.h"
+#include "PolyAABBTree.h"
+#include "PolyBatchTransform.h"
+#include "PolyTransformHierarchy.h"
+#include "PolyJobSystem.h"
 #include "PolyEntity.h"
 #include "PolyPolygon.h"
 #include "PolyEvent.h"
@@ -46,6 +50,9 @@
 #include "PolyQuaternionCurve.h"
 #include "PolyRectangle.h"
 #include "PolyRenderer.h"
+#include "PolyRenderQueue.h"
+#include "PolySpriteBatch.h"
+#include "PolyNullRenderer.h"
 #include "PolyCoreServices.h"
 #include "PolyScreen.h"
 #include "PolyScreenEntity.h"
@@ -53,6 +60,7 @@
 #include "PolyScreenMesh.h"
 #include "PolyScreenShape.h"
 #include "PolyImage.h"
+#include "PolyGlyphCache.h"
 #include "PolyFont.h"
 #include "PolyFontManager.h"
 #include "PolyScreenImage.h"
@@ -60,8 +68,10 @@
 #include "PolyScreenLabel.h"
 #include "PolyScreenCurve.h"
 #include "PolyTexture.h"
+#include "PolyTextureAtlas.h"
 #include "PolyMaterial.h"
 #include "PolyMesh.h"
+#include "PolyMeshSimplifier.h"
 #include "PolyShader.h"
 #include "PolyFixedShader.h"
 #include "PolySceneManager.h"
@@ -70,6 +80,7 @@
 #include "PolyScene.h"
 #include "PolySceneEntity.h"
 #include "PolySceneMesh.h"
+#include "PolySceneInstancedMesh.h"
 #include "PolySceneLine.h"
 #include "PolySceneLight.h"
 #include "PolySkeleton.h"
@@ -163,6 +163,23 @@ size_t OSBasics::write( const void * ptr, size_t size, size_t count, OSFILE * st
 	return 0;
 }
 
+size_t OSBasics::readNumbers(Number *values, size_t count, OSFILE *stream) {
+	double value;
+	for(size_t i=0; i < count; i++) {
+		if(read(&value, sizeof(double), 1, stream) != 1)
+			return i;
+		values[i] = value;
+	}
+	return count;
+}
+
+void OSBasics::writeNumbers(const Number *values, size_t count, OSFILE *stream) {
+	for(size_t i=0; i < count; i++) {
+		double value = values[i];
+		write(&value, sizeof(double), 1, stream);
+	}
+}
+
 int OSBasics::seek(OSFILE * stream, long int offset, int origin ) {
 	switch(stream->fileType) {
 		case OSFILE::TYPE_FILE:
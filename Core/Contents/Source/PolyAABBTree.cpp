@@ -0,0 +1,437 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyAABBTree.h"
+#include "PolyCamera.h"
+
+using namespace Polycode;
+
+AABB::AABB() {
+}
+
+AABB::AABB(const Vector3 &min, const Vector3 &max) {
+	this->min = min;
+	this->max = max;
+}
+
+bool AABB::contains(const AABB &other) const {
+	return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+		max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+}
+
+bool AABB::overlaps(const AABB &other) const {
+	if(other.min.x > max.x || other.max.x < min.x)
+		return false;
+	if(other.min.y > max.y || other.max.y < min.y)
+		return false;
+	if(other.min.z > max.z || other.max.z < min.z)
+		return false;
+	return true;
+}
+
+Number AABB::getSurfaceArea() const {
+	Number dx = max.x - min.x;
+	Number dy = max.y - min.y;
+	Number dz = max.z - min.z;
+	return 2.0 * (dx*dy + dy*dz + dz*dx);
+}
+
+AABB AABB::merge(const AABB &a, const AABB &b) {
+	AABB ret;
+	ret.min.x = a.min.x < b.min.x ? a.min.x : b.min.x;
+	ret.min.y = a.min.y < b.min.y ? a.min.y : b.min.y;
+	ret.min.z = a.min.z < b.min.z ? a.min.z : b.min.z;
+	ret.max.x = a.max.x > b.max.x ? a.max.x : b.max.x;
+	ret.max.y = a.max.y > b.max.y ? a.max.y : b.max.y;
+	ret.max.z = a.max.z > b.max.z ? a.max.z : b.max.z;
+	return ret;
+}
+
+AABBTreeNode::AABBTreeNode() {
+	userData = NULL;
+	parent = -1;
+	child1 = -1;
+	child2 = -1;
+	height = -1;
+}
+
+AABBTree::AABBTree() {
+	root = -1;
+	numProxies = 0;
+	proxyMargin = 0.1;
+}
+
+AABBTree::~AABBTree() {
+}
+
+void AABBTree::clear() {
+	nodes.clear();
+	freeNodes.clear();
+	root = -1;
+	numProxies = 0;
+}
+
+int AABBTree::allocateNode() {
+	int nodeID;
+	if(freeNodes.size() > 0) {
+		nodeID = freeNodes[freeNodes.size()-1];
+		freeNodes.pop_back();
+		nodes[nodeID] = AABBTreeNode();
+	} else {
+		nodeID = nodes.size();
+		nodes.push_back(AABBTreeNode());
+	}
+	nodes[nodeID].height = 0;
+	return nodeID;
+}
+
+void AABBTree::freeNode(int nodeID) {
+	nodes[nodeID].height = -1;
+	nodes[nodeID].userData = NULL;
+	freeNodes.push_back(nodeID);
+}
+
+int AABBTree::createProxy(const AABB &aabb, void *userData) {
+	int proxyID = allocateNode();
+	
+	Vector3 margin = aabb.max - aabb.min;
+	margin.x *= proxyMargin;
+	margin.y *= proxyMargin;
+	margin.z *= proxyMargin;
+	nodes[proxyID].aabb.min = aabb.min - margin;
+	nodes[proxyID].aabb.max = aabb.max + margin;
+	nodes[proxyID].userData = userData;
+	
+	insertLeaf(proxyID);
+	numProxies++;
+	return proxyID;
+}
+
+void AABBTree::destroyProxy(int proxyID) {
+	if(!isProxy(proxyID))
+		return;
+	removeLeaf(proxyID);
+	freeNode(proxyID);
+	numProxies--;
+}
+
+bool AABBTree::moveProxy(int proxyID, const AABB &aabb) {
+	if(nodes[proxyID].aabb.contains(aabb))
+		return false;
+	
+	removeLeaf(proxyID);
+	
+	Vector3 margin = aabb.max - aabb.min;
+	margin.x *= proxyMargin;
+	margin.y *= proxyMargin;
+	margin.z *= proxyMargin;
+	nodes[proxyID].aabb.min = aabb.min - margin;
+	nodes[proxyID].aabb.max = aabb.max + margin;
+	
+	insertLeaf(proxyID);
+	return true;
+}
+
+bool AABBTree::isProxy(int proxyID) const {
+	if(proxyID < 0 || proxyID >= nodes.size())
+		return false;
+	return nodes[proxyID].height == 0;
+}
+
+void *AABBTree::getUserData(int proxyID) const {
+	return nodes[proxyID].userData;
+}
+
+const AABB &AABBTree::getFatAABB(int proxyID) const {
+	return nodes[proxyID].aabb;
+}
+
+int AABBTree::getProxyCapacity() const {
+	return nodes.size();
+}
+
+int AABBTree::getNumProxies() const {
+	return numProxies;
+}
+
+int AABBTree::getHeight() const {
+	if(root == -1)
+		return 0;
+	return nodes[root].height;
+}
+
+void AABBTree::insertLeaf(int leaf) {
+	if(root == -1) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+	
+	// walk down to the sibling that makes the tree grow the least
+	AABB leafAABB = nodes[leaf].aabb;
+	int index = root;
+	while(!nodes[index].isLeaf()) {
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+		
+		Number area = nodes[index].aabb.getSurfaceArea();
+		Number combinedArea = AABB::merge(nodes[index].aabb, leafAABB).getSurfaceArea();
+		
+		// cost of creating a new parent for this node and the leaf
+		Number cost = 2.0 * combinedArea;
+		
+		// minimum cost of pushing the leaf further down the tree
+		Number inheritanceCost = 2.0 * (combinedArea - area);
+		
+		Number cost1 = AABB::merge(leafAABB, nodes[child1].aabb).getSurfaceArea() + inheritanceCost;
+		if(!nodes[child1].isLeaf())
+			cost1 -= nodes[child1].aabb.getSurfaceArea();
+		
+		Number cost2 = AABB::merge(leafAABB, nodes[child2].aabb).getSurfaceArea() + inheritanceCost;
+		if(!nodes[child2].isLeaf())
+			cost2 -= nodes[child2].aabb.getSurfaceArea();
+		
+		if(cost < cost1 && cost < cost2)
+			break;
+		
+		if(cost1 < cost2)
+			index = child1;
+		else
+			index = child2;
+	}
+	
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].aabb = AABB::merge(leafAABB, nodes[sibling].aabb);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+	
+	if(oldParent != -1) {
+		if(nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	} else {
+		root = newParent;
+	}
+	
+	refitFrom(nodes[leaf].parent);
+}
+
+void AABBTree::removeLeaf(int leaf) {
+	if(leaf == root) {
+		root = -1;
+		return;
+	}
+	
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling;
+	if(nodes[parent].child1 == leaf)
+		sibling = nodes[parent].child2;
+	else
+		sibling = nodes[parent].child1;
+	
+	if(grandParent != -1) {
+		if(nodes[grandParent].child1 == parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refitFrom(grandParent);
+	} else {
+		root = sibling;
+		nodes[sibling].parent = -1;
+		freeNode(parent);
+	}
+	nodes[leaf].parent = -1;
+}
+
+void AABBTree::refitFrom(int nodeID) {
+	int index = nodeID;
+	while(index != -1) {
+		index = balance(index);
+		
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+		nodes[index].height = 1 + (nodes[child1].height > nodes[child2].height ? nodes[child1].height : nodes[child2].height);
+		nodes[index].aabb = AABB::merge(nodes[child1].aabb, nodes[child2].aabb);
+		
+		index = nodes[index].parent;
+	}
+}
+
+int AABBTree::balance(int iA) {
+	AABBTreeNode *A = &nodes[iA];
+	if(A->isLeaf() || A->height < 2)
+		return iA;
+	
+	int iB = A->child1;
+	int iC = A->child2;
+	AABBTreeNode *B = &nodes[iB];
+	AABBTreeNode *C = &nodes[iC];
+	
+	int diff = C->height - B->height;
+	
+	// rotate C up
+	if(diff > 1) {
+		int iF = C->child1;
+		int iG = C->child2;
+		AABBTreeNode *F = &nodes[iF];
+		AABBTreeNode *G = &nodes[iG];
+		
+		C->child1 = iA;
+		C->parent = A->parent;
+		A->parent = iC;
+		
+		if(C->parent != -1) {
+			if(nodes[C->parent].child1 == iA)
+				nodes[C->parent].child1 = iC;
+			else
+				nodes[C->parent].child2 = iC;
+		} else {
+			root = iC;
+		}
+		
+		if(F->height > G->height) {
+			C->child2 = iF;
+			A->child2 = iG;
+			G->parent = iA;
+			A->aabb = AABB::merge(B->aabb, G->aabb);
+			C->aabb = AABB::merge(A->aabb, F->aabb);
+			A->height = 1 + (B->height > G->height ? B->height : G->height);
+			C->height = 1 + (A->height > F->height ? A->height : F->height);
+		} else {
+			C->child2 = iG;
+			A->child2 = iF;
+			F->parent = iA;
+			A->aabb = AABB::merge(B->aabb, F->aabb);
+			C->aabb = AABB::merge(A->aabb, G->aabb);
+			A->height = 1 + (B->height > F->height ? B->height : F->height);
+			C->height = 1 + (A->height > G->height ? A->height : G->height);
+		}
+		return iC;
+	}
+	
+	// rotate B up
+	if(diff < -1) {
+		int iD = B->child1;
+		int iE = B->child2;
+		AABBTreeNode *D = &nodes[iD];
+		AABBTreeNode *E = &nodes[iE];
+		
+		B->child1 = iA;
+		B->parent = A->parent;
+		A->parent = iB;
+		
+		if(B->parent != -1) {
+			if(nodes[B->parent].child1 == iA)
+				nodes[B->parent].child1 = iB;
+			else
+				nodes[B->parent].child2 = iB;
+		} else {
+			root = iB;
+		}
+		
+		if(D->height > E->height) {
+			B->child2 = iD;
+			A->child1 = iE;
+			E->parent = iA;
+			A->aabb = AABB::merge(C->aabb, E->aabb);
+			B->aabb = AABB::merge(A->aabb, D->aabb);
+			A->height = 1 + (C->height > E->height ? C->height : E->height);
+			B->height = 1 + (A->height > D->height ? A->height : D->height);
+		} else {
+			B->child2 = iE;
+			A->child1 = iD;
+			D->parent = iA;
+			A->aabb = AABB::merge(C->aabb, D->aabb);
+			B->aabb = AABB::merge(A->aabb, E->aabb);
+			A->height = 1 + (C->height > D->height ? C->height : D->height);
+			B->height = 1 + (A->height > E->height ? A->height : E->height);
+		}
+		return iB;
+	}
+	
+	return iA;
+}
+
+void AABBTree::addSubtree(int nodeID, vector<void*> &results) const {
+	if(nodes[nodeID].isLeaf()) {
+		results.push_back(nodes[nodeID].userData);
+		return;
+	}
+	addSubtree(nodes[nodeID].child1, results);
+	addSubtree(nodes[nodeID].child2, results);
+}
+
+void AABBTree::queryFrustum(Camera *camera, vector<void*> &results) const {
+	if(root == -1)
+		return;
+	
+	vector<int> stack;
+	stack.push_back(root);
+	while(stack.size() > 0) {
+		int index = stack[stack.size()-1];
+		stack.pop_back();
+		
+		int result = camera->classifyAABB(nodes[index].aabb);
+		if(result == Camera::FRUSTRUM_OUTSIDE)
+			continue;
+		
+		// no need to test anything below a node that is completely visible
+		if(result == Camera::FRUSTRUM_INSIDE || nodes[index].isLeaf()) {
+			addSubtree(index, results);
+		} else {
+			stack.push_back(nodes[index].child1);
+			stack.push_back(nodes[index].child2);
+		}
+	}
+}
+
+void AABBTree::queryAABB(const AABB &aabb, vector<void*> &results) const {
+	if(root == -1)
+		return;
+	
+	vector<int> stack;
+	stack.push_back(root);
+	while(stack.size() > 0) {
+		int index = stack[stack.size()-1];
+		stack.pop_back();
+		
+		if(!nodes[index].aabb.overlaps(aabb))
+			continue;
+		
+		if(nodes[index].isLeaf()) {
+			results.push_back(nodes[index].userData);
+		} else {
+			stack.push_back(nodes[index].child1);
+			stack.push_back(nodes[index].child2);
+		}
+	}
+}
@@ -0,0 +1,415 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyBatchTransform.h"
+#include "PolyAABBTree.h"
+#include <math.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+	#define POLYCODE_BATCH_X86
+	#include <emmintrin.h>
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define POLYCODE_SSE_FUNCTION
+		#define POLYCODE_AVX_FUNCTION
+	#else
+		#include <cpuid.h>
+		// lets the SIMD paths compile without raising the minimum CPU of the whole library
+		#define POLYCODE_SSE_FUNCTION __attribute__((target("sse2")))
+		#define POLYCODE_AVX_FUNCTION __attribute__((target("avx")))
+	#endif
+#endif
+
+using namespace Polycode;
+
+int BatchTransform::path = -1;
+
+static inline void getMatrixRows(const Matrix4 &matrix, float *rows) {
+	for(int i=0; i < 16; i++) {
+		rows[i] = matrix.ml[i];
+	}
+}
+
+static void transformPointsScalar(const float *rows, const float *input, float *output) {
+	float x = input[0];
+	float y = input[1];
+	float z = input[2];
+	output[0] = (x * rows[0]) + (y * rows[4]) + (z * rows[8]) + rows[12];
+	output[1] = (x * rows[1]) + (y * rows[5]) + (z * rows[9]) + rows[13];
+	output[2] = (x * rows[2]) + (y * rows[6]) + (z * rows[10]) + rows[14];
+}
+
+static void transformNormalScalar(const float *rows, const float *input, float *output, bool normalize) {
+	float x = input[0];
+	float y = input[1];
+	float z = input[2];
+	float nx = (x * rows[0]) + (y * rows[4]) + (z * rows[8]);
+	float ny = (x * rows[1]) + (y * rows[5]) + (z * rows[9]);
+	float nz = (x * rows[2]) + (y * rows[6]) + (z * rows[10]);
+	if(normalize) {
+		float length = sqrtf((nx * nx) + (ny * ny) + (nz * nz));
+		if(length > 0) {
+			nx /= length;
+			ny /= length;
+			nz /= length;
+		}
+	}
+	output[0] = nx;
+	output[1] = ny;
+	output[2] = nz;
+}
+
+static void transformAABBScalar(const Matrix4 &matrix, const AABB &input, AABB &output) {
+	Vector3 center = (input.min + input.max) * 0.5;
+	Vector3 half = (input.max - input.min) * 0.5;
+	const Number (*m)[4] = matrix.m;
+	
+	Vector3 newCenter = matrix * center;
+	Vector3 extents;
+	extents.x = fabs(m[0][0])*half.x + fabs(m[1][0])*half.y + fabs(m[2][0])*half.z;
+	extents.y = fabs(m[0][1])*half.x + fabs(m[1][1])*half.y + fabs(m[2][1])*half.z;
+	extents.z = fabs(m[0][2])*half.x + fabs(m[1][2])*half.y + fabs(m[2][2])*half.z;
+	
+	output.min = newCenter - extents;
+	output.max = newCenter + extents;
+}
+
+#ifdef POLYCODE_BATCH_X86
+
+static inline POLYCODE_SSE_FUNCTION void loadMatrixRows(const Matrix4 &matrix, __m128 *rows) {
+	for(int i=0; i < 4; i++) {
+#ifdef POLYCODE_SINGLE_PRECISION
+		rows[i] = _mm_loadu_ps(matrix.m[i]);
+#else
+		rows[i] = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(matrix.m[i])), _mm_cvtpd_ps(_mm_loadu_pd(matrix.m[i] + 2)));
+#endif
+	}
+}
+
+// writes three floats, the fourth float after a point usually belongs to the next attribute
+static inline POLYCODE_SSE_FUNCTION void storeVector3(float *output, __m128 v) {
+	_mm_storel_pi((__m64*)output, v);
+	_mm_store_ss(output + 2, _mm_movehl_ps(v, v));
+}
+
+static inline POLYCODE_SSE_FUNCTION __m128 transformSSE(const __m128 *rows, const float *input) {
+	__m128 r = _mm_mul_ps(_mm_set1_ps(input[0]), rows[0]);
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(input[1]), rows[1]));
+	return _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(input[2]), rows[2]));
+}
+
+static inline POLYCODE_SSE_FUNCTION __m128 normalizeSSE(__m128 v) {
+	__m128 squared = _mm_mul_ps(v, v);
+	__m128 lengthSquared = _mm_add_ss(_mm_add_ss(squared, _mm_shuffle_ps(squared, squared, 1)), _mm_movehl_ps(squared, squared));
+	if(_mm_cvtss_f32(lengthSquared) <= 0)
+		return v;
+	// reciprocal square root estimate refined by one Newton step, about 1e-7 relative error
+	__m128 inverseLength = _mm_rsqrt_ss(lengthSquared);
+	inverseLength = _mm_mul_ss(inverseLength, _mm_sub_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), lengthSquared), _mm_mul_ss(inverseLength, inverseLength))));
+	return _mm_mul_ps(v, _mm_shuffle_ps(inverseLength, inverseLength, 0));
+}
+
+static POLYCODE_SSE_FUNCTION void transformPointsSSE(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count) {
+	__m128 rows[4];
+	loadMatrixRows(matrix, rows);
+	for(unsigned int i=0; i < count; i++) {
+		storeVector3(output + (i * outputStride), _mm_add_ps(transformSSE(rows, input + (i * inputStride)), rows[3]));
+	}
+}
+
+static POLYCODE_SSE_FUNCTION void transformPointsSSE(const Matrix4 *matrices, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count) {
+	__m128 rows[4];
+	for(unsigned int i=0; i < count; i++) {
+		loadMatrixRows(matrices[i], rows);
+		storeVector3(output + (i * outputStride), _mm_add_ps(transformSSE(rows, input + (i * inputStride)), rows[3]));
+	}
+}
+
+static POLYCODE_SSE_FUNCTION void transformNormalsSSE(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize) {
+	__m128 rows[4];
+	loadMatrixRows(matrix, rows);
+	for(unsigned int i=0; i < count; i++) {
+		__m128 n = transformSSE(rows, input + (i * inputStride));
+		storeVector3(output + (i * outputStride), normalize ? normalizeSSE(n) : n);
+	}
+}
+
+static POLYCODE_SSE_FUNCTION void transformNormalsSSE(const Matrix4 *matrices, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize) {
+	__m128 rows[4];
+	for(unsigned int i=0; i < count; i++) {
+		loadMatrixRows(matrices[i], rows);
+		__m128 n = transformSSE(rows, input + (i * inputStride));
+		storeVector3(output + (i * outputStride), normalize ? normalizeSSE(n) : n);
+	}
+}
+
+static POLYCODE_SSE_FUNCTION void transformAABBSSE(const __m128 *rows, const __m128 *absRows, const AABB &input, AABB &output) {
+	float center[3];
+	float half[3];
+	center[0] = (input.min.x + input.max.x) * 0.5;
+	center[1] = (input.min.y + input.max.y) * 0.5;
+	center[2] = (input.min.z + input.max.z) * 0.5;
+	half[0] = (input.max.x - input.min.x) * 0.5;
+	half[1] = (input.max.y - input.min.y) * 0.5;
+	half[2] = (input.max.z - input.min.z) * 0.5;
+	
+	__m128 newCenter = _mm_add_ps(transformSSE(rows, center), rows[3]);
+	__m128 extents = transformSSE(absRows, half);
+	
+	float newMin[4];
+	float newMax[4];
+	_mm_storeu_ps(newMin, _mm_sub_ps(newCenter, extents));
+	_mm_storeu_ps(newMax, _mm_add_ps(newCenter, extents));
+	output.min.set(newMin[0], newMin[1], newMin[2]);
+	output.max.set(newMax[0], newMax[1], newMax[2]);
+}
+
+static POLYCODE_SSE_FUNCTION void transformAABBsSSE(const Matrix4 *matrices, unsigned int matrixStep, const AABB *input, AABB *output, unsigned int count) {
+	__m128 rows[4];
+	__m128 absRows[3];
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	for(unsigned int i=0; i < count; i++) {
+		if(i == 0 || matrixStep) {
+			loadMatrixRows(matrices[i * matrixStep], rows);
+			for(int r=0; r < 3; r++) {
+				absRows[r] = _mm_andnot_ps(signMask, rows[r]);
+			}
+		}
+		transformAABBSSE(rows, absRows, input[i], output[i]);
+	}
+}
+
+static inline POLYCODE_AVX_FUNCTION __m256 combine(__m128 low, __m128 high) {
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+}
+
+// two elements per iteration, one in each 128 bit half
+static inline POLYCODE_AVX_FUNCTION __m256 transformAVX(const __m256 *rows, const float *a, const float *b) {
+	__m256 r = _mm256_mul_ps(combine(_mm_set1_ps(a[0]), _mm_set1_ps(b[0])), rows[0]);
+	r = _mm256_add_ps(r, _mm256_mul_ps(combine(_mm_set1_ps(a[1]), _mm_set1_ps(b[1])), rows[1]));
+	return _mm256_add_ps(r, _mm256_mul_ps(combine(_mm_set1_ps(a[2]), _mm_set1_ps(b[2])), rows[2]));
+}
+
+static inline POLYCODE_AVX_FUNCTION __m256 normalizeAVX(__m256 v) {
+	__m256 squared = _mm256_mul_ps(v, v);
+	// x*x + y*y + z*z in every lane of each half
+	__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_permute_ps(squared, 0x00), _mm256_permute_ps(squared, 0x55)), _mm256_permute_ps(squared, 0xAA));
+	__m256 valid = _mm256_cmp_ps(lengthSquared, _mm256_setzero_ps(), _CMP_GT_OQ);
+	__m256 inverseLength = _mm256_rsqrt_ps(lengthSquared);
+	inverseLength = _mm256_mul_ps(inverseLength, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), lengthSquared), _mm256_mul_ps(inverseLength, inverseLength))));
+	return _mm256_or_ps(_mm256_and_ps(valid, _mm256_mul_ps(v, inverseLength)), _mm256_andnot_ps(valid, v));
+}
+
+// Only used with a shared matrix. Combining two matrices per pair of elements costs more than the
+// wider arithmetic saves, so per element matrices stay on the SSE code.
+static POLYCODE_AVX_FUNCTION void transformPointsAVX(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count) {
+	__m128 rowsA[4];
+	__m256 rows[4];
+	loadMatrixRows(matrix, rowsA);
+	for(int r=0; r < 4; r++) {
+		rows[r] = combine(rowsA[r], rowsA[r]);
+	}
+	unsigned int i = 0;
+	for(; i+1 < count; i += 2) {
+		const float *a = input + (i * inputStride);
+		__m256 p = _mm256_add_ps(transformAVX(rows, a, a + inputStride), rows[3]);
+		storeVector3(output + (i * outputStride), _mm256_castps256_ps128(p));
+		storeVector3(output + ((i+1) * outputStride), _mm256_extractf128_ps(p, 1));
+	}
+	if(i < count) {
+		storeVector3(output + (i * outputStride), _mm_add_ps(transformSSE(rowsA, input + (i * inputStride)), rowsA[3]));
+	}
+	_mm256_zeroupper();
+}
+
+static POLYCODE_AVX_FUNCTION void transformNormalsAVX(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize) {
+	__m128 rowsA[4];
+	__m256 rows[3];
+	loadMatrixRows(matrix, rowsA);
+	for(int r=0; r < 3; r++) {
+		rows[r] = combine(rowsA[r], rowsA[r]);
+	}
+	unsigned int i = 0;
+	for(; i+1 < count; i += 2) {
+		const float *a = input + (i * inputStride);
+		__m256 n = transformAVX(rows, a, a + inputStride);
+		if(normalize)
+			n = normalizeAVX(n);
+		storeVector3(output + (i * outputStride), _mm256_castps256_ps128(n));
+		storeVector3(output + ((i+1) * outputStride), _mm256_extractf128_ps(n, 1));
+	}
+	if(i < count) {
+		__m128 n = transformSSE(rowsA, input + (i * inputStride));
+		storeVector3(output + (i * outputStride), normalize ? normalizeSSE(n) : n);
+	}
+	_mm256_zeroupper();
+}
+
+#endif
+
+int BatchTransform::getBestPath() {
+#ifdef POLYCODE_BATCH_X86
+	unsigned int ecx = 0;
+	unsigned int edx = 0;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	ecx = info[2];
+	edx = info[3];
+#else
+	unsigned int eax, ebx;
+	if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return PATH_SCALAR;
+#endif
+	
+	if(!(edx & (1 << 26)))
+		return PATH_SCALAR;
+	
+	// AVX needs the CPU flag and the OS saving the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+	if((ecx & (1 << 28)) && (ecx & (1 << 27))) {
+		unsigned long long xcr0;
+#ifdef _MSC_VER
+		xcr0 = _xgetbv(0);
+#else
+		unsigned int xcr0Low, xcr0High;
+		__asm__ __volatile__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		xcr0 = ((unsigned long long)xcr0High << 32) | xcr0Low;
+#endif
+		if((xcr0 & 6) == 6)
+			return PATH_AVX;
+	}
+	return PATH_SSE;
+#else
+	return PATH_SCALAR;
+#endif
+}
+
+int BatchTransform::getPath() {
+	if(path == -1)
+		path = getBestPath();
+	return path;
+}
+
+void BatchTransform::setPath(int path) {
+	int bestPath = getBestPath();
+	BatchTransform::path = (path > bestPath) ? bestPath : path;
+}
+
+String BatchTransform::getPathName(int path) {
+	switch(path) {
+		case PATH_SSE:
+			return "SSE";
+		case PATH_AVX:
+			return "AVX";
+		default:
+			return "scalar";
+	}
+}
+
+void BatchTransform::transformPoints(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count) {
+#ifdef POLYCODE_BATCH_X86
+	switch(getPath()) {
+		case PATH_AVX:
+			transformPointsAVX(matrix, input, inputStride, output, outputStride, count);
+			return;
+		case PATH_SSE:
+			transformPointsSSE(matrix, input, inputStride, output, outputStride, count);
+			return;
+	}
+#endif
+	float rows[16];
+	getMatrixRows(matrix, rows);
+	for(unsigned int i=0; i < count; i++) {
+		transformPointsScalar(rows, input + (i * inputStride), output + (i * outputStride));
+	}
+}
+
+void BatchTransform::transformPoints(const Matrix4 *matrices, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count) {
+#ifdef POLYCODE_BATCH_X86
+	if(getPath() != PATH_SCALAR) {
+		transformPointsSSE(matrices, input, inputStride, output, outputStride, count);
+		return;
+	}
+#endif
+	float rows[16];
+	for(unsigned int i=0; i < count; i++) {
+		getMatrixRows(matrices[i], rows);
+		transformPointsScalar(rows, input + (i * inputStride), output + (i * outputStride));
+	}
+}
+
+void BatchTransform::transformNormals(const Matrix4 &matrix, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize) {
+#ifdef POLYCODE_BATCH_X86
+	switch(getPath()) {
+		case PATH_AVX:
+			transformNormalsAVX(matrix, input, inputStride, output, outputStride, count, normalize);
+			return;
+		case PATH_SSE:
+			transformNormalsSSE(matrix, input, inputStride, output, outputStride, count, normalize);
+			return;
+	}
+#endif
+	float rows[16];
+	getMatrixRows(matrix, rows);
+	for(unsigned int i=0; i < count; i++) {
+		transformNormalScalar(rows, input + (i * inputStride), output + (i * outputStride), normalize);
+	}
+}
+
+void BatchTransform::transformNormals(const Matrix4 *matrices, const float *input, unsigned int inputStride, float *output, unsigned int outputStride, unsigned int count, bool normalize) {
+#ifdef POLYCODE_BATCH_X86
+	if(getPath() != PATH_SCALAR) {
+		transformNormalsSSE(matrices, input, inputStride, output, outputStride, count, normalize);
+		return;
+	}
+#endif
+	float rows[16];
+	for(unsigned int i=0; i < count; i++) {
+		getMatrixRows(matrices[i], rows);
+		transformNormalScalar(rows, input + (i * inputStride), output + (i * outputStride), normalize);
+	}
+}
+
+void BatchTransform::transformAABBs(const Matrix4 &matrix, const AABB *input, AABB *output, unsigned int count) {
+#ifdef POLYCODE_BATCH_X86
+	if(getPath() != PATH_SCALAR) {
+		transformAABBsSSE(&matrix, 0, input, output, count);
+		return;
+	}
+#endif
+	for(unsigned int i=0; i < count; i++) {
+		transformAABBScalar(matrix, input[i], output[i]);
+	}
+}
+
+void BatchTransform::transformAABBs(const Matrix4 *matrices, const AABB *input, AABB *output, unsigned int count) {
+#ifdef POLYCODE_BATCH_X86
+	if(getPath() != PATH_SCALAR) {
+		transformAABBsSSE(matrices, 1, input, output, count);
+		return;
+	}
+#endif
+	for(unsigned int i=0; i < count; i++) {
+		transformAABBScalar(matrices[i], input[i], output[i]);
+	}
+}
@@ -70,6 +70,30 @@ bool Camera::isSphereInFrustrum(Vector3 pos, Number fRadius) {
     return true;
 }
 
+int Camera::classifyAABB(const AABB &aabb) {
+	Number cx = (aabb.min.x + aabb.max.x) * 0.5;
+	Number cy = (aabb.min.y + aabb.max.y) * 0.5;
+	Number cz = (aabb.min.z + aabb.max.z) * 0.5;
+	Number ex = (aabb.max.x - aabb.min.x) * 0.5;
+	Number ey = (aabb.max.y - aabb.min.y) * 0.5;
+	Number ez = (aabb.max.z - aabb.min.z) * 0.5;
+	
+	int result = FRUSTRUM_INSIDE;
+	for(int i = 0; i < 6; ++i) {
+		Number dist = frustumPlanes[i][0] * cx + frustumPlanes[i][1] * cy + frustumPlanes[i][2] * cz + frustumPlanes[i][3];
+		Number radius = ex * fabs(frustumPlanes[i][0]) + ey * fabs(frustumPlanes[i][1]) + ez * fabs(frustumPlanes[i][2]);
+		if(dist <= -radius)
+			return FRUSTRUM_OUTSIDE;
+		if(dist < radius)
+			result = FRUSTRUM_INTERSECTS;
+	}
+	return result;
+}
+
+bool Camera::isAABBInFrustrum(const AABB &aabb) {
+	return classifyAABB(aabb) != FRUSTRUM_OUTSIDE;
+}
+
 void Camera::setOrthoMode(bool mode) {
 	orthoMode = mode;
 }			
@@ -79,152 +103,17 @@ bool Camera::getOrthoMode() {
 }
 
 void Camera::buildFrustrumPlanes() {
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	Renderer::extractFrustumPlanes(renderer->getProjectionMatrix(), renderer->getModelviewMatrix(), frustumPlanes);
+}
 
-	Matrix4 p; 
-	Matrix4 mv;
-	Matrix4 mvp;
-	Number t;
-
-	p = CoreServices::getInstance()->getRenderer()->getProjectionMatrix();
-    mv = CoreServices::getInstance()->getRenderer()->getModelviewMatrix();
-
-    //
-    // Concatenate the projection matrix and the model-view matrix to produce 
-    // a combined model-view-projection matrix.
-    //
-
-    mvp.ml[ 0] = mv.ml[ 0] * p.ml[ 0] + mv.ml[ 1] * p.ml[ 4] + mv.ml[ 2] * p.ml[ 8] + mv.ml[ 3] * p.ml[12];
-
-    mvp.ml[ 1] = mv.ml[ 0] * p.ml[ 1] + mv.ml[ 1] * p.ml[ 5] + mv.ml[ 2] * p.ml[ 9] + mv.ml[ 3] * p.ml[13];
-    mvp.ml[ 2] = mv.ml[ 0] * p.ml[ 2] + mv.ml[ 1] * p.ml[ 6] + mv.ml[ 2] * p.ml[10] + mv.ml[ 3] * p.ml[14];
-    mvp.ml[ 3] = mv.ml[ 0] * p.ml[ 3] + mv.ml[ 1] * p.ml[ 7] + mv.ml[ 2] * p.ml[11] + mv.ml[ 3] * p.ml[15];
-
-    mvp.ml[ 4] = mv.ml[ 4] * p.ml[ 0] + mv.ml[ 5] * p.ml[ 4] + mv.ml[ 6] * p.ml[ 8] + mv.ml[ 7] * p.ml[12];
-    mvp.ml[ 5] = mv.ml[ 4] * p.ml[ 1] + mv.ml[ 5] * p.ml[ 5] + mv.ml[ 6] * p.ml[ 9] + mv.ml[ 7] * p.ml[13];
-    mvp.ml[ 6] = mv.ml[ 4] * p.ml[ 2] + mv.ml[ 5] * p.ml[ 6] + mv.ml[ 6] * p.ml[10] + mv.ml[ 7] * p.ml[14];
-    mvp.ml[ 7] = mv.ml[ 4] * p.ml[ 3] + mv.ml[ 5] * p.ml[ 7] + mv.ml[ 6] * p.ml[11] + mv.ml[ 7] * p.ml[15];
-
-    mvp.ml[ 8] = mv.ml[ 8] * p.ml[ 0] + mv.ml[ 9] * p.ml[ 4] + mv.ml[10] * p.ml[ 8] + mv.ml[11] * p.ml[12];
-    mvp.ml[ 9] = mv.ml[ 8] * p.ml[ 1] + mv.ml[ 9] * p.ml[ 5] + mv.ml[10] * p.ml[ 9] + mv.ml[11] * p.ml[13];
-    mvp.ml[10] = mv.ml[ 8] * p.ml[ 2] + mv.ml[ 9] * p.ml[ 6] + mv.ml[10] * p.ml[10] + mv.ml[11] * p.ml[14];
-    mvp.ml[11] = mv.ml[ 8] * p.ml[ 3] + mv.ml[ 9] * p.ml[ 7] + mv.ml[10] * p.ml[11] + mv.ml[11] * p.ml[15];
-
-    mvp.ml[12] = mv.ml[12] * p.ml[ 0] + mv.ml[13] * p.ml[ 4] + mv.ml[14] * p.ml[ 8] + mv.ml[15] * p.ml[12];
-    mvp.ml[13] = mv.ml[12] * p.ml[ 1] + mv.ml[13] * p.ml[ 5] + mv.ml[14] * p.ml[ 9] + mv.ml[15] * p.ml[13];
-    mvp.ml[14] = mv.ml[12] * p.ml[ 2] + mv.ml[13] * p.ml[ 6] + mv.ml[14] * p.ml[10] + mv.ml[15] * p.ml[14];
-    mvp.ml[15] = mv.ml[12] * p.ml[ 3] + mv.ml[13] * p.ml[ 7] + mv.ml[14] * p.ml[11] + mv.ml[15] * p.ml[15];
-
-    //
-    // Extract the frustum's right clipping plane and normalize it.
-    //
-
-    frustumPlanes[0][0] = mvp.ml[ 3] - mvp.ml[ 0];
-    frustumPlanes[0][1] = mvp.ml[ 7] - mvp.ml[ 4];
-    frustumPlanes[0][2] = mvp.ml[11] - mvp.ml[ 8];
-    frustumPlanes[0][3] = mvp.ml[15] - mvp.ml[12];
-
-    t = (Number) sqrt( frustumPlanes[0][0] * frustumPlanes[0][0] + 
-                      frustumPlanes[0][1] * frustumPlanes[0][1] + 
-                      frustumPlanes[0][2] * frustumPlanes[0][2] );
-
-    frustumPlanes[0][0] /= t;
-    frustumPlanes[0][1] /= t;
-    frustumPlanes[0][2] /= t;
-    frustumPlanes[0][3] /= t;
-
-    //
-    // Extract the frustum's left clipping plane and normalize it.
-    //
-
-    frustumPlanes[1][0] = mvp.ml[ 3] + mvp.ml[ 0];
-    frustumPlanes[1][1] = mvp.ml[ 7] + mvp.ml[ 4];
-    frustumPlanes[1][2] = mvp.ml[11] + mvp.ml[ 8];
-    frustumPlanes[1][3] = mvp.ml[15] + mvp.ml[12];
-
-    t = (Number) sqrt( frustumPlanes[1][0] * frustumPlanes[1][0] + 
-                      frustumPlanes[1][1] * frustumPlanes[1][1] + 
-                      frustumPlanes[1][2] * frustumPlanes[1][2] );
-
-    frustumPlanes[1][0] /= t;
-    frustumPlanes[1][1] /= t;
-    frustumPlanes[1][2] /= t;
-    frustumPlanes[1][3] /= t;
-
-    //
-    // Extract the frustum's bottom clipping plane and normalize it.
-    //
-
-    frustumPlanes[2][0] = mvp.ml[ 3] + mvp.ml[ 1];
-    frustumPlanes[2][1] = mvp.ml[ 7] + mvp.ml[ 5];
-    frustumPlanes[2][2] = mvp.ml[11] + mvp.ml[ 9];
-    frustumPlanes[2][3] = mvp.ml[15] + mvp.ml[13];
-
-    t = (Number) sqrt( frustumPlanes[2][0] * frustumPlanes[2][0] + 
-                      frustumPlanes[2][1] * frustumPlanes[2][1] + 
-                      frustumPlanes[2][2] * frustumPlanes[2][2] );
-
-    frustumPlanes[2][0] /= t;
-    frustumPlanes[2][1] /= t;
-    frustumPlanes[2][2] /= t;
-    frustumPlanes[2][3] /= t;
-
-    //
-    // Extract the frustum's top clipping plane and normalize it.
-    //
-
-    frustumPlanes[3][0] = mvp.ml[ 3] - mvp.ml[ 1];
-    frustumPlanes[3][1] = mvp.ml[ 7] - mvp.ml[ 5];
-    frustumPlanes[3][2] = mvp.ml[11] - mvp.ml[ 9];
-    frustumPlanes[3][3] = mvp.ml[15] - mvp.ml[13];
-
-    t = (Number) sqrt( frustumPlanes[3][0] * frustumPlanes[3][0] + 
-                      frustumPlanes[3][1] * frustumPlanes[3][1] + 
-                      frustumPlanes[3][2] * frustumPlanes[3][2] );
-
-    frustumPlanes[3][0] /= t;
-    frustumPlanes[3][1] /= t;
-    frustumPlanes[3][2] /= t;
-    frustumPlanes[3][3] /= t;
-
-    //
-    // Extract the frustum's far clipping plane and normalize it.
-    //
-
-    frustumPlanes[4][0] = mvp.ml[ 3] - mvp.ml[ 2];
-    frustumPlanes[4][1] = mvp.ml[ 7] - mvp.ml[ 6];
-    frustumPlanes[4][2] = mvp.ml[11] - mvp.ml[10];
-    frustumPlanes[4][3] = mvp.ml[15] - mvp.ml[14];
-
-    t = (Number) sqrt( frustumPlanes[4][0] * frustumPlanes[4][0] +  
-                      frustumPlanes[4][1] * frustumPlanes[4][1] + 
-                      frustumPlanes[4][2] * frustumPlanes[4][2] );
-
-    frustumPlanes[4][0] /= t;
-    frustumPlanes[4][1] /= t;
-    frustumPlanes[4][2] /= t;
-    frustumPlanes[4][3] /= t;
-
-    //
-    // Extract the frustum's near clipping plane and normalize it.
-    //
-
-    frustumPlanes[5][0] = mvp.ml[ 3] + mvp.ml[ 2];
-    frustumPlanes[5][1] = mvp.ml[ 7] + mvp.ml[ 6];
-    frustumPlanes[5][2] = mvp.ml[11] + mvp.ml[10];
-    frustumPlanes[5][3] = mvp.ml[15] + mvp.ml[14];
-
-    t = (Number) sqrt( frustumPlanes[5][0] * frustumPlanes[5][0] + 
-                      frustumPlanes[5][1] * frustumPlanes[5][1] + 
-                      frustumPlanes[5][2] * frustumPlanes[5][2] );
-
-    frustumPlanes[5][0] /= t;
-    frustumPlanes[5][1] /= t;
-    frustumPlanes[5][2] /= t;
-    frustumPlanes[5][3] /= t;
-
+void Camera::buildFrustrumPlanes(const Matrix4 &projection, const Matrix4 &modelview) {
+	Renderer::extractFrustumPlanes(projection, modelview, frustumPlanes);
 }
 
 bool Camera::canSee(SceneEntity *entity) {
+	if(entity->hasCullingBounds())
+		return isAABBInFrustrum(entity->getWorldAABB());
 	return isSphereInFrustrum(entity->getPosition(), entity->getBBoxRadius());
 }
 
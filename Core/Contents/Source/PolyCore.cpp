@@ -23,7 +23,8 @@
 #include "PolyCore.h"
 #ifdef _WINDOWS
 #include <windows.h>
-
+#else
+#include <unistd.h>
 #endif
 
 namespace Polycode {
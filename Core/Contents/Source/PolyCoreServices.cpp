@@ -21,6 +21,9 @@
 */
 
 #include "PolyCoreServices.h"
+#ifndef _WINDOWS
+#include <pthread.h>
+#endif
 
 using namespace Polycode;
 
@@ -28,6 +31,19 @@ std::map<long, CoreServices*> CoreServices::instanceMap;
 CoreMutex *CoreServices::renderMutex = 0;
 CoreServices* CoreServices::overrideInstance = NULL;
 
+#ifndef _WINDOWS
+// Each thread finds its instance in thread local storage, so getInstance() never locks. The map only
+// keeps track of the registered instances and is locked when a thread registers one. CoreMutex needs
+// a core, which does not exist yet when the first instance is created.
+static pthread_key_t instanceKey;
+static pthread_once_t instanceKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t instanceMapMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void createInstanceKey() {
+	pthread_key_create(&instanceKey, NULL);
+}
+#endif
+
 CoreMutex *CoreServices::getRenderMutex() {
 	if(renderMutex == NULL) {
 		Logger::log("Creating render mutex...\n");
@@ -41,6 +57,16 @@ void CoreServices::setInstance(CoreServices *_instance) {
 	Logger::log("Overriding core instance...\n");
 }
 
+void CoreServices::setThreadInstance(CoreServices *_instance) {
+#ifndef _WINDOWS
+	pthread_once(&instanceKeyOnce, createInstanceKey);
+	pthread_setspecific(instanceKey, _instance);
+	pthread_mutex_lock(&instanceMapMutex);
+	instanceMap[getThreadID()] = _instance;
+	pthread_mutex_unlock(&instanceMapMutex);
+#endif
+}
+
 CoreServices* CoreServices::getInstance() {
 
 	if(overrideInstance) {
@@ -52,14 +78,12 @@ CoreServices* CoreServices::getInstance() {
 		Logger::log("Creating new core services instance...\n");
 		return overrideInstance;
 #else
-	long threadID = getThreadID(); 
-	CoreServices *instance;
-	if(instanceMap.find(threadID) == instanceMap.end()) {
+	pthread_once(&instanceKeyOnce, createInstanceKey);
+	CoreServices *instance = (CoreServices*)pthread_getspecific(instanceKey);
+	if(!instance) {
 		Logger::log("Creating new core services instance...\n");
 		instance = new CoreServices;
-		instanceMap[threadID] = instance;
-	} else {
-		instance = instanceMap[threadID];
+		setThreadInstance(instance);
 	}
 	return instance;
 #endif
@@ -81,6 +105,13 @@ Config *CoreServices::getConfig() {
 	return config;
 }
 
+JobSystem *CoreServices::getJobSystem() {
+	if(jobSystem == NULL) {
+		jobSystem = new JobSystem(core);
+	}
+	return jobSystem;
+}
+
 void CoreServices::installModule(PolycodeModule *module)  {
 	modules.push_back(module);
 	switch(module->getType()) {
@@ -110,9 +141,11 @@ CoreServices::CoreServices() : EventDispatcher() {
 	tweenManager = new TweenManager();
 	soundManager = new SoundManager();
 	fontManager = new FontManager();
+	jobSystem = NULL;
 }
 
 CoreServices::~CoreServices() {
+	delete jobSystem;
 	delete materialManager;
 	delete screenManager;
 	delete sceneManager;
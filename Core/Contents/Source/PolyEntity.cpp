@@ -20,6 +20,9 @@
  THE SOFTWARE.
 */
 #include "PolyEntity.h"
+#include "PolyRenderQueue.h"
+#include "PolySpriteBatch.h"
+#include <string.h>
 
 using namespace Polycode;
 
@@ -36,6 +39,14 @@ Entity::Entity() {
 	color.setColor(1.0f,1.0f,1.0f,1.0f);
 	parentEntity = NULL;
 	matrixDirty = true;
+	worldMatrixDirty = true;
+	worldBoundsDirty = true;
+	transformHierarchy = NULL;
+	transformNode = -1;
+	renderCulled = false;
+	subtreeCulled = false;
+	cullingProxy = -1;
+	cullingBBoxRadius = 0;
 	matrixAdj = 1.0f;
 	billboardMode = false;
 	billboardRoll = false;
@@ -57,6 +68,14 @@ Entity *Entity::getParentEntity() {
 	return parentEntity;
 }
 
+unsigned int Entity::getNumChildren() {
+	return children.size();
+}
+
+Entity *Entity::getChildAtIndex(unsigned int index) {
+	return children[index];
+}
+
 Color Entity::getCombinedColor() {
 	if(parentEntity) {
 		if(parentEntity->colorAffectsChildren)
@@ -109,6 +128,7 @@ void Entity::removeChild(Entity *entityToRemove) {
 	for(int i=0;i<children.size();i++) {
 		if(children[i] == entityToRemove) {
 			children.erase(children.begin()+i);
+			entityToRemove->setParentEntity(NULL);
 		}
 	}	
 }
@@ -163,7 +183,60 @@ void Entity::setBBoxRadius(Number rad) {
 	bBoxRadius = rad;
 }
 
+bool Entity::hasCullingBounds() {
+	if(ignoreParentMatrix)
+		return false;
+	return bBoxRadius > 0 || bBox.x > 0 || bBox.y > 0 || bBox.z > 0;
+}
+
+bool Entity::updateCullingBounds() {
+	bool changed = worldBoundsDirty || bBox != cullingBBox || bBoxRadius != cullingBBoxRadius;
+	worldBoundsDirty = false;
+	cullingBBox = bBox;
+	cullingBBoxRadius = bBoxRadius;
+	return changed;
+}
+
+AABB Entity::getWorldAABB() {
+	Matrix4 m = getConcatenatedMatrix();
+	
+	Vector3 half;
+	if(bBox.x > 0 || bBox.y > 0 || bBox.z > 0) {
+		half.x = bBox.x * 0.5;
+		half.y = bBox.y * 0.5;
+		half.z = bBox.z * 0.5;
+	} else {
+		half.x = bBoxRadius;
+		half.y = bBoxRadius;
+		half.z = bBoxRadius;
+	}
+	
+	Vector3 extents;
+	if(billboardMode) {
+		// the rotation is decided at render time, so use the bounding sphere
+		Number maxScale = 0;
+		for(int i=0; i < 3; i++) {
+			Number rowScale = sqrt(m.m[i][0]*m.m[i][0] + m.m[i][1]*m.m[i][1] + m.m[i][2]*m.m[i][2]);
+			if(rowScale > maxScale)
+				maxScale = rowScale;
+		}
+		Number radius = half.length() * maxScale;
+		extents.x = radius;
+		extents.y = radius;
+		extents.z = radius;
+	} else {
+		extents.x = fabs(m.m[0][0])*half.x + fabs(m.m[1][0])*half.y + fabs(m.m[2][0])*half.z;
+		extents.y = fabs(m.m[0][1])*half.x + fabs(m.m[1][1])*half.y + fabs(m.m[2][1])*half.z;
+		extents.z = fabs(m.m[0][2])*half.x + fabs(m.m[1][2])*half.y + fabs(m.m[2][2])*half.z;
+	}
+	
+	Vector3 center(m.m[3][0], m.m[3][1], m.m[3][2]);
+	return AABB(center - extents, center + extents);
+}
+
 Entity::~Entity() {
+	if(transformHierarchy)
+		transformHierarchy->destroyNode(transformNode);
 }
 
 Vector3 Entity::getChildCenter() {
@@ -183,21 +256,43 @@ void Entity::rebuildTransformMatrix() {
 	if(lockMatrix)
 		return;
 	
-	if(billboardMode){ 
-		transformMatrix.identity();
-	} else {
-		transformMatrix = rotationQuat.createMatrix();
+	Matrix4 newMatrix;
+	if(!billboardMode) {
+		newMatrix = rotationQuat.createMatrix();
 	}
 	
-	Matrix4 scaleMatrix;
-	scaleMatrix.m[0][0] *= scale.x;
-	scaleMatrix.m[1][1] *= scale.y;
-	scaleMatrix.m[2][2] *= scale.z;
+	// Scaling only touches the rotation rows and the position matrix is a pure
+	// translation, so compose them directly instead of two full multiplies.
+	for(int i=0; i < 3; i++) {
+		newMatrix.m[0][i] *= scale.x;
+		newMatrix.m[1][i] *= scale.y;
+		newMatrix.m[2][i] *= scale.z;
+	}
 	
 	Matrix4 posMatrix = buildPositionMatrix();
-
-	transformMatrix = scaleMatrix*transformMatrix*posMatrix;
+	newMatrix.m[3][0] = posMatrix.m[3][0];
+	newMatrix.m[3][1] = posMatrix.m[3][1];
+	newMatrix.m[3][2] = posMatrix.m[3][2];
+	
 	matrixDirty = false;
+	
+	if(memcmp(newMatrix.ml, transformMatrix.ml, sizeof(transformMatrix.ml)) != 0) {
+		transformMatrix = newMatrix;
+		if(transformHierarchy)
+			transformHierarchy->setLocalMatrix(transformNode, transformMatrix);
+		invalidateWorldMatrix();
+	}
+}
+
+void Entity::invalidateWorldMatrix() {
+	// a dirty entity always has a dirty subtree, so we can stop here
+	if(worldMatrixDirty)
+		return;
+	worldMatrixDirty = true;
+	worldBoundsDirty = true;
+	for(int i=0; i < children.size(); i++) {
+		children[i]->invalidateWorldMatrix();
+	}
 }
 
 void Entity::doUpdates() {
@@ -262,7 +357,7 @@ void Entity::clearMask() {
 }
 
 void Entity::transformAndRender() {
-	if(!renderer || !enabled)
+	if(!renderer || !enabled || subtreeCulled)
 		return;
 
 	if(depthOnly) {
@@ -295,31 +390,16 @@ void Entity::transformAndRender() {
 //		renderer->enableDepthWrite(false);
 //		renderer->enableDepthTest(true);		
 //	} else {
-	if(!depthWrite)
-		renderer->enableDepthWrite(false);
-	else
-		renderer->enableDepthWrite(true);
-	
-	if(!depthTest) 
-		renderer->enableDepthTest(false);
-	else
-		renderer->enableDepthTest(true);
+	applyRenderState();
 //	}
-		 
-	renderer->enableAlphaTest(alphaTest);
-	
-	Color combined = getCombinedColor();
-	renderer->setVertexColor(combined.r,combined.g,combined.b,combined.a);
-	
-	renderer->setBlendingMode(blendingMode);
-	renderer->enableBackfaceCulling(backfaceCulled);
 	
 	int mode = renderer->getRenderMode();
 	if(renderWireframe)
 		renderer->setRenderMode(Renderer::RENDER_MODE_WIREFRAME);
 		
 	if(visible) {
-		Render();
+		if(!renderCulled)
+			Render();
 		renderer->setRenderMode(mode);
 	
 	
@@ -349,6 +429,109 @@ void Entity::transformAndRender() {
 	}	
 }
 
+void Entity::applyRenderState() {
+	if(!depthWrite)
+		renderer->enableDepthWrite(false);
+	else
+		renderer->enableDepthWrite(true);
+	
+	if(!depthTest) 
+		renderer->enableDepthTest(false);
+	else
+		renderer->enableDepthTest(true);
+		 
+	renderer->enableAlphaTest(alphaTest);
+	
+	Color combined = getCombinedColor();
+	renderer->setVertexColor(combined.r,combined.g,combined.b,combined.a);
+	
+	renderer->setBlendingMode(blendingMode);
+	renderer->enableBackfaceCulling(backfaceCulled);
+}
+
+void Entity::batchForRender(SpriteBatch *batch) {
+	if(!renderer || !enabled || subtreeCulled)
+		return;
+	
+	if(hasMask || depthOnly) {
+		batch->flush();
+		transformAndRender();
+		return;
+	}
+	
+	renderer->pushMatrix();	
+	if(ignoreParentMatrix && parentEntity) {
+		renderer->multModelviewMatrix(parentEntity->getConcatenatedMatrix().inverse());
+	}else {
+		renderer->multModelviewMatrix(transformMatrix);
+	}
+	if(billboardMode) {
+		renderer->billboardMatrixWithScale(getCompoundScale());
+		if(billboardRoll) {
+			renderer->multModelviewMatrix(getConcatenatedRollMatrix());
+		}
+	}
+	
+	if(visible) {
+		if(!renderCulled && (renderWireframe || !addToSpriteBatch(batch))) {
+			batch->flush();
+			applyRenderState();
+			
+			int mode = renderer->getRenderMode();
+			if(renderWireframe)
+				renderer->setRenderMode(Renderer::RENDER_MODE_WIREFRAME);
+			Render();
+			renderer->setRenderMode(mode);
+			
+			if(!depthWrite)
+				renderer->enableDepthWrite(true);
+		}
+		
+		adjustMatrixForChildren();
+		for(int i=0;i<children.size();i++) {
+			children[i]->batchForRender(batch);
+		}
+	}
+	
+	renderer->popMatrix();
+}
+
+void Entity::enqueueForRender(RenderQueue *queue) {
+	if(!renderer || !enabled || subtreeCulled)
+		return;
+	
+	if(hasMask || depthOnly) {
+		queue->execute(renderer);
+		transformAndRender();
+		return;
+	}
+	
+	renderer->pushMatrix();	
+	if(ignoreParentMatrix && parentEntity) {
+		renderer->multModelviewMatrix(parentEntity->getConcatenatedMatrix().inverse());
+	}else {
+		renderer->multModelviewMatrix(transformMatrix);
+	}
+	if(billboardMode) {
+		renderer->billboardMatrixWithScale(getCompoundScale());
+		if(billboardRoll) {
+			renderer->multModelviewMatrix(getConcatenatedRollMatrix());
+		}
+	}
+	
+	if(visible) {
+		if(!renderCulled)
+			queue->addEntity(this, renderer->getModelviewMatrix());
+		
+		adjustMatrixForChildren();
+		for(int i=0;i<children.size();i++) {
+			children[i]->enqueueForRender(queue);
+		}
+	}
+	
+	renderer->popMatrix();
+}
+
 void Entity::setRenderer(Renderer *renderer) {
 	this->renderer = renderer;
 	for(int i=0;i<children.size();i++) {
@@ -360,6 +543,8 @@ void Entity::addEntity(Entity *newChild) {
 	newChild->setRenderer(renderer);
 	newChild->setParentEntity(this);
 	children.push_back(newChild);
+	if(transformHierarchy)
+		newChild->setTransformHierarchy(transformHierarchy);
 	
 	if(hasMask) {
 		newChild->setMask(maskEntity);
@@ -406,10 +591,26 @@ Vector3 Entity::getScale() {
 }
 
 Matrix4 Entity::getConcatenatedMatrix() {
-	if(parentEntity != NULL) 
-		return transformMatrix * parentEntity->getConcatenatedMatrix();
-	else
-		return transformMatrix;
+	// the hierarchy is only up to date between its sweeps. Before the next
+	// one, or while parallel updates are changing it, fall back to the parents.
+	if(transformHierarchy && !transformHierarchy->isSweepForbidden() && !transformHierarchy->needsUpdate()) {
+		// a clean entity must not have a dirty parent, or invalidateWorldMatrix()
+		// stops at the parent when it moves, so dirty ancestors are refreshed too
+		for(Entity *entity = this; entity && entity->worldMatrixDirty && entity->transformHierarchy == transformHierarchy; entity = entity->parentEntity) {
+			entity->worldMatrix = transformHierarchy->getCachedWorldMatrix(entity->transformNode);
+			entity->worldMatrixDirty = false;
+		}
+		return transformHierarchy->getCachedWorldMatrix(transformNode);
+	}
+	
+	if(worldMatrixDirty) {
+		if(parentEntity != NULL) 
+			worldMatrix = transformMatrix * parentEntity->getConcatenatedMatrix();
+		else
+			worldMatrix = transformMatrix;
+		worldMatrixDirty = false;
+	}
+	return worldMatrix;
 }
 
 Matrix4 Entity::getTransformMatrix() {
@@ -462,6 +663,50 @@ Vector3 Entity::getCombinedPosition() {
 
 void Entity::setParentEntity(Entity *entity) {
 	parentEntity = entity;
+	if(transformHierarchy) {
+		// the scene only tracks the hierarchy through its own entities, so a subtree that leaves
+		// it must not keep nodes in it or it would outlive the hierarchy
+		if(entity && entity->transformHierarchy == transformHierarchy)
+			transformHierarchy->setParent(transformNode, entity->transformNode);
+		else
+			setTransformHierarchy(NULL);
+	}
+	invalidateWorldMatrix();
+}
+
+void Entity::setTransformHierarchy(TransformHierarchy *hierarchy) {
+	if(hierarchy != transformHierarchy) {
+		if(transformHierarchy) {
+			transformHierarchy->destroyNode(transformNode);
+			transformNode = -1;
+		}
+		
+		transformHierarchy = hierarchy;
+		if(transformHierarchy) {
+			int parentNode = -1;
+			if(parentEntity && parentEntity->transformHierarchy == transformHierarchy)
+				parentNode = parentEntity->transformNode;
+			transformNode = transformHierarchy->createNode(parentNode);
+			transformHierarchy->setLocalMatrix(transformNode, transformMatrix);
+		}
+		
+		worldMatrixDirty = true;
+		worldBoundsDirty = true;
+	}
+	
+	// parents are added before their children, which keeps the hierarchy
+	// sorted without a rebuild
+	for(int i=0; i < children.size(); i++) {
+		children[i]->setTransformHierarchy(hierarchy);
+	}
+}
+
+TransformHierarchy *Entity::getTransformHierarchy() {
+	return transformHierarchy;
+}
+
+int Entity::getTransformNode() {
+	return transformNode;
 }
 
 Number Entity::getPitch() {
@@ -478,6 +723,9 @@ Number Entity::getRoll() {
 
 void Entity::setTransformByMatrixPure(Matrix4 matrix) {
 	transformMatrix = matrix;
+	if(transformHierarchy)
+		transformHierarchy->setLocalMatrix(transformNode, transformMatrix);
+	invalidateWorldMatrix();
 }
 
 void Entity::setTransformByMatrix(Matrix4 matrix) {
@@ -52,9 +52,23 @@ bool Font::isValid() {
 }
 
 Font::~Font() {
+	for(std::map<int, GlyphCache*>::iterator it = glyphCaches.begin(); it != glyphCaches.end(); it++) {
+		delete it->second;
+	}
 	free(buffer);
 }
 
+GlyphCache *Font::getGlyphCache(int size, bool monochrome) {
+	int key = (size << 1) | (monochrome ? 1 : 0);
+	std::map<int, GlyphCache*>::iterator it = glyphCaches.find(key);
+	if(it != glyphCaches.end())
+		return it->second;
+	
+	GlyphCache *cache = new GlyphCache(ftFace, size, monochrome);
+	glyphCaches[key] = cache;
+	return cache;
+}
+
 FT_Face Font::getFace() {
 	return ftFace;
 }
\ No newline at end of file
@@ -24,8 +24,14 @@
 
 using namespace Polycode;
 
+// GLES1 only takes float matrices, while Number may be double
+static void toGLMatrix(const Matrix4 &m, GLfloat *values) {
+	for(int i=0; i < 16; i++) {
+		values[i] = m.ml[i];
+	}
+}
+
 OpenGLES1Renderer::OpenGLES1Renderer() : Renderer() {	
-	nearPlane = 0.1f;
 	farPlane = 1000.0f;
 	
 	glGenFramebuffersOES(1, &defaultFramebuffer);
@@ -43,13 +49,13 @@ void OpenGLES1Renderer::Resize(int xRes, int yRes) {
 	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
 	glClearDepthf(1.0f);
 	
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-	gluPerspective(fov,(GLfloat)xRes/(GLfloat)yRes,nearPlane,farPlane);
+	setPerspectiveProjection(fov, (Number)xRes/(Number)yRes);
+	loadProjectionMatrix();
+	viewportWidth = xRes;
+	viewportHeight = yRes;
 	glViewport(0, 0, xRes, yRes);
 	glScissor(0, 0, xRes, yRes);
 	
-	glMatrixMode(GL_MODELVIEW);
 	glLineWidth(1);
 	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	
@@ -85,70 +91,43 @@ void OpenGLES1Renderer::setLineSmooth(bool val) {
 
 void OpenGLES1Renderer::setFOV(Number fov) {
 	this->fov = fov;
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fov,(GLfloat)xRes/(GLfloat)yRes,nearPlane,farPlane);	
+	setPerspectiveProjection(fov, (Number)xRes/(Number)yRes);
+	loadProjectionMatrix();
+	viewportWidth = xRes;
+	viewportHeight = yRes;
 	glViewport(0, 0, xRes, yRes);
 	glScissor(0, 0, xRes, yRes);
-	glMatrixMode(GL_MODELVIEW);	
 }
 
 void OpenGLES1Renderer::setViewportSize(int w, int h, Number fov) {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fov,(GLfloat)w/(GLfloat)h,nearPlane,farPlane);
+	setPerspectiveProjection(fov, (Number)w/(Number)h);
+	loadProjectionMatrix();
+	viewportWidth = w;
+	viewportHeight = h;
 	glViewport(0, 0, w, h);
 	glScissor(0, 0, w, h);
+}
+
+void OpenGLES1Renderer::loadProjectionMatrix() {
+	GLfloat m[16];
+	toGLMatrix(projectionMatrix, m);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(m);
 	glMatrixMode(GL_MODELVIEW);
 }
 
 Vector3 OpenGLES1Renderer::Unproject(Number x, Number y) {
-	Vector3 coords;
-	GLfloat wx, wy, wz;
-	GLfloat cx, cy, cz;
-	
-	GLfloat mv[16];
-	glGetFloatv( GL_MODELVIEW_MATRIX, mv );
-	
-	GLfloat proj[16];
-	glGetFloatv( GL_PROJECTION_MATRIX, proj );
-	
-	GLint vp[4];
-	glGetIntegerv( GL_VIEWPORT, vp );
-	
-	wx = ( Number ) x;
-	wy = ( Number ) vp[3] - ( Number ) y;
-	glReadPixels( x, wy, 1, 1, GL_DEPTH_COMPONENT16_OES, GL_FLOAT, &wz );
-	
-	gluUnProject((GLdouble)wx, (GLdouble)wy, (GLdouble)wz, (GLdouble*)mv, (GLdouble*)proj, vp, (GLdouble*)&cx, (GLdouble*)&cy, (GLdouble*)&cz );
-	
-	coords = Vector3( cx, cy, cz );
-	
-	return coords;
-	
+	// the depth under the cursor is the only thing that has to come from the GPU
+	GLfloat wz;
+	glReadPixels(x, viewportHeight - y, 1, 1, GL_DEPTH_COMPONENT16_OES, GL_FLOAT, &wz);
+	return unprojectPoint(x, y, wz);
 }
 
 bool OpenGLES1Renderer::test2DCoordinate(Number x, Number y, Poly::Polygon *poly, const Matrix4 &matrix, bool billboardMode) {
-	GLfloat nearPlane[3],farPlane[3];
-	
-	GLfloat mv[16];
 	Matrix4 camInverse = cameraMatrix.inverse();	
-	Matrix4 cmv;
-	cmv.identity();
-	cmv = cmv * camInverse;
-	
-	for(int i=0; i < 16; i++) {
-		mv[i] = cmv.ml[i];
-	}
 	
-	GLint vp[4];
-	glGetIntegerv( GL_VIEWPORT, vp );
-	
-	gluUnProject((GLdouble)x, (GLdouble)yRes - y, 0.0, (GLdouble*)mv, (GLdouble*)sceneProjectionMatrix, vp, (GLdouble*)&nearPlane[0], (GLdouble*)&nearPlane[1], (GLdouble*)&nearPlane[2]);
-	gluUnProject((GLdouble)x, (GLdouble)yRes - y, 1.0, (GLdouble*)mv, (GLdouble*)sceneProjectionMatrix, vp,  (GLdouble*)&farPlane[0], (GLdouble*)&farPlane[1], (GLdouble*)&farPlane[2]);
-	
-	Vector3 nearVec(nearPlane[0], nearPlane[1], nearPlane[2]);
-	Vector3 farVec(farPlane[0], farPlane[1], farPlane[2]);
+	Vector3 nearVec = unprojectPoint(x, y, 0.0, sceneProjectionMatrix, camInverse);
+	Vector3 farVec = unprojectPoint(x, y, 1.0, sceneProjectionMatrix, camInverse);
 	
 	Vector3 dirVec = farVec - nearVec;	
 	dirVec.Normalize();
@@ -180,12 +159,18 @@ void OpenGLES1Renderer::enableDepthTest(bool val) {
 }
 
 void OpenGLES1Renderer::setModelviewMatrix(Matrix4 m) {
-	glLoadMatrixf(m.ml);
+	GLfloat values[16];
+	toGLMatrix(m, values);
+	modelviewMatrix = m;
+	glLoadMatrixf(values);
 }
 
 void OpenGLES1Renderer::multModelviewMatrix(Matrix4 m) {
 	//	glMatrixMode(GL_MODELVIEW);
-	glMultMatrixf(m.ml);
+	GLfloat values[16];
+	toGLMatrix(m, values);
+	modelviewMatrix = m * modelviewMatrix;
+	glMultMatrixf(values);
 }
 
 void OpenGLES1Renderer::enableLighting(bool enable) {
@@ -255,18 +240,6 @@ void OpenGLES1Renderer::setBlendingMode(int blendingMode) {
 	glEnable(GL_BLEND);
 }
 
-Matrix4 OpenGLES1Renderer::getProjectionMatrix() {
-	Number m[16];
-	glGetFloatv( GL_PROJECTION_MATRIX, m);
-	return Matrix4(m);
-}
-
-Matrix4 OpenGLES1Renderer::getModelviewMatrix() {
-	Number m[16];
-    glGetFloatv( GL_MODELVIEW_MATRIX, m);
-	return Matrix4(m);
-}
-
 void OpenGLES1Renderer::renderZBufferToTexture(Texture *targetTexture) {
 	//	OpenGLES1Texture *glTexture = (OpenGLES1Texture*)targetTexture;
 	//	glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
@@ -309,15 +282,14 @@ void OpenGLES1Renderer::setOrthoMode() {
 	setBlendingMode(BLEND_MODE_NORMAL);
 	if(!orthoMode) {
 		glDisable(GL_LIGHTING);
-		glMatrixMode(GL_PROJECTION);
 		glDisable(GL_CULL_FACE);
-		glPushMatrix();
-		glLoadIdentity();
-		glOrthox(0.0f,xRes,yRes,0,-1.0f,1.0f);
+		projectionStack.push_back(projectionMatrix);
+		setOrthoProjection(0.0f, xRes, yRes, 0.0f, -1.0f, 1.0f);
+		loadProjectionMatrix();
 		//		glOrtho(0.0f,2500.0f,2500.0f,0,-1.0f,1.0f);
 		orthoMode = true;
 	}
-	glMatrixMode(GL_MODELVIEW);	
+	modelviewMatrix.identity();
 	glLoadIdentity();
 }
 
@@ -335,19 +307,23 @@ void OpenGLES1Renderer::setPerspectiveMode() {
 		}
 		glEnable (GL_DEPTH_TEST);
 		glEnable(GL_CULL_FACE);
-		glMatrixMode( GL_PROJECTION );
-		glPopMatrix();
-		glMatrixMode( GL_MODELVIEW );
+		if(projectionStack.size() > 0) {
+			projectionMatrix = projectionStack.back();
+			projectionStack.pop_back();
+		}
+		loadProjectionMatrix();
 		orthoMode = false;
 	}
+	modelviewMatrix.identity();
 	glLoadIdentity();
 	
-	glGetFloatv( GL_PROJECTION_MATRIX, sceneProjectionMatrix);
+	sceneProjectionMatrix = projectionMatrix;
 	currentTexture = NULL;
 }
 
 void OpenGLES1Renderer::BeginRender() {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	modelviewMatrix.identity();
 	glLoadIdentity();
 	currentTexture = NULL;
 }
@@ -358,14 +334,22 @@ void OpenGLES1Renderer::setClearColor(Number r, Number g, Number b) {
 }
 
 void OpenGLES1Renderer::translate3D(Vector3 *position) {
-	glTranslatef(position->x, position->y, position->z);
+	translate3D(position->x, position->y, position->z);
 }
 
 void OpenGLES1Renderer::translate3D(Number x, Number y, Number z) {
+	Matrix4 translation;
+	translation.setPosition(x, y, z);
+	modelviewMatrix = translation * modelviewMatrix;
 	glTranslatef(x, y, z);
 }
 
 void OpenGLES1Renderer::scale3D(Vector3 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.m[0][0] = scale->x;
+	scaleMatrix.m[1][1] = scale->y;
+	scaleMatrix.m[2][2] = scale->z;
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
 	glScalef(scale->x, scale->y, scale->z);
 }
 
@@ -567,10 +551,15 @@ void OpenGLES1Renderer::beginRenderOperation(int meshType) {
 }
 
 void OpenGLES1Renderer::pushMatrix() {
+	modelviewStack.push_back(modelviewMatrix);
 	glPushMatrix();
 }
 
 void OpenGLES1Renderer::popMatrix() {
+	if(modelviewStack.size() > 0) {
+		modelviewMatrix = modelviewStack.back();
+		modelviewStack.pop_back();
+	}
 	glPopMatrix();
 }
 
@@ -674,20 +663,33 @@ void OpenGLES1Renderer::draw3DLine(Vector3 origin, Vector3 direction, Number len
 }
 
 void OpenGLES1Renderer::translate2D(Number x, Number y) {
-	glTranslatef(x, y, 0.0f);
+	translate3D(x, y, 0.0f);
 }
 
 void OpenGLES1Renderer::scale2D(Vector2 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.m[0][0] = scale->x;
+	scaleMatrix.m[1][1] = scale->y;
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
 	glScalef(scale->x, scale->y, 1.0f);
 }
 
 void OpenGLES1Renderer::loadIdentity() {
 	setBlendingMode(BLEND_MODE_NORMAL);
+	modelviewMatrix.identity();
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 }
 
 void OpenGLES1Renderer::rotate2D(Number angle) {
+	Number c = cos(angle * TORADIANS);
+	Number s = sin(angle * TORADIANS);
+	Matrix4 rotation;
+	rotation.m[0][0] = c;
+	rotation.m[0][1] = s;
+	rotation.m[1][0] = -s;
+	rotation.m[1][1] = c;
+	modelviewMatrix = rotation * modelviewMatrix;
 	glRotatef(angle, 0.0f, 0.0f, 1.0f);
 }
 
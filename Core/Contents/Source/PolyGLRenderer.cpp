@@ -28,6 +28,7 @@
 PFNGLACTIVETEXTUREPROC   glActiveTexture;
 PFNGLMULTITEXCOORD2FPROC glMultiTexCoord2f;
 PFNGLMULTITEXCOORD3FPROC glMultiTexCoord3f;
+PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D;
 
 
 // ARB_vertex_buffer_object
@@ -62,14 +63,24 @@ PFNGLFRAMEBUFFERRENDERBUFFEREXTPROC glFramebufferRenderbufferEXT;
 PFNGLGETFRAMEBUFFERATTACHMENTPARAMETERIVEXTPROC glGetFramebufferAttachmentParameterivEXT;
 PFNGLGENERATEMIPMAPEXTPROC glGenerateMipmapEXT;
 
+// GL_ARB_instanced_arrays, GL_ARB_draw_instanced
+PFNGLGETATTRIBLOCATIONARBPROC glGetAttribLocationARB;
+PFNGLVERTEXATTRIBPOINTERARBPROC glVertexAttribPointerARB;
+PFNGLENABLEVERTEXATTRIBARRAYARBPROC glEnableVertexAttribArrayARB;
+PFNGLDISABLEVERTEXATTRIBARRAYARBPROC glDisableVertexAttribArrayARB;
+PFNGLVERTEXATTRIBDIVISORARBPROC glVertexAttribDivisorARB;
+PFNGLDRAWARRAYSINSTANCEDARBPROC glDrawArraysInstancedARB;
+PFNGLDRAWELEMENTSINSTANCEDARBPROC glDrawElementsInstancedARB;
+
 #endif
 using namespace Polycode;
 
 OpenGLRenderer::OpenGLRenderer() : Renderer() {
 
-	nearPlane = 0.1f;
-	farPlane = 100.0f;
 	verticesToDraw = 0;
+	indicesToDraw = NULL;
+	instancedArraysSupport = -1;
+	textureMatrixLoaded = false;
 }
 
 void OpenGLRenderer::initOSSpecific(){
@@ -78,6 +89,7 @@ void OpenGLRenderer::initOSSpecific(){
 	glActiveTexture   = (PFNGLACTIVETEXTUREPROC)wglGetProcAddress("glActiveTexture");
 	glMultiTexCoord2f = (PFNGLMULTITEXCOORD2FPROC)wglGetProcAddress("glMultiTexCoord2f");
 	glMultiTexCoord3f = (PFNGLMULTITEXCOORD3FPROC)wglGetProcAddress("glMultiTexCoord3f");
+	glCompressedTexImage2D = (PFNGLCOMPRESSEDTEXIMAGE2DPROC)wglGetProcAddress("glCompressedTexImage2D");
 
    // ARB_vertex_buffer_object
         glBindBufferARB = (PFNGLBINDBUFFERARBPROC)wglGetProcAddress("glBindBufferARB");
@@ -110,6 +122,14 @@ void OpenGLRenderer::initOSSpecific(){
         glGetFramebufferAttachmentParameterivEXT = (PFNGLGETFRAMEBUFFERATTACHMENTPARAMETERIVEXTPROC)wglGetProcAddress("glGetFramebufferAttachmentParameterivEXT");
         glGenerateMipmapEXT = (PFNGLGENERATEMIPMAPEXTPROC)wglGetProcAddress("glGenerateMipmapEXT");
 
+        glGetAttribLocationARB = (PFNGLGETATTRIBLOCATIONARBPROC)wglGetProcAddress("glGetAttribLocationARB");
+        glVertexAttribPointerARB = (PFNGLVERTEXATTRIBPOINTERARBPROC)wglGetProcAddress("glVertexAttribPointerARB");
+        glEnableVertexAttribArrayARB = (PFNGLENABLEVERTEXATTRIBARRAYARBPROC)wglGetProcAddress("glEnableVertexAttribArrayARB");
+        glDisableVertexAttribArrayARB = (PFNGLDISABLEVERTEXATTRIBARRAYARBPROC)wglGetProcAddress("glDisableVertexAttribArrayARB");
+        glVertexAttribDivisorARB = (PFNGLVERTEXATTRIBDIVISORARBPROC)wglGetProcAddress("glVertexAttribDivisorARB");
+        glDrawArraysInstancedARB = (PFNGLDRAWARRAYSINSTANCEDARBPROC)wglGetProcAddress("glDrawArraysInstancedARB");
+        glDrawElementsInstancedARB = (PFNGLDRAWELEMENTSINSTANCEDARBPROC)wglGetProcAddress("glDrawElementsInstancedARB");
+
 #endif
 }
 
@@ -119,13 +139,13 @@ void OpenGLRenderer::Resize(int xRes, int yRes) {
 	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
 	glClearDepth(1.0f);
 	
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-	gluPerspective(fov,(GLfloat)xRes/(GLfloat)yRes,nearPlane,farPlane);
+	setPerspectiveProjection(fov, (Number)xRes/(Number)yRes);
+	loadProjectionMatrix();
+	viewportWidth = xRes;
+	viewportHeight = yRes;
 	glViewport(0, 0, xRes, yRes);
 	glScissor(0, 0, xRes, yRes);
 	
-	glMatrixMode(GL_MODELVIEW);
 	glLineWidth(1);
 	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	
@@ -175,70 +195,41 @@ void OpenGLRenderer::setLineSmooth(bool val) {
 
 void OpenGLRenderer::setFOV(Number fov) {
 	this->fov = fov;
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fov,(GLfloat)xRes/(GLfloat)yRes,nearPlane,farPlane);	
+	setPerspectiveProjection(fov, (Number)xRes/(Number)yRes);
+	loadProjectionMatrix();
+	viewportWidth = xRes;
+	viewportHeight = yRes;
 	glViewport(0, 0, xRes, yRes);
 	glScissor(0, 0, xRes, yRes);
-	glMatrixMode(GL_MODELVIEW);	
 }
 
 void OpenGLRenderer::setViewportSize(int w, int h, Number fov) {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fov,(GLfloat)w/(GLfloat)h,nearPlane,farPlane);
+	setPerspectiveProjection(fov, (Number)w/(Number)h);
+	loadProjectionMatrix();
+	viewportWidth = w;
+	viewportHeight = h;
 	glViewport(0, 0, w, h);
 	glScissor(0, 0, w, h);
+}
+
+void OpenGLRenderer::loadProjectionMatrix() {
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixNumber(projectionMatrix.ml);
 	glMatrixMode(GL_MODELVIEW);
 }
 
 Vector3 OpenGLRenderer::Unproject(Number x, Number y) {
-	Vector3 coords;
-	GLfloat wx, wy, wz;
-	GLdouble cx, cy, cz;
-	
-	GLdouble mv[16];
-	glGetDoublev( GL_MODELVIEW_MATRIX, mv );
-	
-	GLdouble proj[16];
-	glGetDoublev( GL_PROJECTION_MATRIX, proj );
-	
-	GLint vp[4];
-	glGetIntegerv( GL_VIEWPORT, vp );
-	
-	wx = ( Number ) x;
-	wy = ( Number ) vp[3] - ( Number ) y;
-	glReadPixels( x, wy, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wz );
-	
-	gluUnProject( wx, wy, wz, mv, proj, vp, &cx, &cy, &cz );
-	
-	coords = Vector3( cx, cy, cz );
-	
-	return coords;
-	
+	// the depth under the cursor is the only thing that has to come from the GPU
+	GLfloat wz;
+	glReadPixels(x, viewportHeight - y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &wz);
+	return unprojectPoint(x, y, wz);
 }
 
 bool OpenGLRenderer::test2DCoordinate(Number x, Number y, Polycode::Polygon *poly, const Matrix4 &matrix, bool billboardMode) {
-	GLdouble nearPlane[3],farPlane[3];
-	
-	GLdouble mv[16];
 	Matrix4 camInverse = cameraMatrix.inverse();	
-	Matrix4 cmv;
-	cmv.identity();
-	cmv = cmv * camInverse;
 	
-	for(int i=0; i < 16; i++) {
-		mv[i] = cmv.ml[i];
-	}
-	
-	GLint vp[4];
-	glGetIntegerv( GL_VIEWPORT, vp );
-	
-	gluUnProject(x, yRes - y, 0.0, mv, sceneProjectionMatrix, vp,  &nearPlane[0], &nearPlane[1], &nearPlane[2]);
-	gluUnProject(x, yRes - y, 1.0, mv, sceneProjectionMatrix, vp,  &farPlane[0], &farPlane[1], &farPlane[2]);
-	
-	Vector3 nearVec(nearPlane[0], nearPlane[1], nearPlane[2]);
-	Vector3 farVec(farPlane[0], farPlane[1], farPlane[2]);
+	Vector3 nearVec = unprojectPoint(x, y, 0.0, sceneProjectionMatrix, camInverse);
+	Vector3 farVec = unprojectPoint(x, y, 1.0, sceneProjectionMatrix, camInverse);
 		
 	Vector3 dirVec = farVec - nearVec;	
 	dirVec.Normalize();
@@ -272,12 +263,14 @@ void OpenGLRenderer::enableDepthTest(bool val) {
 }
 
 void OpenGLRenderer::setModelviewMatrix(Matrix4 m) {
-	glLoadMatrixd(m.ml);
+	modelviewMatrix = m;
+	glLoadMatrixNumber(m.ml);
 }
 
 void OpenGLRenderer::multModelviewMatrix(Matrix4 m) {
 //	glMatrixMode(GL_MODELVIEW);
-	glMultMatrixd(m.ml);
+	modelviewMatrix = m * modelviewMatrix;
+	glMultMatrixNumber(m.ml);
 }
 
 void OpenGLRenderer::enableLighting(bool enable) {
@@ -387,18 +380,6 @@ void OpenGLRenderer::setBlendingMode(int blendingMode) {
 	glEnable(GL_BLEND);
 }
 
-Matrix4 OpenGLRenderer::getProjectionMatrix() {
-	Number m[16];
-	glGetDoublev( GL_PROJECTION_MATRIX, m);
-	return Matrix4(m);
-}
-
-Matrix4 OpenGLRenderer::getModelviewMatrix() {
-	Number m[16];
-    glGetDoublev( GL_MODELVIEW_MATRIX, m);
-	return Matrix4(m);
-}
-
 void OpenGLRenderer::renderZBufferToTexture(Texture *targetTexture) {
 //	OpenGLTexture *glTexture = (OpenGLTexture*)targetTexture;
 //	glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
@@ -440,13 +421,12 @@ void OpenGLRenderer::setFogProperties(int fogMode, Color color, Number density,
 
 void OpenGLRenderer::_setOrthoMode() {
 	if(!orthoMode) {
-		glMatrixMode(GL_PROJECTION);
-		glPushMatrix();
-		glLoadIdentity();
-		glOrtho(-1,1,-1,1,nearPlane,farPlane);
+		projectionStack.push_back(projectionMatrix);
+		setOrthoProjection(-1.0f, 1.0f, -1.0f, 1.0f, nearPlane, farPlane);
+		loadProjectionMatrix();
 		orthoMode = true;
 	}
-	glMatrixMode(GL_MODELVIEW);	
+	modelviewMatrix.identity();
 	glLoadIdentity();	
 }
 
@@ -461,14 +441,13 @@ void OpenGLRenderer::setOrthoMode(Number xSize, Number ySize) {
 	setBlendingMode(BLEND_MODE_NORMAL);
 	if(!orthoMode) {
 		glDisable(GL_LIGHTING);
-		glMatrixMode(GL_PROJECTION);
 		glDisable(GL_CULL_FACE);
-		glPushMatrix();
-		glLoadIdentity();
-		glOrtho(0.0f,xSize,ySize,0,-1.0f,1.0f);
+		projectionStack.push_back(projectionMatrix);
+		setOrthoProjection(0.0f, xSize, ySize, 0.0f, -1.0f, 1.0f);
+		loadProjectionMatrix();
 		orthoMode = true;
 	}
-	glMatrixMode(GL_MODELVIEW);	
+	modelviewMatrix.identity();
 	glLoadIdentity();
 }
 
@@ -486,19 +465,23 @@ void OpenGLRenderer::setPerspectiveMode() {
 		}
 		glEnable (GL_DEPTH_TEST);
 		glEnable(GL_CULL_FACE);
-		glMatrixMode( GL_PROJECTION );
-		glPopMatrix();
-		glMatrixMode( GL_MODELVIEW );
+		if(projectionStack.size() > 0) {
+			projectionMatrix = projectionStack.back();
+			projectionStack.pop_back();
+		}
+		loadProjectionMatrix();
 		orthoMode = false;
 	}
+	modelviewMatrix.identity();
 	glLoadIdentity();
 	
-	glGetDoublev( GL_PROJECTION_MATRIX, sceneProjectionMatrix);
+	sceneProjectionMatrix = projectionMatrix;
 	currentTexture = NULL;
 }
 
 void OpenGLRenderer::BeginRender() {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	modelviewMatrix.identity();
 	glLoadIdentity();
 	currentTexture = NULL;
 }
@@ -509,14 +492,22 @@ void OpenGLRenderer::setClearColor(Number r, Number g, Number b) {
 }
 
 void OpenGLRenderer::translate3D(Vector3 *position) {
-	glTranslatef(position->x, position->y, position->z);
+	translate3D(position->x, position->y, position->z);
 }
 
 void OpenGLRenderer::translate3D(Number x, Number y, Number z) {
+	Matrix4 translation;
+	translation.setPosition(x, y, z);
+	modelviewMatrix = translation * modelviewMatrix;
 	glTranslatef(x, y, z);
 }
 
 void OpenGLRenderer::scale3D(Vector3 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.m[0][0] = scale->x;
+	scaleMatrix.m[1][1] = scale->y;
+	scaleMatrix.m[2][2] = scale->z;
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
 	glScalef(scale->x, scale->y, scale->z);
 }
 
@@ -700,6 +691,13 @@ void OpenGLRenderer::setTexture(Texture *texture) {
 	if(texture == NULL) {
 		glActiveTexture(GL_TEXTURE0);		
 		glDisable(GL_TEXTURE_2D);
+		// untextured draws can still use texture coordinates, for example through a shader
+		if(textureMatrixLoaded) {
+			glMatrixMode(GL_TEXTURE);
+			glLoadIdentity();
+			glMatrixMode(GL_MODELVIEW);
+			textureMatrixLoaded = false;
+		}
 		return;
 	}
 	
@@ -708,8 +706,28 @@ void OpenGLRenderer::setTexture(Texture *texture) {
 		glActiveTexture(GL_TEXTURE0);	
 		
 		if(currentTexture != texture) {			
-			OpenGLTexture *glTexture = (OpenGLTexture*)texture;
-			glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
+			// atlas regions bind their page and map their coordinates into it
+			Texture *pageTexture = texture->getPageTexture();
+			if(currentTexture == NULL || currentTexture->getPageTexture() != pageTexture) {
+				OpenGLTexture *glTexture = (OpenGLTexture*)pageTexture;
+				glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
+			}
+		}
+		
+		// the matrix is also reloaded when unbinding reset it, even though the texture stayed bound
+		if(texture->isAtlasRegion()) {
+			if(currentTexture != texture || !textureMatrixLoaded) {
+				Matrix4 texCoordMatrix = texture->getTexCoordMatrix();
+				glMatrixMode(GL_TEXTURE);
+				glLoadMatrixNumber(texCoordMatrix.ml);
+				glMatrixMode(GL_MODELVIEW);
+				textureMatrixLoaded = true;
+			}
+		} else if(textureMatrixLoaded) {
+			glMatrixMode(GL_TEXTURE);
+			glLoadIdentity();
+			glMatrixMode(GL_MODELVIEW);
+			textureMatrixLoaded = false;
 		}
 	} else {
 		glDisable(GL_TEXTURE_2D);
@@ -719,10 +737,15 @@ void OpenGLRenderer::setTexture(Texture *texture) {
 }
 
 void OpenGLRenderer::pushMatrix() {
+	modelviewStack.push_back(modelviewMatrix);
 	glPushMatrix();
 }
 
 void OpenGLRenderer::popMatrix() {
+	if(modelviewStack.size() > 0) {
+		modelviewMatrix = modelviewStack.back();
+		modelviewStack.pop_back();
+	}
 	glPopMatrix();
 }
 
@@ -750,102 +773,219 @@ void OpenGLRenderer::pushRenderDataArray(RenderDataArray *array) {
 			glBindBufferARB( GL_ARRAY_BUFFER_ARB, 0);			
 			glNormalPointer(GL_FLOAT, 0, array->arrayPtr);	
 		break;
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			indicesToDraw = array;
+		break;
 	}
 }
 
-RenderDataArray *OpenGLRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
-	RenderDataArray *newArray = createRenderDataArray(arrayType);
-		
-	newArray->count = 0;
-	long bufferSize = 0;
-	long newBufferSize = 0;		
-	GLfloat* buffer = NULL;
+void OpenGLRenderer::pushInterleavedRenderDataArray(RenderDataArray *array, bool useColors) {
+	GLfloat *data = (GLfloat*)array->arrayPtr;
+	GLsizei stride = Mesh::VERTEX_STREAM_STRIDE * sizeof(GLfloat);
 	
-	switch (arrayType) {
+	glBindBufferARB( GL_ARRAY_BUFFER_ARB, 0);
+	
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, data + Mesh::VERTEX_STREAM_POSITION_OFFSET);
+	
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glNormalPointer(GL_FLOAT, stride, data + Mesh::VERTEX_STREAM_NORMAL_OFFSET);
+	
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, stride, data + Mesh::VERTEX_STREAM_TEXCOORD_OFFSET);
+	
+	if(useColors) {
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_FLOAT, stride, data + Mesh::VERTEX_STREAM_COLOR_OFFSET);
+	}
+	
+	verticesToDraw = array->count;
+}
+
+static void *reserveRenderDataArray(RenderDataArray *array, unsigned int bytes) {
+	if(bytes > array->capacity) {
+		free(array->arrayPtr);
+		array->arrayPtr = malloc(bytes);
+		array->capacity = bytes;
+	}
+	return array->arrayPtr;
+}
+
+void OpenGLRenderer::updateIndexedRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array) {
+	int offset;
+	switch (array->arrayType) {
 		case RenderDataArray::VERTEX_DATA_ARRAY:
-		{		
-			buffer = (GLfloat*)malloc(1);							
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newArray->count++;			
-					newBufferSize = bufferSize + 3;
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->x;
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->y;
-					buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->z;			
-					bufferSize = newBufferSize;	
-				}		   
-			}
-		}
+			offset = Mesh::VERTEX_STREAM_POSITION_OFFSET;
 		break;
 		case RenderDataArray::COLOR_DATA_ARRAY:
-		{
-			buffer = (GLfloat*)malloc(1);			
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 4;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->vertexColor.r;
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->vertexColor.g;
-					buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->vertexColor.b;
-					buffer[bufferSize+3] = mesh->getPolygon(i)->getVertex(j)->vertexColor.a;			
-					bufferSize = newBufferSize;					
-				}		   
-			}
-		}
+			offset = Mesh::VERTEX_STREAM_COLOR_OFFSET;
 		break;
 		case RenderDataArray::NORMAL_DATA_ARRAY:
+			offset = Mesh::VERTEX_STREAM_NORMAL_OFFSET;
+		break;
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+			offset = Mesh::VERTEX_STREAM_TEXCOORD_OFFSET;
+		break;
+		case RenderDataArray::INDEX_DATA_ARRAY:
 		{
-			buffer = (GLfloat*)malloc(1);	
-			
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 3;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));		
-					if(mesh->getPolygon(i)->useVertexNormals) {
-						buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->normal.x;
-						buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->normal.y;
-						buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->normal.z;				
-					} else {
-						buffer[bufferSize+0] = mesh->getPolygon(i)->getFaceNormal().x;
-						buffer[bufferSize+1] = mesh->getPolygon(i)->getFaceNormal().y;
-						buffer[bufferSize+2] = mesh->getPolygon(i)->getFaceNormal().z;
-					}
-					bufferSize = newBufferSize;					
-				}		   
-			}			
+			array->count = mesh->getIndexCount();
+			array->size = mesh->hasLargeIndices() ? sizeof(GLuint) : sizeof(GLushort);
+			if(array->count > 0) {
+				void *buffer = reserveRenderDataArray(array, array->count * array->size);
+				memcpy(buffer, mesh->getIndexData(), array->count * array->size);
+			}
+			return;
 		}
 		break;
-		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+		case RenderDataArray::INTERLEAVED_DATA_ARRAY:
 		{
-			buffer = (GLfloat*)malloc(1);				
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 2;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));		
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->getTexCoord().x;											
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->getTexCoord().y;							
-					bufferSize = newBufferSize;					
-				}		   
-			}			
+			// the vertex stream already has the interleaved layout
+			array->count = mesh->getStreamVertexCount();
+			if(array->count > 0) {
+				unsigned int bytes = array->count * Mesh::VERTEX_STREAM_STRIDE * sizeof(GLfloat);
+				void *buffer = reserveRenderDataArray(array, bytes);
+				memcpy(buffer, mesh->getVertexStream(), bytes);
+			}
+			return;
 		}
 		break;
 		default:
+			return;
 		break;
 	}
 	
-	if(buffer != NULL) {
-		free(newArray->arrayPtr);
-		newArray->arrayPtr = buffer;		
-	}
+	unsigned int vertexCount = mesh->getStreamVertexCount();
+	if(array->arrayType == RenderDataArray::VERTEX_DATA_ARRAY)
+		array->count = vertexCount;
+	if(vertexCount == 0)
+		return;
 	
+	GLfloat *buffer = (GLfloat*)reserveRenderDataArray(array, vertexCount * array->size * sizeof(GLfloat));
+	float *stream = mesh->getVertexStream() + offset;
+	for(int i=0; i < vertexCount; i++) {
+		for(int j=0; j < array->size; j++) {
+			buffer[(i*array->size)+j] = stream[j];
+		}
+		stream += Mesh::VERTEX_STREAM_STRIDE;
+	}
+}
+
+RenderDataArray *OpenGLRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
+	RenderDataArray *newArray = createRenderDataArray(arrayType);
+	updateRenderDataArrayForMesh(mesh, newArray);
 	return newArray;
 }
 
+void OpenGLRenderer::updateRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array) {
+	if(mesh->isIndexed()) {
+		updateIndexedRenderDataArrayForMesh(mesh, array);
+		return;
+	}
+	
+	int vertexSize;
+	switch (array->arrayType) {
+		case RenderDataArray::VERTEX_DATA_ARRAY:
+		case RenderDataArray::COLOR_DATA_ARRAY:
+		case RenderDataArray::NORMAL_DATA_ARRAY:
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+			vertexSize = array->size;
+		break;
+		case RenderDataArray::INTERLEAVED_DATA_ARRAY:
+			vertexSize = Mesh::VERTEX_STREAM_STRIDE;
+		break;
+		default:
+			return;
+		break;
+	}
+	
+	// size the buffer once up front instead of growing it per vertex
+	unsigned int vertexCount = mesh->getVertexCount();
+	if(array->arrayType == RenderDataArray::VERTEX_DATA_ARRAY || array->arrayType == RenderDataArray::INTERLEAVED_DATA_ARRAY)
+		array->count = vertexCount;
+	if(vertexCount == 0)
+		return;
+	
+	GLfloat *buffer = (GLfloat*)reserveRenderDataArray(array, vertexCount * vertexSize * sizeof(GLfloat));
+	
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		switch (array->arrayType) {
+			case RenderDataArray::VERTEX_DATA_ARRAY:
+				for(int j=0; j < polygon->getVertexCount(); j++) {
+					Vertex *vertex = polygon->getVertex(j);
+					buffer[0] = vertex->x;
+					buffer[1] = vertex->y;
+					buffer[2] = vertex->z;
+					buffer += 3;
+				}
+			break;
+			case RenderDataArray::COLOR_DATA_ARRAY:
+				for(int j=0; j < polygon->getVertexCount(); j++) {
+					Vertex *vertex = polygon->getVertex(j);
+					buffer[0] = vertex->vertexColor.r;
+					buffer[1] = vertex->vertexColor.g;
+					buffer[2] = vertex->vertexColor.b;
+					buffer[3] = vertex->vertexColor.a;
+					buffer += 4;
+				}
+			break;
+			case RenderDataArray::NORMAL_DATA_ARRAY:
+			{
+				Vector3 faceNormal;
+				if(!polygon->useVertexNormals)
+					faceNormal = polygon->getFaceNormal();
+				for(int j=0; j < polygon->getVertexCount(); j++) {
+					Vector3 normal = polygon->useVertexNormals ? polygon->getVertex(j)->normal : faceNormal;
+					buffer[0] = normal.x;
+					buffer[1] = normal.y;
+					buffer[2] = normal.z;
+					buffer += 3;
+				}
+			}
+			break;
+			case RenderDataArray::TEXCOORD_DATA_ARRAY:
+				for(int j=0; j < polygon->getVertexCount(); j++) {
+					Vector2 texCoord = polygon->getVertex(j)->getTexCoord();
+					buffer[0] = texCoord.x;
+					buffer[1] = texCoord.y;
+					buffer += 2;
+				}
+			break;
+			case RenderDataArray::INTERLEAVED_DATA_ARRAY:
+			{
+				Vector3 faceNormal;
+				if(!polygon->useVertexNormals)
+					faceNormal = polygon->getFaceNormal();
+				for(int j=0; j < polygon->getVertexCount(); j++) {
+					Vertex *vertex = polygon->getVertex(j);
+					Vector3 normal = polygon->useVertexNormals ? vertex->normal : faceNormal;
+					Vector2 texCoord = vertex->getTexCoord();
+					
+					buffer[Mesh::VERTEX_STREAM_POSITION_OFFSET+0] = vertex->x;
+					buffer[Mesh::VERTEX_STREAM_POSITION_OFFSET+1] = vertex->y;
+					buffer[Mesh::VERTEX_STREAM_POSITION_OFFSET+2] = vertex->z;
+					buffer[Mesh::VERTEX_STREAM_NORMAL_OFFSET+0] = normal.x;
+					buffer[Mesh::VERTEX_STREAM_NORMAL_OFFSET+1] = normal.y;
+					buffer[Mesh::VERTEX_STREAM_NORMAL_OFFSET+2] = normal.z;
+					buffer[Mesh::VERTEX_STREAM_COLOR_OFFSET+0] = vertex->vertexColor.r;
+					buffer[Mesh::VERTEX_STREAM_COLOR_OFFSET+1] = vertex->vertexColor.g;
+					buffer[Mesh::VERTEX_STREAM_COLOR_OFFSET+2] = vertex->vertexColor.b;
+					buffer[Mesh::VERTEX_STREAM_COLOR_OFFSET+3] = vertex->vertexColor.a;
+					buffer[Mesh::VERTEX_STREAM_TEXCOORD_OFFSET+0] = texCoord.x;
+					buffer[Mesh::VERTEX_STREAM_TEXCOORD_OFFSET+1] = texCoord.y;
+					buffer += Mesh::VERTEX_STREAM_STRIDE;
+				}
+			}
+			break;
+		}
+	}
+}
+
 RenderDataArray *OpenGLRenderer::createRenderDataArray(int arrayType) {
 	RenderDataArray *newArray = new RenderDataArray();
 	newArray->arrayType = arrayType;
 	newArray->arrayPtr = malloc(1);
+	newArray->capacity = 1;
 	newArray->stride = 0;
 	newArray->count = 0;
 	
@@ -861,7 +1001,14 @@ RenderDataArray *OpenGLRenderer::createRenderDataArray(int arrayType) {
 			break;						
 		case RenderDataArray::TEXCOORD_DATA_ARRAY:
 			newArray->size = 2;
-			break;									
+			break;
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			newArray->size = sizeof(GLushort);
+			break;
+		case RenderDataArray::INTERLEAVED_DATA_ARRAY:
+			newArray->size = Mesh::VERTEX_STREAM_STRIDE;
+			newArray->stride = Mesh::VERTEX_STREAM_STRIDE * sizeof(GLfloat);
+			break;
 		default:
 			break;
 	}
@@ -873,7 +1020,7 @@ void OpenGLRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayDat
 	
 }
 
-void OpenGLRenderer::drawArrays(int drawType) {
+GLenum OpenGLRenderer::getDrawMode(int drawType) {
 	
 	GLenum mode = GL_TRIANGLES;
 	
@@ -916,9 +1063,21 @@ void OpenGLRenderer::drawArrays(int drawType) {
 		break;
 	}
 	
-	glDrawArrays( mode, 0, verticesToDraw);	
-	
+	return mode;
+}
+
+void OpenGLRenderer::drawPushedArrays(GLenum mode) {
+	if(indicesToDraw) {
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+		glDrawElements(mode, indicesToDraw->count, indicesToDraw->size == sizeof(GLuint) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, indicesToDraw->arrayPtr);
+	} else {
+		glDrawArrays( mode, 0, verticesToDraw);	
+	}
+}
+
+void OpenGLRenderer::releasePushedArrays() {
 	verticesToDraw = 0;
+	indicesToDraw = NULL;
 		
 	glDisableClientState( GL_VERTEX_ARRAY);	
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );		
@@ -926,6 +1085,115 @@ void OpenGLRenderer::drawArrays(int drawType) {
 	glDisableClientState( GL_COLOR_ARRAY );		
 }
 
+void OpenGLRenderer::drawArrays(int drawType) {
+	drawPushedArrays(getDrawMode(drawType));
+	releasePushedArrays();
+}
+
+bool OpenGLRenderer::supportsInstancedArrays() {
+	if(instancedArraysSupport == -1) {
+		const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+		instancedArraysSupport = 0;
+		if(extensions && strstr(extensions, "GL_ARB_instanced_arrays") && strstr(extensions, "GL_ARB_draw_instanced")) {
+			instancedArraysSupport = 1;
+		}
+#ifdef _WINDOWS
+		if(!glVertexAttribDivisorARB || !glDrawArraysInstancedARB || !glDrawElementsInstancedARB || !glGetAttribLocationARB) {
+			instancedArraysSupport = 0;
+		}
+#endif
+	}
+	return (instancedArraysSupport == 1);
+}
+
+bool OpenGLRenderer::drawInstancedArrays(GLenum mode, const Matrix4 *transforms, const Color *colors, unsigned int numInstances) {
+	if(!supportsInstancedArrays())
+		return false;
+	
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	if(program == 0)
+		return false;
+	
+	GLint matrixLocation = glGetAttribLocationARB(program, "instanceMatrix");
+	if(matrixLocation < 0)
+		return false;
+	GLint colorLocation = -1;
+	if(colors)
+		colorLocation = glGetAttribLocationARB(program, "instanceColor");
+	
+	// matrix columns followed by the color, one record per instance
+	unsigned int recordSize = 20;
+	if(instanceData.size() < numInstances * recordSize)
+		instanceData.resize(numInstances * recordSize);
+	
+	GLfloat *record = &instanceData[0];
+	for(unsigned int i=0; i < numInstances; i++) {
+		for(int j=0; j < 16; j++) {
+			record[j] = transforms[i].ml[j];
+		}
+		if(colors) {
+			record[16] = colors[i].r;
+			record[17] = colors[i].g;
+			record[18] = colors[i].b;
+			record[19] = colors[i].a;
+		}
+		record += recordSize;
+	}
+	
+	GLsizei stride = recordSize * sizeof(GLfloat);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	for(int c=0; c < 4; c++) {
+		glEnableVertexAttribArrayARB(matrixLocation+c);
+		glVertexAttribPointerARB(matrixLocation+c, 4, GL_FLOAT, GL_FALSE, stride, &instanceData[c*4]);
+		glVertexAttribDivisorARB(matrixLocation+c, 1);
+	}
+	if(colorLocation >= 0) {
+		glEnableVertexAttribArrayARB(colorLocation);
+		glVertexAttribPointerARB(colorLocation, 4, GL_FLOAT, GL_FALSE, stride, &instanceData[16]);
+		glVertexAttribDivisorARB(colorLocation, 1);
+	}
+	
+	if(indicesToDraw) {
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+		glDrawElementsInstancedARB(mode, indicesToDraw->count, indicesToDraw->size == sizeof(GLuint) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, indicesToDraw->arrayPtr, numInstances);
+	} else {
+		glDrawArraysInstancedARB(mode, 0, verticesToDraw, numInstances);
+	}
+	
+	for(int c=0; c < 4; c++) {
+		glVertexAttribDivisorARB(matrixLocation+c, 0);
+		glDisableVertexAttribArrayARB(matrixLocation+c);
+	}
+	if(colorLocation >= 0) {
+		glVertexAttribDivisorARB(colorLocation, 0);
+		glDisableVertexAttribArrayARB(colorLocation);
+	}
+	return true;
+}
+
+void OpenGLRenderer::drawArraysInstanced(int drawType, const Matrix4 *transforms, const Color *colors, unsigned int numInstances) {
+	GLenum mode = getDrawMode(drawType);
+	
+	if(numInstances > 0 && !drawInstancedArrays(mode, transforms, colors, numInstances)) {
+		// the pushed arrays stay bound for every instance, only the transform and color change.
+		// The current color is saved so the instance colors do not leak into later draws.
+		glPushAttrib(GL_CURRENT_BIT);
+		for(unsigned int i=0; i < numInstances; i++) {
+			glPushMatrix();
+			glMultMatrixNumber(transforms[i].ml);
+			if(colors) {
+				glColor4f(colors[i].r, colors[i].g, colors[i].b, colors[i].a);
+			}
+			drawPushedArrays(mode);
+			glPopMatrix();
+		}
+		glPopAttrib();
+	}
+	
+	releasePushedArrays();
+}
+
 /*
 void OpenGLRenderer::draw3DVertex2UV(Vertex *vertex, Vector2 *faceUV1, Vector2 *faceUV2) {
 	if(vertex->useVertexColor)
@@ -967,19 +1235,32 @@ void OpenGLRenderer::drawScreenQuad(Number qx, Number qy) {
 
 
 void OpenGLRenderer::translate2D(Number x, Number y) {
-	glTranslatef(x, y, 0.0f);
+	translate3D(x, y, 0.0f);
 }
 
 void OpenGLRenderer::scale2D(Vector2 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.m[0][0] = scale->x;
+	scaleMatrix.m[1][1] = scale->y;
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
 	glScalef(scale->x, scale->y, 1.0f);
 }
 
 void OpenGLRenderer::loadIdentity() {
+	modelviewMatrix.identity();
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 }
 
 void OpenGLRenderer::rotate2D(Number angle) {
+	Number c = cos(angle * TORADIANS);
+	Number s = sin(angle * TORADIANS);
+	Matrix4 rotation;
+	rotation.m[0][0] = c;
+	rotation.m[0][1] = s;
+	rotation.m[1][0] = -s;
+	rotation.m[1][1] = c;
+	modelviewMatrix = rotation * modelviewMatrix;
 	glRotatef(angle, 0.0f, 0.0f, 1.0f);
 }
 
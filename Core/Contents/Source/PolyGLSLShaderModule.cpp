@@ -198,7 +198,7 @@ void GLSLShaderModule::setGLSLSpotLightTextureMatrixParameter(Renderer *renderer
 		vector<LightInfo> spotLights = renderer->getSpotLights();			
 		glMatrixMode(GL_MODELVIEW);
 		glPushMatrix();
-		glLoadMatrixd(spotLights[lightIndex].textureMatrix.ml);				
+		glLoadMatrixNumber(spotLights[lightIndex].textureMatrix.ml);				
 //		cgGLSetStateMatrixParameter(param.cgParam, GLSL_GL_MODELVIEW_MATRIX,GLSL_GL_MATRIX_IDENTITY);
 		glPopMatrix();
 	}					
@@ -551,7 +551,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 		int texture_location = glGetUniformLocation(glslShader->shader_id, cgBinding->textures[i].name.c_str());
 		glUniform1i(texture_location, textureIndex);
 		glActiveTexture(GL_TEXTURE0 + textureIndex);		
-		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());	
+		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)cgBinding->textures[i].texture->getPageTexture())->getTextureID());	
 		textureIndex++;
 	}	
 	
@@ -571,7 +571,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 		int texture_location = glGetUniformLocation(glslShader->shader_id, cgBinding->textures[i].name.c_str());
 		glUniform1i(texture_location, textureIndex);
 		glActiveTexture(GL_TEXTURE0 + textureIndex);		
-		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());	
+		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)cgBinding->textures[i].texture->getPageTexture())->getTextureID());	
 		textureIndex++;
 	}	
 
@@ -607,7 +607,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 /*	
 	cgBinding = (GLSLShaderBinding*)localOptions;
 	for(int i=0; i < cgBinding->textures.size(); i++) {
-		cgGLSetTextureParameter(cgBinding->textures[i].vpParam, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());
+		cgGLSetTextureParameter(cgBinding->textures[i].vpParam, ((OpenGLTexture*)cgBinding->textures[i].texture->getPageTexture())->getTextureID());
 		cgGLEnableTextureParameter(cgBinding->textures[i].vpParam);
 	}			
 	
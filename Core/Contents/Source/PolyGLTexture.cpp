@@ -22,8 +22,37 @@
 
 #include "PolyGLTexture.h"
 
+#ifdef _WINDOWS
+extern PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D;
+#endif
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
 using namespace Polycode;
 
+int OpenGLTexture::compressionSupport = -1;
+
+bool OpenGLTexture::supportsCompression() {
+	if(compressionSupport == -1) {
+		const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+		compressionSupport = 0;
+		if(extensions && strstr(extensions, "GL_EXT_texture_compression_s3tc")) {
+			compressionSupport = 1;
+		}
+#ifdef _WINDOWS
+		if(!glCompressedTexImage2D) {
+			compressionSupport = 0;
+		}
+#endif
+		if(compressionSupport == 0) {
+			Logger::log("S3TC texture compression is not supported, uploading textures uncompressed.\n");
+		}
+	}
+	return (compressionSupport == 1);
+}
+
 OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, int filteringMode, int type) : Texture(width, height, textureData,clamp, type) {
 	this->filteringMode = filteringMode;
 	glTextureLoaded = false;
@@ -43,6 +72,15 @@ void OpenGLTexture::recreateFromImageData() {
 	
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
+	
+	// compressed levels can only be used with S3TC, otherwise fall back to the uncompressed base level
+	bool compressed = (compressionFormat != Image::COMPRESSION_NONE);
+	unsigned int numLevels = getNumLevels();
+	if(compressed && !supportsCompression()) {
+		compressed = false;
+		numLevels = 1;
+	}
+	
 	if(clamp) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
@@ -53,17 +91,30 @@ void OpenGLTexture::recreateFromImageData() {
 	switch(filteringMode) {
 		case Renderer::TEX_FILTERING_LINEAR:
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (numLevels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 			break;
 		case Renderer::TEX_FILTERING_NEAREST:
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);		
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (numLevels > 1) ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);		
 			break;
 	}	
+	// the level chain may stop before 1x1
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels-1);
 	
-	if(textureData) {
-		glTexImage2D(GL_TEXTURE_2D, 0, glTextureType, width, height, 0, glTextureType, GL_UNSIGNED_BYTE, textureData);							
-//		gluBuild2DMipmaps(GL_TEXTURE_2D, 3, glTextureType, width, height, glTextureType, GL_UNSIGNED_BYTE, textureData);
+	if(compressed) {
+		GLenum compressedType = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		if(compressionFormat == Image::COMPRESSION_BC1) {
+			compressedType = (glTextureType == GL_RGB) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		}
+		for(unsigned int i=0; i < numLevels; i++) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, compressedType, getLevelWidth(i), getLevelHeight(i), 0, getLevelDataSize(i), getLevelData(i));
+		}
+	} else if(textureData) {
+		// small RGB levels have rows that are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for(unsigned int i=0; i < numLevels; i++) {
+			glTexImage2D(GL_TEXTURE_2D, i, glTextureType, getLevelWidth(i), getLevelHeight(i), 0, glTextureType, GL_UNSIGNED_BYTE, getLevelData(i));
+		}
 	}
 	glTextureLoaded = true;
 }
@@ -79,10 +130,7 @@ void OpenGLTexture::setGLInfo(GLuint textureID, GLuint frameBufferID) {
 
 void OpenGLTexture::setTextureData(char *data) {
 	glBindTexture(GL_TEXTURE_2D, textureID);
-	glDrawBuffer(GL_AUX0);
-	glDrawPixels(width, height, glTextureType, GL_UNSIGNED_BYTE, data);
-	glReadBuffer(GL_AUX0);
-//	glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, 128, 128, 0);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, glTextureType, GL_UNSIGNED_BYTE, data);
 }
 
 OpenGLTexture::~OpenGLTexture() {
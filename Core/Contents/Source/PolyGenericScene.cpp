@@ -174,14 +174,14 @@ void GenericScene::loadScene(String fileName) {
 	
 	Number r,g,b,a;
 	
-	OSBasics::read(&r, sizeof(Number), 1, inFile);
-	OSBasics::read(&g, sizeof(Number), 1, inFile);
-	OSBasics::read(&b, sizeof(Number), 1, inFile);
+	OSBasics::readNumbers(&r, 1, inFile);
+	OSBasics::readNumbers(&g, 1, inFile);
+	OSBasics::readNumbers(&b, 1, inFile);
 	clearColor.setColor(r,g,b,1.0f);
 
-	OSBasics::read(&r, sizeof(Number), 1, inFile);
-	OSBasics::read(&g, sizeof(Number), 1, inFile);
-	OSBasics::read(&b, sizeof(Number), 1, inFile);
+	OSBasics::readNumbers(&r, 1, inFile);
+	OSBasics::readNumbers(&g, 1, inFile);
+	OSBasics::readNumbers(&b, 1, inFile);
 	ambientColor.setColor(r,g,b,1.0f);
 	
 	
@@ -202,8 +202,8 @@ void GenericScene::loadScene(String fileName) {
 	Logger::log("Loading scene (%d objects)\n", numObjects);
 	for(int i=0; i < numObjects; i++) {
 		
-		OSBasics::read(t, sizeof(Number), 3, inFile);
-		OSBasics::read(rq, sizeof(Number), 4, inFile);
+		OSBasics::readNumbers(t, 3, inFile);
+		OSBasics::readNumbers(rq, 4, inFile);
 		newEntity = NULL;
 		
 		OSBasics::read(&objectType, sizeof(unsigned int), 1, inFile);
@@ -228,10 +228,10 @@ void GenericScene::loadScene(String fileName) {
 				
 				Logger::log("adding mesh (texture: %s)\n", buffer);
 				
-				OSBasics::read(&r, sizeof(Number), 1, inFile);
-				OSBasics::read(&g, sizeof(Number), 1, inFile);
-				OSBasics::read(&b, sizeof(Number), 1, inFile);
-				OSBasics::read(&a, sizeof(Number), 1, inFile);
+				OSBasics::readNumbers(&r, 1, inFile);
+				OSBasics::readNumbers(&g, 1, inFile);
+				OSBasics::readNumbers(&b, 1, inFile);
+				OSBasics::readNumbers(&a, 1, inFile);
 				
 				newMaterial = (Material*) CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, buffer);
 				newMesh = new Mesh(Mesh::TRI_MESH);
@@ -264,7 +264,7 @@ void GenericScene::loadScene(String fileName) {
 					Mesh *mesh = new Mesh(Mesh::TRI_MESH);
 					
 					for(int i=0; i < numVertices; i++) {
-						OSBasics::read(co, sizeof(Number), 3, inFile);
+						OSBasics::readNumbers(co, 3, inFile);
 						Vertex *newVert = new Vertex(co[0], co[1], co[2]);
 						mesh->addVertex(newVert);
 					}
@@ -300,9 +300,9 @@ void GenericScene::loadScene(String fileName) {
 				Number col[3],e,d;
 				unsigned int lType;
 				OSBasics::read(&lType, sizeof(unsigned int), 1, inFile);				
-				OSBasics::read(&e, sizeof(Number), 1, inFile);
-				OSBasics::read(&d, sizeof(Number), 1, inFile);
-				OSBasics::read(col, sizeof(Number), 3, inFile);
+				OSBasics::readNumbers(&e, 1, inFile);
+				OSBasics::readNumbers(&d, 1, inFile);
+				OSBasics::readNumbers(col, 3, inFile);
 
 				SceneLight *newLight = new SceneLight(lType, e, d, this);
 				newLight->lightColor.setColor(col[0],col[1],col[2],1.0f);
@@ -400,8 +400,8 @@ void GenericScene::writeEntityMatrix(SceneEntity *entity, OSFILE *outFile) {
 	rq[2] = entity->getRotationQuat().y;
 	rq[3] = entity->getRotationQuat().z;						
 	
-	OSBasics::write(t, sizeof(Number), 3, outFile);
-	OSBasics::write(rq, sizeof(Number), 4, outFile);
+	OSBasics::writeNumbers(t, 3, outFile);
+	OSBasics::writeNumbers(rq, 4, outFile);
 	
 }
 
@@ -461,7 +461,7 @@ void GenericScene::saveScene(String fileName) {
 			pos[0] = vert->x;
 			pos[1] = vert->y;
 			pos[2] = vert->z;			
-			OSBasics::write(pos, sizeof(Number),3, outFile);
+			OSBasics::writeNumbers(pos, 3, outFile);
 		}
 
 		unsigned int numFaces = mesh->getMesh()->getPolygonCount();
@@ -489,9 +489,9 @@ void GenericScene::saveScene(String fileName) {
 		e = lights[i]->getIntensity();
 		d = lights[i]->getDistance();
 		
-		OSBasics::write(&e, sizeof(Number), 1, outFile);
-		OSBasics::write(&d, sizeof(Number), 1, outFile);
-		OSBasics::write(col, sizeof(Number), 3, outFile);
+		OSBasics::writeNumbers(&e, 1, outFile);
+		OSBasics::writeNumbers(&d, 1, outFile);
+		OSBasics::writeNumbers(col, 3, outFile);
 	}
 
 	for(int i=0; i < customEntities.size(); i++) {
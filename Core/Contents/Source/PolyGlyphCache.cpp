@@ -0,0 +1,235 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyGlyphCache.h"
+#include <string.h>
+
+using namespace Polycode;
+
+#define NORMAL_FT_FLAGS FT_LOAD_TARGET_LIGHT
+
+GlyphInfo::GlyphInfo() {
+	glyphIndex = 0;
+	advance = 0;
+	bitmapLeft = 0;
+	bitmapTop = 0;
+	width = 0;
+	rows = 0;
+	atlasX = 0;
+	atlasY = 0;
+}
+
+TextLayout::TextLayout() {
+	width = 0;
+	maxTop = 0;
+}
+
+GlyphCache::GlyphCache(FT_Face face, int size, bool monochrome) {
+	this->face = face;
+	this->size = size;
+	this->monochrome = monochrome;
+	hasKerning = (FT_HAS_KERNING(face) != 0);
+	
+	atlasWidth = INITIAL_ATLAS_SIZE;
+	atlasHeight = INITIAL_ATLAS_SIZE;
+	atlas.resize(atlasWidth * atlasHeight, 0);
+	shelfX = 0;
+	shelfY = 0;
+	shelfHeight = 0;
+}
+
+GlyphCache::~GlyphCache() {
+
+}
+
+int GlyphCache::getSize() {
+	return size;
+}
+
+bool GlyphCache::isMonochrome() {
+	return monochrome;
+}
+
+const unsigned char *GlyphCache::getAtlasData() {
+	return &atlas[0];
+}
+
+int GlyphCache::getAtlasWidth() {
+	return atlasWidth;
+}
+
+int GlyphCache::getAtlasHeight() {
+	return atlasHeight;
+}
+
+const GlyphInfo *GlyphCache::getGlyph(unsigned int charCode) {
+	map<unsigned int, GlyphInfo>::iterator it = glyphs.find(charCode);
+	if(it != glyphs.end())
+		return &it->second;
+
+	// the face is shared by all caches of a font, so its size has to be set on every miss
+	FT_Set_Pixel_Sizes(face, 0, size);
+	
+	GlyphInfo info;
+	info.glyphIndex = FT_Get_Char_Index(face, (FT_ULong)charCode);
+	
+	FT_GlyphSlot slot = face->glyph;
+	if(FT_Load_Glyph(face, info.glyphIndex, NORMAL_FT_FLAGS) == 0) {
+		if(monochrome)
+			FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
+		else
+			FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT);
+		
+		info.advance = slot->advance.x >> 6;
+		info.bitmapLeft = slot->bitmap_left;
+		info.bitmapTop = slot->bitmap_top;
+		info.width = (int)slot->bitmap.width;
+		info.rows = (int)slot->bitmap.rows;
+		addToAtlas(&info, &slot->bitmap);
+	}
+	
+	return &(glyphs[charCode] = info);
+}
+
+int GlyphCache::getKerning(FT_UInt leftGlyph, FT_UInt rightGlyph) {
+	if(!hasKerning || !leftGlyph || !rightGlyph)
+		return 0;
+	
+	pair<FT_UInt, FT_UInt> key(leftGlyph, rightGlyph);
+	map<pair<FT_UInt, FT_UInt>, int>::iterator it = kerningPairs.find(key);
+	if(it != kerningPairs.end())
+		return it->second;
+	
+	FT_Set_Pixel_Sizes(face, 0, size);
+	FT_Vector delta;
+	delta.x = 0;
+	FT_Get_Kerning(face, leftGlyph, rightGlyph, FT_KERNING_DEFAULT, &delta);
+	int kerning = delta.x >> 6;
+	kerningPairs[key] = kerning;
+	return kerning;
+}
+
+void GlyphCache::layoutText(const String &text, TextLayout *layout) {
+	layout->glyphs.clear();
+	layout->width = 0;
+	layout->maxTop = 0;
+	
+	int penX = 0;
+	FT_UInt previous = 0;
+	
+	for(int i=0; i < text.contents.size(); i++) {
+		wchar_t charCode = text[i];
+		if(charCode == (wchar_t)'\t') {
+			const GlyphInfo *space = getGlyph(' ');
+			penX += space->advance * 4;
+			previous = space->glyphIndex;
+			continue;
+		}
+		
+		const GlyphInfo *glyph = getGlyph((unsigned int)charCode);
+		penX += getKerning(previous, glyph->glyphIndex);
+		
+		GlyphPlacement placement;
+		placement.penX = penX;
+		placement.glyph = glyph;
+		layout->glyphs.push_back(placement);
+		
+		if(glyph->bitmapTop > layout->maxTop)
+			layout->maxTop = glyph->bitmapTop;
+		
+		penX += glyph->advance;
+		previous = glyph->glyphIndex;
+	}
+	
+	layout->width = penX;
+}
+
+int GlyphCache::getTextWidth(const String &text) {
+	int penX = 0;
+	FT_UInt previous = 0;
+	
+	for(int i=0; i < text.contents.size(); i++) {
+		wchar_t charCode = text[i];
+		if(charCode == (wchar_t)'\t') {
+			const GlyphInfo *space = getGlyph(' ');
+			penX += space->advance * 4;
+			previous = space->glyphIndex;
+			continue;
+		}
+		const GlyphInfo *glyph = getGlyph((unsigned int)charCode);
+		penX += getKerning(previous, glyph->glyphIndex) + glyph->advance;
+		previous = glyph->glyphIndex;
+	}
+	return penX;
+}
+
+void GlyphCache::resizeAtlas(int newWidth, int newHeight) {
+	vector<unsigned char> newAtlas(newWidth * newHeight, 0);
+	for(int y=0; y < atlasHeight; y++) {
+		memcpy(&newAtlas[y * newWidth], &atlas[y * atlasWidth], atlasWidth);
+	}
+	atlas.swap(newAtlas);
+	atlasWidth = newWidth;
+	atlasHeight = newHeight;
+}
+
+void GlyphCache::addToAtlas(GlyphInfo *info, FT_Bitmap *bitmap) {
+	if(info->width == 0 || info->rows == 0)
+		return;
+	
+	// shelf packing with one pixel of padding between glyphs
+	int paddedWidth = info->width + 1;
+	int paddedRows = info->rows + 1;
+	
+	while(shelfX + paddedWidth > atlasWidth || shelfY + paddedRows > atlasHeight) {
+		if(paddedWidth <= atlasWidth && shelfX + paddedWidth > atlasWidth && shelfY + shelfHeight + paddedRows <= atlasHeight) {
+			// start a new shelf
+			shelfY += shelfHeight;
+			shelfX = 0;
+			shelfHeight = 0;
+		} else if(paddedWidth > atlasWidth || atlasWidth < atlasHeight) {
+			// grow the atlas by doubling its smaller side, keeping it roughly square
+			resizeAtlas(atlasWidth * 2, atlasHeight);
+		} else {
+			resizeAtlas(atlasWidth, atlasHeight * 2);
+		}
+	}
+	
+	info->atlasX = shelfX;
+	info->atlasY = shelfY;
+	shelfX += paddedWidth;
+	if(paddedRows > shelfHeight)
+		shelfHeight = paddedRows;
+	
+	unsigned char *src = bitmap->buffer;
+	for(int y=0; y < info->rows; y++) {
+		unsigned char *dst = &atlas[(info->atlasY + y) * atlasWidth + info->atlasX];
+		if(monochrome) {
+			for(int x=0; x < info->width; x++) {
+				dst[x] = (src[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+			}
+		} else {
+			memcpy(dst, src, info->width);
+		}
+		src += bitmap->pitch;
+	}
+}
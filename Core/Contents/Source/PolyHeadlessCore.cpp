@@ -0,0 +1,365 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyHeadlessCore.h"
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+using namespace Polycode;
+
+long getThreadID() {
+	return (long)pthread_self();
+}
+
+static bool isDirectory(const char *path) {
+	struct stat info;
+	if(stat(path, &info) != 0)
+		return false;
+	return S_ISDIR(info.st_mode);
+}
+
+static bool copyFile(const char *from, const char *to) {
+	FILE *inFile = fopen(from, "rb");
+	if(!inFile)
+		return false;
+	FILE *outFile = fopen(to, "wb");
+	if(!outFile) {
+		fclose(inFile);
+		return false;
+	}
+	
+	char buffer[8192];
+	size_t read;
+	while((read = fread(buffer, 1, sizeof(buffer), inFile)) > 0) {
+		fwrite(buffer, 1, read, outFile);
+	}
+	fclose(inFile);
+	fclose(outFile);
+	return true;
+}
+
+static bool copyItem(const string &from, const string &to) {
+	if(!isDirectory(from.c_str()))
+		return copyFile(from.c_str(), to.c_str());
+	
+	if(mkdir(to.c_str(), 0755) != 0 && errno != EEXIST)
+		return false;
+	
+	DIR *dir = opendir(from.c_str());
+	if(!dir)
+		return false;
+	
+	bool result = true;
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL) {
+		string name = entry->d_name;
+		if(name == "." || name == "..")
+			continue;
+		if(!copyItem(from + "/" + name, to + "/" + name))
+			result = false;
+	}
+	closedir(dir);
+	return result;
+}
+
+static bool removeItem(const string &path) {
+	if(isDirectory(path.c_str())) {
+		DIR *dir = opendir(path.c_str());
+		if(!dir)
+			return false;
+		struct dirent *entry;
+		while((entry = readdir(dir)) != NULL) {
+			string name = entry->d_name;
+			if(name == "." || name == "..")
+				continue;
+			removeItem(path + "/" + name);
+		}
+		closedir(dir);
+		return rmdir(path.c_str()) == 0;
+	}
+	return unlink(path.c_str()) == 0;
+}
+
+static void *HeadlessThreadFunc(void *data) {
+	Threaded *target = static_cast<Threaded*>(data);
+	target->runThread();
+	return NULL;
+}
+
+HeadlessCore::HeadlessCore(int xRes, int yRes, bool fullScreen, int aaLevel, int frameRate, int rendererType) : Core(xRes, yRes, fullScreen, aaLevel, frameRate > 0 ? frameRate : 1000) {
+	eventMutex = createMutex();
+	lastMouseX = 0;
+	lastMouseY = 0;
+	sleepBetweenFrames = (frameRate > 0);
+	clock_gettime(CLOCK_MONOTONIC, &initTime);
+	
+#ifdef POLYCODE_OSMESA
+	offscreenContext = NULL;
+	offscreenBuffer = NULL;
+#endif
+	
+	if(rendererType == RENDERER_OFFSCREEN && !createOffscreenContext()) {
+		Logger::log("Offscreen rendering is not available, using the null renderer.\n");
+		rendererType = RENDERER_NULL;
+	}
+	this->rendererType = rendererType;
+	
+#ifdef POLYCODE_OSMESA
+	if(rendererType == RENDERER_OFFSCREEN)
+		renderer = new OpenGLRenderer();
+	else
+		renderer = new NullRenderer();
+#else
+	renderer = new NullRenderer();
+#endif
+	
+	services->setRenderer(renderer);
+	setVideoMode(xRes, yRes, fullScreen, aaLevel);
+}
+
+HeadlessCore::~HeadlessCore() {
+	destroyOffscreenContext();
+	HeadlessMutex *mutex = (HeadlessMutex*)eventMutex;
+	pthread_mutex_destroy(&mutex->pMutex);
+	delete mutex;
+}
+
+bool HeadlessCore::createOffscreenContext() {
+#ifdef POLYCODE_OSMESA
+	offscreenContext = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, NULL);
+	if(!offscreenContext)
+		return false;
+	offscreenBuffer = (unsigned char*)malloc(xRes * yRes * 4);
+	if(!OSMesaMakeCurrent(offscreenContext, offscreenBuffer, GL_UNSIGNED_BYTE, xRes, yRes)) {
+		destroyOffscreenContext();
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void HeadlessCore::destroyOffscreenContext() {
+#ifdef POLYCODE_OSMESA
+	if(offscreenContext) {
+		OSMesaDestroyContext(offscreenContext);
+		offscreenContext = NULL;
+	}
+	free(offscreenBuffer);
+	offscreenBuffer = NULL;
+#endif
+}
+
+unsigned int HeadlessCore::getTicks() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((now.tv_sec - initTime.tv_sec) * 1000) + ((now.tv_nsec - initTime.tv_nsec) / 1000000);
+}
+
+bool HeadlessCore::Update() {
+	if(!running)
+		return false;
+	
+	lockMutex(CoreServices::getRenderMutex());
+	checkEvents();
+	renderer->BeginRender();
+	updateCore();
+	renderer->EndRender();
+	unlockMutex(CoreServices::getRenderMutex());
+	if(sleepBetweenFrames)
+		doSleep();
+	return running;
+}
+
+void HeadlessCore::setVideoMode(int xRes, int yRes, bool fullScreen, int aaLevel) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	this->fullScreen = fullScreen;
+	this->aaLevel = aaLevel;
+	
+#ifdef POLYCODE_OSMESA
+	if(offscreenContext) {
+		offscreenBuffer = (unsigned char*)realloc(offscreenBuffer, xRes * yRes * 4);
+		OSMesaMakeCurrent(offscreenContext, offscreenBuffer, GL_UNSIGNED_BYTE, xRes, yRes);
+	}
+#endif
+	
+	renderer->Resize(xRes, yRes);
+	dispatchEvent(new Event(), EVENT_CORE_RESIZE);
+}
+
+void HeadlessCore::resizeTo(int xRes, int yRes) {
+	setVideoMode(xRes, yRes, fullScreen, aaLevel);
+}
+
+vector<Polycode::Rectangle> HeadlessCore::getVideoModes() {
+	vector<Polycode::Rectangle> retVector;
+	return retVector;
+}
+
+void HeadlessCore::setCursor(int cursorType) {
+
+}
+
+void HeadlessCore::createThread(Threaded *target) {
+	pthread_t thread;
+	pthread_create(&thread, NULL, HeadlessThreadFunc, (void*)target);
+}
+
+void HeadlessCore::lockMutex(CoreMutex *mutex) {
+	HeadlessMutex *m = (HeadlessMutex*) mutex;
+	pthread_mutex_lock(&m->pMutex);
+}
+
+void HeadlessCore::unlockMutex(CoreMutex *mutex) {
+	HeadlessMutex *m = (HeadlessMutex*) mutex;
+	pthread_mutex_unlock(&m->pMutex);
+}
+
+CoreMutex *HeadlessCore::createMutex() {
+	HeadlessMutex *mutex = new HeadlessMutex();
+	pthread_mutex_init(&mutex->pMutex, NULL);
+	return mutex;
+}
+
+void HeadlessCore::copyStringToClipboard(String str) {
+	clipboardString = str;
+}
+
+String HeadlessCore::getClipboardString() {
+	return clipboardString;
+}
+
+void HeadlessCore::createFolder(String folderPath) {
+	string path = folderPath.c_str();
+	for(int i=1; i <= path.size(); i++) {
+		if(i == path.size() || path[i] == '/') {
+			mkdir(path.substr(0, i).c_str(), 0755);
+		}
+	}
+}
+
+void HeadlessCore::copyDiskItem(String itemPath, String destItemPath) {
+	if(!copyItem(itemPath.c_str(), destItemPath.c_str()))
+		Logger::log("Error copying %s to %s\n", itemPath.c_str(), destItemPath.c_str());
+}
+
+void HeadlessCore::moveDiskItem(String itemPath, String destItemPath) {
+	if(rename(itemPath.c_str(), destItemPath.c_str()) != 0)
+		Logger::log("Error moving %s to %s\n", itemPath.c_str(), destItemPath.c_str());
+}
+
+void HeadlessCore::removeDiskItem(String itemPath) {
+	if(!removeItem(itemPath.c_str()))
+		Logger::log("Error removing %s\n", itemPath.c_str());
+}
+
+String HeadlessCore::openFolderPicker() {
+	return "";
+}
+
+vector<string> HeadlessCore::openFilePicker(vector<CoreFileExtension> extensions, bool allowMultiple) {
+	vector<string> retVector;
+	return retVector;
+}
+
+void HeadlessCore::queueEvent(const HeadlessEvent &event) {
+	lockMutex(eventMutex);
+	headlessEvents.push_back(event);
+	unlockMutex(eventMutex);
+}
+
+void HeadlessCore::injectMouseMove(int x, int y) {
+	HeadlessEvent event;
+	event.eventGroup = HeadlessEvent::INPUT_EVENT;
+	event.eventCode = InputEvent::EVENT_MOUSEMOVE;
+	event.mouseX = x;
+	event.mouseY = y;
+	queueEvent(event);
+}
+
+void HeadlessCore::injectMouseButton(int mouseButton, bool down) {
+	HeadlessEvent event;
+	event.eventGroup = HeadlessEvent::INPUT_EVENT;
+	event.eventCode = down ? InputEvent::EVENT_MOUSEDOWN : InputEvent::EVENT_MOUSEUP;
+	event.mouseButton = mouseButton;
+	queueEvent(event);
+}
+
+void HeadlessCore::injectMouseWheel(bool up) {
+	HeadlessEvent event;
+	event.eventGroup = HeadlessEvent::INPUT_EVENT;
+	event.eventCode = up ? InputEvent::EVENT_MOUSEWHEEL_UP : InputEvent::EVENT_MOUSEWHEEL_DOWN;
+	queueEvent(event);
+}
+
+void HeadlessCore::injectKey(PolyKEY keyCode, wchar_t unicodeChar, bool down) {
+	HeadlessEvent event;
+	event.eventGroup = HeadlessEvent::INPUT_EVENT;
+	event.eventCode = down ? InputEvent::EVENT_KEYDOWN : InputEvent::EVENT_KEYUP;
+	event.keyCode = keyCode;
+	event.unicodeChar = unicodeChar;
+	queueEvent(event);
+}
+
+void HeadlessCore::checkEvents() {
+	lockMutex(eventMutex);
+	HeadlessEvent event;
+	for(int i=0; i < headlessEvents.size(); i++) {
+		event = headlessEvents[i];
+		switch(event.eventGroup) {
+			case HeadlessEvent::INPUT_EVENT:
+				switch(event.eventCode) {
+					case InputEvent::EVENT_MOUSEMOVE:
+						input->setDeltaPosition(lastMouseX - event.mouseX, lastMouseY - event.mouseY);
+						lastMouseX = event.mouseX;
+						lastMouseY = event.mouseY;
+						input->setMousePosition(event.mouseX, event.mouseY, getTicks());
+					break;
+					case InputEvent::EVENT_MOUSEDOWN:
+						input->setMouseButtonState(event.mouseButton, true, getTicks());
+					break;
+					case InputEvent::EVENT_MOUSEUP:
+						input->setMouseButtonState(event.mouseButton, false, getTicks());
+					break;
+					case InputEvent::EVENT_MOUSEWHEEL_UP:
+						input->mouseWheelUp(getTicks());
+					break;
+					case InputEvent::EVENT_MOUSEWHEEL_DOWN:
+						input->mouseWheelDown(getTicks());
+					break;
+					case InputEvent::EVENT_KEYDOWN:
+						input->setKeyState(event.keyCode, event.unicodeChar, true, getTicks());
+					break;
+					case InputEvent::EVENT_KEYUP:
+						input->setKeyState(event.keyCode, event.unicodeChar, false, getTicks());
+					break;
+				}
+			break;
+		}
+	}
+	headlessEvents.clear();
+	unlockMutex(eventMutex);
+}
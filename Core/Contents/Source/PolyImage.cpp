@@ -21,6 +21,7 @@
 */
 
 #include "PolyImage.h"
+#include <string.h>
 
 
 using namespace Polycode;
@@ -440,11 +441,20 @@ void Image::line(int x0, int y0, int x1, int y1, Color col) {
 }
 
 void Image::fill(Number r, Number g, Number b, Number a) {
-	Color *color = new Color(r,g,b,a);
-	unsigned int val = color->getUint();
-	unsigned int *imageData32 = (unsigned int*) imageData;
-	for(int i=0; i< width*height; i++) {
-		imageData32[i] = val;
+	Color color(r,g,b,a);
+	unsigned int val = color.getUint();
+	if(pixelSize == 4) {
+		unsigned int *imageData32 = (unsigned int*) imageData;
+		for(int i=0; i< width*height; i++) {
+			imageData32[i] = val;
+		}
+	} else {
+		unsigned char *pixels = (unsigned char*) imageData;
+		for(int i=0; i< width*height; i++) {
+			pixels[(i*pixelSize)] = val & 0xFF;
+			pixels[(i*pixelSize)+1] = (val >> 8) & 0xFF;
+			pixels[(i*pixelSize)+2] = (val >> 16) & 0xFF;
+		}
 	}
 }
 
@@ -461,8 +471,8 @@ bool Image::loadPNG(String fileName) {
 	char         sig[8];
 	int           bit_depth;
 	int           color_type;
-	unsigned long width;
-	unsigned long height;
+	png_uint_32 width;
+	png_uint_32 height;
 	unsigned int rowbytes;
 	image_data = NULL;
 	int i;
@@ -510,7 +520,7 @@ bool Image::loadPNG(String fileName) {
 	png_set_sig_bytes(png_ptr, 8);
 	png_read_info(png_ptr, info_ptr);
 #ifdef _WINDOWS
-		png_get_IHDR(png_ptr, info_ptr, (png_uint_32*)&width, (png_uint_32*)&height, &bit_depth, 
+		png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, 
 				 &color_type, NULL, NULL, NULL);
 #else
 	png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, 
@@ -571,4 +581,362 @@ bool Image::loadPNG(String fileName) {
 	
 	imageData = image_data;
 	return true;
-}
\ No newline at end of file
+}
+static Number srgbToLinear(Number value) {
+	if(value <= 0.04045)
+		return value / 12.92;
+	return pow((value + 0.055) / 1.055, 2.4);
+}
+
+static Number linearToSrgb(Number value) {
+	if(value <= 0.0031308)
+		return value * 12.92;
+	return (1.055 * pow(value, 1.0/2.4)) - 0.055;
+}
+
+static unsigned char floatToByte(float value) {
+	if(value <= 0.0f)
+		return 0;
+	if(value >= 1.0f)
+		return 255;
+	return (unsigned char)((value * 255.0f) + 0.5f);
+}
+
+// Computes the source pixels and weights contributing to each destination pixel when
+// shrinking an axis. Taps outside of the source are clamped to its edge.
+static void computeMipmapTaps(unsigned int sourceSize, unsigned int destSize, int filter, vector<unsigned int> &tapStart, vector<unsigned int> &tapIndices, vector<float> &tapWeights) {
+	float scale = ((float)sourceSize) / ((float)destSize);
+	float radius = (filter == Image::MIPMAP_FILTER_TENT) ? scale : scale * 0.5f;
+	
+	for(unsigned int d=0; d < destSize; d++) {
+		tapStart.push_back(tapIndices.size());
+		float center = (((float)d) + 0.5f) * scale;
+		int first = (int)floor(center - radius);
+		int last = (int)ceil(center + radius);
+		
+		float totalWeight = 0.0f;
+		unsigned int start = tapIndices.size();
+		for(int i=first; i < last; i++) {
+			float weight;
+			if(filter == Image::MIPMAP_FILTER_TENT) {
+				weight = 1.0f - (fabs((((float)i) + 0.5f) - center) / radius);
+			} else {
+				float left = (((float)i) > center - radius) ? ((float)i) : center - radius;
+				float right = (((float)i) + 1.0f < center + radius) ? ((float)i) + 1.0f : center + radius;
+				weight = right - left;
+			}
+			if(weight <= 0.0f)
+				continue;
+			
+			int index = i;
+			if(index < 0)
+				index = 0;
+			if(index >= (int)sourceSize)
+				index = sourceSize-1;
+			tapIndices.push_back(index);
+			tapWeights.push_back(weight);
+			totalWeight += weight;
+		}
+		
+		for(unsigned int t=start; t < tapWeights.size(); t++) {
+			tapWeights[t] /= totalWeight;
+		}
+	}
+	tapStart.push_back(tapIndices.size());
+}
+
+Image *Image::createMipmap(int filter, bool gammaCorrect) {
+	unsigned int newWidth = (width > 1) ? width / 2 : 1;
+	unsigned int newHeight = (height > 1) ? height / 2 : 1;
+	
+	// filter premultiplied and straight color side by side, the straight color is
+	// only used where the filtered alpha ends up zero
+	const unsigned int channels = 7;
+	
+	float toLinear[256];
+	for(int i=0; i < 256; i++) {
+		Number value = ((Number)i) / 255.0;
+		toLinear[i] = gammaCorrect ? srgbToLinear(value) : value;
+	}
+	
+	unsigned char *pixels = (unsigned char*)imageData;
+	vector<float> source(width * height * channels);
+	for(unsigned int i=0; i < width * height; i++) {
+		unsigned char *pixel = pixels + (i * pixelSize);
+		float *value = &source[i * channels];
+		float alpha = (pixelSize == 4) ? ((float)pixel[3]) / 255.0f : 1.0f;
+		for(int c=0; c < 3; c++) {
+			value[c] = toLinear[pixel[c]] * alpha;
+			value[4+c] = toLinear[pixel[c]];
+		}
+		value[3] = alpha;
+	}
+	
+	vector<unsigned int> tapStart, tapIndices;
+	vector<float> tapWeights;
+	
+	computeMipmapTaps(width, newWidth, filter, tapStart, tapIndices, tapWeights);
+	vector<float> horizontal(newWidth * height * channels, 0.0f);
+	for(unsigned int y=0; y < height; y++) {
+		for(unsigned int x=0; x < newWidth; x++) {
+			float *dest = &horizontal[((y * newWidth) + x) * channels];
+			for(unsigned int t=tapStart[x]; t < tapStart[x+1]; t++) {
+				float *value = &source[((y * width) + tapIndices[t]) * channels];
+				for(unsigned int c=0; c < channels; c++) {
+					dest[c] += value[c] * tapWeights[t];
+				}
+			}
+		}
+	}
+	
+	tapStart.clear();
+	tapIndices.clear();
+	tapWeights.clear();
+	computeMipmapTaps(height, newHeight, filter, tapStart, tapIndices, tapWeights);
+	
+	Image *mipmap = new Image(newWidth, newHeight, imageType);
+	unsigned char *mipmapPixels = (unsigned char*)mipmap->getPixels();
+	float value[channels];
+	for(unsigned int y=0; y < newHeight; y++) {
+		for(unsigned int x=0; x < newWidth; x++) {
+			for(unsigned int c=0; c < channels; c++) {
+				value[c] = 0.0f;
+			}
+			for(unsigned int t=tapStart[y]; t < tapStart[y+1]; t++) {
+				float *row = &horizontal[((tapIndices[t] * newWidth) + x) * channels];
+				for(unsigned int c=0; c < channels; c++) {
+					value[c] += row[c] * tapWeights[t];
+				}
+			}
+			
+			unsigned char *pixel = mipmapPixels + (((y * newWidth) + x) * pixelSize);
+			float alpha = value[3];
+			for(int c=0; c < 3; c++) {
+				float color = (alpha > 1.0f/512.0f) ? value[c] / alpha : value[4+c];
+				if(color > 1.0f)
+					color = 1.0f;
+				pixel[c] = floatToByte(gammaCorrect ? linearToSrgb(color) : color);
+			}
+			if(pixelSize == 4)
+				pixel[3] = floatToByte(alpha);
+		}
+	}
+	
+	return mipmap;
+}
+
+vector<Image*> Image::createMipmapChain(int filter, bool gammaCorrect) {
+	vector<Image*> levels;
+	Image *level = this;
+	while(level->getWidth() > 1 || level->getHeight() > 1) {
+		level = level->createMipmap(filter, gammaCorrect);
+		levels.push_back(level);
+	}
+	return levels;
+}
+
+unsigned int Image::getCompressedDataSize(unsigned int width, unsigned int height, int format) {
+	unsigned int blocksX = (width > 0) ? (width + 3) / 4 : 1;
+	unsigned int blocksY = (height > 0) ? (height + 3) / 4 : 1;
+	unsigned int blockSize = (format == COMPRESSION_BC1) ? 8 : 16;
+	return blocksX * blocksY * blockSize;
+}
+
+void Image::getBlock(unsigned int blockX, unsigned int blockY, unsigned char *block) {
+	unsigned char *pixels = (unsigned char*)imageData;
+	for(unsigned int y=0; y < 4; y++) {
+		unsigned int py = (blockY * 4) + y;
+		if(py >= height)
+			py = height-1;
+		for(unsigned int x=0; x < 4; x++) {
+			unsigned int px = (blockX * 4) + x;
+			if(px >= width)
+				px = width-1;
+			unsigned char *pixel = pixels + (((py * width) + px) * pixelSize);
+			unsigned char *dest = block + (((y * 4) + x) * 4);
+			dest[0] = pixel[0];
+			dest[1] = pixel[1];
+			dest[2] = pixel[2];
+			dest[3] = (pixelSize == 4) ? pixel[3] : 255;
+		}
+	}
+}
+
+static unsigned short packColor565(const int *color) {
+	return (unsigned short)(((((color[0] * 31) + 127) / 255) << 11) | ((((color[1] * 63) + 127) / 255) << 5) | (((color[2] * 31) + 127) / 255));
+}
+
+static void unpackColor565(unsigned short packed, int *color) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+void Image::encodeColorBlock(const unsigned char *block, bool allowTransparency, unsigned char *dest) {
+	int minColor[3] = {255, 255, 255};
+	int maxColor[3] = {0, 0, 0};
+	bool transparent[16];
+	bool hasTransparency = false;
+	bool hasOpaque = false;
+	
+	for(int i=0; i < 16; i++) {
+		const unsigned char *pixel = block + (i * 4);
+		transparent[i] = (allowTransparency && pixel[3] < 128);
+		if(transparent[i]) {
+			hasTransparency = true;
+			continue;
+		}
+		hasOpaque = true;
+		for(int c=0; c < 3; c++) {
+			if(pixel[c] < minColor[c])
+				minColor[c] = pixel[c];
+			if(pixel[c] > maxColor[c])
+				maxColor[c] = pixel[c];
+		}
+	}
+	
+	if(!hasOpaque) {
+		// three color mode with every pixel using the transparent index
+		memset(dest, 0, 4);
+		memset(dest+4, 0xFF, 4);
+		return;
+	}
+	
+	// insetting the bounding box moves the endpoints closer to where most colors are
+	for(int c=0; c < 3; c++) {
+		int inset = (maxColor[c] - minColor[c]) >> 4;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+	
+	unsigned short color0 = packColor565(maxColor);
+	unsigned short color1 = packColor565(minColor);
+	
+	// color0 > color1 selects the four color mode, otherwise index 3 is transparent
+	if((hasTransparency && color0 > color1) || (!hasTransparency && color0 < color1)) {
+		unsigned short swapColor = color0;
+		color0 = color1;
+		color1 = swapColor;
+	}
+	bool fourColors = (color0 > color1);
+	
+	int palette[4][3];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for(int c=0; c < 3; c++) {
+		if(fourColors) {
+			palette[2][c] = ((2 * palette[0][c]) + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + (2 * palette[1][c])) / 3;
+		} else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	int numColors = fourColors ? 4 : 3;
+	
+	unsigned int indices = 0;
+	for(int i=0; i < 16; i++) {
+		unsigned int index = 3;
+		if(!transparent[i]) {
+			const unsigned char *pixel = block + (i * 4);
+			int bestDistance = 0x7FFFFFFF;
+			for(int p=0; p < numColors; p++) {
+				int dr = pixel[0] - palette[p][0];
+				int dg = pixel[1] - palette[p][1];
+				int db = pixel[2] - palette[p][2];
+				int distance = (dr * dr) + (dg * dg) + (db * db);
+				if(distance < bestDistance) {
+					bestDistance = distance;
+					index = p;
+				}
+			}
+		}
+		indices |= index << (i * 2);
+	}
+	
+	dest[0] = color0 & 0xFF;
+	dest[1] = color0 >> 8;
+	dest[2] = color1 & 0xFF;
+	dest[3] = color1 >> 8;
+	dest[4] = indices & 0xFF;
+	dest[5] = (indices >> 8) & 0xFF;
+	dest[6] = (indices >> 16) & 0xFF;
+	dest[7] = (indices >> 24) & 0xFF;
+}
+
+void Image::encodeAlphaBlock(const unsigned char *block, unsigned char *dest) {
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for(int i=0; i < 16; i++) {
+		int alpha = block[(i * 4) + 3];
+		if(alpha < minAlpha)
+			minAlpha = alpha;
+		if(alpha > maxAlpha)
+			maxAlpha = alpha;
+	}
+	
+	// alpha0 > alpha1 selects eight interpolated values, equal endpoints only use index 0
+	int palette[8];
+	palette[0] = maxAlpha;
+	palette[1] = minAlpha;
+	for(int i=2; i < 8; i++) {
+		palette[i] = (((8 - i) * maxAlpha) + ((i - 1) * minAlpha)) / 7;
+	}
+	
+	dest[0] = maxAlpha;
+	dest[1] = minAlpha;
+	
+	// 3 bit indices, packed as two groups of eight pixels in three bytes each
+	for(int group=0; group < 2; group++) {
+		unsigned int indices = 0;
+		for(int i=0; i < 8; i++) {
+			int alpha = block[(((group * 8) + i) * 4) + 3];
+			unsigned int index = 0;
+			if(maxAlpha > minAlpha) {
+				int bestDistance = 256;
+				for(int p=0; p < 8; p++) {
+					int distance = abs(alpha - palette[p]);
+					if(distance < bestDistance) {
+						bestDistance = distance;
+						index = p;
+					}
+				}
+			}
+			indices |= index << (i * 3);
+		}
+		dest[2 + (group * 3)] = indices & 0xFF;
+		dest[3 + (group * 3)] = (indices >> 8) & 0xFF;
+		dest[4 + (group * 3)] = (indices >> 16) & 0xFF;
+	}
+}
+
+char *Image::createCompressedData(int format, unsigned int *dataSize) {
+	if(format != COMPRESSION_BC1 && format != COMPRESSION_BC3) {
+		Logger::log("Unsupported image compression format %d\n", format);
+		return NULL;
+	}
+	
+	unsigned int blocksX = (width + 3) / 4;
+	unsigned int blocksY = (height + 3) / 4;
+	unsigned int blockSize = (format == COMPRESSION_BC1) ? 8 : 16;
+	*dataSize = getCompressedDataSize(width, height, format);
+	unsigned char *data = (unsigned char*)malloc(*dataSize);
+	
+	unsigned char block[64];
+	for(unsigned int by=0; by < blocksY; by++) {
+		for(unsigned int bx=0; bx < blocksX; bx++) {
+			getBlock(bx, by, block);
+			unsigned char *dest = data + (((by * blocksX) + bx) * blockSize);
+			if(format == COMPRESSION_BC3) {
+				encodeAlphaBlock(block, dest);
+				encodeColorBlock(block, false, dest+8);
+			} else {
+				encodeColorBlock(block, (pixelSize == 4), dest);
+			}
+		}
+	}
+	return (char*)data;
+}
@@ -0,0 +1,391 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyJobSystem.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyThreaded.h"
+
+#ifdef _WINDOWS
+#include <windows.h>
+#define POLYCODE_THREAD_LOCAL __declspec(thread)
+#else
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#define POLYCODE_THREAD_LOCAL __thread
+#endif
+
+using namespace Polycode;
+
+// queue of the calling thread, only valid if currentJobSystem is the system
+// asking. Threads that are not workers use queue 0.
+static POLYCODE_THREAD_LOCAL JobSystem *currentJobSystem = NULL;
+static POLYCODE_THREAD_LOCAL int currentQueueIndex = 0;
+
+namespace Polycode {
+
+	// Counting semaphore that idle workers sleep on. The count is capped at
+	// the number of workers, so a burst of submissions wakes every worker
+	// at most once instead of piling up wakeups.
+	class JobWakeup {
+		public:
+			JobWakeup(int maxCount) {
+				this->maxCount = maxCount;
+#ifdef _WINDOWS
+				semaphore = CreateSemaphore(NULL, 0, maxCount > 0 ? maxCount : 1, NULL);
+#else
+				count = 0;
+				pthread_mutex_init(&mutex, NULL);
+				pthread_cond_init(&condition, NULL);
+#endif
+			}
+			
+			~JobWakeup() {
+#ifdef _WINDOWS
+				CloseHandle(semaphore);
+#else
+				pthread_cond_destroy(&condition);
+				pthread_mutex_destroy(&mutex);
+#endif
+			}
+			
+			void wait() {
+#ifdef _WINDOWS
+				WaitForSingleObject(semaphore, INFINITE);
+#else
+				pthread_mutex_lock(&mutex);
+				while(count == 0) {
+					pthread_cond_wait(&condition, &mutex);
+				}
+				count--;
+				pthread_mutex_unlock(&mutex);
+#endif
+			}
+			
+			void post(int amount) {
+#ifdef _WINDOWS
+				// fails without releasing anything once the maximum is reached
+				for(int i=0; i < amount; i++) {
+					if(!ReleaseSemaphore(semaphore, 1, NULL))
+						break;
+				}
+#else
+				pthread_mutex_lock(&mutex);
+				count += amount;
+				if(count > maxCount)
+					count = maxCount;
+				pthread_cond_broadcast(&condition);
+				pthread_mutex_unlock(&mutex);
+#endif
+			}
+			
+		protected:
+			int maxCount;
+#ifdef _WINDOWS
+			HANDLE semaphore;
+#else
+			int count;
+			pthread_mutex_t mutex;
+			pthread_cond_t condition;
+#endif
+	};
+
+	class JobWorker : public Threaded {
+		public:
+			JobWorker(JobSystem *jobSystem, int queueIndex) : Threaded() {
+				this->jobSystem = jobSystem;
+				this->queueIndex = queueIndex;
+				idleCount = 0;
+			}
+			
+			void runThread() {
+				jobSystem->initWorkerThread(queueIndex);
+				while(threadRunning) {
+					updateThread();
+				}
+				jobSystem->finishWorkerThread();
+			}
+			
+			void updateThread() {
+				if(jobSystem->runPendingJob()) {
+					idleCount = 0;
+					return;
+				}
+				
+				// spin for a while before sleeping, since jobs tend to come in
+				// bursts once per frame
+				idleCount++;
+				if(idleCount < 2000) {
+					JobSystem::yieldThread();
+				} else {
+					jobSystem->waitForJob(this);
+					idleCount = 0;
+				}
+			}
+			
+		protected:
+			JobSystem *jobSystem;
+			int queueIndex;
+			int idleCount;
+	};
+}
+
+JobCounter::JobCounter() {
+	count = 0;
+}
+
+bool JobCounter::isDone() {
+	return JobSystem::atomicAdd(&count, 0) == 0;
+}
+
+Job::Job() {
+	function = NULL;
+	data = NULL;
+	counter = NULL;
+	pendingDependencies = 1;
+}
+
+Job::Job(JobFunction function, void *data) {
+	this->function = function;
+	this->data = data;
+	counter = NULL;
+	pendingDependencies = 1;
+}
+
+void Job::reset() {
+	dependents.clear();
+	counter = NULL;
+	pendingDependencies = 1;
+}
+
+JobSystem::JobSystem(Core *core, int numWorkers) {
+	this->core = core;
+	services = CoreServices::getInstance();
+	
+	if(numWorkers < 0)
+		numWorkers = getNumHardwareThreads() - 1;
+	if(numWorkers < 0)
+		numWorkers = 0;
+	
+	queues.resize(numWorkers + 1);
+	for(int i=0; i < queues.size(); i++) {
+		queueMutexes.push_back(core->createMutex());
+	}
+	numQueuedJobs = 0;
+	
+	wakeup = new JobWakeup(numWorkers);
+	numSleepingWorkers = 0;
+	
+	workerMutex = core->createMutex();
+	numStartedWorkers = 0;
+	numStoppedWorkers = 0;
+	
+	for(int i=0; i < numWorkers; i++) {
+		JobWorker *worker = new JobWorker(this, i+1);
+		workers.push_back(worker);
+		core->createThread(worker);
+	}
+	
+	// the workers register with CoreServices on startup, which must not
+	// happen while this thread is using it
+	while(atomicAdd(&numStartedWorkers, 0) < numWorkers) {
+		yieldThread();
+	}
+	
+	Logger::log("Started job system with %d worker threads\n", numWorkers);
+}
+
+JobSystem::~JobSystem() {
+	for(int i=0; i < workers.size(); i++) {
+		workers[i]->killThread();
+	}
+	wakeup->post(workers.size());
+	while(atomicAdd(&numStoppedWorkers, 0) < (int)workers.size()) {
+		yieldThread();
+	}
+	for(int i=0; i < workers.size(); i++) {
+		delete workers[i];
+	}
+	delete wakeup;
+}
+
+void JobSystem::initWorkerThread(int queueIndex) {
+	currentJobSystem = this;
+	currentQueueIndex = queueIndex;
+	
+	core->lockMutex(workerMutex);
+	CoreServices::setThreadInstance(services);
+	core->unlockMutex(workerMutex);
+	
+	atomicAdd(&numStartedWorkers, 1);
+}
+
+void JobSystem::finishWorkerThread() {
+	currentJobSystem = NULL;
+	atomicAdd(&numStoppedWorkers, 1);
+}
+
+void JobSystem::waitForJob(JobWorker *worker) {
+	// announce the sleep before checking the queues. pushJob() counts the
+	// job before checking for sleepers, and both are full barriers, so
+	// either this sees the job or pushJob() sees the sleeper and posts.
+	atomicAdd(&numSleepingWorkers, 1);
+	if(atomicAdd(&numQueuedJobs, 0) == 0 && worker->threadRunning)
+		wakeup->wait();
+	atomicAdd(&numSleepingWorkers, -1);
+}
+
+int JobSystem::getNumThreads() const {
+	return queues.size();
+}
+
+int JobSystem::getQueueIndex() const {
+	if(currentJobSystem == this)
+		return currentQueueIndex;
+	return 0;
+}
+
+void JobSystem::addDependency(Job *job, Job *dependency) {
+	dependency->dependents.push_back(job);
+	job->pendingDependencies++;
+}
+
+void JobSystem::submit(Job *job, JobCounter *counter) {
+	job->counter = counter;
+	if(counter)
+		atomicAdd(&counter->count, 1);
+	
+	// drop the submission reference, the last dependency to finish queues
+	// the job if it is not ready yet
+	if(atomicAdd(&job->pendingDependencies, -1) == 0)
+		pushJob(job);
+}
+
+void JobSystem::wait(JobCounter *counter) {
+	while(!counter->isDone()) {
+		if(!runPendingJob())
+			yieldThread();
+	}
+}
+
+bool JobSystem::runPendingJob() {
+	Job *job = popJob();
+	if(!job)
+		return false;
+	runJob(job);
+	return true;
+}
+
+void JobSystem::pushJob(Job *job) {
+	int queueIndex = getQueueIndex();
+	core->lockMutex(queueMutexes[queueIndex]);
+	queues[queueIndex].push_back(job);
+	core->unlockMutex(queueMutexes[queueIndex]);
+	atomicAdd(&numQueuedJobs, 1);
+	if(atomicAdd(&numSleepingWorkers, 0) > 0)
+		wakeup->post(1);
+}
+
+Job *JobSystem::popJob() {
+	if(numQueuedJobs <= 0)
+		return NULL;
+	
+	Job *job = NULL;
+	int queueIndex = getQueueIndex();
+	
+	// newest job of our own queue first, it is the most likely to be in cache
+	core->lockMutex(queueMutexes[queueIndex]);
+	if(queues[queueIndex].size() > 0) {
+		job = queues[queueIndex].back();
+		queues[queueIndex].pop_back();
+	}
+	core->unlockMutex(queueMutexes[queueIndex]);
+	
+	// otherwise steal the oldest job of another queue, which usually is the
+	// largest piece of work left there
+	for(int i=1; !job && i < queues.size(); i++) {
+		int victim = (queueIndex + i) % queues.size();
+		core->lockMutex(queueMutexes[victim]);
+		if(queues[victim].size() > 0) {
+			job = queues[victim].front();
+			queues[victim].pop_front();
+		}
+		core->unlockMutex(queueMutexes[victim]);
+	}
+	
+	if(job)
+		atomicAdd(&numQueuedJobs, -1);
+	return job;
+}
+
+void JobSystem::runJob(Job *job) {
+	job->function(job->data);
+	
+	for(int i=0; i < job->dependents.size(); i++) {
+		Job *dependent = job->dependents[i];
+		if(atomicAdd(&dependent->pendingDependencies, -1) == 0)
+			pushJob(dependent);
+	}
+	
+	// the job may be deleted by a waiting thread as soon as the counter is
+	// decremented, so this has to come last
+	if(job->counter)
+		atomicAdd(&job->counter->count, -1);
+}
+
+int JobSystem::getNumHardwareThreads() {
+#ifdef _WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if(count < 1)
+		return 1;
+	return count;
+#endif
+}
+
+int JobSystem::atomicAdd(volatile int *value, int amount) {
+#ifdef _WINDOWS
+	return InterlockedExchangeAdd((volatile LONG*)value, amount) + amount;
+#else
+	return __sync_add_and_fetch(value, amount);
+#endif
+}
+
+int JobSystem::atomicCompareAndSwap(volatile int *value, int expected, int newValue) {
+#ifdef _WINDOWS
+	return InterlockedCompareExchange((volatile LONG*)value, newValue, expected);
+#else
+	return __sync_val_compare_and_swap(value, expected, newValue);
+#endif
+}
+
+void JobSystem::yieldThread() {
+#ifdef _WINDOWS
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
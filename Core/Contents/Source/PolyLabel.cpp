@@ -24,8 +24,6 @@
 
 using namespace Polycode;
 
-#define NORMAL_FT_FLAGS FT_LOAD_TARGET_LIGHT
-
 
 Label::Label(Font *font, String text, int size, int antiAliasMode) {
 		setPixelType(Image::IMAGE_RGBA);
@@ -43,77 +41,19 @@ Label::~Label() {
 }
 
 int Label::getTextWidth(Font *font, String text, int size) {
-	FT_Vector delta;
-	FT_UInt previous = 0;
-	FT_UInt glyph_index;
-	FT_GlyphSlot slot = font->getFace()->glyph;
-	FT_Set_Pixel_Sizes(font->getFace(), 0,  size);
-	int width = 0;
-	
-	String actualString = text; //StringUtil::replace(text, "\t", TAB_REPLACE);
-	
-	for(int i=0; i< actualString.length();i++)
-	{
-		if(actualString[i] == '\t') {
-			glyph_index = FT_Get_Char_Index( font->getFace(), ' ');			
-			FT_Load_Glyph( font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-			for(int k=0 ; k < 4; k++) {
-					FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);		
-					width += slot->advance.x >> 6;				
-			}
-			
-		} else {
-			glyph_index = FT_Get_Char_Index( font->getFace(), actualString[i] );
-			if(previous && glyph_index) {
-				FT_Get_Kerning(font->getFace(), previous, glyph_index, FT_KERNING_DEFAULT, &delta);
-				width += delta.x >> 6;
-			}
-			FT_Load_Glyph( font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-		
-			switch(antiAliasMode) {
-				case ANTIALIAS_FULL:
-					FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT );			
-					break;
-				case ANTIALIAS_NONE:
-					FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
-					break;
-			}
-		width += slot->advance.x >> 6;
-		}
-	}
-
+	GlyphCache *cache = font->getGlyphCache(size, antiAliasMode == ANTIALIAS_NONE);
 	// +5 pixels safety zone :)
-	return width+5;
+	return cache->getTextWidth(text)+5;
 }
 
 int Label::getTextHeight(Font *font, String text, int size) {
-	
-	String actualString = text; //StringUtil::replace(text, "\t", TAB_REPLACE);
-	
+	GlyphCache *cache = font->getGlyphCache(size, antiAliasMode == ANTIALIAS_NONE);
 	int height = 0;
-	
-	FT_UInt glyph_index;
-	FT_GlyphSlot slot = font->getFace()->glyph;
-	FT_Set_Pixel_Sizes(font->getFace(), 0,  size);
-	
-	for(int i=0; i< actualString.length();i++)
-	{
-		glyph_index = FT_Get_Char_Index( font->getFace(), actualString[i] );
-		FT_Load_Glyph(font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-		switch(antiAliasMode) {
-			case ANTIALIAS_FULL:
-				FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT );			
-			break;
-			case ANTIALIAS_NONE:
-				FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
-			break;
-		}
-
-		
-		if(slot->bitmap_top > height)
-			height = slot->bitmap_top;
+	for(int i=0; i< text.length();i++) {
+		const GlyphInfo *glyph = cache->getGlyph((unsigned int)text[i]);
+		if(glyph->bitmapTop > height)
+			height = glyph->bitmapTop;
 	}
-		
 	return height;
 }
 
@@ -134,8 +74,6 @@ String Label::getText() {
 }
 
 void Label::setText(String text) {
-//	Logger::logw((char*)text.c_str());
-	
 	this->text = text;
 	
 	if(!font)
@@ -144,97 +82,51 @@ void Label::setText(String text) {
 	if(!font->isValid())
 		return;
 	
-	String actualString = text; //StringUtil::replace(text, "\t", TAB_REPLACE);
+	GlyphCache *cache = font->getGlyphCache(size, antiAliasMode == ANTIALIAS_NONE);
+	
+	TextLayout layout;
+	cache->layoutText(text, &layout);
 	
-	int textWidth = getTextWidth(font, actualString, size);
-	int textHeight = size+getTextHeight(font, actualString, size);
-	currentTextHeight = 0;
+	// +5 pixels safety zone :)
+	int textWidth = layout.width+5;
+	int textHeight = size+layout.maxTop;
 	
 	createEmpty(textWidth,textHeight);
 	
-	int penX = 0;
-	int xoff = 0;
-//	int x,y;
-	FT_Vector delta;
-	FT_UInt previous = 0;
-	FT_UInt glyph_index;
-	FT_GlyphSlot slot = font->getFace()->glyph;
-	FT_Set_Pixel_Sizes(font->getFace(), 0,  size);
-
-	// copy the freetype data into the texture
-	for(int i=0; i< actualString.length();i++)
-	{
-		if(actualString[i] == (wchar_t)'\t') {
-			glyph_index = FT_Get_Char_Index( font->getFace(), ' ');			
-			FT_Load_Glyph( font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-			for(int k=0 ; k < 4; k++) {
-				FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);		
-				penX += slot->advance.x >> 6;
-				currentTextWidth = penX;
-				previous = glyph_index;				
-			}
-			
-		} else {	
-		glyph_index = FT_Get_Char_Index( font->getFace(), (FT_ULong)actualString[i]);
-		if(previous && glyph_index) {
-			FT_Get_Kerning(font->getFace(), previous, glyph_index, FT_KERNING_DEFAULT, &delta);
-			penX += delta.x >> 6;
-		}
-		FT_Load_Glyph(font->getFace(), glyph_index, NORMAL_FT_FLAGS);
-		switch(antiAliasMode) {
-			case ANTIALIAS_FULL:
-				FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT );			
-			break;
-			case ANTIALIAS_NONE:
-				FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
-			break;
-		}
-
-		int lineoffset = ((size-slot->bitmap_top) * (textWidth*4));
-		xoff = ((penX + slot->bitmap_left)*4);
+	const unsigned char *atlas = cache->getAtlasData();
+	int atlasWidth = cache->getAtlasWidth();
+	
+	// copy the cached glyph coverage into the image
+	for(int i=0; i < layout.glyphs.size(); i++) {
+		const GlyphInfo *glyph = layout.glyphs[i].glyph;
+		int dstX = layout.glyphs[i].penX + glyph->bitmapLeft;
+		int dstY = size - glyph->bitmapTop;
 		
-		switch(antiAliasMode) {
-			case ANTIALIAS_FULL:
-				for(int j = 0; j < ((slot->bitmap.width * slot->bitmap.rows)); j++) {
-					if(!(j%slot->bitmap.width) && j !=0)
-						lineoffset += (textWidth*4)-(slot->bitmap.width * 4);
-
-						imageData[xoff+lineoffset] = 255;
-						imageData[xoff+lineoffset+1] =  255;
-						imageData[xoff+lineoffset+2] =  255;
-						
-						if(imageData[xoff+lineoffset+3] == 0)
-							imageData[xoff+lineoffset+3] =  slot->bitmap.buffer[j];
-						xoff += 4;
-				}
-			break;
-			case ANTIALIAS_NONE:
-				unsigned char *src =  slot->bitmap.buffer;
-				for(int j=0; j <slot->bitmap.rows;j++) {
-					unsigned char b;
-					unsigned char *bptr =  src;
-					for(int k=0; k < slot->bitmap.width ; k++){					
-						if (k%8==0){ b = (*bptr++);}
-						imageData[xoff+lineoffset] = 255;
-						imageData[xoff+lineoffset+1] =  255;
-						imageData[xoff+lineoffset+2] =  255;
-						imageData[xoff+lineoffset+3] =  b&0x80 ? 255 : 0;
-						xoff += 4;
-						b <<= 1;
-					}
-					lineoffset += (textWidth*4)-(slot->bitmap.width * 4);
-					src += slot->bitmap.pitch;
+		for(int y=0; y < glyph->rows; y++) {
+			if(dstY + y < 0 || dstY + y >= textHeight)
+				continue;
+			const unsigned char *src = atlas + ((glyph->atlasY + y) * atlasWidth) + glyph->atlasX;
+			char *dst = imageData + (((dstY + y) * textWidth) * 4);
+			for(int x=0; x < glyph->width; x++) {
+				if(dstX + x < 0 || dstX + x >= textWidth)
+					continue;
+				char *pixel = dst + ((dstX + x) * 4);
+				pixel[0] = (char)255;
+				pixel[1] = (char)255;
+				pixel[2] = (char)255;
+				switch(antiAliasMode) {
+					case ANTIALIAS_FULL:
+						if(pixel[3] == 0)
+							pixel[3] = (char)src[x];
+					break;
+					case ANTIALIAS_NONE:
+						pixel[3] = (char)src[x];
+					break;
 				}
-			break;
-		}
-		
-		if(slot->bitmap_top > currentTextHeight)
-			currentTextHeight = slot->bitmap_top;
-		
-		penX += slot->advance.x >> 6;
-		currentTextWidth = penX;
-		previous = glyph_index;
+			}
 		}
 	}
-
-}
\ No newline at end of file
+	
+	currentTextWidth = layout.width;
+	currentTextHeight = layout.maxTop;
+}
@@ -21,11 +21,15 @@
 */
 
 #include "PolyMaterialManager.h"
+#include "PolyTextureAtlas.h"
 
 using namespace Polycode;
 
 MaterialManager::MaterialManager() {
-	
+	generateMipmaps = false;
+	mipmapFilter = Image::MIPMAP_FILTER_BOX;
+	gammaCorrectMipmaps = true;
+	textureCompression = Image::COMPRESSION_NONE;
 }
 
 MaterialManager::~MaterialManager() {
@@ -63,6 +67,19 @@ void MaterialManager::deleteTexture(Texture *texture) {
 	}
 }
 
+void MaterialManager::addTextureAtlas(TextureAtlas *atlas) {
+	atlases.push_back(atlas);
+}
+
+void MaterialManager::removeTextureAtlas(TextureAtlas *atlas) {
+	for(int i=0;i < atlases.size(); i++) {
+		if(atlases[i] == atlas) {
+			atlases.erase(atlases.begin()+i);
+			return;
+		}
+	}
+}
+
 void MaterialManager::reloadPrograms() {
 	for(int m=0; m < shaderModules.size(); m++) {
 		PolycodeShaderModule *shaderModule = shaderModules[m];
@@ -81,9 +98,16 @@ Texture *MaterialManager::createTextureFromFile(String fileName, bool clamp) {
 		return newTexture;
 	}
 	
+	for(int i=0; i < atlases.size(); i++) {
+		newTexture = atlases[i]->getRegion(fileName);
+		if(newTexture)
+			return newTexture;
+	}
+	
 	Image *image = new Image(fileName);
 	if(image->isLoaded()) {
 		newTexture = createTexture(image->getWidth(), image->getHeight(), image->getPixels(), clamp);
+		createTextureLevels(newTexture, image);
 	} else {
 		Logger::log("Error loading image, using default texture.\n");
 		delete image;		
@@ -122,9 +146,44 @@ Texture *MaterialManager::createTexture(int width, int height, char *imageData,
 Texture *MaterialManager::createTextureFromImage(Image *image, bool clamp) {
 	Texture *newTexture;
 	newTexture = createTexture(image->getWidth(), image->getHeight(), image->getPixels(),clamp, image->getType());
+	createTextureLevels(newTexture, image);
 	return newTexture; 
 }
 
+void MaterialManager::createTextureLevels(Texture *texture, Image *image) {
+	if(!generateMipmaps && textureCompression == Image::COMPRESSION_NONE)
+		return;
+	
+	vector<Image*> mipmaps;
+	if(generateMipmaps)
+		mipmaps = image->createMipmapChain(mipmapFilter, gammaCorrectMipmaps);
+	
+	if(textureCompression == Image::COMPRESSION_NONE) {
+		texture->setMipmapLevels(mipmaps);
+	} else {
+		vector<char*> levels;
+		vector<unsigned int> levelSizes;
+		unsigned int dataSize;
+		char *data = image->createCompressedData(textureCompression, &dataSize);
+		if(data) {
+			levels.push_back(data);
+			levelSizes.push_back(dataSize);
+			for(int i=0; i < mipmaps.size(); i++) {
+				levels.push_back(mipmaps[i]->createCompressedData(textureCompression, &dataSize));
+				levelSizes.push_back(dataSize);
+			}
+			texture->setCompressedData(textureCompression, levels, levelSizes);
+		}
+		for(int i=0; i < levels.size(); i++) {
+			free(levels[i]);
+		}
+	}
+	
+	for(int i=0; i < mipmaps.size(); i++) {
+		delete mipmaps[i];
+	}
+}
+
 void MaterialManager::reloadProgramsAndTextures() {
 	reloadTextures();
 	reloadPrograms();
@@ -36,8 +36,112 @@ Matrix4::Matrix4(Number *m) {
 	memcpy(ml, m, sizeof(Number)*16);
 }
 
+Matrix4 Matrix4::transpose() const {
+	Matrix4 r;
+#ifdef POLYCODE_USE_SSE
+	__m128 row0 = _mm_loadu_ps(m[0]);
+	__m128 row1 = _mm_loadu_ps(m[1]);
+	__m128 row2 = _mm_loadu_ps(m[2]);
+	__m128 row3 = _mm_loadu_ps(m[3]);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	_mm_storeu_ps(r.m[0], row0);
+	_mm_storeu_ps(r.m[1], row1);
+	_mm_storeu_ps(r.m[2], row2);
+	_mm_storeu_ps(r.m[3], row3);
+#else
+	for(int i=0; i < 4; i++) {
+		for(int j=0; j < 4; j++) {
+			r.m[i][j] = m[j][i];
+		}
+	}
+#endif
+	return r;
+}
+
     Matrix4 Matrix4::inverse() 
     {
+#ifdef POLYCODE_USE_SSE
+		// Cramer's rule on transposed rows, after Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix"
+		const Number *src = ml;
+		__m128 minor0, minor1, minor2, minor3;
+		__m128 row0, row1, row2, row3;
+		__m128 det, tmp1;
+		
+		tmp1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src)), (const __m64*)(src+4));
+		row1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src+8)), (const __m64*)(src+12));
+		row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+		row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+		tmp1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src+2)), (const __m64*)(src+6));
+		row3 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src+10)), (const __m64*)(src+14));
+		row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+		row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+		
+		tmp1 = _mm_mul_ps(row2, row3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor0 = _mm_mul_ps(row1, tmp1);
+		minor1 = _mm_mul_ps(row0, tmp1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
+		minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
+		minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+		
+		tmp1 = _mm_mul_ps(row1, row2);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
+		minor3 = _mm_mul_ps(row0, tmp1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
+		minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
+		minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+		
+		tmp1 = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+		minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
+		minor2 = _mm_mul_ps(row0, tmp1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
+		minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
+		minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+		
+		tmp1 = _mm_mul_ps(row0, row1);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
+		minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
+		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
+		
+		tmp1 = _mm_mul_ps(row0, row3);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
+		minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
+		minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
+		
+		tmp1 = _mm_mul_ps(row0, row2);
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+		minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
+		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
+		tmp1 = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
+		minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
+		
+		// a full division instead of the reciprocal estimate, so the result stays close to the double build
+		det = _mm_mul_ps(row0, minor0);
+		det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+		det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+		det = _mm_div_ss(_mm_set_ss(1.0f), det);
+		det = _mm_shuffle_ps(det, det, 0x00);
+		
+		Matrix4 r;
+		_mm_storeu_ps(r.m[0], _mm_mul_ps(det, minor0));
+		_mm_storeu_ps(r.m[1], _mm_mul_ps(det, minor1));
+		_mm_storeu_ps(r.m[2], _mm_mul_ps(det, minor2));
+		_mm_storeu_ps(r.m[3], _mm_mul_ps(det, minor3));
+		return r;
+#else
         Number m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
         Number m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
         Number m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
@@ -96,6 +200,7 @@ Matrix4::Matrix4(Number *m) {
             d10, d11, d12, d13,
             d20, d21, d22, d23,
             d30, d31, d32, d33);
+#endif
     }
     //-----------------------------------------------------------------------
     Matrix4 Matrix4::inverseAffine(void) 
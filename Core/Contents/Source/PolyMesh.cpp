@@ -21,6 +21,7 @@
 */
 
 #include "PolyMesh.h"
+#include "PolyMeshSimplifier.h"
 
 namespace Polycode {
 
@@ -34,6 +35,12 @@ namespace Polycode {
 		
 		meshType = TRI_MESH;
 		meshHasVertexBuffer = false;
+		indexedStorage = false;
+		polygonViewValid = false;
+		fileBoundsValid = false;
+		fileRadius = 0;
+		largeIndices = false;
+		indexedFaceSize = 0;
 		loadMesh(fileName);
 		vertexBuffer = NULL;			
 		useVertexColors = false;
@@ -47,15 +54,18 @@ namespace Polycode {
 		this->meshType = meshType;
 		meshHasVertexBuffer = false;		
 		vertexBuffer = NULL;
-		useVertexColors = false;				
+		useVertexColors = false;
+		indexedStorage = false;
+		polygonViewValid = false;
+		fileBoundsValid = false;
+		fileRadius = 0;
+		largeIndices = false;
+		indexedFaceSize = 0;
 	}
 	
 	
 	Mesh::~Mesh() {
-		for(int i=0; i < polygons.size(); i++) {	
-			delete polygons[i];
-		}
-		polygons.clear();
+		clearPolygons();
 		if(vertexBuffer)
 			delete vertexBuffer;
 		
@@ -79,6 +89,18 @@ namespace Polycode {
 	Number Mesh::getRadius() {
 		Number hRad = 0;
 		Number len;
+		if(indexedStorage) {
+			commitPolygonView(RenderDataArray::VERTEX_DATA_ARRAY);
+			if(fileBoundsValid)
+				return fileRadius;
+			for(int i=0; i < vertexStream.size(); i += VERTEX_STREAM_STRIDE) {
+				len = sqrt(vertexStream[i]*vertexStream[i] + vertexStream[i+1]*vertexStream[i+1] + vertexStream[i+2]*vertexStream[i+2]);
+				if(len > hRad)
+					hRad = len;
+			}
+			return hRad;
+		}
+		
 		for(int i=0; i < polygons.size(); i++) {	
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
 				len = polygons[i]->getVertex(j)->length();
@@ -89,11 +111,201 @@ namespace Polycode {
 		return hRad;
 	}
 	
-	void Mesh::saveToFile(OSFILE *outFile) {				
-		unsigned int numFaces = polygons.size();
+	void Mesh::saveToFile(OSFILE *outFile) {
+		vector<float> polygonVertices;
+		vector<unsigned int> polygonBoneIDs;
+		vector<float> polygonBoneWeights;
+		vector<unsigned short> polygonIndices16;
+		vector<unsigned int> polygonIndices32;
+		
+		float *vertices = NULL;
+		unsigned int vertexCount = 0;
+		void *indexData = NULL;
+		unsigned int indexCount = 0;
+		bool writeLargeIndices = false;
+		unsigned int *boneIDs = NULL;
+		float *boneWeights = NULL;
+		unsigned int faceSize = 0;
+		
+		if(indexedStorage) {
+			commitPolygonView();
+			vertices = getVertexStream();
+			vertexCount = getStreamVertexCount();
+			indexData = getIndexData();
+			indexCount = getIndexCount();
+			writeLargeIndices = largeIndices;
+			boneIDs = getBoneIDStream();
+			boneWeights = getBoneWeightStream();
+			faceSize = getIndexedFaceSize();
+		} else {
+			for(int i=0; i < polygons.size(); i++) {
+				if(i > 0 && polygons[i]->getVertexCount() != faceSize) {
+					saveLegacyToFile(outFile);
+					return;
+				}
+				faceSize = polygons[i]->getVertexCount();
+			}
+			
+			// every polygon vertex becomes a stream vertex, welding is left to useIndexedStorage()
+			bool hasBones = false;
+			vertexCount = polygons.size() * faceSize;
+			writeLargeIndices = (vertexCount > 65536);
+			polygonVertices.resize(vertexCount * VERTEX_STREAM_STRIDE);
+			polygonBoneIDs.resize(vertexCount * MAX_BONE_ASSIGNMENTS, 0);
+			polygonBoneWeights.resize(vertexCount * MAX_BONE_ASSIGNMENTS, 0);
+			
+			unsigned int index = 0;
+			for(int i=0; i < polygons.size(); i++) {
+				Polygon *polygon = polygons[i];
+				for(int j=0; j < polygon->getVertexCount(); j++) {
+					Vertex *vertex = polygon->getVertex(j);
+					Vector3 normal = polygon->useVertexNormals ? vertex->normal : polygon->getFaceNormal();
+					float *v = &polygonVertices[index * VERTEX_STREAM_STRIDE];
+					v[VERTEX_STREAM_POSITION_OFFSET] = vertex->x;
+					v[VERTEX_STREAM_POSITION_OFFSET+1] = vertex->y;
+					v[VERTEX_STREAM_POSITION_OFFSET+2] = vertex->z;
+					v[VERTEX_STREAM_NORMAL_OFFSET] = normal.x;
+					v[VERTEX_STREAM_NORMAL_OFFSET+1] = normal.y;
+					v[VERTEX_STREAM_NORMAL_OFFSET+2] = normal.z;
+					v[VERTEX_STREAM_COLOR_OFFSET] = vertex->vertexColor.r;
+					v[VERTEX_STREAM_COLOR_OFFSET+1] = vertex->vertexColor.g;
+					v[VERTEX_STREAM_COLOR_OFFSET+2] = vertex->vertexColor.b;
+					v[VERTEX_STREAM_COLOR_OFFSET+3] = vertex->vertexColor.a;
+					v[VERTEX_STREAM_TEXCOORD_OFFSET] = vertex->getTexCoord().x;
+					v[VERTEX_STREAM_TEXCOORD_OFFSET+1] = vertex->getTexCoord().y;
+					
+					if(selectBoneAssignments(vertex, &polygonBoneIDs[index * MAX_BONE_ASSIGNMENTS], &polygonBoneWeights[index * MAX_BONE_ASSIGNMENTS]) > 0)
+						hasBones = true;
+					
+					if(writeLargeIndices)
+						polygonIndices32.push_back(index);
+					else
+						polygonIndices16.push_back(index);
+					index++;
+				}
+			}
+			
+			if(vertexCount > 0) {
+				vertices = &polygonVertices[0];
+				indexData = writeLargeIndices ? (void*)&polygonIndices32[0] : (void*)&polygonIndices16[0];
+				indexCount = vertexCount;
+			}
+			if(hasBones) {
+				boneIDs = &polygonBoneIDs[0];
+				boneWeights = &polygonBoneWeights[0];
+			}
+		}
+		
+		MeshFileHeader header;
+		memset(&header, 0, sizeof(MeshFileHeader));
+		header.magic = MESH_FILE_MAGIC;
+		header.version = MESH_FILE_VERSION;
+		header.meshType = meshType;
+		header.faceSize = faceSize;
+		header.vertexCount = vertexCount;
+		header.indexCount = indexCount;
+		
+		for(unsigned int i=0; i < vertexCount; i++) {
+			float *v = vertices + (i * VERTEX_STREAM_STRIDE) + VERTEX_STREAM_POSITION_OFFSET;
+			if(i == 0) {
+				header.boundsMin.x = header.boundsMax.x = v[0];
+				header.boundsMin.y = header.boundsMax.y = v[1];
+				header.boundsMin.z = header.boundsMax.z = v[2];
+			}
+			header.boundsMin.x = min(header.boundsMin.x, v[0]);
+			header.boundsMin.y = min(header.boundsMin.y, v[1]);
+			header.boundsMin.z = min(header.boundsMin.z, v[2]);
+			header.boundsMax.x = max(header.boundsMax.x, v[0]);
+			header.boundsMax.y = max(header.boundsMax.y, v[1]);
+			header.boundsMax.z = max(header.boundsMax.z, v[2]);
+			header.radius = max(header.radius, (float)sqrt((v[0]*v[0]) + (v[1]*v[1]) + (v[2]*v[2])));
+		}
+		
+		vector<MeshFileSection> sections;
+		vector<const void*> sectionData;
+		MeshFileSection section;
+		section.reserved = 0;
+		if(vertexCount > 0) {
+			section.type = MESH_SECTION_VERTICES;
+			section.size = vertexCount * VERTEX_STREAM_STRIDE * sizeof(float);
+			sections.push_back(section);
+			sectionData.push_back(vertices);
+		}
+		if(indexCount > 0) {
+			section.type = writeLargeIndices ? MESH_SECTION_INDICES32 : MESH_SECTION_INDICES16;
+			section.size = indexCount * (writeLargeIndices ? sizeof(unsigned int) : sizeof(unsigned short));
+			sections.push_back(section);
+			sectionData.push_back(indexData);
+		}
+		if(boneIDs && boneWeights && vertexCount > 0) {
+			section.type = MESH_SECTION_BONE_IDS;
+			section.size = vertexCount * MAX_BONE_ASSIGNMENTS * sizeof(unsigned int);
+			sections.push_back(section);
+			sectionData.push_back(boneIDs);
+			section.type = MESH_SECTION_BONE_WEIGHTS;
+			section.size = vertexCount * MAX_BONE_ASSIGNMENTS * sizeof(float);
+			sections.push_back(section);
+			sectionData.push_back(boneWeights);
+		}
+		
+		unsigned int offset = sizeof(MeshFileHeader) + (sections.size() * sizeof(MeshFileSection));
+		for(int i=0; i < sections.size(); i++) {
+			offset = (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+			sections[i].offset = offset;
+			offset += sections[i].size;
+		}
+		header.numSections = sections.size();
+		header.dataSize = offset;
+		
+		OSBasics::write(&header, sizeof(MeshFileHeader), 1, outFile);
+		if(sections.size() > 0)
+			OSBasics::write(&sections[0], sizeof(MeshFileSection), sections.size(), outFile);
+		
+		char padding[MESH_FILE_ALIGNMENT];
+		memset(padding, 0, MESH_FILE_ALIGNMENT);
+		offset = sizeof(MeshFileHeader) + (sections.size() * sizeof(MeshFileSection));
+		for(int i=0; i < sections.size(); i++) {
+			if(sections[i].offset > offset)
+				OSBasics::write(padding, 1, sections[i].offset - offset, outFile);
+			OSBasics::write(sectionData[i], 1, sections[i].size, outFile);
+			offset = sections[i].offset + sections[i].size;
+		}
+	}
+	
+	void Mesh::saveLegacyToFile(OSFILE *outFile) {				
+		unsigned int numFaces = getPolygonCount();
 
 		OSBasics::write(&meshType, sizeof(unsigned int), 1, outFile);		
 		OSBasics::write(&numFaces, sizeof(unsigned int), 1, outFile);
+		
+		if(indexedStorage) {
+			commitPolygonView();
+			unsigned int numIndices = numFaces * getIndexedFaceSize();
+			for(int i=0; i < numIndices; i++) {
+				float *v = &vertexStream[getIndex(i) * VERTEX_STREAM_STRIDE];
+				OSBasics::write(v + VERTEX_STREAM_POSITION_OFFSET, sizeof(Vector3_struct), 1, outFile);
+				OSBasics::write(v + VERTEX_STREAM_NORMAL_OFFSET, sizeof(Vector3_struct), 1, outFile);
+				OSBasics::write(v + VERTEX_STREAM_COLOR_OFFSET, sizeof(Vector4_struct), 1, outFile);				
+				OSBasics::write(v + VERTEX_STREAM_TEXCOORD_OFFSET, sizeof(Vector2_struct), 1, outFile);
+				
+				unsigned int numBoneWeights = 0;
+				if(hasBoneStream()) {
+					for(int b=0; b < MAX_BONE_ASSIGNMENTS; b++) {
+						if(boneWeightStream[(getIndex(i) * MAX_BONE_ASSIGNMENTS) + b] > 0)
+							numBoneWeights++;
+					}
+				}
+				OSBasics::write(&numBoneWeights, sizeof(unsigned int), 1, outFile);
+				for(int b=0; b < numBoneWeights; b++) {
+					unsigned int boneID = boneIDStream[(getIndex(i) * MAX_BONE_ASSIGNMENTS) + b];
+					float weight = boneWeightStream[(getIndex(i) * MAX_BONE_ASSIGNMENTS) + b];
+					OSBasics::write(&boneID, sizeof(unsigned int), 1, outFile);
+					OSBasics::write(&weight, sizeof(float), 1, outFile);
+				}
+			}
+			return;
+		}
+		
 		for(int i=0; i < polygons.size(); i++) {
 			
 			Vector3_struct pos;
@@ -140,9 +352,134 @@ namespace Polycode {
 
 	
 	void Mesh::loadFromFile(OSFILE *inFile) {
+		long start = OSBasics::tell(inFile);
+		
+		// old mesh records start with the mesh type instead of the magic number
+		unsigned int magic;
+		OSBasics::read(&magic, sizeof(unsigned int), 1, inFile);
+		if(magic != MESH_FILE_MAGIC) {
+			loadLegacyFromFile(inFile, magic);
+			return;
+		}
+		
+		MeshFileHeader header;
+		header.magic = magic;
+		OSBasics::read(((char*)&header) + sizeof(unsigned int), sizeof(MeshFileHeader) - sizeof(unsigned int), 1, inFile);
+		if(header.version != MESH_FILE_VERSION) {
+			Logger::log("Unsupported mesh file version %d\n", header.version);
+			OSBasics::seek(inFile, start + header.dataSize, SEEK_SET);
+			return;
+		}
+		
+		vector<MeshFileSection> sections(header.numSections);
+		if(header.numSections > 0)
+			OSBasics::read(&sections[0], sizeof(MeshFileSection), header.numSections, inFile);
+		
+		clearPolygons();
+		vertexStream.clear();
+		boneIDStream.clear();
+		boneWeightStream.clear();
+		indices16.clear();
+		indices32.clear();
+		
+		meshType = header.meshType;
+		indexedStorage = true;
+		polygonViewValid = false;
+		fileBoundsValid = false;
+		largeIndices = false;
+		indexedFaceSize = header.faceSize;
+		
+		for(int i=0; i < sections.size(); i++) {
+			MeshFileSection &section = sections[i];
+			void *dest = NULL;
+			unsigned int expectedSize = 0;
+			switch(section.type) {
+				case MESH_SECTION_VERTICES:
+					expectedSize = header.vertexCount * VERTEX_STREAM_STRIDE * sizeof(float);
+					vertexStream.resize(header.vertexCount * VERTEX_STREAM_STRIDE);
+					dest = getVertexStream();
+				break;
+				case MESH_SECTION_INDICES16:
+					expectedSize = header.indexCount * sizeof(unsigned short);
+					indices16.resize(header.indexCount);
+					largeIndices = false;
+					dest = getIndexData();
+				break;
+				case MESH_SECTION_INDICES32:
+					expectedSize = header.indexCount * sizeof(unsigned int);
+					indices32.resize(header.indexCount);
+					largeIndices = true;
+					dest = getIndexData();
+				break;
+				case MESH_SECTION_BONE_IDS:
+					expectedSize = header.vertexCount * MAX_BONE_ASSIGNMENTS * sizeof(unsigned int);
+					boneIDStream.resize(header.vertexCount * MAX_BONE_ASSIGNMENTS);
+					dest = getBoneIDStream();
+				break;
+				case MESH_SECTION_BONE_WEIGHTS:
+					expectedSize = header.vertexCount * MAX_BONE_ASSIGNMENTS * sizeof(float);
+					boneWeightStream.resize(header.vertexCount * MAX_BONE_ASSIGNMENTS);
+					dest = getBoneWeightStream();
+				break;
+				default:
+					// sections from newer writers are skipped
+				break;
+			}
+			
+			if(!dest)
+				continue;
+			if(section.size != expectedSize) {
+				Logger::log("Mesh file section %d has the wrong size\n", section.type);
+				continue;
+			}
+			OSBasics::seek(inFile, start + section.offset, SEEK_SET);
+			OSBasics::read(dest, 1, section.size, inFile);
+		}
+		
+		if(boneIDStream.size() != boneWeightStream.size()) {
+			boneIDStream.clear();
+			boneWeightStream.clear();
+		}
+		
+		// an index past the vertex stream would make every draw read out of bounds, so the mesh is dropped
+		unsigned int streamVertexCount = getStreamVertexCount();
+		unsigned int indexCount = getIndexCount();
+		for(unsigned int i=0; i < indexCount; i++) {
+			if(getIndex(i) >= streamVertexCount) {
+				Logger::log("Mesh file index %d is out of range, %d vertices\n", getIndex(i), streamVertexCount);
+				vertexStream.clear();
+				boneIDStream.clear();
+				boneWeightStream.clear();
+				indices16.clear();
+				indices32.clear();
+				break;
+			}
+		}
+		
+		// the header bounds save getRadius() and calculateBBox() a pass over the stream
+		if(getStreamVertexCount() == header.vertexCount) {
+			fileBBox.x = max(fabs(header.boundsMin.x), fabs(header.boundsMax.x)) * 2;
+			fileBBox.y = max(fabs(header.boundsMin.y), fabs(header.boundsMax.y)) * 2;
+			fileBBox.z = max(fabs(header.boundsMin.z), fabs(header.boundsMax.z)) * 2;
+			fileRadius = header.radius;
+			fileBoundsValid = true;
+		}
+		
+		OSBasics::seek(inFile, start + header.dataSize, SEEK_SET);
+		
+		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
+		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
+		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+		arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
+	}
+	
+	void Mesh::loadLegacyFromFile(OSFILE *inFile, unsigned int meshType) {
 
-		unsigned int meshType;		
-		OSBasics::read(&meshType, sizeof(unsigned int), 1, inFile);				
+		bool loadIndexed = indexedStorage;
+		if(loadIndexed)
+			useIndexedStorage(false);
+		
 		setMeshType(meshType);
 		
 		int verticesPerFace;
@@ -198,6 +535,9 @@ namespace Polycode {
 			addPolygon(poly);
 		}
 		
+		if(loadIndexed)
+			useIndexedStorage(true);
+		
 		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
 		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
 		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
@@ -208,6 +548,7 @@ namespace Polycode {
 		OSFILE *outFile = OSBasics::open(fileName.c_str(), "wb");
 		if(!outFile) {
 			Logger::log("Error opening mesh file for saving: %s", fileName.c_str());
+			return;
 		}
 		saveToFile(outFile);
 		OSBasics::close(outFile);	
@@ -218,6 +559,7 @@ namespace Polycode {
 		OSFILE *inFile = OSBasics::open(fileName.c_str(), "rb");
 		if(!inFile) {
 			Logger::log("Error opening mesh file %s", fileName.c_str());
+			return;
 		}
 		loadFromFile(inFile);
 		OSBasics::close(inFile);	
@@ -229,33 +571,48 @@ namespace Polycode {
 	}
 	
 	void Mesh::createPlane(Number w, Number h) { 
-		Polygon *imagePolygon = new Polygon();
-		imagePolygon->addVertex(0,0,h,0,0);	
-		imagePolygon->addVertex(w,0,h, 1, 0);			
-		imagePolygon->addVertex(w,0,0, 1, 1);		
-		imagePolygon->addVertex(0,0,0,0,1);
-
-		addPolygon(imagePolygon);
+		Number hw = w/2.0f;
+		Number hh = h/2.0f;
 		
-		for(int i=0; i < polygons.size(); i++) {
-			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
-				polygons[i]->getVertex(j)->x = polygons[i]->getVertex(j)->x - (w/2.0f);
-				polygons[i]->getVertex(j)->z = polygons[i]->getVertex(j)->z - (h/2.0f);
-			}
-		}
-
-		calculateNormals();
-		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;										
+		Number positions[] = {-hw,0,hh, hw,0,hh, hw,0,-hh, -hw,0,-hh};
+		Number texCoords[] = {0,0, 1,0, 1,1, 0,1};
+		addBuilderFace(positions, texCoords, 4);
 		
+		finishBuild();
 	}
 
 	Vector3 Mesh::recenterMesh() {
 		Vector3 positiveOffset;
 		Vector3 negativeOffset;
 		
+		if(indexedStorage) {
+			commitPolygonView(RenderDataArray::VERTEX_DATA_ARRAY);
+			for(int i=0; i < vertexStream.size(); i += VERTEX_STREAM_STRIDE) {
+				positiveOffset.x = max(positiveOffset.x, (Number)vertexStream[i]);
+				positiveOffset.y = max(positiveOffset.y, (Number)vertexStream[i+1]);
+				positiveOffset.z = max(positiveOffset.z, (Number)vertexStream[i+2]);
+				negativeOffset.x = min(negativeOffset.x, (Number)vertexStream[i]);
+				negativeOffset.y = min(negativeOffset.y, (Number)vertexStream[i+1]);
+				negativeOffset.z = min(negativeOffset.z, (Number)vertexStream[i+2]);
+			}
+			
+			Vector3 finalOffset;
+			finalOffset.x = (positiveOffset.x + negativeOffset.x)/2.0f;
+			finalOffset.y = (positiveOffset.y + negativeOffset.y)/2.0f;
+			finalOffset.z = (positiveOffset.z + negativeOffset.z)/2.0f;
+			
+			for(int i=0; i < vertexStream.size(); i += VERTEX_STREAM_STRIDE) {
+				vertexStream[i] -= finalOffset.x;
+				vertexStream[i+1] -= finalOffset.y;
+				vertexStream[i+2] -= finalOffset.z;
+			}
+			fileBoundsValid = false;
+			refreshPolygonView();
+			
+			arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;
+			return finalOffset;
+		}
+		
 		for(int i=0; i < polygons.size(); i++) {
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
 				positiveOffset.x = max(positiveOffset.x,polygons[i]->getVertex(j)->x);
@@ -308,6 +665,18 @@ namespace Polycode {
 	Vector3 Mesh::calculateBBox() {
 		Vector3 retVec;
 		
+		if(indexedStorage) {
+			commitPolygonView(RenderDataArray::VERTEX_DATA_ARRAY);
+			if(fileBoundsValid)
+				return fileBBox;
+			for(int i=0; i < vertexStream.size(); i += VERTEX_STREAM_STRIDE) {
+				retVec.x = max(retVec.x,(Number)fabs(vertexStream[i]));
+				retVec.y = max(retVec.y,(Number)fabs(vertexStream[i+1]));
+				retVec.z = max(retVec.z,(Number)fabs(vertexStream[i+2]));
+			}
+			return retVec*2;
+		}
+		
 		for(int i=0; i < polygons.size(); i++) {
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {				
 				retVec.x = max(retVec.x,fabs(polygons[i]->getVertex(j)->x));
@@ -351,6 +720,9 @@ namespace Polycode {
 	}
 	
 	unsigned int Mesh::getVertexCount() {
+		if(indexedStorage)
+			return getIndexCount();
+		
 		unsigned int total = 0;
 		for(int i=0; i < polygons.size(); i++) {
 			total += polygons[i]->getVertexCount();
@@ -361,185 +733,160 @@ namespace Polycode {
 	void Mesh::createCylinder(Number height, Number radius, int numSegments) {
 	
 		setMeshType(Mesh::TRI_MESH);
-		Number lastx = -1;
-		Number lastz = -1;		
+		Number top = height - (height/2.0f);
+		Number bottom = -(height/2.0f);
+		Number lastx = 0;
+		Number lastz = 0;		
 		for (int i=0 ; i < numSegments+1; i++) {
 			Number pos = ((PI*2.0)/((Number)numSegments)) * i;
 			Number x = sinf(pos) * radius;
 			Number z = cosf(pos) * radius;
 			
-			if(lastx > -1) {
-				Polygon *polygon = new Polygon();
-				polygon->addVertex(lastx,0,lastz,0,0);				
-				polygon->addVertex(x,0,z, 1, 0);
-				polygon->addVertex(x,height,z, 1, 1);				
-				addPolygon(polygon);							
-
-				polygon = new Polygon();	
-				polygon->addVertex(x,height,z, 1, 1);								
-				polygon->addVertex(lastx,height,lastz, 1, 1);																												
-				polygon->addVertex(lastx,0,lastz,0,0);												
-				addPolygon(polygon);	
-				
-				polygon = new Polygon();	
-				polygon->addVertex(lastx,height,lastz, 1, 1);				
-				polygon->addVertex(x,height,z, 1, 1);														
-				polygon->addVertex(0,height,0,0,0);							
-				addPolygon(polygon);			
+			if(i > 0) {
+				Number side1[] = {lastx,bottom,lastz, x,bottom,z, x,top,z};
+				Number side1UV[] = {0,0, 1,0, 1,1};
+				addBuilderFace(side1, side1UV, 3);
 
-				polygon = new Polygon();	
-				polygon->addVertex(lastx,0,lastz, 1, 1);						
-				polygon->addVertex(0,0,0,0,0);																																					
-				polygon->addVertex(x,0,z, 1, 1);								
-				addPolygon(polygon);			
+				Number side2[] = {x,top,z, lastx,top,lastz, lastx,bottom,lastz};
+				Number side2UV[] = {1,1, 1,1, 0,0};
+				addBuilderFace(side2, side2UV, 3);
+				
+				Number topCap[] = {lastx,top,lastz, x,top,z, 0,top,0};
+				Number topCapUV[] = {1,1, 1,1, 0,0};
+				addBuilderFace(topCap, topCapUV, 3);
 
-								
+				Number bottomCap[] = {lastx,bottom,lastz, 0,bottom,0, x,bottom,z};
+				Number bottomCapUV[] = {1,1, 0,0, 1,1};
+				addBuilderFace(bottomCap, bottomCapUV, 3);
 			}
 			lastx = x;
 			lastz = z;			
-		/*
-			Polygon *polygon = new Polygon();
-			polygon->addVertex(w,0,h, 1, 1);
-			polygon->addVertex(0,0,h, 1, 0);
-			polygon->addVertex(0,0,0,0,0);
-			polygon->addVertex(w,0,0,0,1);
-			addPolygon(polygon);			
-			*/
         }
 		
-		for(int i=0; i < polygons.size(); i++) {
-			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
-//				polygons[i]->getVertex(j)->x = polygons[i]->getVertex(j)->x - (radius/2.0f);
-				polygons[i]->getVertex(j)->y = polygons[i]->getVertex(j)->y - (height/2.0f);
-//				polygons[i]->getVertex(j)->z = polygons[i]->getVertex(j)->z - (radius/2.0f);	
-			}
-		}
-		
-		
-		calculateNormals();
-		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;										
-		
+		finishBuild();
 	}
 	
 	void Mesh::createCone(Number height, Number radius, int numSegments) {
 	
-	
 		setMeshType(Mesh::TRI_MESH);
-		Number lastx = -1;
-		Number lastz = -1;		
+		Number top = height - (height/2.0f);
+		Number bottom = -(height/2.0f);
+		Number lastx = 0;
+		Number lastz = 0;		
 		for (int i=0 ; i < numSegments+1; i++) {
 			Number pos = ((PI*2.0)/((Number)numSegments)) * i;
 			Number x = sinf(pos) * radius;
 			Number z = cosf(pos) * radius;
 			
-			if(lastx > -1) {
-				Polygon *polygon = new Polygon();
-				polygon->addVertex(lastx,0,lastz,0,0);				
-				polygon->addVertex(x,0,z, 1, 0);
-				polygon->addVertex(0,height,0, 1, 1);				
-				addPolygon(polygon);							
-			
-
-				polygon = new Polygon();	
-				polygon->addVertex(x,0,z, 1, 1);												
-				polygon->addVertex(lastx,0,lastz, 1, 1);																														
-				polygon->addVertex(0,0,0,0,0);												
-				addPolygon(polygon);			
+			if(i > 0) {
+				Number side[] = {lastx,bottom,lastz, x,bottom,z, 0,top,0};
+				Number sideUV[] = {0,0, 1,0, 1,1};
+				addBuilderFace(side, sideUV, 3);
 
-								
+				Number bottomCap[] = {x,bottom,z, lastx,bottom,lastz, 0,bottom,0};
+				Number bottomCapUV[] = {1,1, 1,1, 0,0};
+				addBuilderFace(bottomCap, bottomCapUV, 3);
 			}
 			lastx = x;
 			lastz = z;			
-		/*
-			Polygon *polygon = new Polygon();
-			polygon->addVertex(w,0,h, 1, 1);
-			polygon->addVertex(0,0,h, 1, 0);
-			polygon->addVertex(0,0,0,0,0);
-			polygon->addVertex(w,0,0,0,1);
-			addPolygon(polygon);			
-			*/
         }
 		
-		for(int i=0; i < polygons.size(); i++) {
-			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
-//				polygons[i]->getVertex(j)->x = polygons[i]->getVertex(j)->x - (radius/2.0f);
-				polygons[i]->getVertex(j)->y = polygons[i]->getVertex(j)->y - (height/2.0f);
-//				polygons[i]->getVertex(j)->z = polygons[i]->getVertex(j)->z - (radius/2.0f);	
+		finishBuild();
+	}
+
+	void Mesh::createBox(Number w, Number d, Number h) {
+		// corner signs and texture coordinates for the six faces
+		static const Number boxFaces[] = {
+			1,-1,1,1,1,		-1,-1,1,1,0,	-1,-1,-1,0,0,	1,-1,-1,0,1,
+			1,1,1,1,1,		1,1,-1,1,0,		-1,1,-1,0,0,	-1,1,1,0,1,
+			-1,1,-1,0,1,	1,1,-1,1,1,		1,-1,-1,1,0,	-1,-1,-1,0,0,
+			-1,-1,1,0,0,	1,-1,1,1,0,		1,1,1,1,1,		-1,1,1,0,1,
+			-1,-1,1,0,1,	-1,1,1,1,1,		-1,1,-1,1,0,	-1,-1,-1,0,0,
+			1,-1,1,0,1,		1,-1,-1,1,1,	1,1,-1,1,0,		1,1,1,0,0
+		};
+		
+		Number positions[12];
+		Number texCoords[8];
+		for(int f=0; f < 6; f++) {
+			for(int v=0; v < 4; v++) {
+				const Number *corner = &boxFaces[(f*20)+(v*5)];
+				positions[(v*3)] = corner[0] * (w/2.0f);
+				positions[(v*3)+1] = corner[1] * (d/2.0f);
+				positions[(v*3)+2] = corner[2] * (h/2.0f);
+				texCoords[(v*2)] = corner[3];
+				texCoords[(v*2)+1] = corner[4];
 			}
+			addBuilderFace(positions, texCoords, 4);
 		}
 		
-		
-		calculateNormals();
-		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;										
-			
-	
+		finishBuild();
 	}
-
-	void Mesh::createBox(Number w, Number d, Number h) {
-		Polygon *polygon = new Polygon();
-		polygon->addVertex(w,0,h, 1, 1);
-		polygon->addVertex(0,0,h, 1, 0);
-		polygon->addVertex(0,0,0,0,0);
-		polygon->addVertex(w,0,0,0,1);
-		addPolygon(polygon);
-
-		polygon = new Polygon();
-		polygon->addVertex(w,d,h, 1, 1);
-		polygon->addVertex(w,d,0, 1, 0);
-		polygon->addVertex(0,d,0,0,0);
-		polygon->addVertex(0,d,h,0,1);
-		addPolygon(polygon);
-
-		polygon = new Polygon();
-		polygon->addVertex(0,d,0,0,1);
-		polygon->addVertex(w,d,0, 1, 1);
-		polygon->addVertex(w,0,0, 1, 0);
-		polygon->addVertex(0,0,0,0,0);
-		addPolygon(polygon);
-
-		polygon = new Polygon();
-		polygon->addVertex(0,0,h,0,0);
-		polygon->addVertex(w,0,h, 1, 0);
-		polygon->addVertex(w,d,h, 1, 1);
-		polygon->addVertex(0,d,h,0,1);
-		addPolygon(polygon);
-
-		polygon = new Polygon();
-		polygon->addVertex(0,0,h,0,1);
-		polygon->addVertex(0,d,h, 1, 1);
-		polygon->addVertex(0,d,0, 1, 0);
-		polygon->addVertex(0,0,0,0,0);
-		addPolygon(polygon);
-
-		polygon = new Polygon();
-		polygon->addVertex(w,0,h,0,1);
-		polygon->addVertex(w,0,0, 1, 1);
-		polygon->addVertex(w,d,0, 1, 0);
-		polygon->addVertex(w,d,h,0,0);
-		addPolygon(polygon);
-
-		for(int i=0; i < polygons.size(); i++) {
-			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
-				polygons[i]->getVertex(j)->x = polygons[i]->getVertex(j)->x - (w/2.0f);
-				polygons[i]->getVertex(j)->y = polygons[i]->getVertex(j)->y - (d/2.0f);
-				polygons[i]->getVertex(j)->z = polygons[i]->getVertex(j)->z - (h/2.0f);	
+	
+	void Mesh::addBuilderFace(const Number *positions, const Number *texCoords, int numVertices) {
+		if(!indexedStorage) {
+			Polygon *polygon = new Polygon();
+			for(int i=0; i < numVertices; i++) {
+				polygon->addVertex(positions[(i*3)], positions[(i*3)+1], positions[(i*3)+2], texCoords[(i*2)], texCoords[(i*2)+1]);
 			}
+			addPolygon(polygon);
+			return;
+		}
+		
+		if(polygonViewValid) {
+			commitPolygonView();
+			clearPolygons();
+			polygonViewValid = false;
+		}
+		
+		Vector3 normal;
+		if(numVertices > 2) {
+			Vector3 v0 = Vector3(positions[0], positions[1], positions[2]);
+			Vector3 v1 = Vector3(positions[3], positions[4], positions[5]);
+			Vector3 v2 = Vector3(positions[6], positions[7], positions[8]);
+			normal = (v0 - v1).crossProduct(v1 - v2);
+			normal.Normalize();
+		}
+		
+		Color color;
+		unsigned int base = getStreamVertexCount();
+		for(int i=0; i < numVertices; i++) {
+			addStreamVertex(Vector3(positions[(i*3)], positions[(i*3)+1], positions[(i*3)+2]), normal, color, Vector2(texCoords[(i*2)], texCoords[(i*2)+1]));
+		}
+		
+		if(meshType == TRI_MESH) {
+			for(int i=1; i < numVertices-1; i++) {
+				addIndex(base);
+				addIndex(base+i);
+				addIndex(base+i+1);
+			}
+			indexedFaceSize = 3;
+		} else {
+			for(int i=0; i < numVertices; i++) {
+				addIndex(base+i);
+			}
+			indexedFaceSize = numVertices;
+		}
+	}
+	
+	void Mesh::finishBuild() {
+		if(indexedStorage) {
+			// face normals are already in the stream, welding keeps them flat
+			weldVertices();
+		} else {
+			calculateNormals();
 		}
-
-		calculateNormals();
 		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
 		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
 		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;										
+		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+		arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
 	}
 	
 	void Mesh::useVertexNormals(bool val) {
+		if(indexedStorage && !polygonViewValid) {
+			arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+			return;
+		}
 		for(int i =0; i < polygons.size(); i++) {
 			polygons[i]->useVertexNormals = val;
 		}		
@@ -547,6 +894,39 @@ namespace Polycode {
 	}
 	
 	void Mesh::calculateNormals() {
+		if(indexedStorage) {
+			commitPolygonView(RenderDataArray::VERTEX_DATA_ARRAY);
+			unsigned int vertexCount = getStreamVertexCount();
+			vector<Vector3> normals(vertexCount);
+			
+			// accumulate unnormalized face normals, weighting shared vertices by face area
+			int faceSize = getIndexedFaceSize();
+			unsigned int numIndices = getPolygonCount() * faceSize;
+			for(int i=0; i < numIndices && faceSize > 2; i += faceSize) {
+				float *p0 = &vertexStream[getIndex(i) * VERTEX_STREAM_STRIDE];
+				float *p1 = &vertexStream[getIndex(i+1) * VERTEX_STREAM_STRIDE];
+				float *p2 = &vertexStream[getIndex(i+2) * VERTEX_STREAM_STRIDE];
+				Vector3 v0 = Vector3(p0[0], p0[1], p0[2]);
+				Vector3 v1 = Vector3(p1[0], p1[1], p1[2]);
+				Vector3 v2 = Vector3(p2[0], p2[1], p2[2]);
+				Vector3 faceNormal = (v0 - v1).crossProduct(v1 - v2);
+				for(int j=0; j < faceSize; j++) {
+					normals[getIndex(i+j)] += faceNormal;
+				}
+			}
+			
+			for(int i=0; i < vertexCount; i++) {
+				normals[i].Normalize();
+				float *n = &vertexStream[(i * VERTEX_STREAM_STRIDE) + VERTEX_STREAM_NORMAL_OFFSET];
+				n[0] = normals[i].x;
+				n[1] = normals[i].y;
+				n[2] = normals[i].z;
+			}
+			refreshPolygonView();
+			arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+			return;
+		}
+		
 		for(int i =0; i < polygons.size(); i++) {
 			polygons[i]->calculateNormal();
 		}
@@ -562,6 +942,8 @@ namespace Polycode {
 	}
 	
 	void Mesh::addPolygon(Polygon *newPolygon) {
+		if(indexedStorage)
+			useIndexedStorage(false);
 		polygons.push_back(newPolygon);
 		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
 		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
@@ -571,10 +953,544 @@ namespace Polycode {
 	
 	
 	unsigned int Mesh::getPolygonCount() {
+		if(indexedStorage) {
+			int faceSize = getIndexedFaceSize();
+			if(faceSize == 0)
+				return 0;
+			return getIndexCount() / faceSize;
+		}
 		return polygons.size();
 	}
 	
 	Polygon *Mesh::getPolygon(unsigned int index) {
+		if(indexedStorage && !polygonViewValid)
+			buildPolygonView();
 		return polygons[index];
 	}
+	
+	bool Mesh::useIndexedStorage(bool val) {
+		if(val == indexedStorage)
+			return true;
+		
+		if(val) {
+			return buildIndexedStorage();
+		} else {
+			expandIndexedStorage();
+			return true;
+		}
+	}
+	
+	bool Mesh::buildIndexedStorage() {
+		int faceSize = 0;
+		for(int i=0; i < polygons.size(); i++) {
+			if(i > 0 && polygons[i]->getVertexCount() != faceSize) {
+				Logger::log("Cannot convert mesh to indexed storage, polygons have differing vertex counts.\n");
+				return false;
+			}
+			faceSize = polygons[i]->getVertexCount();
+		}
+		
+		vertexStream.clear();
+		boneIDStream.clear();
+		boneWeightStream.clear();
+		indices16.clear();
+		indices32.clear();
+		largeIndices = false;
+		fileBoundsValid = false;
+		indexedFaceSize = faceSize;
+		
+		vertexStream.reserve(polygons.size() * faceSize * VERTEX_STREAM_STRIDE);
+		for(int i=0; i < polygons.size(); i++) {
+			Polygon *polygon = polygons[i];
+			for(int j=0; j < polygon->getVertexCount(); j++) {
+				Vertex *vertex = polygon->getVertex(j);
+				Vector3 normal = polygon->useVertexNormals ? vertex->normal : polygon->getFaceNormal();
+				unsigned int index = addStreamVertex(*vertex, normal, vertex->vertexColor, vertex->getTexCoord());
+				
+				unsigned int boneIDs[MAX_BONE_ASSIGNMENTS];
+				float boneWeights[MAX_BONE_ASSIGNMENTS];
+				int numAssignments = selectBoneAssignments(vertex, boneIDs, boneWeights);
+				for(int slot=0; slot < numAssignments; slot++) {
+					setStreamBoneAssignment(index, slot, boneIDs[slot], boneWeights[slot]);
+				}
+				addIndex(index);
+			}
+		}
+		
+		clearPolygons();
+		polygonViewValid = false;
+		indexedStorage = true;
+		weldVertices();
+		
+		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
+		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+		arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
+		return true;
+	}
+	
+	int Mesh::selectBoneAssignments(Vertex *vertex, unsigned int *boneIDs, float *weights) {
+		// keep the strongest assignments if the vertex has more than we can store
+		int numAssignments = vertex->getNumBoneAssignments();
+		vector<bool> used(numAssignments, false);
+		int slot;
+		for(slot=0; slot < MAX_BONE_ASSIGNMENTS && slot < numAssignments; slot++) {
+			int best = -1;
+			for(int b=0; b < numAssignments; b++) {
+				if(!used[b] && (best == -1 || vertex->getBoneAssignment(b)->weight > vertex->getBoneAssignment(best)->weight))
+					best = b;
+			}
+			used[best] = true;
+			boneIDs[slot] = vertex->getBoneAssignment(best)->boneID;
+			weights[slot] = vertex->getBoneAssignment(best)->weight;
+		}
+		return slot;
+	}
+	
+	void Mesh::expandIndexedStorage() {
+		if(!polygonViewValid)
+			buildPolygonView();
+		
+		indexedStorage = false;
+		polygonViewValid = false;
+		fileBoundsValid = false;
+		largeIndices = false;
+		indexedFaceSize = 0;
+		vertexStream.clear();
+		boneIDStream.clear();
+		boneWeightStream.clear();
+		indices16.clear();
+		indices32.clear();
+		
+		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
+		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+	}
+	
+	void Mesh::buildPolygonView() {
+		clearPolygons();
+		
+		int faceSize = getIndexedFaceSize();
+		unsigned int numFaces = getPolygonCount();
+		for(int i=0; i < numFaces; i++) {
+			Polygon *polygon = new Polygon();
+			for(int j=0; j < faceSize; j++) {
+				unsigned int index = getIndex((i*faceSize)+j);
+				float *v = &vertexStream[index * VERTEX_STREAM_STRIDE];
+				float *n = v + VERTEX_STREAM_NORMAL_OFFSET;
+				float *c = v + VERTEX_STREAM_COLOR_OFFSET;
+				float *t = v + VERTEX_STREAM_TEXCOORD_OFFSET;
+				
+				Vertex *vertex = new Vertex(v[0], v[1], v[2], n[0], n[1], n[2], t[0], t[1]);
+				vertex->restNormal.set(n[0], n[1], n[2]);
+				vertex->vertexColor.setColor(c[0], c[1], c[2], c[3]);
+				if(hasBoneStream()) {
+					for(int b=0; b < MAX_BONE_ASSIGNMENTS; b++) {
+						float weight = boneWeightStream[(index * MAX_BONE_ASSIGNMENTS) + b];
+						if(weight > 0)
+							vertex->addBoneAssignment(boneIDStream[(index * MAX_BONE_ASSIGNMENTS) + b], weight);
+					}
+				}
+				polygon->addVertex(vertex);
+			}
+			
+			if(faceSize > 2) {
+				Vector3 faceNormal = (*polygon->getVertex(0) - *polygon->getVertex(1)).crossProduct(*polygon->getVertex(1) - *polygon->getVertex(2));
+				faceNormal.Normalize();
+				polygon->setNormal(faceNormal);
+			}
+			polygons.push_back(polygon);
+		}
+
+		polygonViewStream.resize(numFaces * faceSize * VERTEX_STREAM_STRIDE);
+		for(unsigned int i=0; i < numFaces * faceSize; i++) {
+			snapshotPolygonViewCorner(i);
+		}
+		polygonViewValid = true;
+	}
+
+	void Mesh::refreshPolygonView() {
+		if(!polygonViewValid)
+			return;
+
+		int faceSize = getIndexedFaceSize();
+		for(int i=0; i < polygons.size(); i++) {
+			for(int j=0; j < faceSize; j++) {
+				Vertex *vertex = polygons[i]->getVertex(j);
+				float *v = &vertexStream[getIndex((i*faceSize)+j) * VERTEX_STREAM_STRIDE];
+				float *n = v + VERTEX_STREAM_NORMAL_OFFSET;
+				float *c = v + VERTEX_STREAM_COLOR_OFFSET;
+				float *t = v + VERTEX_STREAM_TEXCOORD_OFFSET;
+				vertex->set(v[0], v[1], v[2]);
+				vertex->setNormal(n[0], n[1], n[2]);
+				vertex->vertexColor.setColor(c[0], c[1], c[2], c[3]);
+				vertex->setTexCoord(t[0], t[1]);
+				snapshotPolygonViewCorner((i*faceSize)+j);
+			}
+		}
+	}
+
+	void Mesh::snapshotPolygonViewCorner(unsigned int corner) {
+		float *committed = &polygonViewStream[corner * VERTEX_STREAM_STRIDE];
+		getPolygonViewAttribute(corner, RenderDataArray::VERTEX_DATA_ARRAY, committed + VERTEX_STREAM_POSITION_OFFSET);
+		getPolygonViewAttribute(corner, RenderDataArray::NORMAL_DATA_ARRAY, committed + VERTEX_STREAM_NORMAL_OFFSET);
+		getPolygonViewAttribute(corner, RenderDataArray::COLOR_DATA_ARRAY, committed + VERTEX_STREAM_COLOR_OFFSET);
+		getPolygonViewAttribute(corner, RenderDataArray::TEXCOORD_DATA_ARRAY, committed + VERTEX_STREAM_TEXCOORD_OFFSET);
+	}
+
+	int Mesh::getStreamAttributeOffset(int arrayType) {
+		switch(arrayType) {
+			case RenderDataArray::VERTEX_DATA_ARRAY:
+				return VERTEX_STREAM_POSITION_OFFSET;
+			case RenderDataArray::NORMAL_DATA_ARRAY:
+				return VERTEX_STREAM_NORMAL_OFFSET;
+			case RenderDataArray::COLOR_DATA_ARRAY:
+				return VERTEX_STREAM_COLOR_OFFSET;
+			case RenderDataArray::TEXCOORD_DATA_ARRAY:
+				return VERTEX_STREAM_TEXCOORD_OFFSET;
+			default:
+				return -1;
+		}
+	}
+
+	int Mesh::getPolygonViewAttribute(unsigned int corner, int arrayType, float *values) {
+		int faceSize = getIndexedFaceSize();
+		Polygon *polygon = polygons[corner / faceSize];
+		Vertex *vertex = polygon->getVertex(corner % faceSize);
+		switch(arrayType) {
+			case RenderDataArray::VERTEX_DATA_ARRAY:
+				values[0] = vertex->x;
+				values[1] = vertex->y;
+				values[2] = vertex->z;
+				return 3;
+			case RenderDataArray::NORMAL_DATA_ARRAY:
+			{
+				Vector3 normal = polygon->useVertexNormals ? vertex->normal : polygon->getFaceNormal();
+				values[0] = normal.x;
+				values[1] = normal.y;
+				values[2] = normal.z;
+				return 3;
+			}
+			case RenderDataArray::COLOR_DATA_ARRAY:
+				values[0] = vertex->vertexColor.r;
+				values[1] = vertex->vertexColor.g;
+				values[2] = vertex->vertexColor.b;
+				values[3] = vertex->vertexColor.a;
+				return 4;
+			case RenderDataArray::TEXCOORD_DATA_ARRAY:
+				values[0] = vertex->getTexCoord().x;
+				values[1] = vertex->getTexCoord().y;
+				return 2;
+			default:
+				return 0;
+		}
+	}
+
+	void Mesh::setPolygonViewAttribute(unsigned int corner, int arrayType, const float *values) {
+		int faceSize = getIndexedFaceSize();
+		Vertex *vertex = polygons[corner / faceSize]->getVertex(corner % faceSize);
+		switch(arrayType) {
+			case RenderDataArray::VERTEX_DATA_ARRAY:
+				vertex->set(values[0], values[1], values[2]);
+			break;
+			case RenderDataArray::NORMAL_DATA_ARRAY:
+				vertex->setNormal(values[0], values[1], values[2]);
+			break;
+			case RenderDataArray::COLOR_DATA_ARRAY:
+				vertex->vertexColor.setColor(values[0], values[1], values[2], values[3]);
+			break;
+			case RenderDataArray::TEXCOORD_DATA_ARRAY:
+				vertex->setTexCoord(values[0], values[1]);
+			break;
+		}
+	}
+
+	void Mesh::commitPolygonView() {
+		commitPolygonView(RenderDataArray::VERTEX_DATA_ARRAY);
+		commitPolygonView(RenderDataArray::COLOR_DATA_ARRAY);
+		commitPolygonView(RenderDataArray::NORMAL_DATA_ARRAY);
+		commitPolygonView(RenderDataArray::TEXCOORD_DATA_ARRAY);
+	}
+
+	void Mesh::commitPolygonView(int arrayType) {
+		if(!indexedStorage || !polygonViewValid)
+			return;
+
+		int offset = getStreamAttributeOffset(arrayType);
+		if(offset < 0)
+			return;
+
+		// each polygon vertex is a separate copy of a possibly welded stream vertex, so only
+		// the ones that differ from what was last committed are written back
+		unsigned int numCorners = polygons.size() * getIndexedFaceSize();
+		bool changed = false;
+		float values[4];
+		for(unsigned int i=0; i < numCorners; i++) {
+			int count = getPolygonViewAttribute(i, arrayType, values);
+			float *committed = &polygonViewStream[(i * VERTEX_STREAM_STRIDE) + offset];
+			if(memcmp(values, committed, count * sizeof(float)) == 0)
+				continue;
+			memcpy(committed, values, count * sizeof(float));
+			memcpy(&vertexStream[(getIndex(i) * VERTEX_STREAM_STRIDE) + offset], values, count * sizeof(float));
+			changed = true;
+		}
+		
+		if(changed && arrayType == RenderDataArray::VERTEX_DATA_ARRAY)
+			fileBoundsValid = false;
+
+		if(!changed)
+			return;
+
+		// copies in neighbouring polygons still hold the old value
+		for(unsigned int i=0; i < numCorners; i++) {
+			float *v = &vertexStream[(getIndex(i) * VERTEX_STREAM_STRIDE) + offset];
+			int count = getPolygonViewAttribute(i, arrayType, values);
+			if(memcmp(values, v, count * sizeof(float)) == 0)
+				continue;
+			setPolygonViewAttribute(i, arrayType, v);
+			getPolygonViewAttribute(i, arrayType, &polygonViewStream[(i * VERTEX_STREAM_STRIDE) + offset]);
+		}
+	}
+
+	Mesh *Mesh::createSimplifiedMesh(Number triangleRatio) {
+		MeshSimplifier simplifier(this);
+		if(!simplifier.isValid())
+			return NULL;
+		return simplifier.simplify((unsigned int)(simplifier.getTriangleCount() * triangleRatio));
+	}
+
+	vector<Mesh*> Mesh::createLODChain(unsigned int numLevels, Number triangleRatio) {
+		vector<Mesh*> levels;
+		MeshSimplifier simplifier(this);
+		if(!simplifier.isValid())
+			return levels;
+		
+		Number targetTriangles = simplifier.getTriangleCount();
+		for(unsigned int i=0; i < numLevels; i++) {
+			targetTriangles *= triangleRatio;
+			levels.push_back(simplifier.simplify((unsigned int)targetTriangles));
+		}
+		return levels;
+	}
+	
+	void Mesh::clearPolygons() {
+		for(int i=0; i < polygons.size(); i++) {	
+			delete polygons[i];
+		}
+		polygons.clear();
+	}
+	
+	int Mesh::getIndexedFaceSize() {
+		if(indexedFaceSize > 0)
+			return indexedFaceSize;
+		
+		switch(meshType) {
+			case TRI_MESH:
+				return 3;
+			case QUAD_MESH:
+				return 4;
+			case LINE_MESH:
+				return 2;
+			case POINT_MESH:
+				return 1;
+			default:
+				return getIndexCount();
+		}
+	}
+	
+	unsigned int Mesh::addStreamVertex(const Vector3 &position, const Vector3 &normal, const Color &color, const Vector2 &texCoord) {
+		unsigned int index = getStreamVertexCount();
+		fileBoundsValid = false;
+		vertexStream.push_back(position.x);
+		vertexStream.push_back(position.y);
+		vertexStream.push_back(position.z);
+		vertexStream.push_back(normal.x);
+		vertexStream.push_back(normal.y);
+		vertexStream.push_back(normal.z);
+		vertexStream.push_back(color.r);
+		vertexStream.push_back(color.g);
+		vertexStream.push_back(color.b);
+		vertexStream.push_back(color.a);
+		vertexStream.push_back(texCoord.x);
+		vertexStream.push_back(texCoord.y);
+		
+		if(hasBoneStream()) {
+			boneIDStream.resize(boneIDStream.size() + MAX_BONE_ASSIGNMENTS, 0);
+			boneWeightStream.resize(boneWeightStream.size() + MAX_BONE_ASSIGNMENTS, 0);
+		}
+		return index;
+	}
+	
+	void Mesh::setStreamBoneAssignment(unsigned int vertexIndex, unsigned int slot, unsigned int boneID, float weight) {
+		if(vertexIndex >= getStreamVertexCount() || slot >= MAX_BONE_ASSIGNMENTS)
+			return;
+		
+		if(!hasBoneStream()) {
+			boneIDStream.resize(getStreamVertexCount() * MAX_BONE_ASSIGNMENTS, 0);
+			boneWeightStream.resize(getStreamVertexCount() * MAX_BONE_ASSIGNMENTS, 0);
+		}
+		boneIDStream[(vertexIndex * MAX_BONE_ASSIGNMENTS) + slot] = boneID;
+		boneWeightStream[(vertexIndex * MAX_BONE_ASSIGNMENTS) + slot] = weight;
+	}
+	
+	void Mesh::addIndex(unsigned int index) {
+		if(!largeIndices && index > 65535) {
+			indices32.assign(indices16.begin(), indices16.end());
+			indices16.clear();
+			largeIndices = true;
+		}
+		
+		if(largeIndices)
+			indices32.push_back(index);
+		else
+			indices16.push_back(index);
+	}
+	
+	void Mesh::compactIndices() {
+		if(!largeIndices || getStreamVertexCount() > 65536)
+			return;
+		indices16.assign(indices32.begin(), indices32.end());
+		indices32.clear();
+		largeIndices = false;
+	}
+	
+	unsigned int Mesh::getStreamVertexCount() {
+		return vertexStream.size() / VERTEX_STREAM_STRIDE;
+	}
+	
+	unsigned int Mesh::getIndexCount() {
+		if(largeIndices)
+			return indices32.size();
+		return indices16.size();
+	}
+	
+	unsigned int Mesh::getIndex(unsigned int i) {
+		if(largeIndices)
+			return indices32[i];
+		return indices16[i];
+	}
+	
+	void *Mesh::getIndexData() {
+		if(getIndexCount() == 0)
+			return NULL;
+		if(largeIndices)
+			return &indices32[0];
+		return &indices16[0];
+	}
+	
+	float *Mesh::getVertexStream() {
+		if(vertexStream.size() == 0)
+			return NULL;
+		return &vertexStream[0];
+	}
+	
+	unsigned int *Mesh::getBoneIDStream() {
+		if(boneIDStream.size() == 0)
+			return NULL;
+		return &boneIDStream[0];
+	}
+	
+	float *Mesh::getBoneWeightStream() {
+		if(boneWeightStream.size() == 0)
+			return NULL;
+		return &boneWeightStream[0];
+	}
+	
+	unsigned int Mesh::hashStreamVertex(unsigned int index) {
+		// FNV-1a over the raw vertex data
+		unsigned int hash = 2166136261U;
+		const unsigned char *data = (const unsigned char*)&vertexStream[index * VERTEX_STREAM_STRIDE];
+		for(int i=0; i < sizeof(float) * VERTEX_STREAM_STRIDE; i++) {
+			hash = (hash ^ data[i]) * 16777619U;
+		}
+		if(hasBoneStream()) {
+			data = (const unsigned char*)&boneIDStream[index * MAX_BONE_ASSIGNMENTS];
+			for(int i=0; i < sizeof(unsigned int) * MAX_BONE_ASSIGNMENTS; i++) {
+				hash = (hash ^ data[i]) * 16777619U;
+			}
+		}
+		return hash;
+	}
+	
+	bool Mesh::streamVerticesEqual(unsigned int a, unsigned int b) {
+		if(memcmp(&vertexStream[a * VERTEX_STREAM_STRIDE], &vertexStream[b * VERTEX_STREAM_STRIDE], sizeof(float) * VERTEX_STREAM_STRIDE) != 0)
+			return false;
+		if(hasBoneStream()) {
+			if(memcmp(&boneIDStream[a * MAX_BONE_ASSIGNMENTS], &boneIDStream[b * MAX_BONE_ASSIGNMENTS], sizeof(unsigned int) * MAX_BONE_ASSIGNMENTS) != 0)
+				return false;
+			if(memcmp(&boneWeightStream[a * MAX_BONE_ASSIGNMENTS], &boneWeightStream[b * MAX_BONE_ASSIGNMENTS], sizeof(float) * MAX_BONE_ASSIGNMENTS) != 0)
+				return false;
+		}
+		return true;
+	}
+	
+	void Mesh::copyStreamVertex(unsigned int from, unsigned int to) {
+		memcpy(&vertexStream[to * VERTEX_STREAM_STRIDE], &vertexStream[from * VERTEX_STREAM_STRIDE], sizeof(float) * VERTEX_STREAM_STRIDE);
+		if(hasBoneStream()) {
+			memcpy(&boneIDStream[to * MAX_BONE_ASSIGNMENTS], &boneIDStream[from * MAX_BONE_ASSIGNMENTS], sizeof(unsigned int) * MAX_BONE_ASSIGNMENTS);
+			memcpy(&boneWeightStream[to * MAX_BONE_ASSIGNMENTS], &boneWeightStream[from * MAX_BONE_ASSIGNMENTS], sizeof(float) * MAX_BONE_ASSIGNMENTS);
+		}
+	}
+	
+	void Mesh::weldVertices() {
+		commitPolygonView();
+		
+		unsigned int vertexCount = getStreamVertexCount();
+		if(vertexCount == 0)
+			return;
+		
+		unsigned int tableSize = 1;
+		while(tableSize < vertexCount * 2)
+			tableSize <<= 1;
+		
+		// buckets and chains hold indices of already welded vertices, which are compacted to the front of the stream
+		vector<int> buckets(tableSize, -1);
+		vector<int> chain(vertexCount, -1);
+		vector<unsigned int> remap(vertexCount);
+		unsigned int uniqueCount = 0;
+		
+		for(unsigned int i=0; i < vertexCount; i++) {
+			unsigned int bucket = hashStreamVertex(i) & (tableSize-1);
+			int match = -1;
+			for(int c = buckets[bucket]; c != -1; c = chain[c]) {
+				if(streamVerticesEqual(c, i)) {
+					match = c;
+					break;
+				}
+			}
+			
+			if(match == -1) {
+				if(uniqueCount != i)
+					copyStreamVertex(i, uniqueCount);
+				chain[uniqueCount] = buckets[bucket];
+				buckets[bucket] = uniqueCount;
+				remap[i] = uniqueCount;
+				uniqueCount++;
+			} else {
+				remap[i] = match;
+			}
+		}
+		
+		vertexStream.resize(uniqueCount * VERTEX_STREAM_STRIDE);
+		if(hasBoneStream()) {
+			boneIDStream.resize(uniqueCount * MAX_BONE_ASSIGNMENTS);
+			boneWeightStream.resize(uniqueCount * MAX_BONE_ASSIGNMENTS);
+		}
+		
+		for(int i=0; i < indices16.size(); i++) {
+			indices16[i] = remap[indices16[i]];
+		}
+		for(int i=0; i < indices32.size(); i++) {
+			indices32[i] = remap[indices32[i]];
+		}
+		compactIndices();
+		
+		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
+		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+		arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
+	}
 }
\ No newline at end of file
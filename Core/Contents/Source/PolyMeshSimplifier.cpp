@@ -0,0 +1,518 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyMeshSimplifier.h"
+#include "PolyLogger.h"
+#include <algorithm>
+#include <iterator>
+
+using namespace Polycode;
+
+// orders stream vertices by position, so equal positions end up next to each other
+class MeshSimplifierPositionLess {
+	public:
+		MeshSimplifierPositionLess(const float *vertices) : vertices(vertices) {}
+		
+		bool operator()(unsigned int a, unsigned int b) const {
+			const float *pa = vertices + (a * Mesh::VERTEX_STREAM_STRIDE) + Mesh::VERTEX_STREAM_POSITION_OFFSET;
+			const float *pb = vertices + (b * Mesh::VERTEX_STREAM_STRIDE) + Mesh::VERTEX_STREAM_POSITION_OFFSET;
+			if(pa[0] != pb[0])
+				return pa[0] < pb[0];
+			if(pa[1] != pb[1])
+				return pa[1] < pb[1];
+			return pa[2] < pb[2];
+		}
+		
+		const float *vertices;
+};
+
+MeshSimplifier::MeshSimplifier(Mesh *mesh) {
+	maxError = 0;
+	borderWeight = 10;
+	error = 0;
+	numTriangles = 0;
+	valid = false;
+	
+	int meshType = mesh->getMeshType();
+	if(meshType != Mesh::TRI_MESH && meshType != Mesh::QUAD_MESH) {
+		Logger::log("Only triangle and quad meshes can be simplified.\n");
+		return;
+	}
+	
+	// weld a temporary indexed copy, so the faces share their vertices. Indexed meshes can be
+	// unwelded as well (v2 mesh files store one vertex per polygon corner), and every unshared
+	// vertex would count as a seam and never collapse.
+	Mesh *indexedMesh = new Mesh(meshType);
+	indexedMesh->useIndexedStorage(true);
+	if(mesh->isIndexed()) {
+		mesh->commitPolygonView();
+		float *stream = mesh->getVertexStream();
+		for(unsigned int i=0; i < mesh->getStreamVertexCount(); i++) {
+			float *v = stream + (i * Mesh::VERTEX_STREAM_STRIDE);
+			float *n = v + Mesh::VERTEX_STREAM_NORMAL_OFFSET;
+			float *c = v + Mesh::VERTEX_STREAM_COLOR_OFFSET;
+			float *t = v + Mesh::VERTEX_STREAM_TEXCOORD_OFFSET;
+			indexedMesh->addStreamVertex(Vector3(v[0], v[1], v[2]), Vector3(n[0], n[1], n[2]), Color(c[0], c[1], c[2], c[3]), Vector2(t[0], t[1]));
+			if(mesh->hasBoneStream()) {
+				for(int slot=0; slot < Mesh::MAX_BONE_ASSIGNMENTS; slot++) {
+					unsigned int b = (i * Mesh::MAX_BONE_ASSIGNMENTS) + slot;
+					if(mesh->getBoneWeightStream()[b] > 0)
+						indexedMesh->setStreamBoneAssignment(i, slot, mesh->getBoneIDStream()[b], mesh->getBoneWeightStream()[b]);
+				}
+			}
+		}
+		for(unsigned int i=0; i < mesh->getIndexCount(); i++) {
+			indexedMesh->addIndex(mesh->getIndex(i));
+		}
+	} else {
+		int faceSize = (meshType == Mesh::QUAD_MESH) ? 4 : 3;
+		for(int i=0; i < mesh->getPolygonCount(); i++) {
+			Polygon *polygon = mesh->getPolygon(i);
+			if(polygon->getVertexCount() != faceSize)
+				continue;
+			for(int j=0; j < faceSize; j++) {
+				Vertex *vertex = polygon->getVertex(j);
+				Vector3 normal = polygon->useVertexNormals ? vertex->normal : polygon->getFaceNormal();
+				unsigned int index = indexedMesh->addStreamVertex(*vertex, normal, vertex->vertexColor, vertex->getTexCoord());
+				unsigned int boneIDs[Mesh::MAX_BONE_ASSIGNMENTS];
+				float boneWeights[Mesh::MAX_BONE_ASSIGNMENTS];
+				int numAssignments = Mesh::selectBoneAssignments(vertex, boneIDs, boneWeights);
+				for(int slot=0; slot < numAssignments; slot++) {
+					indexedMesh->setStreamBoneAssignment(index, slot, boneIDs[slot], boneWeights[slot]);
+				}
+				indexedMesh->addIndex(index);
+			}
+		}
+	}
+	indexedMesh->weldVertices();
+	addStreamData(indexedMesh);
+	delete indexedMesh;
+	
+	buildPositionIDs();
+	
+	// drop faces that are already degenerate
+	for(int t=0; t < triangleRemoved.size(); t++) {
+		unsigned int p0 = positionIDs[triangles[t*3]];
+		unsigned int p1 = positionIDs[triangles[(t*3)+1]];
+		unsigned int p2 = positionIDs[triangles[(t*3)+2]];
+		if(p0 == p1 || p1 == p2 || p0 == p2) {
+			triangleRemoved[t] = true;
+			numTriangles--;
+		}
+	}
+	removeCollapsedTriangles();
+	
+	buildQuadrics();
+	valid = true;
+}
+
+MeshSimplifier::~MeshSimplifier() {
+
+}
+
+void MeshSimplifier::addStreamData(Mesh *mesh) {
+	unsigned int numVertices = mesh->getStreamVertexCount();
+	float *stream = mesh->getVertexStream();
+	if(stream)
+		vertices.assign(stream, stream + (numVertices * Mesh::VERTEX_STREAM_STRIDE));
+	
+	if(mesh->hasBoneStream()) {
+		boneIDs.assign(mesh->getBoneIDStream(), mesh->getBoneIDStream() + (numVertices * Mesh::MAX_BONE_ASSIGNMENTS));
+		boneWeights.assign(mesh->getBoneWeightStream(), mesh->getBoneWeightStream() + (numVertices * Mesh::MAX_BONE_ASSIGNMENTS));
+	}
+	
+	int faceSize = (mesh->getMeshType() == Mesh::QUAD_MESH) ? 4 : 3;
+	unsigned int numFaces = mesh->getIndexCount() / faceSize;
+	for(unsigned int f=0; f < numFaces; f++) {
+		unsigned int first = f * faceSize;
+		triangles.push_back(mesh->getIndex(first));
+		triangles.push_back(mesh->getIndex(first+1));
+		triangles.push_back(mesh->getIndex(first+2));
+		if(faceSize == 4) {
+			triangles.push_back(mesh->getIndex(first));
+			triangles.push_back(mesh->getIndex(first+2));
+			triangles.push_back(mesh->getIndex(first+3));
+		}
+	}
+	numTriangles = triangles.size() / 3;
+	triangleRemoved.assign(numTriangles, false);
+}
+
+void MeshSimplifier::buildPositionIDs() {
+	unsigned int numVertices = vertices.size() / Mesh::VERTEX_STREAM_STRIDE;
+	vector<unsigned int> order(numVertices);
+	for(unsigned int i=0; i < numVertices; i++) {
+		order[i] = i;
+	}
+	
+	positionIDs.assign(numVertices, 0);
+	positionVertexCounts.clear();
+	if(numVertices == 0)
+		return;
+	
+	MeshSimplifierPositionLess positionLess(&vertices[0]);
+	std::sort(order.begin(), order.end(), positionLess);
+	
+	unsigned int positionID = 0;
+	positionVertexCounts.push_back(0);
+	for(unsigned int i=0; i < numVertices; i++) {
+		if(i > 0 && positionLess(order[i-1], order[i])) {
+			positionID++;
+			positionVertexCounts.push_back(0);
+		}
+		positionIDs[order[i]] = positionID;
+		positionVertexCounts[positionID]++;
+	}
+}
+
+void MeshSimplifier::addPlaneQuadric(unsigned int position, double a, double b, double c, double d, double weight) {
+	double *q = &quadrics[position * 10];
+	q[0] += a*a*weight;
+	q[1] += a*b*weight;
+	q[2] += a*c*weight;
+	q[3] += a*d*weight;
+	q[4] += b*b*weight;
+	q[5] += b*c*weight;
+	q[6] += b*d*weight;
+	q[7] += c*c*weight;
+	q[8] += c*d*weight;
+	q[9] += d*d*weight;
+}
+
+void MeshSimplifier::buildQuadrics() {
+	quadrics.assign(positionVertexCounts.size() * 10, 0.0);
+	
+	// edges by position, an edge used by a single triangle is on an open border
+	vector<unsigned long long> edges;
+	vector<unsigned int> edgeTriangles;
+	
+	for(unsigned int t=0; t < numTriangles; t++) {
+		const float *p[3];
+		for(int k=0; k < 3; k++) {
+			p[k] = &vertices[triangles[(t*3)+k] * Mesh::VERTEX_STREAM_STRIDE];
+		}
+		Vector3 normal = (Vector3(p[1][0], p[1][1], p[1][2]) - Vector3(p[0][0], p[0][1], p[0][2])).crossProduct(Vector3(p[2][0], p[2][1], p[2][2]) - Vector3(p[0][0], p[0][1], p[0][2]));
+		if(normal.length() == 0)
+			continue;
+		normal.Normalize();
+		double d = -((normal.x * p[0][0]) + (normal.y * p[0][1]) + (normal.z * p[0][2]));
+		for(int k=0; k < 3; k++) {
+			addPlaneQuadric(positionIDs[triangles[(t*3)+k]], normal.x, normal.y, normal.z, d, 1.0);
+			
+			unsigned long long a = positionIDs[triangles[(t*3)+k]];
+			unsigned long long b = positionIDs[triangles[(t*3)+((k+1)%3)]];
+			edges.push_back((a < b) ? ((a << 32) | b) : ((b << 32) | a));
+			edgeTriangles.push_back((t*3)+k);
+		}
+	}
+	
+	vector<unsigned int> edgeOrder(edges.size());
+	for(unsigned int i=0; i < edges.size(); i++) {
+		edgeOrder[i] = i;
+	}
+	vector<unsigned long long> sortedEdges = edges;
+	std::sort(sortedEdges.begin(), sortedEdges.end());
+	
+	for(unsigned int i=0; i < edges.size(); i++) {
+		std::pair<vector<unsigned long long>::iterator, vector<unsigned long long>::iterator> range = std::equal_range(sortedEdges.begin(), sortedEdges.end(), edges[i]);
+		if(range.second - range.first != 1)
+			continue;
+		
+		// a plane through the border edge, perpendicular to its triangle
+		unsigned int t = edgeTriangles[i] / 3;
+		unsigned int k = edgeTriangles[i] % 3;
+		const float *pa = &vertices[triangles[(t*3)+k] * Mesh::VERTEX_STREAM_STRIDE];
+		const float *pb = &vertices[triangles[(t*3)+((k+1)%3)] * Mesh::VERTEX_STREAM_STRIDE];
+		const float *pc = &vertices[triangles[(t*3)+((k+2)%3)] * Mesh::VERTEX_STREAM_STRIDE];
+		Vector3 edge = Vector3(pb[0], pb[1], pb[2]) - Vector3(pa[0], pa[1], pa[2]);
+		Vector3 normal = edge.crossProduct(Vector3(pc[0], pc[1], pc[2]) - Vector3(pa[0], pa[1], pa[2]));
+		Vector3 borderNormal = edge.crossProduct(normal);
+		if(borderNormal.length() == 0)
+			continue;
+		borderNormal.Normalize();
+		double d = -((borderNormal.x * pa[0]) + (borderNormal.y * pa[1]) + (borderNormal.z * pa[2]));
+		addPlaneQuadric(positionIDs[triangles[(t*3)+k]], borderNormal.x, borderNormal.y, borderNormal.z, d, borderWeight);
+		addPlaneQuadric(positionIDs[triangles[(t*3)+((k+1)%3)]], borderNormal.x, borderNormal.y, borderNormal.z, d, borderWeight);
+	}
+}
+
+double MeshSimplifier::evaluateQuadric(unsigned int positionA, unsigned int positionB, unsigned int vertex) {
+	const double *qa = &quadrics[positionA * 10];
+	const double *qb = &quadrics[positionB * 10];
+	double q[10];
+	for(int i=0; i < 10; i++) {
+		q[i] = qa[i] + qb[i];
+	}
+	
+	const float *p = &vertices[vertex * Mesh::VERTEX_STREAM_STRIDE];
+	double x = p[0];
+	double y = p[1];
+	double z = p[2];
+	return (q[0]*x*x) + (2*q[1]*x*y) + (2*q[2]*x*z) + (2*q[3]*x) + (q[4]*y*y) + (2*q[5]*y*z) + (2*q[6]*y) + (q[7]*z*z) + (2*q[8]*z) + q[9];
+}
+
+int MeshSimplifier::getDominantBone(unsigned int vertex) {
+	if(boneWeights.size() == 0)
+		return -1;
+	
+	int bone = -1;
+	float bestWeight = 0;
+	for(int b=0; b < Mesh::MAX_BONE_ASSIGNMENTS; b++) {
+		float weight = boneWeights[(vertex * Mesh::MAX_BONE_ASSIGNMENTS) + b];
+		if(weight > bestWeight) {
+			bestWeight = weight;
+			bone = boneIDs[(vertex * Mesh::MAX_BONE_ASSIGNMENTS) + b];
+		}
+	}
+	return bone;
+}
+
+void MeshSimplifier::buildAdjacency() {
+	unsigned int numPositions = positionVertexCounts.size();
+	adjacencyStart.assign(numPositions + 1, 0);
+	for(unsigned int i=0; i < triangles.size(); i++) {
+		adjacencyStart[positionIDs[triangles[i]] + 1]++;
+	}
+	for(unsigned int p=0; p < numPositions; p++) {
+		adjacencyStart[p+1] += adjacencyStart[p];
+	}
+	
+	adjacency.resize(triangles.size());
+	vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for(unsigned int i=0; i < triangles.size(); i++) {
+		adjacency[fill[positionIDs[triangles[i]]]++] = i / 3;
+	}
+}
+
+bool MeshSimplifier::canCollapse(unsigned int from, unsigned int to) {
+	unsigned int fromPosition = positionIDs[from];
+	unsigned int toPosition = positionIDs[to];
+	const float *target = &vertices[to * Mesh::VERTEX_STREAM_STRIDE];
+	
+	vector<unsigned int> fromNeighbours;
+	vector<unsigned int> toNeighbours;
+	unsigned int sharedTriangles = 0;
+	
+	for(unsigned int a=adjacencyStart[fromPosition]; a < adjacencyStart[fromPosition+1]; a++) {
+		unsigned int t = adjacency[a];
+		if(triangleRemoved[t])
+			continue;
+		
+		bool hasTo = false;
+		for(int k=0; k < 3; k++) {
+			unsigned int position = positionIDs[triangles[(t*3)+k]];
+			if(position == toPosition)
+				hasTo = true;
+			if(position != fromPosition)
+				fromNeighbours.push_back(position);
+		}
+		
+		if(hasTo) {
+			sharedTriangles++;
+			continue;
+		}
+		
+		// the triangle must not turn by more than 60 degrees when its corner moves, larger turns would let
+		// a few collapses in a row flip it
+		Vector3 before[3];
+		Vector3 after[3];
+		for(int k=0; k < 3; k++) {
+			const float *p = &vertices[triangles[(t*3)+k] * Mesh::VERTEX_STREAM_STRIDE];
+			before[k] = Vector3(p[0], p[1], p[2]);
+			after[k] = (triangles[(t*3)+k] == from) ? Vector3(target[0], target[1], target[2]) : before[k];
+		}
+		Vector3 normalBefore = (before[1] - before[0]).crossProduct(before[2] - before[0]);
+		Vector3 normalAfter = (after[1] - after[0]).crossProduct(after[2] - after[0]);
+		if(normalBefore.dot(normalAfter) <= 0.5 * normalBefore.length() * normalAfter.length())
+			return false;
+	}
+	
+	for(unsigned int a=adjacencyStart[toPosition]; a < adjacencyStart[toPosition+1]; a++) {
+		unsigned int t = adjacency[a];
+		if(triangleRemoved[t])
+			continue;
+		for(int k=0; k < 3; k++) {
+			unsigned int position = positionIDs[triangles[(t*3)+k]];
+			if(position != toPosition)
+				toNeighbours.push_back(position);
+		}
+	}
+	
+	// the two ends may only share the neighbours of the triangles on the edge, otherwise the collapse pinches the surface
+	std::sort(fromNeighbours.begin(), fromNeighbours.end());
+	fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+	std::sort(toNeighbours.begin(), toNeighbours.end());
+	toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+	
+	vector<unsigned int> commonNeighbours;
+	std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(), std::back_inserter(commonNeighbours));
+	return (commonNeighbours.size() <= sharedTriangles);
+}
+
+void MeshSimplifier::collapse(unsigned int from, unsigned int to) {
+	unsigned int fromPosition = positionIDs[from];
+	unsigned int toPosition = positionIDs[to];
+	
+	for(unsigned int a=adjacencyStart[fromPosition]; a < adjacencyStart[fromPosition+1]; a++) {
+		unsigned int t = adjacency[a];
+		if(triangleRemoved[t])
+			continue;
+		
+		unsigned int *triangle = &triangles[t*3];
+		for(int k=0; k < 3; k++) {
+			if(triangle[k] == from)
+				triangle[k] = to;
+			positionLocked[positionIDs[triangle[k]]] = true;
+		}
+		
+		unsigned int p0 = positionIDs[triangle[0]];
+		unsigned int p1 = positionIDs[triangle[1]];
+		unsigned int p2 = positionIDs[triangle[2]];
+		if(p0 == p1 || p1 == p2 || p0 == p2) {
+			triangleRemoved[t] = true;
+			numTriangles--;
+		}
+	}
+	
+	for(int i=0; i < 10; i++) {
+		quadrics[(toPosition * 10) + i] += quadrics[(fromPosition * 10) + i];
+	}
+	positionLocked[fromPosition] = true;
+	positionLocked[toPosition] = true;
+}
+
+void MeshSimplifier::removeCollapsedTriangles() {
+	unsigned int live = 0;
+	for(unsigned int t=0; t < triangleRemoved.size(); t++) {
+		if(triangleRemoved[t])
+			continue;
+		for(int k=0; k < 3; k++) {
+			triangles[(live*3)+k] = triangles[(t*3)+k];
+		}
+		live++;
+	}
+	triangles.resize(live*3);
+	triangleRemoved.assign(live, false);
+	numTriangles = live;
+}
+
+bool MeshSimplifier::simplifyPass(unsigned int targetTriangles) {
+	buildAdjacency();
+	positionLocked.assign(positionVertexCounts.size(), false);
+	bool skinned = (boneWeights.size() > 0);
+	
+	vector<Collapse> collapses;
+	for(unsigned int i=0; i < triangles.size(); i++) {
+		unsigned int a = triangles[i];
+		unsigned int b = triangles[((i/3)*3) + ((i+1)%3)];
+		for(int direction=0; direction < 2; direction++) {
+			Collapse collapse;
+			collapse.from = direction ? b : a;
+			collapse.to = direction ? a : b;
+			unsigned int fromPosition = positionIDs[collapse.from];
+			unsigned int toPosition = positionIDs[collapse.to];
+			
+			// seam vertices have several stream vertices that would all have to move
+			if(positionVertexCounts[fromPosition] > 1)
+				continue;
+			if(skinned && getDominantBone(collapse.from) != getDominantBone(collapse.to))
+				continue;
+			
+			collapse.cost = evaluateQuadric(fromPosition, toPosition, collapse.to);
+			if(maxError > 0 && collapse.cost > maxError)
+				continue;
+			collapses.push_back(collapse);
+		}
+	}
+	if(collapses.size() == 0)
+		return false;
+	
+	std::sort(collapses.begin(), collapses.end());
+	
+	// a collapse removes about two triangles; only taking the cheapest collapses needed lets
+	// the next pass see the errors updated by this one
+	unsigned int neededCollapses = ((numTriangles - targetTriangles) / 2) + 1;
+	double costLimit = collapses[std::min((unsigned int)collapses.size()-1, neededCollapses*2)].cost;
+	
+	bool progress = false;
+	for(int attempt=0; attempt < 2 && !progress; attempt++) {
+		for(unsigned int i=0; i < collapses.size() && numTriangles > targetTriangles; i++) {
+			Collapse &collapse = collapses[i];
+			if(attempt == 0 && collapse.cost > costLimit)
+				break;
+			if(positionLocked[positionIDs[collapse.from]] || positionLocked[positionIDs[collapse.to]])
+				continue;
+			if(!canCollapse(collapse.from, collapse.to))
+				continue;
+			
+			this->collapse(collapse.from, collapse.to);
+			error = std::max(error, collapse.cost);
+			progress = true;
+		}
+	}
+	
+	removeCollapsedTriangles();
+	return progress;
+}
+
+Mesh *MeshSimplifier::simplify(unsigned int targetTriangles) {
+	if(!valid)
+		return NULL;
+	
+	while(numTriangles > targetTriangles) {
+		if(!simplifyPass(targetTriangles))
+			break;
+	}
+	
+	Mesh *result = new Mesh(Mesh::TRI_MESH);
+	result->useIndexedStorage(true);
+	
+	vector<int> remap(vertices.size() / Mesh::VERTEX_STREAM_STRIDE, -1);
+	for(unsigned int i=0; i < triangles.size(); i++) {
+		unsigned int vertex = triangles[i];
+		if(remap[vertex] == -1) {
+			const float *v = &vertices[vertex * Mesh::VERTEX_STREAM_STRIDE];
+			const float *n = v + Mesh::VERTEX_STREAM_NORMAL_OFFSET;
+			const float *c = v + Mesh::VERTEX_STREAM_COLOR_OFFSET;
+			const float *t = v + Mesh::VERTEX_STREAM_TEXCOORD_OFFSET;
+			remap[vertex] = result->addStreamVertex(Vector3(v[0], v[1], v[2]), Vector3(n[0], n[1], n[2]), Color(c[0], c[1], c[2], c[3]), Vector2(t[0], t[1]));
+			
+			if(boneWeights.size() > 0) {
+				for(int b=0; b < Mesh::MAX_BONE_ASSIGNMENTS; b++) {
+					float weight = boneWeights[(vertex * Mesh::MAX_BONE_ASSIGNMENTS) + b];
+					if(weight > 0)
+						result->setStreamBoneAssignment(remap[vertex], b, boneIDs[(vertex * Mesh::MAX_BONE_ASSIGNMENTS) + b], weight);
+				}
+			}
+		}
+		result->addIndex(remap[vertex]);
+	}
+	return result;
+}
+
+unsigned int MeshSimplifier::getTriangleCount() {
+	return numTriangles;
+}
+
+Number MeshSimplifier::getError() {
+	return error;
+}
@@ -0,0 +1,560 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyNullRenderer.h"
+
+using namespace Polycode;
+
+NullTexture::NullTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, int type) : Texture(width, height, textureData, clamp, type) {
+
+}
+
+NullTexture::~NullTexture() {
+
+}
+
+void NullTexture::setTextureData(char *data) {
+	memcpy(textureData, data, width*height*pixelSize);
+}
+
+void NullTexture::recreateFromImageData() {
+
+}
+
+NullVertexBuffer::NullVertexBuffer(Mesh *mesh) : VertexBuffer() {
+	meshType = mesh->getMeshType();
+	vertexCount = mesh->getVertexCount();
+	verticesPerFace = 0;
+	if(mesh->getPolygonCount() > 0)
+		verticesPerFace = vertexCount / mesh->getPolygonCount();
+}
+
+NullVertexBuffer::~NullVertexBuffer() {
+
+}
+
+RenderFrameStats::RenderFrameStats() {
+	reset();
+}
+
+void RenderFrameStats::reset() {
+	drawCalls = 0;
+	verticesSubmitted = 0;
+	textureBinds = 0;
+	textureCalls = 0;
+	blendChanges = 0;
+	blendCalls = 0;
+	depthChanges = 0;
+	depthCalls = 0;
+	cullChanges = 0;
+	cullCalls = 0;
+	alphaTestChanges = 0;
+	alphaTestCalls = 0;
+	matrixPushes = 0;
+	materialChanges = 0;
+}
+
+NullRenderer::NullRenderer() : Renderer() {
+	verticesToDraw = 0;
+	indicesToDraw = 0;
+	frameCount = 0;
+	recordCommands = true;
+	
+	blendingMode = -1;
+	depthFunction = -1;
+	depthTestEnabled = false;
+	depthWriteEnabled = true;
+	backfaceCullingEnabled = false;
+	alphaTestEnabled = false;
+}
+
+NullRenderer::~NullRenderer() {
+
+}
+
+void NullRenderer::recordCommand(int type, int value) {
+	if(recordCommands)
+		commands.push_back(RenderCommand(type, value));
+}
+
+void NullRenderer::setCommandRecording(bool val) {
+	recordCommands = val;
+	if(!val)
+		commands.clear();
+}
+
+void NullRenderer::Resize(int xRes, int yRes) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	viewportWidth = xRes;
+	viewportHeight = yRes;
+	setPerspectiveProjection(fov, (Number)xRes/(Number)yRes);
+	setBlendingMode(BLEND_MODE_NORMAL);
+	setDepthFunction(DEPTH_FUNCTION_LEQUAL);
+	enableDepthTest(true);
+}
+
+void NullRenderer::BeginRender() {
+	currentStats.reset();
+	commands.clear();
+	modelviewMatrix.identity();
+	modelviewStack.clear();
+	currentTexture = NULL;
+	recordCommand(RenderCommand::COMMAND_CLEAR, 3);
+}
+
+void NullRenderer::EndRender() {
+	frameStats = currentStats;
+	frameCount++;
+}
+
+Cubemap *NullRenderer::createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) {
+	return new Cubemap(t0,t1,t2,t3,t4,t5);
+}
+
+Texture *NullRenderer::createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, int type) {
+	return new NullTexture(width, height, textureData, clamp, type);
+}
+
+void NullRenderer::createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height) {
+	if(colorBuffer)
+		*colorBuffer = new NullTexture(width, height, NULL, true, Image::IMAGE_RGBA);
+	if(depthBuffer)
+		*depthBuffer = new NullTexture(width, height, NULL, true, Image::IMAGE_RGBA);
+}
+
+Texture *NullRenderer::createFramebufferTexture(unsigned int width, unsigned int height) {
+	return new NullTexture(width, height, NULL, true, Image::IMAGE_RGBA);
+}
+
+void NullRenderer::bindFrameBufferTexture(Texture *texture) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	currentFrameBufferTexture = texture;
+	recordCommand(RenderCommand::COMMAND_BIND_FRAMEBUFFER, 1);
+	recordCommand(RenderCommand::COMMAND_CLEAR, 3);
+}
+
+void NullRenderer::unbindFramebuffers() {
+	currentFrameBufferTexture = NULL;
+	recordCommand(RenderCommand::COMMAND_BIND_FRAMEBUFFER, 0);
+	if(previousFrameBufferTexture) {
+		bindFrameBufferTexture(previousFrameBufferTexture);
+		previousFrameBufferTexture = NULL;
+	}
+}
+
+void NullRenderer::renderToTexture(Texture *targetTexture) {
+
+}
+
+void NullRenderer::renderZBufferToTexture(Texture *targetTexture) {
+
+}
+
+void NullRenderer::setViewportSize(int w, int h, Number fov) {
+	viewportWidth = w;
+	viewportHeight = h;
+	setPerspectiveProjection(fov, (Number)w/(Number)h);
+}
+
+void NullRenderer::loadIdentity() {
+	modelviewMatrix.identity();
+}
+
+void NullRenderer::setOrthoMode(Number xSize, Number ySize) {
+	if(xSize == 0)
+		xSize = xRes;
+
+	if(ySize == 0)
+		ySize = yRes;
+	
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(!orthoMode) {
+		enableBackfaceCulling(false);
+		projectionStack.push_back(projectionMatrix);
+		setOrthoProjection(0.0f, xSize, ySize, 0.0f, -1.0f, 1.0f);
+		orthoMode = true;
+		recordCommand(RenderCommand::COMMAND_SET_ORTHO_MODE, 0);
+	}
+	modelviewMatrix.identity();
+}
+
+void NullRenderer::_setOrthoMode() {
+	if(!orthoMode) {
+		projectionStack.push_back(projectionMatrix);
+		setOrthoProjection(-1.0f, 1.0f, -1.0f, 1.0f, nearPlane, farPlane);
+		orthoMode = true;
+		recordCommand(RenderCommand::COMMAND_SET_ORTHO_MODE, 0);
+	}
+	modelviewMatrix.identity();
+}
+
+void NullRenderer::setPerspectiveMode() {
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(orthoMode) {
+		enableDepthTest(true);
+		enableBackfaceCulling(true);
+		if(projectionStack.size() > 0) {
+			projectionMatrix = projectionStack.back();
+			projectionStack.pop_back();
+		}
+		orthoMode = false;
+		recordCommand(RenderCommand::COMMAND_SET_PERSPECTIVE_MODE, 0);
+	}
+	modelviewMatrix.identity();
+	currentTexture = NULL;
+}
+
+void NullRenderer::setTexture(Texture *texture) {
+	currentStats.textureCalls++;
+	if(texture == NULL) {
+		return;
+	}
+	
+	// regions of the same atlas page share one bind
+	if(renderMode == RENDER_MODE_NORMAL && (currentTexture == NULL || currentTexture->getPageTexture() != texture->getPageTexture())) {
+		currentStats.textureBinds++;
+		recordCommand(RenderCommand::COMMAND_BIND_TEXTURE, 0);
+	}
+	currentTexture = texture;
+}
+
+void NullRenderer::enableBackfaceCulling(bool val) {
+	currentStats.cullCalls++;
+	if(val != backfaceCullingEnabled) {
+		backfaceCullingEnabled = val;
+		currentStats.cullChanges++;
+		recordCommand(RenderCommand::COMMAND_BACKFACE_CULLING, val);
+	}
+}
+
+void NullRenderer::cullFrontFaces(bool val) {
+	currentStats.cullCalls++;
+	if(val != cullingFrontFaces) {
+		cullingFrontFaces = val;
+		currentStats.cullChanges++;
+		recordCommand(RenderCommand::COMMAND_CULL_FRONT_FACES, val);
+	}
+}
+
+void NullRenderer::setClearColor(Number r, Number g, Number b) {
+	clearColor.setColor(r,g,b,1.0f);
+}
+
+void NullRenderer::clearScreen() {
+	recordCommand(RenderCommand::COMMAND_CLEAR, 3);
+}
+
+void NullRenderer::clearBuffer(bool colorBuffer, bool depthBuffer) {
+	int mask = 0;
+	if(colorBuffer)
+		mask = mask | 1;
+	if(depthBuffer)
+		mask = mask | 2;
+	recordCommand(RenderCommand::COMMAND_CLEAR, mask);
+}
+
+void NullRenderer::translate2D(Number x, Number y) {
+	translate3D(x, y, 0.0f);
+}
+
+void NullRenderer::rotate2D(Number angle) {
+	Number c = cos(angle * TORADIANS);
+	Number s = sin(angle * TORADIANS);
+	Matrix4 rotation;
+	rotation.m[0][0] = c;
+	rotation.m[0][1] = s;
+	rotation.m[1][0] = -s;
+	rotation.m[1][1] = c;
+	modelviewMatrix = rotation * modelviewMatrix;
+}
+
+void NullRenderer::scale2D(Vector2 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.m[0][0] = scale->x;
+	scaleMatrix.m[1][1] = scale->y;
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
+}
+
+void NullRenderer::setFOV(Number fov) {
+	this->fov = fov;
+	setPerspectiveProjection(fov, (Number)xRes/(Number)yRes);
+}
+
+void NullRenderer::setVertexColor(Number r, Number g, Number b, Number a) {
+
+}
+
+void NullRenderer::pushRenderDataArray(RenderDataArray *array) {
+	switch(array->arrayType) {
+		case RenderDataArray::VERTEX_DATA_ARRAY:
+			verticesToDraw = array->count;
+		break;
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			indicesToDraw = array->count;
+		break;
+	}
+}
+
+void NullRenderer::pushInterleavedRenderDataArray(RenderDataArray *array, bool useColors) {
+	verticesToDraw = array->count;
+}
+
+RenderDataArray *NullRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
+	RenderDataArray *newArray = createRenderDataArray(arrayType);
+	updateRenderDataArrayForMesh(mesh, newArray);
+	return newArray;
+}
+
+void NullRenderer::updateRenderDataArrayForMesh(Mesh *mesh, RenderDataArray *array) {
+	// nothing is uploaded, so only the element counts are kept
+	if(array->arrayType == RenderDataArray::INDEX_DATA_ARRAY) {
+		array->count = mesh->getIndexCount();
+	} else if(mesh->isIndexed()) {
+		array->count = mesh->getStreamVertexCount();
+	} else {
+		array->count = mesh->getVertexCount();
+	}
+}
+
+RenderDataArray *NullRenderer::createRenderDataArray(int arrayType) {
+	RenderDataArray *newArray = new RenderDataArray();
+	newArray->arrayType = arrayType;
+	newArray->arrayPtr = NULL;
+	newArray->rendererData = NULL;
+	newArray->stride = 0;
+	newArray->count = 0;
+	newArray->size = 0;
+	
+	switch (arrayType) {
+		case RenderDataArray::VERTEX_DATA_ARRAY:
+			newArray->size = 3;
+			break;
+		case RenderDataArray::COLOR_DATA_ARRAY:
+			newArray->size = 4;
+			break;			
+		case RenderDataArray::NORMAL_DATA_ARRAY:
+			newArray->size = 3;
+			break;						
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+			newArray->size = 2;
+			break;
+		case RenderDataArray::INTERLEAVED_DATA_ARRAY:
+			newArray->size = Mesh::VERTEX_STREAM_STRIDE;
+			break;
+		default:
+			break;
+	}
+	return newArray;
+}
+
+void NullRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayData) {
+
+}
+
+void NullRenderer::drawArrays(int drawType) {
+	int count = verticesToDraw;
+	if(indicesToDraw > 0)
+		count = indicesToDraw;
+	
+	currentStats.drawCalls++;
+	currentStats.verticesSubmitted += count;
+	recordCommand(RenderCommand::COMMAND_DRAW_ARRAYS, count);
+	
+	verticesToDraw = 0;
+	indicesToDraw = 0;
+}
+
+void NullRenderer::drawArraysInstanced(int drawType, const Matrix4 *transforms, const Color *colors, unsigned int numInstances) {
+	int count = verticesToDraw;
+	if(indicesToDraw > 0)
+		count = indicesToDraw;
+	
+	currentStats.drawCalls++;
+	currentStats.verticesSubmitted += count * numInstances;
+	recordCommand(RenderCommand::COMMAND_DRAW_ARRAYS_INSTANCED, numInstances);
+	
+	verticesToDraw = 0;
+	indicesToDraw = 0;
+}
+
+void NullRenderer::translate3D(Vector3 *position) {
+	translate3D(position->x, position->y, position->z);
+}
+
+void NullRenderer::translate3D(Number x, Number y, Number z) {
+	Matrix4 translation;
+	translation.setPosition(x, y, z);
+	modelviewMatrix = translation * modelviewMatrix;
+}
+
+void NullRenderer::scale3D(Vector3 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.m[0][0] = scale->x;
+	scaleMatrix.m[1][1] = scale->y;
+	scaleMatrix.m[2][2] = scale->z;
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
+}
+
+void NullRenderer::pushMatrix() {
+	modelviewStack.push_back(modelviewMatrix);
+	currentStats.matrixPushes++;
+	recordCommand(RenderCommand::COMMAND_PUSH_MATRIX, modelviewStack.size());
+}
+
+void NullRenderer::popMatrix() {
+	if(modelviewStack.size() == 0) {
+		Logger::log("NullRenderer: matrix stack underflow\n");
+		return;
+	}
+	modelviewMatrix = modelviewStack.back();
+	modelviewStack.pop_back();
+	recordCommand(RenderCommand::COMMAND_POP_MATRIX, modelviewStack.size());
+}
+
+void NullRenderer::setLineSmooth(bool val) {
+
+}
+
+void NullRenderer::setLineSize(Number lineSize) {
+
+}
+
+void NullRenderer::enableLighting(bool enable) {
+	lightingEnabled = enable;
+}
+
+void NullRenderer::enableFog(bool enable) {
+
+}
+
+void NullRenderer::setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth) {
+
+}
+
+void NullRenderer::multModelviewMatrix(Matrix4 m) {
+	modelviewMatrix = m * modelviewMatrix;
+}
+
+void NullRenderer::setModelviewMatrix(Matrix4 m) {
+	modelviewMatrix = m;
+	recordCommand(RenderCommand::COMMAND_LOAD_MATRIX, 0);
+}
+
+void NullRenderer::setBlendingMode(int blendingMode) {
+	currentStats.blendCalls++;
+	if(blendingMode != this->blendingMode) {
+		this->blendingMode = blendingMode;
+		currentStats.blendChanges++;
+		recordCommand(RenderCommand::COMMAND_SET_BLENDING_MODE, blendingMode);
+	}
+}
+
+void NullRenderer::applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex) {
+	if(!material->getShader(shaderIndex) || !shadersEnabled) {
+		setTexture(NULL);
+		return;
+	}
+	
+	currentStats.materialChanges++;
+	recordCommand(RenderCommand::COMMAND_APPLY_MATERIAL, shaderIndex);
+	
+	if(material->getShader(shaderIndex)->getType() == Shader::FIXED_SHADER) {
+		FixedShaderBinding *fBinding = (FixedShaderBinding*)material->getShaderBinding(shaderIndex);
+		setTexture(fBinding->getDiffuseTexture());
+	} else {
+		currentMaterial = material;
+	}
+}
+
+void NullRenderer::clearShader() {
+	currentMaterial = NULL;
+	recordCommand(RenderCommand::COMMAND_CLEAR_SHADER, 0);
+}
+
+void NullRenderer::setDepthFunction(int depthFunction) {
+	currentStats.depthCalls++;
+	if(depthFunction != this->depthFunction) {
+		this->depthFunction = depthFunction;
+		currentStats.depthChanges++;
+		recordCommand(RenderCommand::COMMAND_DEPTH_FUNCTION, depthFunction);
+	}
+}
+
+void NullRenderer::createVertexBufferForMesh(Mesh *mesh) {
+	mesh->setVertexBuffer(new NullVertexBuffer(mesh));
+}
+
+void NullRenderer::drawVertexBuffer(VertexBuffer *buffer) {
+	currentStats.drawCalls++;
+	currentStats.verticesSubmitted += buffer->getVertexCount();
+	recordCommand(RenderCommand::COMMAND_DRAW_VERTEX_BUFFER, buffer->getVertexCount());
+}
+
+void NullRenderer::enableDepthTest(bool val) {
+	currentStats.depthCalls++;
+	if(val != depthTestEnabled) {
+		depthTestEnabled = val;
+		currentStats.depthChanges++;
+		recordCommand(RenderCommand::COMMAND_DEPTH_TEST, val);
+	}
+}
+
+void NullRenderer::enableDepthWrite(bool val) {
+	currentStats.depthCalls++;
+	if(val != depthWriteEnabled) {
+		depthWriteEnabled = val;
+		currentStats.depthChanges++;
+		recordCommand(RenderCommand::COMMAND_DEPTH_WRITE, val);
+	}
+}
+
+void NullRenderer::enableAlphaTest(bool val) {
+	currentStats.alphaTestCalls++;
+	if(val != alphaTestEnabled) {
+		alphaTestEnabled = val;
+		currentStats.alphaTestChanges++;
+		recordCommand(RenderCommand::COMMAND_ALPHA_TEST, val);
+	}
+}
+
+void NullRenderer::drawToColorBuffer(bool val) {
+
+}
+
+void NullRenderer::drawScreenQuad(Number qx, Number qy) {
+	setOrthoMode();
+	currentStats.drawCalls++;
+	currentStats.verticesSubmitted += 4;
+	recordCommand(RenderCommand::COMMAND_DRAW_ARRAYS, 4);
+	setPerspectiveMode();
+}
+
+bool NullRenderer::test2DCoordinate(Number x, Number y, Polygon *poly, const Matrix4 &matrix, bool billboardMode) {
+	return false;
+}
+
+Vector3 NullRenderer::Unproject(Number x, Number y) {
+	return Vector3(0,0,0);
+}
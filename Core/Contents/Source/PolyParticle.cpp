@@ -21,128 +21,273 @@
 */
 
 #include "PolyParticle.h"
+#include "PolyQuaternion.h"
 
 using namespace Polycode;
 
-Mesh *Particle::billboardMesh = NULL;
+ParticleSimulation::ParticleSimulation() {
+	particleCount = 0;
+	streamVertexCount = 0;
+}
+
+ParticleSimulation::~ParticleSimulation() {
 
-Particle::Particle(int particleType, bool isScreenParticle, Material *material, Texture *texture, Mesh *particleMesh) {
-	life = 0;
-	if(isScreenParticle) {
-		createScreenParticle(particleType, texture, particleMesh);		
-	} else {
-		createSceneParticle(particleType, material, particleMesh);
-	}
-	
-	Reset(true);
 }
 
-void Particle::createSceneParticle(int particleType, Material *material, Mesh *particleMesh) {
-	switch(particleType) {
-		case BILLBOARD_PARTICLE:
-		{
-			if(!billboardMesh) {
-				billboardMesh = new Mesh(Mesh::QUAD_MESH);
-				
-				Polygon *imagePolygon = new Polygon();
-				imagePolygon->addVertex(0,1,0,0,0);	
-				imagePolygon->addVertex(1,1,0, 1, 0);			
-				imagePolygon->addVertex(1,0,0, 1, 1);		
-				imagePolygon->addVertex(0,0,0,0,1);
+void ParticleSimulation::setCount(unsigned int count) {
+	posX.resize(count, 0);
+	posY.resize(count, 0);
+	posZ.resize(count, 0);
+	velX.resize(count, 0);
+	velY.resize(count, 0);
+	velZ.resize(count, 0);
+	rotX.resize(count, 0);
+	rotY.resize(count, 0);
+	rotZ.resize(count, 0);
+	life.resize(count, 0);
+	size.resize(count, 1);
+	colorR.resize(count, 1);
+	colorG.resize(count, 1);
+	colorB.resize(count, 1);
+	colorA.resize(count, 1);
+	brightness.resize(count, 1);
+	perlinX.resize(count, 0);
+	perlinY.resize(count, 0);
+	perlinZ.resize(count, 0);
+	particleCount = count;
+}
 
-				billboardMesh->addPolygon(imagePolygon);
-		
-		for(int i=0; i < billboardMesh->getPolygonCount(); i++) {
-			for(int j=0; j < billboardMesh->getPolygon(i)->getVertexCount(); j++) {
-				billboardMesh->getPolygon(i)->getVertex(j)->x = billboardMesh->getPolygon(i)->getVertex(j)->x - (1.0/2.0f);
-				billboardMesh->getPolygon(i)->getVertex(j)->z = billboardMesh->getPolygon(i)->getVertex(j)->z - (1.0/2.0f);
-			}
-		}
+unsigned int ParticleSimulation::getCount() {
+	return particleCount;
+}
 
-		billboardMesh->calculateNormals();
-		billboardMesh->arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		billboardMesh->arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		billboardMesh->arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		billboardMesh->arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;					
-				
-			} 
-			SceneMesh *primitive = new SceneMesh(billboardMesh);
-			
-			primitive->setMaterial(material);
-			primitive->billboardMode = true;
-			primitive->billboardRoll = true;
-//			primitive->alphaTest = true;
-//			primitive->depthTest = false;
-			primitive->depthWrite = false;
-			primitive->backfaceCulled = false;
-			particleBody = primitive;			
-		}
-			break;
-		case MESH_PARTICLE: 
-		{
-			SceneMesh *primitive = new SceneMesh(particleMesh);
-			if(particleMesh->getMeshType() == Mesh::TRI_MESH)
-				primitive->cacheToVertexBuffer(true);
-			primitive->setMaterial(material);
-			//			primitive->billboardMode = true;
-			//			primitive->billboardRoll = true;
-			//primitive->depthTest = false;
-			//			primitive->backfaceCulled = false;
-			particleBody = primitive;						
-		}			
-		break;
-		default:
-			assert(0);
-		break;
+void ParticleSimulation::integrate(unsigned int count, Number elapsed, Number timeStep, const Vector3 &gravity, Number rotationSpeed, bool planar) {
+	if(count > particleCount)
+		count = particleCount;
+	if(count == 0)
+		return;
+	
+	float dt = elapsed;
+	float step = timeStep;
+	float gx = gravity.x * timeStep;
+	float gy = gravity.y * timeStep;
+	float gz = gravity.z * timeStep;
+	float spin = rotationSpeed * elapsed;
+	
+	float *px = &posX[0], *py = &posY[0], *pz = &posZ[0];
+	float *vx = &velX[0], *vy = &velY[0], *vz = &velZ[0];
+	float *l = &life[0];
+	
+	for(unsigned int i=0; i < count; i++) {
+		l[i] += dt;
+	}
+	
+	for(unsigned int i=0; i < count; i++) {
+		vx[i] -= gx;
+		vy[i] -= gy;
+		px[i] += vx[i] * step;
+		py[i] += vy[i] * step;
+	}
+	
+	float *rz = &rotZ[0];
+	for(unsigned int i=0; i < count; i++) {
+		rz[i] += spin;
+	}
+	
+	if(planar)
+		return;
+	
+	float *rx = &rotX[0], *ry = &rotY[0];
+	for(unsigned int i=0; i < count; i++) {
+		vz[i] -= gz;
+		pz[i] += vz[i] * step;
+		rx[i] += spin;
+		ry[i] += spin;
 	}
 }
 
-void Particle::createScreenParticle(int particleType, Texture *texture, Mesh *particleMesh) {
-	
-	ScreenShape *primitive = new ScreenShape(ScreenShape::SHAPE_RECT, 10.0f, 10.0f);
-	primitive->setTexture(texture);	
-//	primitive->billboardMode = true;
-//	primitive->billboardRoll = true;
-	
-	particleBody = primitive;			
-	return;
-	
-	switch(particleType) {
-		case BILLBOARD_PARTICLE:
-		{
-			ScreenShape *primitive = new ScreenShape(ScreenShape::SHAPE_RECT, 1.0f, 1.0f);
-//			primitive->setTexture(texture->get)
-			particleBody = primitive;			
+void ParticleSimulation::setMeshTemplate(Mesh *mesh) {
+	templatePositions.clear();
+	templateNormals.clear();
+	templateTexCoords.clear();
+	if(!mesh)
+		return;
+	
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			templatePositions.push_back(vertex->x);
+			templatePositions.push_back(vertex->y);
+			templatePositions.push_back(vertex->z);
+			
+			Vector3 normal;
+			if(polygon->useVertexNormals)
+				normal = vertex->normal;
+			else
+				normal = polygon->getFaceNormal();
+			templateNormals.push_back(normal.x);
+			templateNormals.push_back(normal.y);
+			templateNormals.push_back(normal.z);
+			
+			templateTexCoords.push_back(vertex->getTexCoord().x);
+			templateTexCoords.push_back(vertex->getTexCoord().y);
 		}
-			break;
-		case MESH_PARTICLE: 
-		{
-//			ScreenMesh *primitive = new ScreenMesh(particleMesh);
-//			primitive->cacheToVertexBuffer(true);
-//			primitive->setMaterial(texture);
-//			particleBody = primitive;						
-		}			
-			break;
-	}	
+	}
 }
 
-
-void Particle::Reset(bool continuious) {
-	if(continuious) {
-		if(life > lifespan)
-			life = 0 + (life - lifespan);
-		else
-			life = 0;
-	} else {
-			life = 0;		
+void ParticleSimulation::buildQuadStream(unsigned int count, const Vector3 &right, const Vector3 &up, Number baseSize, bool followPath) {
+	if(count > particleCount)
+		count = particleCount;
+	
+	streamVertexCount = count * 4;
+	vertexPositions.resize(streamVertexCount * 3);
+	vertexColors.resize(streamVertexCount * 4);
+	vertexTexCoords.resize(streamVertexCount * 2);
+	vertexNormals.clear();
+	
+	float rx = right.x, ry = right.y, rz = right.z;
+	float ux = up.x, uy = up.y, uz = up.z;
+	float halfSize = baseSize * 0.5;
+	
+	if(streamVertexCount == 0)
+		return;
+	
+	float *pos = &vertexPositions[0];
+	float *col = &vertexColors[0];
+	float *uv = &vertexTexCoords[0];
+	
+	for(unsigned int i=0; i < count; i++) {
+		float c, s;
+		if(followPath) {
+			// roll the quad so that its right vector points along the velocity as seen on the quad's plane
+			float along = velX[i]*rx + velY[i]*ry + velZ[i]*rz;
+			float across = velX[i]*ux + velY[i]*uy + velZ[i]*uz;
+			float len = sqrtf(along*along + across*across);
+			if(len > 0.0f) {
+				c = along / len;
+				s = across / len;
+			} else {
+				c = 1.0f;
+				s = 0.0f;
+			}
+		} else {
+			float angle = rotZ[i] * TORADIANS;
+			c = cosf(angle);
+			s = sinf(angle);
+		}
+		
+		float h = halfSize * size[i];
+		
+		// rotated right and up vectors, scaled to half the quad size
+		float ax = (rx*c + ux*s) * h;
+		float ay = (ry*c + uy*s) * h;
+		float az = (rz*c + uz*s) * h;
+		float bx = (ux*c - rx*s) * h;
+		float by = (uy*c - ry*s) * h;
+		float bz = (uz*c - rz*s) * h;
+		
+		float x = posX[i], y = posY[i], z = posZ[i];
+		
+		pos[0] = x - ax + bx; pos[1] = y - ay + by; pos[2] = z - az + bz;
+		pos[3] = x + ax + bx; pos[4] = y + ay + by; pos[5] = z + az + bz;
+		pos[6] = x + ax - bx; pos[7] = y + ay - by; pos[8] = z + az - bz;
+		pos[9] = x - ax - bx; pos[10] = y - ay - by; pos[11] = z - az - bz;
+		pos += 12;
+		
+		uv[0] = 0; uv[1] = 0;
+		uv[2] = 1; uv[3] = 0;
+		uv[4] = 1; uv[5] = 1;
+		uv[6] = 0; uv[7] = 1;
+		uv += 8;
+		
+		for(int v=0; v < 4; v++) {
+			col[0] = colorR[i];
+			col[1] = colorG[i];
+			col[2] = colorB[i];
+			col[3] = colorA[i];
+			col += 4;
+		}
 	}
+}
 
-	perlinPosX = (Number)rand()/RAND_MAX;
-	perlinPosY = (Number)rand()/RAND_MAX;
-	perlinPosZ = (Number)rand()/RAND_MAX;
+void ParticleSimulation::buildMeshStream(unsigned int count, bool billboard, bool followPath, const Vector3 &right, const Vector3 &up) {
+	if(count > particleCount)
+		count = particleCount;
+	
+	unsigned int templateCount = templatePositions.size() / 3;
+	streamVertexCount = count * templateCount;
+	vertexPositions.resize(streamVertexCount * 3);
+	vertexNormals.resize(streamVertexCount * 3);
+	vertexColors.resize(streamVertexCount * 4);
+	vertexTexCoords.resize(streamVertexCount * 2);
 	
+	if(streamVertexCount == 0)
+		return;
+	
+	float *pos = &vertexPositions[0];
+	float *nor = &vertexNormals[0];
+	float *col = &vertexColors[0];
+	float *uv = &vertexTexCoords[0];
+	
+	Vector3 back = right.crossProduct(up);
+	
+	for(unsigned int i=0; i < count; i++) {
+		Matrix4 m;
+		if(billboard) {
+			m = Matrix4(right.x, right.y, right.z, 0,
+						up.x, up.y, up.z, 0,
+						back.x, back.y, back.z, 0,
+						0, 0, 0, 1);
+		} else if(followPath) {
+			Vector3 pathBack(-velX[i], -velY[i], -velZ[i]);
+			pathBack.Normalize();
+			Vector3 pathRight = pathBack.crossProduct(Vector3(1,0,0));
+			pathRight.Normalize();
+			pathRight = pathRight * -1;
+			Vector3 pathUp = pathBack.crossProduct(pathRight);
+			m = Matrix4(pathRight.x, pathRight.y, pathRight.z, 0,
+						pathUp.x, pathUp.y, pathUp.z, 0,
+						pathBack.x, pathBack.y, pathBack.z, 0,
+						0, 0, 0, 1);
+		} else {
+			Quaternion q;
+			q.fromAxes(rotX[i], rotY[i], rotZ[i]);
+			m = q.createMatrix();
+		}
+		
+		float s = size[i];
+		float m00 = m.m[0][0]*s, m01 = m.m[0][1]*s, m02 = m.m[0][2]*s;
+		float m10 = m.m[1][0]*s, m11 = m.m[1][1]*s, m12 = m.m[1][2]*s;
+		float m20 = m.m[2][0]*s, m21 = m.m[2][1]*s, m22 = m.m[2][2]*s;
+		float x = posX[i], y = posY[i], z = posZ[i];
+		
+		const float *tp = &templatePositions[0];
+		const float *tn = &templateNormals[0];
+		const float *tuv = &templateTexCoords[0];
+		for(unsigned int v=0; v < templateCount; v++) {
+			pos[0] = tp[0]*m00 + tp[1]*m10 + tp[2]*m20 + x;
+			pos[1] = tp[0]*m01 + tp[1]*m11 + tp[2]*m21 + y;
+			pos[2] = tp[0]*m02 + tp[1]*m12 + tp[2]*m22 + z;
+			
+			nor[0] = tn[0]*m.m[0][0] + tn[1]*m.m[1][0] + tn[2]*m.m[2][0];
+			nor[1] = tn[0]*m.m[0][1] + tn[1]*m.m[1][1] + tn[2]*m.m[2][1];
+			nor[2] = tn[0]*m.m[0][2] + tn[1]*m.m[1][2] + tn[2]*m.m[2][2];
+			
+			uv[0] = tuv[0];
+			uv[1] = tuv[1];
+			
+			col[0] = colorR[i];
+			col[1] = colorG[i];
+			col[2] = colorB[i];
+			col[3] = colorA[i];
+			
+			tp += 3; tn += 3; tuv += 2;
+			pos += 3; nor += 3; uv += 2; col += 4;
+		}
+	}
 }
 
-Particle::~Particle() {
-
-}
\ No newline at end of file
+unsigned int ParticleSimulation::getStreamVertexCount() {
+	return streamVertexCount;
+}
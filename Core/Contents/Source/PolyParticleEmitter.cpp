@@ -31,6 +31,10 @@ SceneEntity()
 	isScreenEmitter = false;
 	emitterMesh = emitter;	
 	this->particleParentScene = particleParentScene;	
+	if(particleType == Particle::BILLBOARD_PARTICLE) {
+		particleBillboardMode = true;
+		particleDepthWrite = false;
+	}
 	createParticles();	
 }
 
@@ -38,10 +42,6 @@ SceneParticleEmitter::~SceneParticleEmitter() {
 	
 }
 
-void SceneParticleEmitter::addParticleBody(Entity *particleBody) {
-	particleParentScene->addEntity((SceneEntity*)particleBody);	
-}
-
 Matrix4 SceneParticleEmitter::getBaseMatrix() {
 	return getConcatenatedMatrix();	
 }
@@ -50,6 +50,32 @@ void SceneParticleEmitter::Update() {
 	updateEmitter();
 }
 
+void SceneParticleEmitter::Render() {
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	
+	// particles are simulated in world space, so undo the emitter's own transform
+	renderer->pushMatrix();
+	renderer->multModelviewMatrix(getConcatenatedMatrix().inverse());
+	
+	Matrix4 viewMatrix = renderer->getModelviewMatrix();
+	Vector3 right(viewMatrix.m[0][0], viewMatrix.m[1][0], viewMatrix.m[2][0]);
+	Vector3 up(viewMatrix.m[0][1], viewMatrix.m[1][1], viewMatrix.m[2][1]);
+	right.Normalize();
+	up.Normalize();
+	
+	if(particleMaterial) {
+		renderer->applyMaterial(particleMaterial, particleShaderOptions, 0);
+	} else {
+		renderer->setTexture(NULL);
+	}
+	
+	renderParticles(renderer, right, up);
+	
+	if(particleMaterial)
+		renderer->clearShader();
+	
+	renderer->popMatrix();
+}
 
 ScreenParticleEmitter::ScreenParticleEmitter(String imageFile, Screen *particleParentScreen, int particleType, int emitterType, Number lifespan, unsigned int numParticles, Vector3 direction, Vector3 gravity, Vector3 deviation, Mesh *particleMesh, ScreenMesh *emitter)
 		: ParticleEmitter(imageFile, particleMesh, particleType, emitterType, lifespan, numParticles,  direction, gravity, deviation),
@@ -58,6 +84,8 @@ ScreenEntity()
 	isScreenEmitter = true;
 	emitterMesh = emitter;	
 	this->particleParentScreen = particleParentScreen;	
+	particleDepthWrite = depthWrite;
+	particleDepthTest = depthTest;
 	createParticles();
 }
 
@@ -69,8 +97,14 @@ void ScreenParticleEmitter::Update() {
 	updateEmitter();
 }
 
-void ScreenParticleEmitter::addParticleBody(Entity *particleBody) {
-	particleParentScreen->addChild((ScreenEntity*)particleBody);
+void ScreenParticleEmitter::Render() {
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	
+	renderer->pushMatrix();
+	renderer->multModelviewMatrix(getConcatenatedMatrix().inverse());
+	renderer->setTexture(particleTexture);
+	renderParticles(renderer, Vector3(1,0,0), Vector3(0,1,0));
+	renderer->popMatrix();
 }
 
 Matrix4 ScreenParticleEmitter::getBaseMatrix() {
@@ -103,8 +137,27 @@ ParticleEmitter::ParticleEmitter(String imageFile, Mesh *particleMesh, int parti
 	this->lifespan = lifespan;
 	timer = new Timer(true, 1);	
 	motionPerlin = new Perlin(3,5,1.0,rand());
+	randomSeed = rand() | 1;
 	
 	textureFile = imageFile;
+	particleMaterial = NULL;
+	particleShaderOptions = NULL;
+	particleTexture = NULL;
+	
+	particleBlendingMode = Renderer::BLEND_MODE_NORMAL;
+	particleDepthWrite = true;
+	particleDepthTest = true;
+	particleAlphaTest = false;
+	particleBillboardMode = false;
+	
+	vertexArray = NULL;
+	normalArray = NULL;
+	colorArray = NULL;
+	texCoordArray = NULL;
+	
+	emitterPitch = 0;
+	emitterYaw = 0;
+	emitterRoll = 0;
 	
 	useColorCurves = false;
 	useScaleCurves = false;	
@@ -112,27 +165,38 @@ ParticleEmitter::ParticleEmitter(String imageFile, Mesh *particleMesh, int parti
 
 void ParticleEmitter::createParticles() {
 	
-	if(isScreenEmitter)
+	if(isScreenEmitter) {
 		particleTexture = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(textureFile);	
-	else
+	} else {
 		particleMaterial = (Material*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, textureFile);	
+		if(particleMaterial)
+			particleShaderOptions = particleMaterial->getShader(0)->createBinding();
+	}
 	
+	if(particleType == Particle::MESH_PARTICLE)
+		particles.setMeshTemplate(pMesh);
 	
-	Particle *particle;	
+	particles.setCount(numParticles);
+	updateEmitterMatrix();
 	for(int i=0; i < numParticles; i++) {
-		particle = new Particle(particleType, isScreenEmitter, particleMaterial, particleTexture, pMesh);
-		particle->velVector = dirVector;
-		particle->dirVector = dirVector;
-		particle->deviation = deviation;
-		particle->lifespan = lifespan;
-		particles.push_back(particle);
-		addParticleBody(particle->particleBody);					
-		resetParticle(particle);
-		particle->life = lifespan * ((Number)rand()/RAND_MAX);		
+		resetParticle(i);
+		particles.life[i] = lifespan * randomUnit();
 	}
 	updateEmitter();	
 }
 
+Number ParticleEmitter::randomUnit() {
+	randomSeed ^= randomSeed << 13;
+	randomSeed ^= randomSeed >> 17;
+	randomSeed ^= randomSeed << 5;
+	return (Number)randomSeed / 4294967295.0;
+}
+
+void ParticleEmitter::updateEmitterMatrix() {
+	emitterMatrix = getBaseMatrix();
+	emitterMatrix.getEulerAngles(&emitterPitch, &emitterYaw, &emitterRoll);
+}
+
 void ParticleEmitter::setEmitterRadius(Vector3 rad) {
 	emitterRadius = rad;
 }
@@ -143,34 +207,24 @@ void ParticleEmitter::setRotationSpeed(Number speed) {
 
 
 void ParticleEmitter::setParticleBlendingMode(int mode) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->setBlendingMode(mode);
-	}
+	particleBlendingMode = mode;
 }
 
 void ParticleEmitter::setAlphaTest(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->alphaTest = val;
-	}		
+	particleAlphaTest = val;
 }
 
 void ParticleEmitter::setDepthWrite(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->depthWrite = val;
-	}	
+	particleDepthWrite = val;
 }
 
 void ParticleEmitter::setDepthTest(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->depthTest= val;
-	}	
+	particleDepthTest = val;
 }
 
 
 void ParticleEmitter::setBillboardMode(bool mode) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->billboardMode = mode;
-	}
+	particleBillboardMode = mode;
 }
 
 void ParticleEmitter::enablePerlin(bool val) {
@@ -178,32 +232,31 @@ void ParticleEmitter::enablePerlin(bool val) {
 }
 
 ParticleEmitter::~ParticleEmitter() {
-	
+	delete vertexArray;
+	delete normalArray;
+	delete colorArray;
+	delete texCoordArray;
 }
 
 void ParticleEmitter::setParticleCount(int count) {
-	if(count > particles.size()) {
-		int oldSize  = count-particles.size();
-		Particle *particle;
-		for(int i=0; i  < oldSize; i++) {
-			particle = new Particle(particleType, isScreenEmitter, particleMaterial, particleTexture, pMesh);
-			particle->velVector = dirVector;
-			particle->dirVector = dirVector;
-			particle->deviation = deviation;
-			particle->lifespan = lifespan;
-			particle->life = lifespan * ((Number)rand()/RAND_MAX);
-			particles.push_back(particle);
-			addParticleBody(particle->particleBody);
+	int oldCount = particles.getCount();
+	if(count > oldCount) {
+		particles.setCount(count);
+		updateEmitterMatrix();
+		for(int i=oldCount; i < count; i++) {
+			resetParticle(i);
+			particles.life[i] = lifespan * randomUnit();
 		}
 	}
 	numParticles = count;
-	for(int i=0; i < particles.size(); i++) {
-		if(i < numParticles)
-			particles[i]->particleBody->visible =true;
-		else
-			particles[i]->particleBody->visible = false;
-	}
+}
+
+unsigned int ParticleEmitter::getParticleCount() {
+	return numParticles;
+}
 
+ParticleSimulation *ParticleEmitter::getParticleSimulation() {
+	return &particles;
 }
 
 void ParticleEmitter::setPerlinModSize(Number size) {
@@ -215,7 +268,7 @@ void ParticleEmitter::enableEmitter(bool val) {
 	isEmitterEnabled = val;
 	if(val) {
 		for(int i=0;i < numParticles; i++) {
-			particles[i]->life = particles[i]->lifespan * ((Number)rand()/RAND_MAX);
+			particles.life[i] = lifespan * randomUnit();
 		}
 	}
 }
@@ -223,8 +276,9 @@ void ParticleEmitter::enableEmitter(bool val) {
 void ParticleEmitter::Trigger() {
 	if(!isEmitterEnabled)
 		return;
+	updateEmitterMatrix();
 	for(int i=0;i < numParticles; i++) {
-			resetParticle(particles[i]);
+		resetParticle(i);
 	}
 }
 
@@ -232,130 +286,169 @@ bool ParticleEmitter::emitterEnabled() {
 	return isEmitterEnabled;
 }
 
-void ParticleEmitter::resetParticle(Particle *particle) {
-	particle->particleBody->visible = true;
-	particle->lifespan  = lifespan;
-	Matrix4 concatMatrix = getBaseMatrix();
-	Vector3	startVector;
-	
-//	if(emitterMesh) {
-//		Polygon *randPoly = emitterMesh->getMesh()->getPolygon(rand() % emitterMesh->getMesh()->getPolygonCount());		
-//		startVector = *randPoly->getVertex(rand() % 3);
-//		startVector = emitterMesh->getConcatenatedMatrix() * startVector;
-//	} else {
-		startVector = Vector3(-(emitterRadius.x/2.0f)+emitterRadius.x*((Number)rand()/RAND_MAX),-(emitterRadius.y/2.0f)+emitterRadius.y*((Number)rand()/RAND_MAX),-(emitterRadius.z/2.0f)+emitterRadius.z*((Number)rand()/RAND_MAX));	
-//	}
-	
-	particle->Reset(emitterType != TRIGGERED_EMITTER);	
-	particle->velVector = particle->dirVector;
-	Number dev = ((deviation.x/2.0f)*-1.0f) + ((deviation.x)*((Number)rand()/RAND_MAX));
-	particle->velVector.x += dev;
-	dev = (deviation.y/2.0f*-1.0f) + ((deviation.y)*((Number)rand()/RAND_MAX));
-	particle->velVector.y += dev;
-	dev = (deviation.z/2.0f*-1.0f) + ((deviation.z)*((Number)rand()/RAND_MAX));
-	particle->velVector.z += dev;
-	
-	particle->brightnessDeviation = 1.0f - ( (-brightnessDeviation) + ((brightnessDeviation*2) * ((Number)rand()/RAND_MAX)));
-	
-	particle->velVector = concatMatrix.rotateVector(particle->velVector);	
-	particle->particleBody->setTransformByMatrix(concatMatrix);
-	particle->particleBody->Translate(startVector);
-	particle->particleBody->rebuildTransformMatrix();	
+void ParticleEmitter::resetParticle(unsigned int index) {
+	
+	if(emitterType != TRIGGERED_EMITTER && particles.life[index] > lifespan)
+		particles.life[index] -= lifespan;
+	else
+		particles.life[index] = 0;
+	
+	particles.perlinX[index] = randomUnit();
+	particles.perlinY[index] = randomUnit();
+	particles.perlinZ[index] = randomUnit();
+	
+	Vector3 velVector = dirVector;
+	velVector.x += -(deviation.x/2.0f) + deviation.x*randomUnit();
+	velVector.y += -(deviation.y/2.0f) + deviation.y*randomUnit();
+	velVector.z += -(deviation.z/2.0f) + deviation.z*randomUnit();
+	velVector = emitterMatrix.rotateVector(velVector);
+	
+	particles.velX[index] = velVector.x;
+	particles.velY[index] = velVector.y;
+	particles.velZ[index] = velVector.z;
+	
+	particles.posX[index] = emitterMatrix.m[3][0] - (emitterRadius.x/2.0f) + emitterRadius.x*randomUnit();
+	particles.posY[index] = emitterMatrix.m[3][1] - (emitterRadius.y/2.0f) + emitterRadius.y*randomUnit();
+	particles.posZ[index] = emitterMatrix.m[3][2] - (emitterRadius.z/2.0f) + emitterRadius.z*randomUnit();
+	if(isScreenEmitter)
+		particles.posZ[index] = emitterMatrix.m[3][2];
+	
+	particles.rotX[index] = emitterPitch;
+	particles.rotY[index] = emitterYaw;
+	particles.rotZ[index] = emitterRoll;
+	
+	particles.brightness[index] = 1.0f - ( (-brightnessDeviation) + ((brightnessDeviation*2) * randomUnit()));
 	
 	if(useScaleCurves) {
-		particle->particleBody->setScale(scaleCurve.getHeightAt(0),
-									 scaleCurve.getHeightAt(0),
-									 scaleCurve.getHeightAt(0));
+		particles.size[index] = scaleCurve.getHeightAt(0);
+	} else {
+		particles.size[index] = 1.0f;
 	}
 	
 	if(useColorCurves) {
-		particle->particleBody->color.setColor(colorCurveR.getHeightAt(0),
-										   colorCurveG.getHeightAt(0),
-										   colorCurveB.getHeightAt(0),
-										   colorCurveA.getHeightAt(0));
+		particles.colorR[index] = colorCurveR.getHeightAt(0);
+		particles.colorG[index] = colorCurveG.getHeightAt(0);
+		particles.colorB[index] = colorCurveB.getHeightAt(0);
+		particles.colorA[index] = colorCurveA.getHeightAt(0);
 	}
-	
-			
 }
 
 void ParticleEmitter::setAllAtOnce(bool val) {
 	allAtOnce = val;
-	for(int i=0;i < particles.size(); i++) {
+	for(int i=0;i < particles.getCount(); i++) {
 		if(allAtOnce)
-			particles[i]->life = 0;
+			particles.life[i] = 0;
 		else
-			particles[i]->life = particles[i]->lifespan * ((Number)rand()/RAND_MAX);
+			particles.life[i] = lifespan * randomUnit();
 	}
 }
 
 void ParticleEmitter::updateEmitter() {	
 	
-	Vector3 translationVector;
 	Number elapsed = timer->getElapsedf();
+	Number timeStep = elapsed*particleSpeedMod;
+	unsigned int count = numParticles;
+	if(count > particles.getCount())
+		count = particles.getCount();
 	
-	Particle *particle;
-	Number normLife;
-	
-	for(int i=0;i < numParticles; i++) {	
-		particle = particles[i];
-		
-		normLife = particle->life / particle->lifespan;
-		Vector3 gVec = gravVector;
-		particle->life += elapsed;
-		particle->velVector -= gVec*elapsed*particleSpeedMod;
-		translationVector = particle->velVector;
-		translationVector = translationVector*elapsed*particleSpeedMod;
-		if(perlinEnabled) {
-			translationVector.x += ((perlinModSize * motionPerlin->Get((particle->life/particle->lifespan), particle->perlinPosX))*elapsed*particleSpeedMod);
-			translationVector.y += ((perlinModSize * motionPerlin->Get((particle->life/particle->lifespan), particle->perlinPosY))*elapsed*particleSpeedMod);
-			translationVector.z += ((perlinModSize * motionPerlin->Get((particle->life/particle->lifespan), particle->perlinPosZ))*elapsed*particleSpeedMod);
-		}
-		
-		if(isScreenEmitter) {		
-			translationVector.z = 0;
+	if(count == 0)
+		return;
+	
+	particles.integrate(count, elapsed, timeStep, gravVector, rotationFollowsPath ? 0 : rotationSpeed, isScreenEmitter);
+	
+	Number invLifespan = lifespan > 0 ? 1.0/lifespan : 0;
+	float *life = &particles.life[0];
+	
+	if(perlinEnabled) {
+		Number perlinStep = perlinModSize * timeStep;
+		for(unsigned int i=0; i < count; i++) {
+			Number normLife = life[i] * invLifespan;
+			particles.posX[i] += motionPerlin->Get(normLife, particles.perlinX[i]) * perlinStep;
+			particles.posY[i] += motionPerlin->Get(normLife, particles.perlinY[i]) * perlinStep;
+			if(!isScreenEmitter)
+				particles.posZ[i] += motionPerlin->Get(normLife, particles.perlinZ[i]) * perlinStep;
 		}
-		
-		particle->particleBody->Translate(translationVector);
-		
-		
-		if(rotationFollowsPath)  {
-			if(isScreenEmitter) {
-				particle->particleBody->lookAt(particle->particleBody->getPosition() + translationVector, Vector3(1,0,0));													
-			} else {
-				particle->particleBody->lookAt(particle->particleBody->getPosition() + translationVector, Vector3(1,0,0));			
-			}
-		} else {
-			if(isScreenEmitter) {
-				particle->particleBody->Roll(rotationSpeed*elapsed);
-			} else {
-				particle->particleBody->Roll(rotationSpeed*elapsed);
-				particle->particleBody->Pitch(rotationSpeed*elapsed);
-				particle->particleBody->Yaw(rotationSpeed*elapsed);						
-			}
-		}		
-		
-//		if(isScreenEmitter)
-//			particle->particleBody->setPositionZ(0);		
-		
-		if(useColorCurves) {
-			particle->particleBody->color.setColor(colorCurveR.getHeightAt(normLife)*particle->brightnessDeviation,
-											   colorCurveG.getHeightAt(normLife)*particle->brightnessDeviation,
-											   colorCurveB.getHeightAt(normLife)*particle->brightnessDeviation,
-											   colorCurveA.getHeightAt(normLife)*particle->brightnessDeviation);
+	}
+	
+	if(useColorCurves) {
+		for(unsigned int i=0; i < count; i++) {
+			Number normLife = life[i] * invLifespan;
+			Number brightness = particles.brightness[i];
+			particles.colorR[i] = colorCurveR.getHeightAt(normLife) * brightness;
+			particles.colorG[i] = colorCurveG.getHeightAt(normLife) * brightness;
+			particles.colorB[i] = colorCurveB.getHeightAt(normLife) * brightness;
+			particles.colorA[i] = colorCurveA.getHeightAt(normLife) * brightness;
 		}
+	}
 	
-		if(useScaleCurves) {
-			particle->particleBody->setScale(scaleCurve.getHeightAt(normLife),
-										 scaleCurve.getHeightAt(normLife),
-										 scaleCurve.getHeightAt(normLife));
-		
+	if(useScaleCurves) {
+		for(unsigned int i=0; i < count; i++) {
+			particles.size[i] = scaleCurve.getHeightAt(life[i] * invLifespan);
 		}
-		if(particle->life > particle->lifespan && isEmitterEnabled) {
-			if(emitterType == CONTINUOUS_EMITTER) {
-				resetParticle(particle);
-			} else {
-//				particle->particleBody->visible = false;
+	}
+	
+	if(isEmitterEnabled && emitterType == CONTINUOUS_EMITTER) {
+		bool matrixUpdated = false;
+		for(unsigned int i=0; i < count; i++) {
+			if(life[i] > lifespan) {
+				if(!matrixUpdated) {
+					updateEmitterMatrix();
+					matrixUpdated = true;
+				}
+				resetParticle(i);
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+void ParticleEmitter::renderParticles(Renderer *renderer, const Vector3 &right, const Vector3 &up) {
+	unsigned int count = numParticles;
+	int meshType = Mesh::QUAD_MESH;
+	
+	if(particleType == Particle::MESH_PARTICLE && pMesh) {
+		particles.buildMeshStream(count, particleBillboardMode, rotationFollowsPath, right, up);
+		meshType = pMesh->getMeshType();
+	} else {
+		particles.buildQuadStream(count, right, up, isScreenEmitter ? 10.0 : 1.0, rotationFollowsPath);
+	}
+	
+	unsigned int vertexCount = particles.getStreamVertexCount();
+	if(vertexCount == 0)
+		return;
+	
+	if(!vertexArray) {
+		// the arrays point straight into the simulation's vertex stream
+		vertexArray = renderer->createRenderDataArray(RenderDataArray::VERTEX_DATA_ARRAY);
+		normalArray = renderer->createRenderDataArray(RenderDataArray::NORMAL_DATA_ARRAY);
+		colorArray = renderer->createRenderDataArray(RenderDataArray::COLOR_DATA_ARRAY);
+		texCoordArray = renderer->createRenderDataArray(RenderDataArray::TEXCOORD_DATA_ARRAY);
+		free(vertexArray->arrayPtr);
+		free(normalArray->arrayPtr);
+		free(colorArray->arrayPtr);
+		free(texCoordArray->arrayPtr);
+	}
+	
+	vertexArray->arrayPtr = &particles.vertexPositions[0];
+	vertexArray->count = vertexCount;
+	colorArray->arrayPtr = &particles.vertexColors[0];
+	colorArray->count = vertexCount;
+	texCoordArray->arrayPtr = &particles.vertexTexCoords[0];
+	texCoordArray->count = vertexCount;
+	
+	renderer->setBlendingMode(particleBlendingMode);
+	renderer->enableDepthWrite(particleDepthWrite);
+	renderer->enableDepthTest(particleDepthTest);
+	renderer->enableAlphaTest(particleAlphaTest);
+	if(particleType == Particle::BILLBOARD_PARTICLE || isScreenEmitter)
+		renderer->enableBackfaceCulling(false);
+	
+	renderer->pushRenderDataArray(colorArray);
+	renderer->pushRenderDataArray(vertexArray);
+	if(particles.vertexNormals.size() > 0) {
+		normalArray->arrayPtr = &particles.vertexNormals[0];
+		normalArray->count = vertexCount;
+		renderer->pushRenderDataArray(normalArray);
+	}
+	renderer->pushRenderDataArray(texCoordArray);
+	renderer->drawArrays(meshType);
+}
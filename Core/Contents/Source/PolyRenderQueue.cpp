@@ -0,0 +1,312 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyRenderQueue.h"
+#include "PolyEntity.h"
+#include "PolyRenderer.h"
+#include "PolyMaterial.h"
+#include "PolyMesh.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+using namespace Polycode;
+
+// Orders items like their sort keys would without the ID fields' size limits.
+// Only used when a frame has more resources than the key can hold.
+class RenderQueueFullCompare {
+	public:
+		RenderQueueFullCompare(const vector<RenderQueueItem> &items) : items(items) {}
+		
+		bool operator()(const RenderQueueSortEntry &a, const RenderQueueSortEntry &b) const {
+			const RenderQueueItem &x = items[a.index];
+			const RenderQueueItem &y = items[b.index];
+			if(x.pass != y.pass)
+				return x.pass < y.pass;
+			if(x.pass == RenderQueue::PASS_OPAQUE) {
+				if((x.sortDepth >> 14) != (y.sortDepth >> 14))
+					return (x.sortDepth >> 14) < (y.sortDepth >> 14);
+			} else if(x.sortDepth != y.sortDepth) {
+				return x.sortDepth > y.sortDepth;
+			}
+			for(int i=0; i < 4; i++) {
+				if(x.sortIDs[i] != y.sortIDs[i])
+					return x.sortIDs[i] < y.sortIDs[i];
+			}
+			if(x.sortDepth != y.sortDepth)
+				return x.sortDepth < y.sortDepth;
+			return a.index < b.index;
+		}
+		
+	protected:
+		const vector<RenderQueueItem> &items;
+};
+
+RenderQueueItem::RenderQueueItem() {
+	entity = NULL;
+	blendingMode = Renderer::BLEND_MODE_NORMAL;
+	depthWrite = true;
+	depthTest = true;
+	alphaTest = false;
+	backfaceCulled = true;
+	wireframe = false;
+	hasResources = false;
+	material = NULL;
+	localShaderOptions = NULL;
+	texture = NULL;
+	mesh = NULL;
+	depth = 0;
+	pass = RenderQueue::PASS_OPAQUE;
+	sortDepth = 0;
+	for(int i=0; i < 4; i++) {
+		sortIDs[i] = 0;
+	}
+}
+
+RenderQueue::RenderQueue() {
+	numResourceChanges = 0;
+	idOverflow = false;
+}
+
+RenderQueue::~RenderQueue() {
+}
+
+void RenderQueue::addEntity(Entity *entity, const Matrix4 &modelviewMatrix) {
+	items.push_back(RenderQueueItem());
+	RenderQueueItem &item = items.back();
+	
+	item.entity = entity;
+	item.modelviewMatrix = modelviewMatrix;
+	item.color = entity->getCombinedColor();
+	item.blendingMode = entity->blendingMode;
+	item.depthWrite = entity->depthWrite;
+	item.depthTest = entity->depthTest;
+	item.alphaTest = entity->alphaTest;
+	item.backfaceCulled = entity->backfaceCulled;
+	item.wireframe = entity->renderWireframe;
+	item.hasResources = entity->getRenderResources(&item);
+	
+	// the camera looks down -z
+	item.depth = -modelviewMatrix.ml[14];
+	
+	if(item.depthWrite && item.color.a >= 1.0 && item.blendingMode == Renderer::BLEND_MODE_NORMAL)
+		item.pass = PASS_OPAQUE;
+	else
+		item.pass = PASS_BLENDED;
+}
+
+unsigned int RenderQueue::getResourceID(int type, void *resource) {
+	if(resource == NULL)
+		return 0;
+	std::map<void*, unsigned int> &ids = resourceIDs[type];
+	std::map<void*, unsigned int>::iterator it = ids.find(resource);
+	if(it != ids.end())
+		return it->second;
+	unsigned int id = ids.size() + 1;
+	ids[resource] = id;
+	return id;
+}
+
+unsigned int RenderQueue::quantizeDepth(Number depth, int exponentBits, int mantissaBits) {
+	if(depth < 0)
+		depth = 0;
+	
+	// the exponent gives logarithmic buckets, the mantissa orders items within a bucket
+	int exponent;
+	Number mantissa = frexp(depth + 1.0, &exponent);
+	
+	unsigned int maxExponent = (1 << exponentBits) - 1;
+	unsigned int maxMantissa = (1 << mantissaBits) - 1;
+	unsigned int e = exponent - 1;
+	unsigned int m = (unsigned int)((mantissa - 0.5) * 2.0 * (maxMantissa + 1));
+	if(e > maxExponent) {
+		e = maxExponent;
+		m = maxMantissa;
+	}
+	if(m > maxMantissa)
+		m = maxMantissa;
+	return (e << mantissaBits) | m;
+}
+
+unsigned long long RenderQueue::buildSortKey(RenderQueueItem &item) {
+	unsigned long long shaderID = 0;
+	if(item.material)
+		shaderID = getResourceID(RESOURCE_SHADER, item.material->getShader(0));
+	unsigned long long materialID = getResourceID(RESOURCE_MATERIAL, item.material);
+	unsigned long long textureID = getResourceID(RESOURCE_TEXTURE, item.texture);
+	unsigned long long meshID = getResourceID(RESOURCE_MESH, item.mesh);
+	
+	item.sortIDs[RESOURCE_SHADER] = shaderID;
+	item.sortIDs[RESOURCE_MATERIAL] = materialID;
+	item.sortIDs[RESOURCE_TEXTURE] = textureID;
+	item.sortIDs[RESOURCE_MESH] = meshID;
+	
+	unsigned long long key = ((unsigned long long)item.pass) << 62;
+	if(item.pass == PASS_OPAQUE) {
+		// pass:2 bucket:4 shader:8 material:12 texture:12 mesh:12 depth:14
+		unsigned long long depth = quantizeDepth(item.depth, 4, 14);
+		item.sortDepth = depth;
+		if(shaderID > 0xFF || materialID > 0xFFF || textureID > 0xFFF || meshID > 0xFFF)
+			idOverflow = true;
+		key |= (depth >> 14) << 58;
+		key |= (shaderID & 0xFF) << 50;
+		key |= (materialID & 0xFFF) << 38;
+		key |= (textureID & 0xFFF) << 26;
+		key |= (meshID & 0xFFF) << 14;
+		key |= depth & 0x3FFF;
+	} else {
+		// pass:2 depth:24 shader:6 material:10 texture:11 mesh:11, far to near
+		item.sortDepth = quantizeDepth(item.depth, 5, 19);
+		if(shaderID > 0x3F || materialID > 0x3FF || textureID > 0x7FF || meshID > 0x7FF)
+			idOverflow = true;
+		unsigned long long depth = 0xFFFFFF - item.sortDepth;
+		key |= depth << 38;
+		key |= (shaderID & 0x3F) << 32;
+		key |= (materialID & 0x3FF) << 22;
+		key |= (textureID & 0x7FF) << 11;
+		key |= meshID & 0x7FF;
+	}
+	return key;
+}
+
+void RenderQueue::execute(Renderer *renderer) {
+	if(items.size() == 0)
+		return;
+	
+	sortEntries.resize(items.size());
+	for(unsigned int i=0; i < items.size(); i++) {
+		sortEntries[i].key = buildSortKey(items[i]);
+		sortEntries[i].index = i;
+	}
+	if(idOverflow)
+		std::sort(sortEntries.begin(), sortEntries.end(), RenderQueueFullCompare(items));
+	else
+		std::sort(sortEntries.begin(), sortEntries.end());
+	
+	int baseRenderMode = renderer->getRenderMode();
+	renderer->pushMatrix();
+	
+	numResourceChanges = 0;
+	
+	RenderQueueItem *last = NULL;
+	bool shaderActive = false;
+	bool resourcesKnown = false;
+	bool colorKnown = false;
+	bool matrixKnown = false;
+	Material *currentMaterial = NULL;
+	ShaderBinding *currentOptions = NULL;
+	Texture *currentTexture = NULL;
+	Color currentColor;
+	Matrix4 currentMatrix;
+	
+	for(unsigned int i=0; i < sortEntries.size(); i++) {
+		RenderQueueItem &item = items[sortEntries[i].index];
+		
+		if(!last || last->depthWrite != item.depthWrite)
+			renderer->enableDepthWrite(item.depthWrite);
+		if(!last || last->depthTest != item.depthTest)
+			renderer->enableDepthTest(item.depthTest);
+		if(!last || last->alphaTest != item.alphaTest)
+			renderer->enableAlphaTest(item.alphaTest);
+		if(!last || last->blendingMode != item.blendingMode)
+			renderer->setBlendingMode(item.blendingMode);
+		if(!last || last->backfaceCulled != item.backfaceCulled)
+			renderer->enableBackfaceCulling(item.backfaceCulled);
+		if(!last || last->wireframe != item.wireframe)
+			renderer->setRenderMode(item.wireframe ? Renderer::RENDER_MODE_WIREFRAME : baseRenderMode);
+		
+		if(!colorKnown || currentColor.r != item.color.r || currentColor.g != item.color.g || currentColor.b != item.color.b || currentColor.a != item.color.a) {
+			renderer->setVertexColor(item.color.r, item.color.g, item.color.b, item.color.a);
+			currentColor = item.color;
+			colorKnown = true;
+		}
+		
+		// items of one entity, and entities sharing a transform, draw with the same matrix
+		if(!matrixKnown || memcmp(currentMatrix.ml, item.modelviewMatrix.ml, sizeof(currentMatrix.ml)) != 0) {
+			renderer->setModelviewMatrix(item.modelviewMatrix);
+			currentMatrix = item.modelviewMatrix;
+			matrixKnown = true;
+		}
+		
+		if(item.hasResources) {
+			if(item.material) {
+				if(!resourcesKnown || currentMaterial != item.material || currentOptions != item.localShaderOptions) {
+					if(shaderActive && currentMaterial != item.material)
+						renderer->clearShader();
+					renderer->applyMaterial(item.material, item.localShaderOptions, 0);
+					shaderActive = true;
+					numResourceChanges++;
+				}
+				// materials bind their own textures
+				currentTexture = NULL;
+			} else {
+				if(shaderActive) {
+					renderer->clearShader();
+					shaderActive = false;
+				}
+				if(!resourcesKnown || currentMaterial != NULL || currentTexture != item.texture) {
+					renderer->setTexture(item.texture);
+					numResourceChanges++;
+				}
+				currentTexture = item.texture;
+			}
+			currentMaterial = item.material;
+			currentOptions = item.localShaderOptions;
+			resourcesKnown = true;
+			
+			item.entity->renderGeometry();
+			
+			if(item.mesh && item.mesh->useVertexColors)
+				colorKnown = false;
+		} else {
+			// the entity binds its own state, so nothing is known about it afterwards
+			if(shaderActive) {
+				renderer->clearShader();
+				shaderActive = false;
+			}
+			item.entity->Render();
+			resourcesKnown = false;
+			colorKnown = false;
+			matrixKnown = false;
+		}
+		// entities that render themselves can change any render state, so the next item sets all of it again
+		last = item.hasResources ? &item : NULL;
+	}
+	
+	if(shaderActive)
+		renderer->clearShader();
+	
+	renderer->setRenderMode(baseRenderMode);
+	renderer->enableDepthWrite(true);
+	renderer->enableDepthTest(true);
+	renderer->popMatrix();
+	
+	clear();
+}
+
+void RenderQueue::clear() {
+	items.clear();
+	for(int i=0; i < 4; i++) {
+		resourceIDs[i].clear();
+	}
+	idOverflow = false;
+}
@@ -21,6 +21,7 @@
 */
 
 #include "PolyRenderer.h"
+#include <math.h>
 
 using namespace Polycode;
 
@@ -43,6 +44,10 @@ Renderer::Renderer() : currentTexture(NULL), xRes(0), yRes(0), renderMode(0), or
 	previousFrameBufferTexture = NULL;
 	fov = 45.0;
 	cullingFrontFaces = false;
+	nearPlane = 0.1f;
+	farPlane = 100.0f;
+	viewportWidth = 0;
+	viewportHeight = 0;
 }
 
 Renderer::~Renderer() {
@@ -164,6 +169,73 @@ void Renderer::addLight(Vector3 position, Vector3 direction, int type, Color col
 	}
 }
 
+Matrix4 Renderer::getProjectionMatrix() {
+	return projectionMatrix;
+}
+
+Matrix4 Renderer::getModelviewMatrix() {
+	return modelviewMatrix;
+}
+
+void Renderer::setPerspectiveProjection(Number fov, Number aspect) {
+	Number f = 1.0f / tan((fov * TORADIANS) / 2.0f);
+	projectionMatrix = Matrix4(f/aspect, 0, 0, 0,
+							   0, f, 0, 0,
+							   0, 0, (farPlane+nearPlane)/(nearPlane-farPlane), -1,
+							   0, 0, (2.0f*farPlane*nearPlane)/(nearPlane-farPlane), 0);
+}
+
+void Renderer::setOrthoProjection(Number left, Number right, Number bottom, Number top, Number zNear, Number zFar) {
+	projectionMatrix = Matrix4(2.0f/(right-left), 0, 0, 0,
+							   0, 2.0f/(top-bottom), 0, 0,
+							   0, 0, -2.0f/(zFar-zNear), 0,
+							   -(right+left)/(right-left), -(top+bottom)/(top-bottom), -(zFar+zNear)/(zFar-zNear), 1);
+}
+
+Vector3 Renderer::unprojectPoint(Number x, Number y, Number depth) {
+	return unprojectPoint(x, y, depth, projectionMatrix, modelviewMatrix);
+}
+
+Vector3 Renderer::unprojectPoint(Number x, Number y, Number depth, const Matrix4 &projection, const Matrix4 &modelview) {
+	int width = viewportWidth > 0 ? viewportWidth : xRes;
+	int height = viewportHeight > 0 ? viewportHeight : yRes;
+	if(width <= 0 || height <= 0)
+		return Vector3(0,0,0);
+	
+	Number in[4];
+	in[0] = (x / width) * 2.0f - 1.0f;
+	in[1] = ((height - y) / height) * 2.0f - 1.0f;
+	in[2] = depth * 2.0f - 1.0f;
+	in[3] = 1.0f;
+	
+	Matrix4 inv = (modelview * projection).inverse();
+	Number out[4];
+	for(int j=0; j < 4; j++) {
+		out[j] = in[0] * inv.m[0][j] + in[1] * inv.m[1][j] + in[2] * inv.m[2][j] + in[3] * inv.m[3][j];
+	}
+	if(out[3] == 0.0f)
+		return Vector3(0,0,0);
+	return Vector3(out[0] / out[3], out[1] / out[3], out[2] / out[3]);
+}
+
+void Renderer::extractFrustumPlanes(const Matrix4 &projection, const Matrix4 &modelview, Number planes[6][4]) {
+	Matrix4 mvp = modelview * projection;
+	
+	// each plane is the fourth column of the matrix plus or minus one of the others
+	static const int axis[6] = {0, 0, 1, 1, 2, 2};
+	static const Number sign[6] = {-1, 1, 1, -1, -1, 1};
+	
+	for(int i=0; i < 6; i++) {
+		for(int j=0; j < 4; j++) {
+			planes[i][j] = mvp.ml[j*4+3] + sign[i] * mvp.ml[j*4+axis[i]];
+		}
+		Number t = (Number) sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		for(int j=0; j < 4; j++) {
+			planes[i][j] /= t;
+		}
+	}
+}
+
 Matrix4 Renderer::getCameraMatrix() {
 	return cameraMatrix;
 }
@@ -208,17 +280,58 @@ void Renderer::billboardMatrix() {
 }
 
 void Renderer::pushDataArrayForMesh(Mesh *mesh, int arrayType) {
-	if(mesh->arrayDirtyMap[arrayType] == true || mesh->renderDataArrays[arrayType] == NULL) {
-		if(mesh->renderDataArrays[arrayType] != NULL) {
-			free(mesh->renderDataArrays[arrayType]->arrayPtr);
-			delete mesh->renderDataArrays[arrayType];
+	bool dirty = mesh->arrayDirtyMap[arrayType];
+	
+	if(mesh->renderDataArrays[arrayType] == NULL || dirty) {
+		if(mesh->isIndexed())
+			mesh->commitPolygonView(arrayType);
+		
+		if(mesh->renderDataArrays[arrayType] == NULL) {
+			mesh->renderDataArrays[arrayType] = createRenderDataArrayForMesh(mesh, arrayType);
+		} else {
+			updateRenderDataArrayForMesh(mesh, mesh->renderDataArrays[arrayType]);
 		}
-		mesh->renderDataArrays[arrayType] = createRenderDataArrayForMesh(mesh, arrayType);
 		mesh->arrayDirtyMap[arrayType] = false;
+		
+		// the dirty flag was consumed here, so an interleaved copy is stale now
+		if(dirty && arrayType <= RenderDataArray::TEXCOORD_DATA_ARRAY)
+			mesh->arrayDirtyMap[RenderDataArray::INTERLEAVED_DATA_ARRAY] = true;
 	}
 	pushRenderDataArray(mesh->renderDataArrays[arrayType]);
 }
 
+void Renderer::pushInterleavedDataArrayForMesh(Mesh *mesh, bool useColors) {
+	int interleaved = RenderDataArray::INTERLEAVED_DATA_ARRAY;
+	bool dirty = mesh->arrayDirtyMap[interleaved];
+	
+	for(int i=RenderDataArray::VERTEX_DATA_ARRAY; i <= RenderDataArray::TEXCOORD_DATA_ARRAY; i++) {
+		if(mesh->arrayDirtyMap[i]) {
+			dirty = true;
+			if(mesh->isIndexed())
+				mesh->commitPolygonView(i);
+			
+			// separate arrays of this type are stale, drop them so they get rebuilt if they are used again
+			if(mesh->renderDataArrays[i]) {
+				free(mesh->renderDataArrays[i]->arrayPtr);
+				delete mesh->renderDataArrays[i];
+				mesh->renderDataArrays[i] = NULL;
+			}
+			mesh->arrayDirtyMap[i] = false;
+		}
+	}
+	
+	if(mesh->renderDataArrays[interleaved] == NULL) {
+		if(mesh->isIndexed())
+			mesh->commitPolygonView();
+		mesh->renderDataArrays[interleaved] = createRenderDataArrayForMesh(mesh, interleaved);
+	} else if(dirty) {
+		updateRenderDataArrayForMesh(mesh, mesh->renderDataArrays[interleaved]);
+	}
+	mesh->arrayDirtyMap[interleaved] = false;
+	
+	pushInterleavedRenderDataArray(mesh->renderDataArrays[interleaved], useColors);
+}
+
 int Renderer::getXRes() {
 	return xRes;
 }
@@ -21,11 +21,13 @@
 */
 
 #include "PolyResource.h"
+#include "PolyResourceManager.h"
 
 using namespace Polycode;
 
 Resource::Resource(int type) {
 	this->type = type;
+	resourceManager = NULL;
 }
 
 Resource::~Resource() {
@@ -41,7 +43,10 @@ int Resource::getResourceType() {
 }
 
 void Resource::setResourceName(String newName) {
+	String oldName = name;
 	name = newName;
+	if(resourceManager)
+		resourceManager->reindexResource(this, oldName);
 }
 
 void Resource::setResourcePath(String path) {
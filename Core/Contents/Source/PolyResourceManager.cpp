@@ -21,11 +21,13 @@
 */
 
 #include "PolyResourceManager.h"
+#include <algorithm>
 
 using namespace Polycode;
 
 ResourceManager::ResourceManager() {
 	PHYSFS_init(NULL);
+	resourceIndex.resize(INITIAL_INDEX_SIZE);
 }
 
 ResourceManager::~ResourceManager() {
@@ -37,172 +39,257 @@ ResourceManager::~ResourceManager() {
 		resources.clear();
 }
 
-void ResourceManager::parseShaders(String dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
+unsigned int ResourceManager::hashResourceKey(int resourceType, const String &resourceName) {
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	hash = (hash ^ (unsigned int)resourceType) * 16777619u;
+	for(int i=0; i < resourceName.contents.size(); i++) {
+		hash = (hash ^ (unsigned int)resourceName[i]) * 16777619u;
+	}
+	return hash;
+}
+
+void ResourceManager::indexResource(ResourceHandle handle) {
+	Resource *resource = resources[handle];
+	unsigned int hash = hashResourceKey(resource->getResourceType(), resource->getResourceName());
+	resourceIndex[hash & (resourceIndex.size()-1)].push_back(handle);
+}
+
+void ResourceManager::growIndex() {
+	// the bucket count stays a power of two
+	unsigned int newSize = resourceIndex.size() * 2;
+	resourceIndex.clear();
+	resourceIndex.resize(newSize);
 	
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "mat") {
-				Logger::log("Adding shaders from %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				TiXmlDocument doc(resourceDir[i].fullPath.c_str());
-				doc.LoadFile();
-				if(doc.Error()) {
-					Logger::log("XML Error: %s\n", doc.ErrorDesc());
-				} else {
-					TiXmlElement *mElem = doc.RootElement()->FirstChildElement("shaders");
-					
-					if(mElem) {
-						TiXmlNode* pChild;					
-						for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {						
-							Shader *newShader = CoreServices::getInstance()->getMaterialManager()->createShaderFromXMLNode(pChild);
-							if(newShader != NULL) {
-								Logger::log("Adding shader %s\n", newShader->getName().c_str());
-								newShader->setResourceName(newShader->getName());
-								resources.push_back(newShader);
-							}
-						}
-					}
-				}
-			}
-		} else {
-			if(recursive)
-				parseShaders(dirPath+"/"+resourceDir[i].name, true);
+	// reinsert in order, so the first of several resources with the same key stays in front
+	for(ResourceHandle i=0; i < resources.size(); i++) {
+		indexResource(i);
+	}
+}
+
+ResourceHandle ResourceManager::addResource(Resource *resource) {
+	ResourceHandle handle = resources.size();
+	resources.push_back(resource);
+	resource->resourceManager = this;
+	if(resources.size() > resourceIndex.size()) {
+		growIndex();
+	} else {
+		indexResource(handle);
+	}
+	return handle;
+}
+
+void ResourceManager::reindexResource(Resource *resource, const String &oldName) {
+	unsigned int mask = resourceIndex.size()-1;
+	vector<ResourceHandle> &oldBucket = resourceIndex[hashResourceKey(resource->getResourceType(), oldName) & mask];
+	ResourceHandle handle = INVALID_RESOURCE_HANDLE;
+	for(int i=0; i < oldBucket.size(); i++) {
+		if(resources[oldBucket[i]] == resource) {
+			handle = oldBucket[i];
+			oldBucket.erase(oldBucket.begin() + i);
+			break;
+		}
+	}
+	if(handle == INVALID_RESOURCE_HANDLE)
+		return;
+	
+	// buckets are kept in handle order, so the first of several resources with the same key stays in front
+	vector<ResourceHandle> &newBucket = resourceIndex[hashResourceKey(resource->getResourceType(), resource->getResourceName()) & mask];
+	newBucket.insert(std::lower_bound(newBucket.begin(), newBucket.end(), handle), handle);
+}
+
+ResourceHandle ResourceManager::getResourceHandle(int resourceType, String resourceName) {
+	unsigned int hash = hashResourceKey(resourceType, resourceName);
+	vector<ResourceHandle> &bucket = resourceIndex[hash & (resourceIndex.size()-1)];
+	for(int i=0; i < bucket.size(); i++) {
+		Resource *resource = resources[bucket[i]];
+		if(resource->getResourceType() == resourceType && resource->getResourceName() == resourceName) {
+			return bucket[i];
 		}
 	}
+	return INVALID_RESOURCE_HANDLE;
+}
+
+Resource *ResourceManager::getResourceByHandle(ResourceHandle handle) {
+	if(handle >= resources.size())
+		return NULL;
+	return resources[handle];
+}
+
+Resource *ResourceManager::getResource(int resourceType, String resourceName) {
+	ResourceHandle handle = getResourceHandle(resourceType, resourceName);
+	if(handle == INVALID_RESOURCE_HANDLE) {
+		Logger::log("Resource %s not found\n", resourceName.c_str());
+		// need to add some sort of default resource for each type
+		return NULL;
+	}
+	return resources[handle];
 }
 
 void ResourceManager::addShaderModule(PolycodeShaderModule *module) {
 	shaderModules.push_back(module);
 }
 
-void ResourceManager::parsePrograms(String dirPath, bool recursive) {
+void ResourceManager::scanDirectory(String dirPath, bool recursive, vector<OSFileEntry> &files) {
 	vector<OSFileEntry> resourceDir;
 	resourceDir = OSBasics::parseFolder(dirPath, false);
 	for(int i=0; i < resourceDir.size(); i++) {	
 		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			for(int m=0; m < shaderModules.size(); m++) {
-				PolycodeShaderModule *shaderModule = shaderModules[m];
-				if(shaderModule->acceptsExtension(resourceDir[i].extension)) {
-					Resource *newProgram = shaderModule->createProgramFromFile(resourceDir[i].extension, resourceDir[i].fullPath);
-					if(newProgram) {
-						newProgram->setResourceName(resourceDir[i].name);
-						newProgram->setResourcePath(resourceDir[i].fullPath);				
-						resources.push_back(newProgram);					
-					}
-				}
-			}
+			files.push_back(resourceDir[i]);
 		} else {
 			if(recursive)
-				parsePrograms(dirPath+"/"+resourceDir[i].name, true);
+				scanDirectory(dirPath+"/"+resourceDir[i].name, true, files);
 		}
-	}	
+	}
 }
 
-void ResourceManager::parseMaterials(String dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
-	
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "mat") {
-				Logger::log("Adding materials from %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				TiXmlDocument doc(resourceDir[i].fullPath.c_str());
-				doc.LoadFile();
-				if(doc.Error()) {
-					Logger::log("XML Error: %s\n", doc.ErrorDesc());
-				} else {
-					TiXmlElement *mElem = doc.RootElement()->FirstChildElement("materials");
-					if(mElem) {
-						TiXmlNode* pChild;					
-						for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-							Material *newMat = CoreServices::getInstance()->getMaterialManager()->materialFromXMLNode(pChild);
-							newMat->setResourceName(newMat->getName());
-							resources.push_back(newMat);
-						}
-					}
-				}
+TiXmlDocument *ResourceManager::loadMaterialFile(OSFileEntry entry) {
+	Logger::log("Adding materials from %s\n", entry.nameWithoutExtension.c_str());
+	TiXmlDocument *doc = new TiXmlDocument(entry.fullPath.c_str());
+	doc->LoadFile();
+	if(doc->Error() || !doc->RootElement()) {
+		Logger::log("XML Error: %s\n", doc->ErrorDesc());
+		delete doc;
+		return NULL;
+	}
+	return doc;
+}
+
+void ResourceManager::loadTexture(OSFileEntry entry) {
+	Logger::log("Adding texture %s\n", entry.nameWithoutExtension.c_str());
+	Texture *t = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(entry.fullPath);
+	if(t) {
+		t->setResourceName(entry.name);
+		addResource(t);
+	}
+}
+
+void ResourceManager::loadPrograms(OSFileEntry entry) {
+	for(int m=0; m < shaderModules.size(); m++) {
+		PolycodeShaderModule *shaderModule = shaderModules[m];
+		if(shaderModule->acceptsExtension(entry.extension)) {
+			Resource *newProgram = shaderModule->createProgramFromFile(entry.extension, entry.fullPath);
+			if(newProgram) {
+				newProgram->setResourceName(entry.name);
+				newProgram->setResourcePath(entry.fullPath);				
+				addResource(newProgram);
 			}
-		} else {
-			if(recursive)
-				parseMaterials(dirPath+"/"+resourceDir[i].name, true);
 		}
 	}
 }
 
-void ResourceManager::parseCubemaps(String dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
-	
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "mat") {
-				Logger::log("Adding cubemaps from %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				TiXmlDocument doc(resourceDir[i].fullPath.c_str());
-				doc.LoadFile();
-				if(doc.Error()) {
-					Logger::log("XML Error: %s\n", doc.ErrorDesc());
-				} else {
-					TiXmlElement *mElem = doc.RootElement()->FirstChildElement("cubemaps");
-					
-					if(mElem) {
-						TiXmlNode* pChild;					
-						for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
-							Cubemap *newMat = CoreServices::getInstance()->getMaterialManager()->cubemapFromXMLNode(pChild);
-							//						newMat->setResourceName(newMat->getName());
-							if(newMat)
-								resources.push_back(newMat);
-						}
-					}
-				}
+void ResourceManager::loadShaders(TiXmlDocument *doc) {
+	TiXmlElement *mElem = doc->RootElement()->FirstChildElement("shaders");
+	if(mElem) {
+		TiXmlNode* pChild;					
+		for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {						
+			Shader *newShader = CoreServices::getInstance()->getMaterialManager()->createShaderFromXMLNode(pChild);
+			if(newShader != NULL) {
+				Logger::log("Adding shader %s\n", newShader->getName().c_str());
+				newShader->setResourceName(newShader->getName());
+				addResource(newShader);
 			}
-		} else {
-			if(recursive)
-				parseCubemaps(dirPath+"/"+resourceDir[i].name, true);
 		}
-	}	
+	}
+}
+
+void ResourceManager::loadCubemaps(TiXmlDocument *doc) {
+	TiXmlElement *mElem = doc->RootElement()->FirstChildElement("cubemaps");
+	if(mElem) {
+		TiXmlNode* pChild;					
+		for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
+			Cubemap *newMat = CoreServices::getInstance()->getMaterialManager()->cubemapFromXMLNode(pChild);
+			if(newMat)
+				addResource(newMat);
+		}
+	}
 }
 
-void ResourceManager::addResource(Resource *resource) {
-	resources.push_back(resource);
+void ResourceManager::loadMaterials(TiXmlDocument *doc) {
+	TiXmlElement *mElem = doc->RootElement()->FirstChildElement("materials");
+	if(mElem) {
+		TiXmlNode* pChild;					
+		for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
+			Material *newMat = CoreServices::getInstance()->getMaterialManager()->materialFromXMLNode(pChild);
+			newMat->setResourceName(newMat->getName());
+			addResource(newMat);
+		}
+	}
 }
 
-void ResourceManager::parseTextures(String dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "png") {
-				Logger::log("Adding texture %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				Texture *t = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(resourceDir[i].fullPath);
-				if(t) {
-					t->setResourceName(resourceDir[i].name);
-					resources.push_back(t);
-				}
+void ResourceManager::loadOther(OSFileEntry entry) {
+	if(entry.extension == "ttf") {
+		Logger::log("Registering font: %s\n", entry.nameWithoutExtension.c_str());
+		CoreServices::getInstance()->getFontManager()->registerFont(entry.nameWithoutExtension, entry.fullPath);
+	}
+}
+
+void ResourceManager::parseShaders(String dirPath, bool recursive) {
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "mat") {
+			TiXmlDocument *doc = loadMaterialFile(files[i]);
+			if(doc) {
+				loadShaders(doc);
+				delete doc;
 			}
-		} else {
-			if(recursive)
-				parseTextures(dirPath+"/"+resourceDir[i].name, true);
 		}
 	}
 }
 
-void ResourceManager::parseOthers(String dirPath, bool recursive) {
-	vector<OSFileEntry> resourceDir;
-	resourceDir = OSBasics::parseFolder(dirPath, false);
-	for(int i=0; i < resourceDir.size(); i++) {	
-		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "ttf") {
-				Logger::log("Registering font: %s\n", resourceDir[i].nameWithoutExtension.c_str());
-				CoreServices::getInstance()->getFontManager()->registerFont(resourceDir[i].nameWithoutExtension, resourceDir[i].fullPath);
+void ResourceManager::parsePrograms(String dirPath, bool recursive) {
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	for(int i=0; i < files.size(); i++) {
+		loadPrograms(files[i]);
+	}
+}
+
+void ResourceManager::parseMaterials(String dirPath, bool recursive) {
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "mat") {
+			TiXmlDocument *doc = loadMaterialFile(files[i]);
+			if(doc) {
+				loadMaterials(doc);
+				delete doc;
 			}
-		} else {
-			if(recursive)
-				parseOthers(dirPath+"/"+resourceDir[i].name, true);
-		}	
+		}
+	}
+}
+
+void ResourceManager::parseCubemaps(String dirPath, bool recursive) {
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "mat") {
+			TiXmlDocument *doc = loadMaterialFile(files[i]);
+			if(doc) {
+				loadCubemaps(doc);
+				delete doc;
+			}
+		}
 	}
 }
 
+void ResourceManager::parseTextures(String dirPath, bool recursive) {
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "png")
+			loadTexture(files[i]);
+	}
+}
+
+void ResourceManager::parseOthers(String dirPath, bool recursive) {
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	for(int i=0; i < files.size(); i++) {
+		loadOther(files[i]);
+	}
+}
 
 void ResourceManager::addArchive(String zipPath) {
 //	if(PHYSFS_addToSearchPath(zipPath.c_str(), 1, getThreadID()) == 0) {
@@ -214,23 +301,41 @@ void ResourceManager::addArchive(String zipPath) {
 }
 
 void ResourceManager::addDirResource(String dirPath, bool recursive) {
-	parseTextures(dirPath, recursive);
-	parsePrograms(dirPath, recursive);
-	parseShaders(dirPath, recursive);
-	parseCubemaps(dirPath, recursive);	
-	parseMaterials(dirPath, recursive);
-	parseOthers(dirPath, recursive);	
-}
-
-Resource *ResourceManager::getResource(int resourceType, String resourceName) {
-	Logger::log("requested %s\n", resourceName.c_str());
-	for(int i =0; i < resources.size(); i++) {
-//		Logger::log("is it %s?\n", resources[i]->getResourceName().c_str());		
-		if(resources[i]->getResourceName() == resourceName && resources[i]->getResourceType() == resourceType) {
-			return resources[i];
+	vector<OSFileEntry> files;
+	scanDirectory(dirPath, recursive, files);
+	
+	// sort the files by what they contain, textures and programs can be loaded right away
+	vector<TiXmlDocument*> materialFiles;
+	vector<int> otherFiles;
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "png") {
+			loadTexture(files[i]);
+		} else if(files[i].extension == "mat") {
+			TiXmlDocument *doc = loadMaterialFile(files[i]);
+			if(doc)
+				materialFiles.push_back(doc);
+		} else {
+			otherFiles.push_back(i);
 		}
 	}
-	Logger::log("return NULL\n");
-	// need to add some sort of default resource for each type
-	return NULL;
-}
\ No newline at end of file
+	
+	for(int i=0; i < otherFiles.size(); i++) {
+		loadPrograms(files[otherFiles[i]]);
+	}
+	
+	// shaders need the programs, materials need shaders, textures and cubemaps
+	for(int i=0; i < materialFiles.size(); i++) {
+		loadShaders(materialFiles[i]);
+	}
+	for(int i=0; i < materialFiles.size(); i++) {
+		loadCubemaps(materialFiles[i]);
+	}
+	for(int i=0; i < materialFiles.size(); i++) {
+		loadMaterials(materialFiles[i]);
+		delete materialFiles[i];
+	}
+	
+	for(int i=0; i < otherFiles.size(); i++) {
+		loadOther(files[otherFiles[i]]);
+	}
+}
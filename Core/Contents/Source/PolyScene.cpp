@@ -21,6 +21,7 @@
 */
 
 #include "PolyScene.h"
+#include "PolyBatchTransform.h"
 
 using namespace Polycode;
 
@@ -35,6 +36,12 @@ Scene::Scene() : EventDispatcher() {
 	hasLightmaps = false;
 	clearColor.setColor(0.13f,0.13f,0.13f,1.0f); 
 	useClearColor = false;	
+	cullingStamp = 0;
+	numVisibleEntities = 0;
+	staticBatching = false;
+	staticBatchCellSize = 50;
+	transformHierarchy = NULL;
+	parallelUpdates = false;
 }
 
 Scene::Scene(bool virtualScene) {
@@ -47,6 +54,12 @@ Scene::Scene(bool virtualScene) {
 	hasLightmaps = false;
 	clearColor.setColor(0.13f,0.13f,0.13f,1.0f); 
 	useClearColor = false;	
+	cullingStamp = 0;
+	numVisibleEntities = 0;
+	staticBatching = false;
+	staticBatchCellSize = 50;
+	transformHierarchy = NULL;
+	parallelUpdates = false;
 }
 
 
@@ -73,6 +86,8 @@ void Scene::Update() {
 
 Scene::~Scene() {
 	Logger::log("Cleaning scene...\n");
+	clearStaticBatches();
+	enableTransformHierarchy(false);
 	for(int i=0; i < entities.size(); i++) {	
 //		delete entities[i];
 	}
@@ -88,6 +103,28 @@ void Scene::enableLighting(bool enable) {
 
 
 
+void Scene::enableTransformHierarchy(bool enable) {
+	if(enable == (transformHierarchy != NULL))
+		return;
+	
+	if(enable) {
+		transformHierarchy = new TransformHierarchy();
+		for(int i=0; i < entities.size(); i++) {
+			entities[i]->setTransformHierarchy(transformHierarchy);
+		}
+	} else {
+		for(int i=0; i < entities.size(); i++) {
+			entities[i]->setTransformHierarchy(NULL);
+		}
+		delete transformHierarchy;
+		transformHierarchy = NULL;
+	}
+}
+
+TransformHierarchy *Scene::getTransformHierarchy() {
+	return transformHierarchy;
+}
+
 void Scene::enableFog(bool enable) {
 	fogEnabled = enable;
 	
@@ -114,17 +151,235 @@ SceneEntity *Scene::getEntityAtScreenPosition(Number x, Number y) {
 void Scene::addEntity(SceneEntity *entity) {
 	entity->setRenderer(CoreServices::getInstance()->getRenderer());
 	entities.push_back(entity);
+	if(transformHierarchy)
+		entity->setTransformHierarchy(transformHierarchy);
 }
 
 void Scene::removeEntity(SceneEntity *entity) {
 	for(int i=0; i < entities.size(); i++) {
 		if(entities[i] == entity) {
 			entities.erase(entities.begin()+i);
+			clearEntityCulling(entity);
+			if(transformHierarchy && entity->getTransformHierarchy() == transformHierarchy)
+				entity->setTransformHierarchy(NULL);
 			return;
 		}		
 	}
 }
 
+void Scene::clearEntityCulling(Entity *entity) {
+	if(cullingTree.isProxy(entity->cullingProxy) && cullingTree.getUserData(entity->cullingProxy) == entity) {
+		cullingTree.destroyProxy(entity->cullingProxy);
+	}
+	entity->cullingProxy = -1;
+	entity->renderCulled = false;
+	entity->subtreeCulled = false;
+	for(int i=0; i < entity->getNumChildren(); i++) {
+		clearEntityCulling(entity->getChildAtIndex(i));
+	}
+}
+
+void Scene::gatherEntityCulling(Entity *entity, vector<SceneCullingUpdate> &updates) {
+	bool culled = false;
+	
+	if(entity->hasCullingBounds()) {
+		SceneCullingUpdate update;
+		update.entity = entity;
+		update.action = SceneCullingUpdate::ACTION_NONE;
+		
+		int proxy = entity->cullingProxy;
+		if(!cullingTree.isProxy(proxy) || cullingTree.getUserData(proxy) != entity) {
+			update.action = SceneCullingUpdate::ACTION_CREATE;
+			update.worldAABB = entity->getWorldAABB();
+			entity->updateCullingBounds();
+		} else if(entity->updateCullingBounds()) {
+			update.action = SceneCullingUpdate::ACTION_MOVE;
+			update.worldAABB = entity->getWorldAABB();
+		}
+		updates.push_back(update);
+		
+		// hidden until a camera query finds it
+		culled = true;
+	} else {
+		entity->cullingProxy = -1;
+	}
+	
+	entity->renderCulled = culled;
+	for(int i=0; i < entity->getNumChildren(); i++) {
+		Entity *child = entity->getChildAtIndex(i);
+		gatherEntityCulling(child, updates);
+		culled = culled && child->subtreeCulled;
+	}
+	entity->subtreeCulled = culled;
+}
+
+void Scene::applyCullingUpdates(const vector<SceneCullingUpdate> &updates) {
+	for(int i=0; i < updates.size(); i++) {
+		const SceneCullingUpdate &update = updates[i];
+		int proxy = update.entity->cullingProxy;
+		
+		switch(update.action) {
+			case SceneCullingUpdate::ACTION_CREATE:
+				proxy = cullingTree.createProxy(update.worldAABB, update.entity);
+				update.entity->cullingProxy = proxy;
+			break;
+			case SceneCullingUpdate::ACTION_MOVE:
+				cullingTree.moveProxy(proxy, update.worldAABB);
+			break;
+		}
+		
+		if(cullingStamps.size() <= proxy)
+			cullingStamps.resize(proxy+1, 0);
+		cullingStamps[proxy] = cullingStamp;
+	}
+}
+
+void Scene::removeStaleCulling() {
+	// drop proxies of entities that have left the scene's hierarchy
+	for(int i=0; i < cullingStamps.size(); i++) {
+		if(cullingTree.isProxy(i) && cullingStamps[i] != cullingStamp) {
+			cullingTree.destroyProxy(i);
+		}
+	}
+}
+
+void Scene::updateCulling() {
+	cullingStamp++;
+	cullingUpdates.clear();
+	for(int i=0; i < entities.size(); i++) {
+		gatherEntityCulling(entities[i], cullingUpdates);
+	}
+	applyCullingUpdates(cullingUpdates);
+	removeStaleCulling();
+}
+
+void Scene::updateEntities() {
+	if(parallelUpdates) {
+		updateEntitiesParallel();
+		return;
+	}
+	
+	for(int i=0; i<entities.size();i++) {
+		entities[i]->doUpdates();		
+		entities[i]->updateEntityMatrix();
+	}	
+	
+	// apply all local matrix changes to the world matrices in one pass
+	if(transformHierarchy)
+		transformHierarchy->updateWorldMatrices();
+	
+	updateCulling();
+}
+
+void Scene::runUpdateJob(void *data) {
+	SceneUpdateBatch *batch = (SceneUpdateBatch*)data;
+	for(int i=batch->beginEntity; i < batch->endEntity; i++) {
+		batch->scene->entities[i]->doUpdates();
+		batch->scene->entities[i]->updateEntityMatrix();
+	}
+}
+
+void Scene::runCullingJob(void *data) {
+	SceneUpdateBatch *batch = (SceneUpdateBatch*)data;
+	for(int i=batch->beginEntity; i < batch->endEntity; i++) {
+		batch->scene->gatherEntityCulling(batch->scene->entities[i], batch->cullingUpdates);
+	}
+}
+
+void Scene::updateEntitiesParallel() {
+	JobSystem *jobSystem = CoreServices::getInstance()->getJobSystem();
+	
+	// a few batches per thread, so that stealing can even out top level
+	// entities with subtrees of very different sizes
+	int numBatches = jobSystem->getNumThreads() * 4;
+	if(numBatches > entities.size())
+		numBatches = entities.size();
+	updateBatches.resize(numBatches);
+	
+	for(int i=0; i < numBatches; i++) {
+		SceneUpdateBatch &batch = updateBatches[i];
+		batch.scene = this;
+		batch.beginEntity = entities.size() * i / numBatches;
+		batch.endEntity = entities.size() * (i+1) / numBatches;
+		batch.cullingUpdates.clear();
+		
+		batch.updateJob.reset();
+		batch.updateJob.function = runUpdateJob;
+		batch.updateJob.data = &batch;
+		batch.cullingJob.reset();
+		batch.cullingJob.function = runCullingJob;
+		batch.cullingJob.data = &batch;
+	}
+	
+	cullingStamp++;
+	JobCounter counter;
+	if(transformHierarchy) {
+		// the sweep needs every local matrix, so it has to run between the
+		// update and culling passes. Until then entities compute their world
+		// matrices from their parents instead of sweeping on their own.
+		transformHierarchy->setSweepForbidden(true);
+		for(int i=0; i < numBatches; i++) {
+			jobSystem->submit(&updateBatches[i].updateJob, &counter);
+		}
+		jobSystem->wait(&counter);
+		transformHierarchy->setSweepForbidden(false);
+		
+		transformHierarchy->updateWorldMatrices();
+		
+		for(int i=0; i < numBatches; i++) {
+			jobSystem->submit(&updateBatches[i].cullingJob, &counter);
+		}
+		jobSystem->wait(&counter);
+	} else {
+		// batches only read matrices of their own subtrees, so each one can
+		// be culled as soon as its own update is done
+		for(int i=0; i < numBatches; i++) {
+			jobSystem->addDependency(&updateBatches[i].cullingJob, &updateBatches[i].updateJob);
+			jobSystem->submit(&updateBatches[i].updateJob, &counter);
+			jobSystem->submit(&updateBatches[i].cullingJob, &counter);
+		}
+		jobSystem->wait(&counter);
+	}
+	
+	// the culling tree is shared, so it is only changed from this thread
+	for(int i=0; i < numBatches; i++) {
+		applyCullingUpdates(updateBatches[i].cullingUpdates);
+	}
+	removeStaleCulling();
+}
+
+void Scene::cullForCamera(Camera *camera) {
+	visibleEntities.clear();
+	unculledParents.clear();
+	cullingTree.queryFrustum(camera, visibleEntities);
+	numVisibleEntities = visibleEntities.size();
+	
+	for(int i=0; i < visibleEntities.size(); i++) {
+		Entity *entity = (Entity*)visibleEntities[i];
+		entity->renderCulled = false;
+		while(entity && entity->subtreeCulled) {
+			entity->subtreeCulled = false;
+			unculledParents.push_back(entity);
+			entity = entity->getParentEntity();
+		}
+	}
+}
+
+void Scene::restoreCulling() {
+	for(int i=0; i < visibleEntities.size(); i++) {
+		((Entity*)visibleEntities[i])->renderCulled = true;
+	}
+	for(int i=0; i < unculledParents.size(); i++) {
+		unculledParents[i]->subtreeCulled = true;
+	}
+	visibleEntities.clear();
+	unculledParents.clear();
+}
+
+int Scene::getNumVisibleEntities() {
+	return numVisibleEntities;
+}
+
 Camera *Scene::getDefaultCamera() {
 	return defaultCamera;
 }
@@ -138,10 +393,7 @@ void Scene::Render(Camera *targetCamera) {
 		targetCamera = defaultCamera;
 	
 	// prepare lights...
-	for(int i=0; i<entities.size();i++) {
-		entities[i]->doUpdates();		
-		entities[i]->updateEntityMatrix();
-	}	
+	updateEntities();
 	
 	//make these the closest
 	
@@ -210,14 +462,12 @@ void Scene::Render(Camera *targetCamera) {
 	}
 	
 	
+	cullForCamera(targetCamera);
 	for(int i=0; i<entities.size();i++) {
-		if(entities[i]->getBBoxRadius() > 0) {
-			if(targetCamera->isSphereInFrustrum((entities[i]->getPosition()), entities[i]->getBBoxRadius()))
-				entities[i]->transformAndRender();
-		} else {
-			entities[i]->transformAndRender();		
-		}
+		entities[i]->enqueueForRender(&renderQueue);
 	}
+	renderQueue.execute(CoreServices::getInstance()->getRenderer());
+	restoreCulling();
 	
 	if(targetCamera->getOrthoMode()) {
 		CoreServices::getInstance()->getRenderer()->setPerspectiveMode();
@@ -241,14 +491,12 @@ void Scene::RenderDepthOnly(Camera *targetCamera) {
 	
 	CoreServices::getInstance()->getRenderer()->setTexture(NULL);
 	CoreServices::getInstance()->getRenderer()->enableShaders(false);
+	cullForCamera(targetCamera);
 	for(int i=0; i<entities.size();i++) {
-		if(entities[i]->getBBoxRadius() > 0) {
-			if(targetCamera->isSphereInFrustrum((entities[i]->getPosition()), entities[i]->getBBoxRadius()))
-				entities[i]->transformAndRender();
-		} else {
-			entities[i]->transformAndRender();		
-		}
+		entities[i]->enqueueForRender(&renderQueue);
 	}	
+	renderQueue.execute(CoreServices::getInstance()->getRenderer());
+	restoreCulling();
 	CoreServices::getInstance()->getRenderer()->enableShaders(true);
 	CoreServices::getInstance()->getRenderer()->cullFrontFaces(false);	
 }
@@ -285,14 +533,14 @@ void Scene::loadScene(String fileName) {
 	
 	Number r,g,b,a;
 	
-	OSBasics::read(&r, sizeof(Number), 1, inFile);
-	OSBasics::read(&g, sizeof(Number), 1, inFile);
-	OSBasics::read(&b, sizeof(Number), 1, inFile);
+	OSBasics::readNumbers(&r, 1, inFile);
+	OSBasics::readNumbers(&g, 1, inFile);
+	OSBasics::readNumbers(&b, 1, inFile);
 	clearColor.setColor(r,g,b,1.0f);
 	
-	OSBasics::read(&r, sizeof(Number), 1, inFile);
-	OSBasics::read(&g, sizeof(Number), 1, inFile);
-	OSBasics::read(&b, sizeof(Number), 1, inFile);
+	OSBasics::readNumbers(&r, 1, inFile);
+	OSBasics::readNumbers(&g, 1, inFile);
+	OSBasics::readNumbers(&b, 1, inFile);
 	ambientColor.setColor(r,g,b,1.0f);
 	
 	
@@ -313,8 +561,8 @@ void Scene::loadScene(String fileName) {
 	Logger::log("Loading scene (%d objects)\n", numObjects);
 	for(int i=0; i < numObjects; i++) {
 		
-		OSBasics::read(t, sizeof(Number), 3, inFile);
-		OSBasics::read(rq, sizeof(Number), 4, inFile);
+		OSBasics::readNumbers(t, 3, inFile);
+		OSBasics::readNumbers(rq, 4, inFile);
 		newEntity = NULL;
 		
 		OSBasics::read(&objectType, sizeof(unsigned int), 1, inFile);
@@ -339,10 +587,10 @@ void Scene::loadScene(String fileName) {
 				
 				Logger::log("adding mesh (texture: %s)\n", buffer);
 				
-				OSBasics::read(&r, sizeof(Number), 1, inFile);
-				OSBasics::read(&g, sizeof(Number), 1, inFile);
-				OSBasics::read(&b, sizeof(Number), 1, inFile);
-				OSBasics::read(&a, sizeof(Number), 1, inFile);
+				OSBasics::readNumbers(&r, 1, inFile);
+				OSBasics::readNumbers(&g, 1, inFile);
+				OSBasics::readNumbers(&b, 1, inFile);
+				OSBasics::readNumbers(&a, 1, inFile);
 				
 				newMaterial = (Material*) CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, buffer);
 				newMesh = new Mesh(Mesh::TRI_MESH);
@@ -376,7 +624,7 @@ void Scene::loadScene(String fileName) {
 				Mesh *mesh = new Mesh(Mesh::TRI_MESH);
 				
 				for(int i=0; i < numVertices; i++) {
-					OSBasics::read(co, sizeof(Number), 3, inFile);
+					OSBasics::readNumbers(co, 3, inFile);
 					Vertex *newVert = new Vertex(co[0], co[1], co[2]);
 					mesh->addVertex(newVert);
 				}
@@ -413,9 +661,9 @@ void Scene::loadScene(String fileName) {
 				Number col[3],e,d;
 				unsigned int lType;
 				OSBasics::read(&lType, sizeof(unsigned int), 1, inFile);				
-				OSBasics::read(&e, sizeof(Number), 1, inFile);
-				OSBasics::read(&d, sizeof(Number), 1, inFile);
-				OSBasics::read(col, sizeof(Number), 3, inFile);
+				OSBasics::readNumbers(&e, 1, inFile);
+				OSBasics::readNumbers(&d, 1, inFile);
+				OSBasics::readNumbers(col, 3, inFile);
 				
 				SceneLight *newLight = new SceneLight(lType, e, d, this);
 				newLight->lightColor.setColor(col[0],col[1],col[2],1.0f);
@@ -456,6 +704,9 @@ void Scene::loadScene(String fileName) {
 		}		
 	}
 	
+	if(staticBatching)
+		batchStaticGeometry();
+	
 	if(!hasLightmaps) {
 		OSBasics::close(inFile);
 		return;
@@ -514,8 +765,8 @@ void Scene::writeEntityMatrix(SceneEntity *entity, OSFILE *outFile) {
 	rq[2] = entity->getRotationQuat().y;
 	rq[3] = entity->getRotationQuat().z;						
 	
-	OSBasics::write(t, sizeof(Number), 3, outFile);
-	OSBasics::write(rq, sizeof(Number), 4, outFile);
+	OSBasics::writeNumbers(t, 3, outFile);
+	OSBasics::writeNumbers(rq, 4, outFile);
 	
 }
 
@@ -575,7 +826,7 @@ void Scene::saveScene(String fileName) {
 			pos[0] = vert->x;
 			pos[1] = vert->y;
 			pos[2] = vert->z;			
-			OSBasics::write(pos, sizeof(Number),3, outFile);
+			OSBasics::writeNumbers(pos, 3, outFile);
 		}
 		
 		unsigned int numFaces = mesh->getMesh()->getPolygonCount();
@@ -604,9 +855,9 @@ void Scene::saveScene(String fileName) {
 		e = lights[i]->getIntensity();
 		d = lights[i]->getDistance();
 		
-		OSBasics::write(&e, sizeof(Number), 1, outFile);
-		OSBasics::write(&d, sizeof(Number), 1, outFile);
-		OSBasics::write(col, sizeof(Number), 3, outFile);
+		OSBasics::writeNumbers(&e, 1, outFile);
+		OSBasics::writeNumbers(&d, 1, outFile);
+		OSBasics::writeNumbers(col, 3, outFile);
 	}
 	*/
 	for(int i=0; i < customEntities.size(); i++) {
@@ -665,6 +916,222 @@ SceneMesh *Scene::getStaticGeometry(int index) {
 	return staticGeometry[index];
 }
 
+bool StaticBatchKey::operator < (const StaticBatchKey &other) const {
+	if(material != other.material)
+		return material < other.material;
+	if(texture != other.texture)
+		return texture < other.texture;
+	if(lightmapIndex != other.lightmapIndex)
+		return lightmapIndex < other.lightmapIndex;
+	if(backfaceCulled != other.backfaceCulled)
+		return backfaceCulled < other.backfaceCulled;
+	if(alphaTest != other.alphaTest)
+		return alphaTest < other.alphaTest;
+	if(depthTest != other.depthTest)
+		return depthTest < other.depthTest;
+	if(depthWrite != other.depthWrite)
+		return depthWrite < other.depthWrite;
+	if(cellX != other.cellX)
+		return cellX < other.cellX;
+	if(cellY != other.cellY)
+		return cellY < other.cellY;
+	return cellZ < other.cellZ;
+}
+
+bool Scene::isStaticBatchable(SceneMesh *sceneMesh) {
+	if(!sceneMesh->visible || sceneMesh->getEntityProp("batch") == "false")
+		return false;
+	if(sceneMesh->getSkeleton())
+		return false;
+	// batches are drawn as opaque geometry, translucent meshes have to stay sorted back to front
+	if(sceneMesh->getCombinedColor().a < 1.0 || sceneMesh->blendingMode != Renderer::BLEND_MODE_NORMAL || !sceneMesh->depthWrite)
+		return false;
+	Mesh *mesh = sceneMesh->getMesh();
+	if(mesh->getMeshType() != Mesh::TRI_MESH || mesh->hasBoneStream())
+		return false;
+	return true;
+}
+
+void Scene::batchStaticGeometry() {
+	clearStaticBatches();
+	
+	map<StaticBatchKey, vector<SceneMesh*> > groups;
+	for(int i=0; i < staticGeometry.size(); i++) {
+		SceneMesh *sceneMesh = staticGeometry[i];
+		if(!isStaticBatchable(sceneMesh))
+			continue;
+		
+		Vector3 position = sceneMesh->getConcatenatedMatrix().getPosition();
+		StaticBatchKey key;
+		key.material = sceneMesh->getMaterial();
+		if(!key.material)
+			key.texture = sceneMesh->getTexture();
+		key.lightmapIndex = sceneMesh->lightmapIndex;
+		key.backfaceCulled = sceneMesh->backfaceCulled;
+		key.alphaTest = sceneMesh->alphaTest;
+		key.depthTest = sceneMesh->depthTest;
+		key.depthWrite = sceneMesh->depthWrite;
+		key.cellX = (int)floor(position.x / staticBatchCellSize);
+		key.cellY = (int)floor(position.y / staticBatchCellSize);
+		key.cellZ = (int)floor(position.z / staticBatchCellSize);
+		groups[key].push_back(sceneMesh);
+	}
+	
+	map<StaticBatchKey, vector<SceneMesh*> >::iterator it;
+	for(it = groups.begin(); it != groups.end(); it++) {
+		// a single mesh gains nothing from being copied
+		if(it->second.size() < 2)
+			continue;
+		SceneMesh *batch = createStaticBatch(it->first, it->second);
+		addEntity(batch);
+		staticBatches.push_back(batch);
+	}
+	
+	Logger::log("Batched %d static meshes into %d batches\n", (int)batchedGeometry.size(), (int)staticBatches.size());
+}
+
+// Normals take the inverse transpose of the rotation and scale part, or non-uniform scale skews them.
+// Up to a scale factor that is the cofactor matrix, which stays finite for degenerate transforms.
+static Matrix4 normalMatrix(const Matrix4 &transform) {
+	Vector3 rows[3];
+	for(int i=0; i < 3; i++) {
+		rows[i] = Vector3(transform.m[i][0], transform.m[i][1], transform.m[i][2]);
+	}
+	Vector3 cofactors[3] = {rows[1].crossProduct(rows[2]), rows[2].crossProduct(rows[0]), rows[0].crossProduct(rows[1])};
+	
+	// a mirroring transform has a negative determinant, which would flip the normals
+	Number sign = rows[0].dot(cofactors[0]) < 0 ? -1 : 1;
+	Matrix4 result;
+	for(int i=0; i < 3; i++) {
+		result.m[i][0] = cofactors[i].x * sign;
+		result.m[i][1] = cofactors[i].y * sign;
+		result.m[i][2] = cofactors[i].z * sign;
+	}
+	return result;
+}
+
+SceneMesh *Scene::createStaticBatch(const StaticBatchKey &key, vector<SceneMesh*> &sceneMeshes) {
+	// batch vertices are stored relative to the batch center, so the batch can be culled by its position and radius
+	Vector3 center;
+	for(int i=0; i < sceneMeshes.size(); i++) {
+		center += sceneMeshes[i]->getConcatenatedMatrix().getPosition();
+	}
+	center = center / (Number)sceneMeshes.size();
+	
+	Mesh *batchMesh = new Mesh(Mesh::TRI_MESH);
+	batchMesh->useIndexedStorage(true);
+	batchMesh->useVertexColors = true;
+	
+	for(int i=0; i < sceneMeshes.size(); i++) {
+		SceneMesh *sceneMesh = sceneMeshes[i];
+		Mesh *mesh = sceneMesh->getMesh();
+		Matrix4 transform = sceneMesh->getConcatenatedMatrix();
+		Matrix4 normalTransform = normalMatrix(transform);
+		Color entityColor = sceneMesh->color;
+		Color white(1.0f,1.0f,1.0f,1.0f);
+		
+		if(mesh->isIndexed()) {
+			unsigned int base = batchMesh->getStreamVertexCount();
+			unsigned int vertexCount = mesh->getStreamVertexCount();
+			float *stream = mesh->getVertexStream();
+			
+			Matrix4 batchTransform = transform;
+			batchTransform.setPosition(transform.m[3][0] - center.x, transform.m[3][1] - center.y, transform.m[3][2] - center.z);
+			vector<float> transformed(vertexCount * 6);
+			if(vertexCount > 0) {
+				BatchTransform::transformPoints(batchTransform, stream + Mesh::VERTEX_STREAM_POSITION_OFFSET, Mesh::VERTEX_STREAM_STRIDE, &transformed[0], 6, vertexCount);
+				BatchTransform::transformNormals(normalTransform, stream + Mesh::VERTEX_STREAM_NORMAL_OFFSET, Mesh::VERTEX_STREAM_STRIDE, &transformed[3], 6, vertexCount, true);
+			}
+			
+			for(unsigned int v=0; v < vertexCount; v++) {
+				float *sv = stream + (v * Mesh::VERTEX_STREAM_STRIDE);
+				float *tv = &transformed[v * 6];
+				Vector3 position(tv[0], tv[1], tv[2]);
+				Vector3 normal(tv[3], tv[4], tv[5]);
+				Color color = white;
+				if(mesh->useVertexColors) {
+					float *c = sv + Mesh::VERTEX_STREAM_COLOR_OFFSET;
+					color.setColor(c[0], c[1], c[2], c[3]);
+				}
+				batchMesh->addStreamVertex(position, normal, color * entityColor, Vector2(sv[Mesh::VERTEX_STREAM_TEXCOORD_OFFSET], sv[Mesh::VERTEX_STREAM_TEXCOORD_OFFSET+1]));
+			}
+			for(unsigned int j=0; j < mesh->getIndexCount(); j++) {
+				batchMesh->addIndex(base + mesh->getIndex(j));
+			}
+		} else {
+			for(int p=0; p < mesh->getPolygonCount(); p++) {
+				Polygon *polygon = mesh->getPolygon(p);
+				unsigned int vCount = polygon->getVertexCount();
+				if(vCount < 3)
+					continue;
+				
+				Vector3 faceNormal = normalTransform.rotateVector(polygon->getFaceNormal());
+				faceNormal.Normalize();
+				
+				unsigned int base = batchMesh->getStreamVertexCount();
+				for(int j=0; j < vCount; j++) {
+					Vertex *vertex = polygon->getVertex(j);
+					Vector3 position = (transform * Vector3(vertex->x, vertex->y, vertex->z)) - center;
+					Vector3 normal = faceNormal;
+					if(polygon->useVertexNormals) {
+						normal = normalTransform.rotateVector(vertex->normal);
+						normal.Normalize();
+					}
+					Color color = white;
+					if(mesh->useVertexColors)
+						color = vertex->vertexColor;
+					batchMesh->addStreamVertex(position, normal, color * entityColor, vertex->getTexCoord());
+				}
+				for(int j=1; j+1 < vCount; j++) {
+					batchMesh->addIndex(base);
+					batchMesh->addIndex(base+j);
+					batchMesh->addIndex(base+j+1);
+				}
+			}
+		}
+		
+		sceneMesh->visible = false;
+		batchedGeometry.push_back(sceneMesh);
+	}
+	
+	batchMesh->weldVertices();
+	
+	SceneMesh *batch = new SceneMesh(batchMesh);
+	batch->setPosition(center.x, center.y, center.z);
+	batch->lightmapIndex = key.lightmapIndex;
+	batch->backfaceCulled = key.backfaceCulled;
+	batch->alphaTest = key.alphaTest;
+	batch->depthTest = key.depthTest;
+	batch->depthWrite = key.depthWrite;
+	if(key.material)
+		batch->setMaterial(key.material);
+	else if(key.texture)
+		batch->setTexture(key.texture);
+	return batch;
+}
+
+void Scene::clearStaticBatches() {
+	for(int i=0; i < staticBatches.size(); i++) {
+		removeEntity(staticBatches[i]);
+		delete staticBatches[i]->getMesh();
+		delete staticBatches[i];
+	}
+	staticBatches.clear();
+	
+	for(int i=0; i < batchedGeometry.size(); i++) {
+		batchedGeometry[i]->visible = true;
+	}
+	batchedGeometry.clear();
+}
+
+int Scene::getNumStaticBatches() {
+	return staticBatches.size();
+}
+
+SceneMesh *Scene::getStaticBatch(int index) {
+	return staticBatches[index];
+}
+
 int Scene::getNumLights() {
 	return lights.size();
 }
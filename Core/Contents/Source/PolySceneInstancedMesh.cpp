@@ -0,0 +1,192 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolySceneInstancedMesh.h"
+
+using namespace Polycode;
+
+SceneInstancedMesh::SceneInstancedMesh(Mesh *mesh) : SceneMesh(mesh) {
+	numVisibleInstances = 0;
+	updateInstanceBounds();
+}
+
+SceneInstancedMesh::SceneInstancedMesh(String fileName) : SceneMesh(fileName) {
+	numVisibleInstances = 0;
+	updateInstanceBounds();
+}
+
+SceneInstancedMesh::~SceneInstancedMesh() {
+
+}
+
+unsigned int SceneInstancedMesh::addInstance(const Matrix4 &transform, Color color) {
+	instanceTransforms.push_back(transform);
+	instanceColors.push_back(color);
+	instanceRadii.push_back(0);
+	updateInstanceBound(instanceTransforms.size()-1);
+	updateGroupBounds();
+	return instanceTransforms.size()-1;
+}
+
+void SceneInstancedMesh::removeInstance(unsigned int index) {
+	if(index >= instanceTransforms.size())
+		return;
+	
+	unsigned int last = instanceTransforms.size()-1;
+	instanceTransforms[index] = instanceTransforms[last];
+	instanceColors[index] = instanceColors[last];
+	instanceRadii[index] = instanceRadii[last];
+	instanceTransforms.pop_back();
+	instanceColors.pop_back();
+	instanceRadii.pop_back();
+	updateGroupBounds();
+}
+
+void SceneInstancedMesh::clearInstances() {
+	instanceTransforms.clear();
+	instanceColors.clear();
+	instanceRadii.clear();
+	updateGroupBounds();
+}
+
+void SceneInstancedMesh::setInstanceTransform(unsigned int index, const Matrix4 &transform) {
+	if(index >= instanceTransforms.size())
+		return;
+	instanceTransforms[index] = transform;
+	updateInstanceBound(index);
+	updateGroupBounds();
+}
+
+void SceneInstancedMesh::setInstanceColor(unsigned int index, Color color) {
+	if(index >= instanceColors.size())
+		return;
+	instanceColors[index] = color;
+}
+
+Matrix4 SceneInstancedMesh::getInstanceTransform(unsigned int index) {
+	if(index >= instanceTransforms.size())
+		return Matrix4();
+	return instanceTransforms[index];
+}
+
+Color SceneInstancedMesh::getInstanceColor(unsigned int index) {
+	if(index >= instanceColors.size())
+		return Color();
+	return instanceColors[index];
+}
+
+unsigned int SceneInstancedMesh::getNumInstances() {
+	return instanceTransforms.size();
+}
+
+unsigned int SceneInstancedMesh::getNumVisibleInstances() {
+	return numVisibleInstances;
+}
+
+void SceneInstancedMesh::updateInstanceBounds() {
+	meshRadius = mesh->getRadius();
+	for(unsigned int i=0; i < instanceTransforms.size(); i++) {
+		updateInstanceBound(i);
+	}
+	updateGroupBounds();
+}
+
+void SceneInstancedMesh::updateInstanceBound(unsigned int index) {
+	// the mesh radius is measured from the mesh origin, so the instance sphere is centered on the instance position and grows with its largest axis scale
+	const Matrix4 &m = instanceTransforms[index];
+	Number maxScale = 0;
+	for(int r=0; r < 3; r++) {
+		Number s = sqrt(m.m[r][0]*m.m[r][0] + m.m[r][1]*m.m[r][1] + m.m[r][2]*m.m[r][2]);
+		if(s > maxScale)
+			maxScale = s;
+	}
+	instanceRadii[index] = meshRadius * maxScale;
+}
+
+void SceneInstancedMesh::updateGroupBounds() {
+	Vector3 extents;
+	Number radius = 0;
+	for(unsigned int i=0; i < instanceTransforms.size(); i++) {
+		const Matrix4 &m = instanceTransforms[i];
+		Number r = instanceRadii[i];
+		Number x = m.m[3][0];
+		Number y = m.m[3][1];
+		Number z = m.m[3][2];
+		
+		extents.x = max(extents.x, (Number)fabs(x) + r);
+		extents.y = max(extents.y, (Number)fabs(y) + r);
+		extents.z = max(extents.z, (Number)fabs(z) + r);
+		
+		Number distance = sqrt(x*x + y*y + z*z) + r;
+		if(distance > radius)
+			radius = distance;
+	}
+	bBox = extents * 2;
+	bBoxRadius = radius;
+}
+
+void SceneInstancedMesh::renderGeometry() {
+	numVisibleInstances = 0;
+	if(instanceTransforms.size() == 0)
+		return;
+	
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	
+	// planes in the local space of the instanced mesh, instance transforms can be tested directly
+	Number planes[6][4];
+	Renderer::extractFrustumPlanes(renderer->getProjectionMatrix(), renderer->getModelviewMatrix(), planes);
+	
+	if(visibleTransforms.size() < instanceTransforms.size()) {
+		visibleTransforms.resize(instanceTransforms.size());
+		visibleColors.resize(instanceTransforms.size());
+	}
+	
+	Color combinedColor = getCombinedColor();
+	
+	for(unsigned int i=0; i < instanceTransforms.size(); i++) {
+		const Matrix4 &m = instanceTransforms[i];
+		Number r = instanceRadii[i];
+		bool visible = true;
+		for(int p=0; p < 6; p++) {
+			if(planes[p][0] * m.m[3][0] + planes[p][1] * m.m[3][1] + planes[p][2] * m.m[3][2] + planes[p][3] <= -r) {
+				visible = false;
+				break;
+			}
+		}
+		if(!visible)
+			continue;
+		
+		visibleTransforms[numVisibleInstances] = m;
+		visibleColors[numVisibleInstances] = instanceColors[i] * combinedColor;
+		numVisibleInstances++;
+	}
+	
+	if(numVisibleInstances == 0)
+		return;
+	
+	renderer->pushInterleavedDataArrayForMesh(mesh, mesh->useVertexColors);
+	
+	if(mesh->isIndexed())
+		renderer->pushDataArrayForMesh(mesh, RenderDataArray::INDEX_DATA_ARRAY);
+	
+	renderer->drawArraysInstanced(mesh->getMeshType(), &visibleTransforms[0], &visibleColors[0], numVisibleInstances);
+}
@@ -21,6 +21,8 @@
 */
 
 #include "PolySceneMesh.h"
+#include "PolyRenderQueue.h"
+#include "PolyBatchTransform.h"
 
 using namespace Polycode;
 
@@ -32,6 +34,8 @@ SceneMesh::SceneMesh(String fileName) : SceneEntity(), texture(NULL), material(N
 	lightmapIndex=0;
 	showVertexNormals = false;
 	useVertexBuffer = false;
+	lodHysteresis = 0.1;
+	currentLODLevel = 0;
 }
 
 SceneMesh::SceneMesh(Mesh *mesh) : SceneEntity(), texture(NULL), material(NULL) {
@@ -42,6 +46,8 @@ SceneMesh::SceneMesh(Mesh *mesh) : SceneEntity(), texture(NULL), material(NULL)
 	lightmapIndex=0;
 	showVertexNormals = false;	
 	useVertexBuffer = false;	
+	lodHysteresis = 0.1;
+	currentLODLevel = 0;
 }
 
 SceneMesh::SceneMesh(int meshType) : texture(NULL), material(NULL) {
@@ -52,9 +58,12 @@ SceneMesh::SceneMesh(int meshType) : texture(NULL), material(NULL) {
 	lightmapIndex=0;
 	showVertexNormals = false;	
 	useVertexBuffer = false;	
+	lodHysteresis = 0.1;
+	currentLODLevel = 0;
 }
 
 void SceneMesh::setMesh(Mesh *mesh) {
+	clearLODLevels();
 	this->mesh = mesh;
 	bBoxRadius = mesh->getRadius();
 	bBox = mesh->calculateBBox();
@@ -64,6 +73,7 @@ void SceneMesh::setMesh(Mesh *mesh) {
 
 
 SceneMesh::~SceneMesh() {
+	clearLODLevels();
 }
 
 Mesh *SceneMesh::getMesh() {
@@ -108,16 +118,100 @@ void SceneMesh::loadSkeleton(String fileName) {
 
 void SceneMesh::setSkeleton(Skeleton *skeleton) {
 	this->skeleton = skeleton;
-	for(int i=0; i < mesh->getPolygonCount(); i++) {
-		Polygon *polygon = mesh->getPolygon(i);
-		unsigned int vCount = polygon->getVertexCount();
-		for(int j=0; j < vCount; j++) {
-			Vertex *vertex = polygon->getVertex(j);
-			for(int k=0; k < vertex->getNumBoneAssignments(); k++) {
-				vertex->getBoneAssignment(k)->bone = skeleton->getBone(vertex->getBoneAssignment(k)->boneID);
+	for(unsigned int l=0; l <= lodMeshes.size(); l++) {
+		Mesh *lodMesh = getLODMesh(l);
+		for(int i=0; i < lodMesh->getPolygonCount(); i++) {
+			Polygon *polygon = lodMesh->getPolygon(i);
+			unsigned int vCount = polygon->getVertexCount();
+			for(int j=0; j < vCount; j++) {
+				Vertex *vertex = polygon->getVertex(j);
+				for(int k=0; k < vertex->getNumBoneAssignments(); k++) {
+					vertex->getBoneAssignment(k)->bone = skeleton->getBone(vertex->getBoneAssignment(k)->boneID);
+				}
 			}
 		}
-	}	
+	}
+}
+
+void SceneMesh::addLODLevel(Mesh *lodMesh, Number screenSize) {
+	lodMeshes.push_back(lodMesh);
+	lodScreenSizes.push_back(screenSize);
+	lodMeshesOwned.push_back(false);
+	
+	if(useVertexBuffer && !lodMesh->hasVertexBuffer())
+		CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(lodMesh);
+	if(skeleton)
+		setSkeleton(skeleton);
+}
+
+void SceneMesh::generateLODLevels(unsigned int numLevels, Number triangleRatio, Number firstScreenSize) {
+	clearLODLevels();
+	
+	vector<Mesh*> levels = mesh->createLODChain(numLevels, triangleRatio);
+	Number screenSize = firstScreenSize;
+	for(int i=0; i < levels.size(); i++) {
+		addLODLevel(levels[i], screenSize);
+		lodMeshesOwned[i] = true;
+		screenSize *= 0.5;
+	}
+}
+
+void SceneMesh::clearLODLevels() {
+	for(int i=0; i < lodMeshes.size(); i++) {
+		if(lodMeshesOwned[i])
+			delete lodMeshes[i];
+	}
+	lodMeshes.clear();
+	lodScreenSizes.clear();
+	lodMeshesOwned.clear();
+	currentLODLevel = 0;
+}
+
+unsigned int SceneMesh::getNumLODLevels() {
+	return lodMeshes.size();
+}
+
+Mesh *SceneMesh::getLODMesh(unsigned int level) {
+	if(level == 0 || level > lodMeshes.size())
+		return mesh;
+	return lodMeshes[level-1];
+}
+
+Mesh *SceneMesh::getCurrentMesh() {
+	return getLODMesh(currentLODLevel);
+}
+
+void SceneMesh::updateLODLevel(const Matrix4 &modelviewMatrix) {
+	if(lodMeshes.size() == 0)
+		return;
+	
+	// the largest axis scale, so the bounding sphere stays a bound
+	Number scale = 0;
+	for(int i=0; i < 3; i++) {
+		Number rowLength = sqrt((modelviewMatrix.m[i][0] * modelviewMatrix.m[i][0]) + (modelviewMatrix.m[i][1] * modelviewMatrix.m[i][1]) + (modelviewMatrix.m[i][2] * modelviewMatrix.m[i][2]));
+		if(rowLength > scale)
+			scale = rowLength;
+	}
+	
+	// fraction of the screen height covered by the bounding sphere, the camera looks down -z
+	Matrix4 projectionMatrix = CoreServices::getInstance()->getRenderer()->getProjectionMatrix();
+	Number screenSize = bBoxRadius * scale * projectionMatrix.m[1][1];
+	if(projectionMatrix.m[2][3] != 0) {
+		Number distance = -modelviewMatrix.m[3][2];
+		if(distance <= 0) {
+			currentLODLevel = 0;
+			return;
+		}
+		screenSize /= distance;
+	}
+	
+	unsigned int numLevels = lodMeshes.size();
+	if(currentLODLevel > numLevels)
+		currentLODLevel = numLevels;
+	while(currentLODLevel < numLevels && screenSize < lodScreenSizes[currentLODLevel] * (1.0 - lodHysteresis))
+		currentLODLevel++;
+	while(currentLODLevel > 0 && screenSize > lodScreenSizes[currentLODLevel-1] * (1.0 + lodHysteresis))
+		currentLODLevel--;
 }
 
 Material *SceneMesh::getMaterial() {
@@ -130,80 +224,120 @@ Skeleton *SceneMesh::getSkeleton() {
 
 void SceneMesh::renderMeshLocally() {
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	Mesh *renderMesh = getCurrentMesh();
 	
-	if(skeleton) {	
-		for(int i=0; i < mesh->getPolygonCount(); i++) {
-			Polygon *polygon = mesh->getPolygon(i);			
-			unsigned int vCount = polygon->getVertexCount();			
+	if(skeleton) {
+		// one rest to pose matrix per bone
+		boneSkinningMatrices.resize(skeleton->getNumBones());
+		for(int i=0; i < skeleton->getNumBones(); i++) {
+			Bone *bone = skeleton->getBone(i);
+			boneSkinningMatrices[i] = bone->getRestMatrix() * bone->getFinalMatrix();
+		}
+		
+		// blend a matrix per vertex from its bones, then move all rest positions and normals in one batch
+		skinningMatrices.clear();
+		skinningData.clear();
+		for(int i=0; i < renderMesh->getPolygonCount(); i++) {
+			Polygon *polygon = renderMesh->getPolygon(i);
+			unsigned int vCount = polygon->getVertexCount();
 			for(int j=0; j < vCount; j++) {
 				Vertex *vert = polygon->getVertex(j);
-				Vector3 norm;
 				
-					Vector3 aPos = vert->restPosition;
-					Vector3 tPos;
+				Number mult = 0;
+				for(int b =0; b < vert->getNumBoneAssignments(); b++) {
+					BoneAssignment *bas = vert->getBoneAssignment(b);
+					mult += bas->weight;
+				}
+				mult = 1.0f/mult;
 				
-					Number mult = 0;
-					for(int b =0; b < vert->getNumBoneAssignments(); b++) {
-						BoneAssignment *bas = vert->getBoneAssignment(b);
-						mult += bas->weight;
-					}
-					mult = 1.0f/mult;
-				
-					for(int b =0; b < vert->getNumBoneAssignments(); b++) {
-						BoneAssignment *bas = vert->getBoneAssignment(b);
-						Bone *bone = bas->bone;
-						if(bone) {
-							
-							Matrix4 restMatrix = bone->getRestMatrix();
-							Matrix4 finalMatrix = bone->getFinalMatrix();
-							
-							Vector3 vec = restMatrix * aPos;
-							tPos += finalMatrix * vec * (bas->weight*mult);
-							
-							Vector3 nvec = vert->restNormal;
-							nvec = restMatrix.rotateVector(nvec);
-							nvec = finalMatrix.rotateVector(nvec);
-							
-							norm += nvec * (bas->weight*mult);
+				Matrix4 skinMatrix;
+				memset(skinMatrix.ml, 0, sizeof(Number)*16);
+				for(int b =0; b < vert->getNumBoneAssignments(); b++) {
+					BoneAssignment *bas = vert->getBoneAssignment(b);
+					if(bas->bone && bas->boneID < boneSkinningMatrices.size()) {
+						const Number *boneMatrix = boneSkinningMatrices[bas->boneID].ml;
+						Number weight = bas->weight*mult;
+						for(int k=0; k < 16; k++) {
+							skinMatrix.ml[k] += boneMatrix[k] * weight;
 						}
-					}					
-					
-				
-					vert->x = tPos.x;
-					vert->y = tPos.y;
-					vert->z = tPos.z;				
-				
-					norm.Normalize();
-					vert->setNormal(norm.x, norm.y, norm.z);
+					}
+				}
+				skinningMatrices.push_back(skinMatrix);
 				
+				skinningData.push_back(vert->restPosition.x);
+				skinningData.push_back(vert->restPosition.y);
+				skinningData.push_back(vert->restPosition.z);
+				skinningData.push_back(vert->restNormal.x);
+				skinningData.push_back(vert->restNormal.y);
+				skinningData.push_back(vert->restNormal.z);
+			}
+		}
+		
+		unsigned int skinnedVertices = skinningMatrices.size();
+		if(skinnedVertices > 0) {
+			BatchTransform::transformPoints(&skinningMatrices[0], &skinningData[0], 6, &skinningData[0], 6, skinnedVertices);
+			BatchTransform::transformNormals(&skinningMatrices[0], &skinningData[3], 6, &skinningData[3], 6, skinnedVertices, true);
+		}
+		
+		unsigned int index = 0;
+		for(int i=0; i < renderMesh->getPolygonCount(); i++) {
+			Polygon *polygon = renderMesh->getPolygon(i);
+			unsigned int vCount = polygon->getVertexCount();
+			for(int j=0; j < vCount; j++) {
+				Vertex *vert = polygon->getVertex(j);
+				float *skinned = &skinningData[index * 6];
+				vert->x = skinned[0];
+				vert->y = skinned[1];
+				vert->z = skinned[2];
+				vert->setNormal(skinned[3], skinned[4], skinned[5]);
+				index++;
 			}
 		}
-		mesh->arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		mesh->arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;		
+		renderMesh->arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
+		renderMesh->arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;		
 	}
 
-	if(mesh->useVertexColors) {
-		renderer->pushDataArrayForMesh(mesh, RenderDataArray::COLOR_DATA_ARRAY);
-	}
-	 
-	renderer->pushDataArrayForMesh(mesh, RenderDataArray::VERTEX_DATA_ARRAY);
-	renderer->pushDataArrayForMesh(mesh, RenderDataArray::NORMAL_DATA_ARRAY);		
-	renderer->pushDataArrayForMesh(mesh, RenderDataArray::TEXCOORD_DATA_ARRAY);	
+	renderer->pushInterleavedDataArrayForMesh(renderMesh, renderMesh->useVertexColors);
 	
-	renderer->drawArrays(mesh->getMeshType());
+	if(renderMesh->isIndexed())
+		renderer->pushDataArrayForMesh(renderMesh, RenderDataArray::INDEX_DATA_ARRAY);
+	
+	renderer->drawArrays(renderMesh->getMeshType());
 }
 
 void SceneMesh::cacheToVertexBuffer(bool cache) {
 
-	if(cache && !mesh->hasVertexBuffer()) {
-		CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(mesh);
+	if(cache) {
+		for(unsigned int l=0; l <= lodMeshes.size(); l++) {
+			if(!getLODMesh(l)->hasVertexBuffer())
+				CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(getLODMesh(l));
+		}
 	}
 	useVertexBuffer = cache;
 }
 
+bool SceneMesh::getRenderResources(RenderQueueItem *item) {
+	item->material = material;
+	item->localShaderOptions = localShaderOptions;
+	item->texture = material ? NULL : texture;
+	updateLODLevel(item->modelviewMatrix);
+	item->mesh = getCurrentMesh();
+	return true;
+}
+
+void SceneMesh::renderGeometry() {
+	Mesh *renderMesh = getCurrentMesh();
+	if(useVertexBuffer && renderMesh->hasVertexBuffer()) {
+		CoreServices::getInstance()->getRenderer()->drawVertexBuffer(renderMesh->getVertexBuffer());
+	} else {
+		renderMeshLocally();
+	}
+}
+
 void SceneMesh::Render() {
 	
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	updateLODLevel(renderer->getModelviewMatrix());
 	
 	if(material) {
 		renderer->applyMaterial(material, localShaderOptions,0);
@@ -214,11 +348,7 @@ void SceneMesh::Render() {
 			renderer->setTexture(NULL);
 	}
 	
-	if(useVertexBuffer) {
-		renderer->drawVertexBuffer(mesh->getVertexBuffer());
-	} else {
-		renderMeshLocally();
-	}
+	renderGeometry();
 	
 	if(material) 
 		renderer->clearShader();
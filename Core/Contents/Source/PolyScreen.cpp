@@ -34,6 +34,7 @@ Screen::Screen() : EventDispatcher() {
 	filterShaderMaterial = NULL;
 	_hasFilterShader = false;
 	useNormalizedCoordinates = false;
+	spriteBatching = true;
 	rootEntity = new ScreenEntity();
 	addChild(rootEntity);
 }
@@ -283,6 +284,9 @@ void Screen::Render() {
 	
 	renderer->multModelviewMatrix(rootEntity->getConcatenatedMatrix());
 	
+	if(spriteBatching)
+		spriteBatch.begin(renderer);
+	
 	for(int i=0; i<children.size();i++) {
 		if(children[i]->hasFocus && focusChild != children[i] && children[i]->isFocusable()) {
 			if(focusChild != NULL) {
@@ -294,6 +298,12 @@ void Screen::Render() {
 		}
 		children[i]->doUpdates();
 		children[i]->updateEntityMatrix();
-		children[i]->transformAndRender();
+		if(spriteBatching)
+			children[i]->batchForRender(&spriteBatch);
+		else
+			children[i]->transformAndRender();
 	}
+	
+	if(spriteBatching)
+		spriteBatch.end();
 }
@@ -21,15 +21,18 @@
 */
 
 #include "PolyScreenMesh.h"
+#include "PolySpriteBatch.h"
 
 using namespace Polycode;
 
 ScreenMesh::ScreenMesh(String fileName) : ScreenEntity(), texture(NULL) {
 	mesh = new Mesh(fileName);
+	allowSpriteBatching = true;
 }
 
 ScreenMesh::ScreenMesh(int meshType) : ScreenEntity(), texture(NULL) {
 	mesh = new Mesh(meshType);
+	allowSpriteBatching = true;
 }
 
 
@@ -60,10 +63,22 @@ void ScreenMesh::loadTexture(Image *image) {
 void ScreenMesh::Render() {	
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	renderer->setTexture(texture);
-	if(mesh->useVertexColors) {
-		renderer->pushDataArrayForMesh(mesh, RenderDataArray::COLOR_DATA_ARRAY);
-	}
-	renderer->pushDataArrayForMesh(mesh, RenderDataArray::VERTEX_DATA_ARRAY);
-	renderer->pushDataArrayForMesh(mesh, RenderDataArray::TEXCOORD_DATA_ARRAY);	
+	renderer->pushInterleavedDataArrayForMesh(mesh, mesh->useVertexColors);
+	
+	if(mesh->isIndexed())
+		renderer->pushDataArrayForMesh(mesh, RenderDataArray::INDEX_DATA_ARRAY);
+	
 	renderer->drawArrays(mesh->getMeshType());
-}
\ No newline at end of file
+}
+
+bool ScreenMesh::addToSpriteBatch(SpriteBatch *batch) {
+	if(!allowSpriteBatching || mesh->getMeshType() != Mesh::QUAD_MESH || mesh->isIndexed() || mesh->getPolygonCount() != 1)
+		return false;
+	
+	Polygon *quad = mesh->getPolygon(0);
+	if(quad->getVertexCount() != 4)
+		return false;
+	
+	batch->addQuad(this, texture, renderer->getModelviewMatrix(), quad, mesh->useVertexColors, getCombinedColor());
+	return true;
+}
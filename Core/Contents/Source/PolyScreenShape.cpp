@@ -186,6 +186,13 @@ void ScreenShape::Render() {
 }
 
 
+bool ScreenShape::addToSpriteBatch(SpriteBatch *batch) {
+	// strokes are drawn as a second wireframe pass in Render()
+	if(strokeEnabled)
+		return false;
+	return ScreenMesh::addToSpriteBatch(batch);
+}
+
 ScreenShape::~ScreenShape() {
 
 }
\ No newline at end of file
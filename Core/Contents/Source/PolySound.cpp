@@ -21,6 +21,8 @@
 */
 
 #include "PolySound.h"
+#include "PolySoundManager.h"
+#include "PolyCoreServices.h"
 
 using namespace Polycode;
 
@@ -44,7 +46,7 @@ long custom_tellfunc(void *datasource) {
 	return OSBasics::tell(file);
 }
 
-Sound::Sound(String fileName) {
+Sound::Sound(String fileName, bool streaming) {
 	String extension;
 	size_t found;
 	found=fileName.rfind(".");
@@ -54,20 +56,53 @@ Sound::Sound(String fileName) {
 		extension = "";
 	}
 
-	ALuint buffer;
+	this->streaming = false;
+	streamPlaying = false;
+	streamLooping = false;
+	streamEnded = false;
+	streamData = NULL;
+	soundManager = NULL;
+
+	ALuint buffer = AL_NONE;
 	if(extension == "wav" || extension == "WAV") {
+		if(streaming)
+			Logger::log("Streaming is only supported for OGG files, loading %s fully\n", fileName.c_str());
 		buffer = loadWAV(fileName);			
 	} else if(extension == "ogg" || extension == "OGG") {
-		buffer = loadOGG(fileName);			
+		if(streaming) {
+			this->streaming = openStream(fileName);
+		} else {
+			buffer = loadOGG(fileName);
+		}
 	}
 	
-	soundSource = GenSource(buffer);
+	if(this->streaming) {
+		soundSource = GenSource();
+		soundManager = CoreServices::getInstance()->getSoundManager();
+		soundManager->addStream(this);
+	} else {
+		soundSource = GenSource(buffer);
+	}
 	setIsPositional(false);
 }
 
 Sound::~Sound() {
 	Logger::log("destroying sound...\n");
+	if(streaming) {
+		soundManager->removeStream(this);
+		alSourceStop(soundSource);
+		alSourcei(soundSource, AL_BUFFER, 0);
+	}
 	alDeleteSources(1,&soundSource);
+	if(streaming) {
+		alDeleteBuffers(STREAM_BUFFER_COUNT, streamBuffers);
+		ov_clear(&streamFile);
+		free(streamData);
+	}
+}
+
+bool Sound::isStreaming() {
+	return streaming;
 }
 
 void Sound::soundCheck(bool result, String err) {
@@ -96,6 +131,17 @@ unsigned short Sound::readByte16(const unsigned char buffer[2]) {
 }
 
 void Sound::Play(bool loop) {
+	if(streaming) {
+		// the source must not loop, looping is done by the decoder
+		soundManager->lockStreams();
+		streamLooping = loop;
+		if(streamPlaying)
+			rewindStream();
+		restartStream();
+		soundManager->unlockStreams();
+		return;
+	}
+	
 	if(!loop) {
 		alSourcei(soundSource, AL_LOOPING, AL_FALSE);
 	} else {
@@ -104,6 +150,20 @@ void Sound::Play(bool loop) {
 	alSourcePlay(soundSource);
 }
 
+void Sound::setOffset(Number seconds) {
+	if(streaming) {
+		soundManager->lockStreams();
+		if(ov_time_seek(&streamFile, seconds) != 0)
+			soundError("Could not seek in stream");
+		streamEnded = false;
+		if(streamPlaying)
+			restartStream();
+		soundManager->unlockStreams();
+		return;
+	}
+	alSourcef(soundSource, AL_SEC_OFFSET, seconds);
+}
+
 void Sound::setVolume(Number newVolume) {
 	alSourcef(soundSource, AL_GAIN, newVolume);
 }
@@ -174,7 +234,138 @@ void Sound::checkALError(String operation) {
 }
 
 void Sound::Stop() {
+	if(streaming) {
+		soundManager->lockStreams();
+		alSourceStop(soundSource);
+		alSourcei(soundSource, AL_BUFFER, 0);
+		streamPlaying = false;
+		rewindStream();
+		soundManager->unlockStreams();
+		return;
+	}
+	alSourceStop(soundSource);
+}
+
+bool Sound::openStream(String fileName) {
+	OSFILE *f = OSBasics::open(fileName.c_str(), "rb");
+	if(!f) {
+		soundError("Error loading OGG file!\n");
+		return false;
+	}
+	
+	ov_callbacks callbacks;
+	callbacks.read_func = custom_readfunc;
+	callbacks.seek_func = custom_seekfunc;
+	callbacks.close_func = custom_closefunc;
+	callbacks.tell_func = custom_tellfunc;
+	
+	if(ov_open_callbacks((void*)f, &streamFile, NULL, 0, callbacks) != 0) {
+		soundError("Error opening OGG stream!\n");
+		OSBasics::close(f);
+		return false;
+	}
+	
+	vorbis_info *pInfo = ov_info(&streamFile, -1);
+	if (pInfo->channels == 1)
+		streamFormat = AL_FORMAT_MONO16;
+	else
+		streamFormat = AL_FORMAT_STEREO16;
+	streamFreq = pInfo->rate;
+	
+	alGetError();
+	alGenBuffers(STREAM_BUFFER_COUNT, streamBuffers);
+	checkALError("Generating stream buffers");
+	
+	streamData = (char*)malloc(BUFFER_SIZE);
+	return true;
+}
+
+bool Sound::fillStreamBuffer(ALuint buffer) {
+	int endian = 0;
+	int bitStream;
+	long size = 0;
+	bool rewound = false;
+	
+	while(size < BUFFER_SIZE) {
+		long bytes = ov_read(&streamFile, streamData + size, BUFFER_SIZE - size, endian, 2, 1, &bitStream);
+		if(bytes > 0) {
+			size += bytes;
+			rewound = false;
+		} else if(bytes == 0 && streamLooping && !rewound) {
+			// end of file, wrap around without a gap
+			rewindStream();
+			rewound = true;
+		} else if(bytes == 0) {
+			streamEnded = true;
+			break;
+		} else {
+			soundError("Error decoding OGG stream");
+			streamEnded = true;
+			break;
+		}
+	}
+	
+	if(size == 0)
+		return false;
+	
+	alBufferData(buffer, streamFormat, streamData, (ALsizei)size, streamFreq);
+	return true;
+}
+
+void Sound::rewindStream() {
+	ov_pcm_seek(&streamFile, 0);
+	streamEnded = false;
+}
+
+void Sound::restartStream() {
 	alSourceStop(soundSource);
+	alSourcei(soundSource, AL_BUFFER, 0);
+	alSourcei(soundSource, AL_LOOPING, AL_FALSE);
+	
+	int queued = 0;
+	for(int i=0; i < STREAM_BUFFER_COUNT; i++) {
+		if(!fillStreamBuffer(streamBuffers[i]))
+			break;
+		queued++;
+	}
+	
+	if(queued == 0) {
+		streamPlaying = false;
+		return;
+	}
+	
+	alSourceQueueBuffers(soundSource, queued, streamBuffers);
+	alSourcePlay(soundSource);
+	streamPlaying = true;
+}
+
+void Sound::updateStream() {
+	if(!streaming || !streamPlaying)
+		return;
+	
+	ALint processed = 0;
+	alGetSourcei(soundSource, AL_BUFFERS_PROCESSED, &processed);
+	while(processed > 0) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(soundSource, 1, &buffer);
+		if(!streamEnded && fillStreamBuffer(buffer))
+			alSourceQueueBuffers(soundSource, 1, &buffer);
+		processed--;
+	}
+	
+	ALint state;
+	alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
+	if(state != AL_PLAYING) {
+		ALint queued = 0;
+		alGetSourcei(soundSource, AL_BUFFERS_QUEUED, &queued);
+		if(queued > 0) {
+			// the source ran dry before we could refill it
+			alSourcePlay(soundSource);
+		} else {
+			streamPlaying = false;
+			rewindStream();
+		}
+	}
 }
 
 ALuint Sound::GenSource() {
@@ -250,6 +441,11 @@ ALuint Sound::loadOGG(String fileName) {
 	
 	// The frequency of the sampling rate
 	freq = pInfo->rate;	
+	
+	ogg_int64_t totalSamples = ov_pcm_total(&oggFile, -1);
+	if(totalSamples > 0)
+		buffer.reserve((size_t)totalSamples * pInfo->channels * 2);
+	
 	do {
 		// Read up to a buffer's worth of decoded sound data
 		bytes = ov_read(&oggFile, array, BUFFER_SIZE, endian, 2, 1, &bitStream);
@@ -21,13 +21,91 @@
 */
 
 #include "PolySoundManager.h"
+#include "PolySound.h"
+#include "PolyCoreServices.h"
+#include "PolyCore.h"
+#ifndef _WINDOWS
+#include <unistd.h>
+#endif
 
 using namespace Polycode;
 
+SoundStreamThread::SoundStreamThread(Core *core, CoreMutex *mutex) : Threaded() {
+	this->core = core;
+	this->mutex = mutex;
+}
+
+void SoundStreamThread::runThread() {
+	while(threadRunning)
+		updateThread();
+	// nothing can join this thread, so it cleans up after itself
+	delete this;
+}
+
+void SoundStreamThread::updateThread() {
+	core->lockMutex(mutex);
+	if(threadRunning) {
+		for(int i=0; i < streams.size(); i++) {
+			streams[i]->updateStream();
+		}
+	}
+	core->unlockMutex(mutex);
+	
+#ifdef _WINDOWS
+	Sleep(UPDATE_INTERVAL);
+#else
+	usleep(UPDATE_INTERVAL * 1000);
+#endif
+}
+
 SoundManager::SoundManager() {
+	core = NULL;
+	streamMutex = NULL;
+	streamThread = NULL;
 	initAL();
 }
 
+void SoundManager::addStream(Sound *sound) {
+	if(!streamThread) {
+		core = CoreServices::getInstance()->getCore();
+		if(!core) {
+			Logger::log("Cannot start sound stream thread without a core\n");
+			return;
+		}
+		streamMutex = core->createMutex();
+		streamThread = new SoundStreamThread(core, streamMutex);
+		core->createThread(streamThread);
+	}
+	
+	lockStreams();
+	streamThread->streams.push_back(sound);
+	unlockStreams();
+}
+
+void SoundManager::removeStream(Sound *sound) {
+	if(!streamThread)
+		return;
+	
+	lockStreams();
+	for(int i=0; i < streamThread->streams.size(); i++) {
+		if(streamThread->streams[i] == sound) {
+			streamThread->streams.erase(streamThread->streams.begin()+i);
+			break;
+		}
+	}
+	unlockStreams();
+}
+
+void SoundManager::lockStreams() {
+	if(streamMutex)
+		core->lockMutex(streamMutex);
+}
+
+void SoundManager::unlockStreams() {
+	if(streamMutex)
+		core->unlockMutex(streamMutex);
+}
+
 void SoundManager::initAL() {
 	alGetError();
 	if(alcGetCurrentContext() == NULL) {
@@ -101,6 +179,12 @@ void SoundManager::setListenerOrientation(Vector3 orientation) {
 }
 
 SoundManager::~SoundManager() {
+	if(streamThread) {
+		lockStreams();
+		streamThread->streams.clear();
+		streamThread->killThread();
+		unlockStreams();
+	}
 	alcSuspendContext(context);
 	alcDestroyContext(context);
 	if (device != NULL) {
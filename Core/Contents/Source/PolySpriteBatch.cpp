@@ -0,0 +1,153 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolySpriteBatch.h"
+#include "PolyEntity.h"
+#include "PolyRenderer.h"
+#include "PolyPolygon.h"
+#include "PolyVertex.h"
+
+using namespace Polycode;
+
+SpriteBatch::SpriteBatch() {
+	renderer = NULL;
+	texture = NULL;
+	blendingMode = Renderer::BLEND_MODE_NORMAL;
+	depthWrite = false;
+	depthTest = false;
+	alphaTest = false;
+	backfaceCulled = false;
+	numQuads = 0;
+	numFlushes = 0;
+	numBatchedQuads = 0;
+	vertexArray.arrayType = RenderDataArray::INTERLEAVED_DATA_ARRAY;
+	vertexArray.stride = Mesh::VERTEX_STREAM_STRIDE;
+	vertexArray.size = Mesh::VERTEX_STREAM_STRIDE;
+}
+
+SpriteBatch::~SpriteBatch() {
+	// the array only points into vertexData
+	vertexArray.arrayPtr = NULL;
+}
+
+void SpriteBatch::begin(Renderer *renderer) {
+	this->renderer = renderer;
+	numQuads = 0;
+	numFlushes = 0;
+	numBatchedQuads = 0;
+}
+
+void SpriteBatch::end() {
+	flush();
+}
+
+bool SpriteBatch::stateMatches(Entity *entity, Texture *texture) {
+	return (this->texture == texture && blendingMode == entity->blendingMode && depthWrite == entity->depthWrite && depthTest == entity->depthTest && alphaTest == entity->alphaTest && backfaceCulled == entity->backfaceCulled);
+}
+
+void SpriteBatch::addQuad(Entity *entity, Texture *texture, const Matrix4 &transform, Polygon *quad, bool useVertexColors, const Color &color) {
+	// quads using regions of the same atlas page share a batch
+	Texture *pageTexture = NULL;
+	bool mapTexCoords = false;
+	Matrix4 texCoordMatrix;
+	if(texture) {
+		pageTexture = texture->getPageTexture();
+		if(texture->isAtlasRegion()) {
+			mapTexCoords = true;
+			texCoordMatrix = texture->getTexCoordMatrix();
+		}
+	}
+	
+	if(numQuads > 0 && !stateMatches(entity, pageTexture))
+		flush();
+	
+	if(numQuads == 0) {
+		this->texture = pageTexture;
+		blendingMode = entity->blendingMode;
+		depthWrite = entity->depthWrite;
+		depthTest = entity->depthTest;
+		alphaTest = entity->alphaTest;
+		backfaceCulled = entity->backfaceCulled;
+	}
+	
+	unsigned int quadSize = 4 * Mesh::VERTEX_STREAM_STRIDE;
+	if(vertexData.size() < (numQuads+1) * quadSize)
+		vertexData.resize((numQuads+1) * quadSize * 2);
+	
+	float *v = &vertexData[numQuads * quadSize];
+	for(int i=0; i < 4; i++) {
+		Vertex *vertex = quad->getVertex(i);
+		Vector3 position = transform * Vector3(vertex->x, vertex->y, vertex->z);
+		Vector2 texCoord = vertex->getTexCoord();
+		if(mapTexCoords) {
+			texCoord = Vector2(texCoord.x*texCoordMatrix.m[0][0] + texCoord.y*texCoordMatrix.m[1][0] + texCoordMatrix.m[3][0],
+							texCoord.x*texCoordMatrix.m[0][1] + texCoord.y*texCoordMatrix.m[1][1] + texCoordMatrix.m[3][1]);
+		}
+		Color vertexColor = color;
+		if(useVertexColors)
+			vertexColor = vertex->vertexColor;
+		
+		v[Mesh::VERTEX_STREAM_POSITION_OFFSET] = position.x;
+		v[Mesh::VERTEX_STREAM_POSITION_OFFSET+1] = position.y;
+		v[Mesh::VERTEX_STREAM_POSITION_OFFSET+2] = position.z;
+		v[Mesh::VERTEX_STREAM_NORMAL_OFFSET] = 0;
+		v[Mesh::VERTEX_STREAM_NORMAL_OFFSET+1] = 0;
+		v[Mesh::VERTEX_STREAM_NORMAL_OFFSET+2] = 1;
+		v[Mesh::VERTEX_STREAM_COLOR_OFFSET] = vertexColor.r;
+		v[Mesh::VERTEX_STREAM_COLOR_OFFSET+1] = vertexColor.g;
+		v[Mesh::VERTEX_STREAM_COLOR_OFFSET+2] = vertexColor.b;
+		v[Mesh::VERTEX_STREAM_COLOR_OFFSET+3] = vertexColor.a;
+		v[Mesh::VERTEX_STREAM_TEXCOORD_OFFSET] = texCoord.x;
+		v[Mesh::VERTEX_STREAM_TEXCOORD_OFFSET+1] = texCoord.y;
+		v += Mesh::VERTEX_STREAM_STRIDE;
+	}
+	numQuads++;
+}
+
+void SpriteBatch::flush() {
+	if(numQuads == 0 || !renderer)
+		return;
+	
+	renderer->setTexture(texture);
+	renderer->setBlendingMode(blendingMode);
+	renderer->enableDepthWrite(depthWrite);
+	renderer->enableDepthTest(depthTest);
+	renderer->enableAlphaTest(alphaTest);
+	renderer->enableBackfaceCulling(backfaceCulled);
+	
+	vertexArray.arrayPtr = &vertexData[0];
+	vertexArray.count = numQuads * 4;
+	
+	// the vertices are already transformed
+	renderer->pushMatrix();
+	renderer->loadIdentity();
+	renderer->pushInterleavedRenderDataArray(&vertexArray, true);
+	renderer->drawArrays(Mesh::QUAD_MESH);
+	renderer->popMatrix();
+	
+	if(!depthWrite)
+		renderer->enableDepthWrite(true);
+	
+	numFlushes++;
+	numBatchedQuads += numQuads;
+	numQuads = 0;
+}
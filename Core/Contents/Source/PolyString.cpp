@@ -21,6 +21,7 @@
 */
 
 #include "PolyString.h"
+#include <wctype.h>
 
 using namespace Polycode;
 
@@ -136,13 +137,13 @@ String String::replace(const String &what, const String &withWhat) {
 
 String String::toLowerCase() {
 	wstring str = contents;
-	std::transform(str.begin(), str.end(), str.begin(),tolower);	
+	std::transform(str.begin(), str.end(), str.begin(),towlower);	
 	return String(str);
 }
 
 String String::toUpperCase() {
 	wstring str = contents;
-	std::transform(str.begin(), str.end(), str.begin(),toupper);	
+	std::transform(str.begin(), str.end(), str.begin(),towupper);	
 	return String(str);
 }
 
@@ -51,6 +51,7 @@ Texture::Texture(unsigned int width, unsigned int height, char *textureData,bool
 	scrollOffsetX = 0;
 	scrollOffsetY = 0;
 	resourcePath = "";
+	compressionFormat = Image::COMPRESSION_NONE;
 }
 
 int Texture::getWidth() {
@@ -62,6 +63,7 @@ int Texture::getHeight() {
 }
 
 Texture::~Texture(){
+	clearLevels();
 	free(textureData);
 }
 
@@ -71,14 +73,108 @@ void Texture::setImageData(Image *data) {
 		free(this->textureData);
 	this->textureData = (char*)malloc(width*height*pixelSize);
 	memcpy(this->textureData, data->getPixels(), width*height*pixelSize);
-	setTextureData(data->getPixels());
+	
+	// the other levels are out of date now
+	if(levelData.size() > 0) {
+		clearLevels();
+		recreateFromImageData();
+	} else {
+		setTextureData(data->getPixels());
+	}
+
+}
+
+void Texture::clearLevels() {
+	for(int i=0; i < levelData.size(); i++) {
+		free(levelData[i]);
+	}
+	levelData.clear();
+	levelDataSizes.clear();
+	compressionFormat = Image::COMPRESSION_NONE;
+}
+
+void Texture::setMipmapLevels(const vector<Image*> &levels) {
+	clearLevels();
+	for(int i=0; i < levels.size(); i++) {
+		Image *level = levels[i];
+		if(level->getWidth() != getLevelWidth(i+1) || level->getHeight() != getLevelHeight(i+1) || (level->getType() == Image::IMAGE_RGB) != (pixelSize == 3)) {
+			Logger::log("Mipmap level %d does not match the texture, ignoring it and all smaller levels.\n", i+1);
+			break;
+		}
+		unsigned int size = level->getWidth() * level->getHeight() * pixelSize;
+		char *data = (char*)malloc(size);
+		memcpy(data, level->getPixels(), size);
+		levelData.push_back(data);
+		levelDataSizes.push_back(size);
+	}
+	recreateFromImageData();
+}
+
+void Texture::setCompressedData(int format, const vector<char*> &levels, const vector<unsigned int> &levelSizes) {
+	clearLevels();
+	for(int i=0; i < levels.size() && i < levelSizes.size(); i++) {
+		if(levelSizes[i] != Image::getCompressedDataSize(getLevelWidth(i), getLevelHeight(i), format)) {
+			Logger::log("Compressed level %d has the wrong size, ignoring it and all smaller levels.\n", i);
+			break;
+		}
+		char *data = (char*)malloc(levelSizes[i]);
+		memcpy(data, levels[i], levelSizes[i]);
+		levelData.push_back(data);
+		levelDataSizes.push_back(levelSizes[i]);
+	}
+	if(levelData.size() > 0)
+		compressionFormat = format;
+	recreateFromImageData();
+}
+
+int Texture::getCompressionFormat() {
+	return compressionFormat;
+}
+
+unsigned int Texture::getNumLevels() {
+	if(compressionFormat != Image::COMPRESSION_NONE)
+		return levelData.size();
+	return levelData.size() + 1;
+}
+
+char *Texture::getLevelData(unsigned int level) {
+	// uncompressed textures keep their base level in textureData
+	if(compressionFormat == Image::COMPRESSION_NONE) {
+		if(level == 0)
+			return textureData;
+		level--;
+	}
+	if(level >= levelData.size())
+		return NULL;
+	return levelData[level];
+}
+
+unsigned int Texture::getLevelDataSize(unsigned int level) {
+	if(compressionFormat == Image::COMPRESSION_NONE) {
+		if(level == 0)
+			return width*height*pixelSize;
+		level--;
+	}
+	if(level >= levelDataSizes.size())
+		return 0;
+	return levelDataSizes[level];
+}
+
+int Texture::getLevelWidth(unsigned int level) {
+	int levelWidth = width >> level;
+	return (levelWidth > 0) ? levelWidth : 1;
+}
 
+int Texture::getLevelHeight(unsigned int level) {
+	int levelHeight = height >> level;
+	return (levelHeight > 0) ? levelHeight : 1;
 }
 
 Texture::Texture(Image *image) : Resource(Resource::RESOURCE_TEXTURE) {	
 	pixelSize = 4;
 	this->textureData = (char*)malloc(image->getWidth()*image->getHeight()*pixelSize);
 	memcpy(this->textureData, image->getPixels(), image->getWidth()*image->getHeight()*pixelSize);	
+	compressionFormat = Image::COMPRESSION_NONE;
 
 }
 
@@ -0,0 +1,355 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyTextureAtlas.h"
+#include "PolyCoreServices.h"
+#include "PolyMaterialManager.h"
+#include "PolyLogger.h"
+#include <algorithm>
+
+using namespace Polycode;
+
+TextureAtlasRegion::TextureAtlasRegion(Texture *page, unsigned int pageIndex, int x, int y, int width, int height, bool rotated) : Texture(0, 0, NULL, true) {
+	this->page = page;
+	this->pageIndex = pageIndex;
+	this->width = width;
+	this->height = height;
+	this->rotated = rotated;
+	pageX = x;
+	pageY = y;
+	
+	Number pw = page->getWidth();
+	Number ph = page->getHeight();
+	
+	// maps (s,t) of the region to the page, see Renderer::setTexture
+	if(rotated) {
+		// stored turned clockwise: s runs down the page, t runs to the right
+		texCoordMatrix.m[0][0] = 0;
+		texCoordMatrix.m[1][0] = ((Number)height)/pw;
+		texCoordMatrix.m[3][0] = ((Number)x)/pw;
+		texCoordMatrix.m[0][1] = -((Number)width)/ph;
+		texCoordMatrix.m[1][1] = 0;
+		texCoordMatrix.m[3][1] = ((Number)(y+width))/ph;
+	} else {
+		texCoordMatrix.m[0][0] = ((Number)width)/pw;
+		texCoordMatrix.m[1][1] = ((Number)height)/ph;
+		texCoordMatrix.m[3][0] = ((Number)x)/pw;
+		texCoordMatrix.m[3][1] = ((Number)y)/ph;
+	}
+}
+
+TextureAtlasRegion::~TextureAtlasRegion() {
+
+}
+
+void TextureAtlasRegion::setTextureData(char *data) {
+	Logger::log("Texture atlas regions can not be updated directly, update the atlas page instead.\n");
+}
+
+void TextureAtlasRegion::recreateFromImageData() {
+
+}
+
+Texture *TextureAtlasRegion::getPageTexture() {
+	return page;
+}
+
+bool TextureAtlasRegion::isAtlasRegion() {
+	return true;
+}
+
+Matrix4 TextureAtlasRegion::getTexCoordMatrix() {
+	return texCoordMatrix;
+}
+
+unsigned int TextureAtlasRegion::getPageIndex() {
+	return pageIndex;
+}
+
+int TextureAtlasRegion::getPageX() {
+	return pageX;
+}
+
+int TextureAtlasRegion::getPageY() {
+	return pageY;
+}
+
+bool TextureAtlasRegion::isRotated() {
+	return rotated;
+}
+
+TextureAtlasNode::TextureAtlasNode(int x, int y, int width, int height) {
+	this->x = x;
+	this->y = y;
+	this->width = width;
+	this->height = height;
+	used = false;
+	child[0] = NULL;
+	child[1] = NULL;
+}
+
+TextureAtlasNode::~TextureAtlasNode() {
+	delete child[0];
+	delete child[1];
+}
+
+TextureAtlasNode *TextureAtlasNode::insert(int width, int height) {
+	if(child[0]) {
+		TextureAtlasNode *node = child[0]->insert(width, height);
+		if(node)
+			return node;
+		return child[1]->insert(width, height);
+	}
+	
+	if(used || width > this->width || height > this->height)
+		return NULL;
+	
+	if(width == this->width && height == this->height) {
+		used = true;
+		return this;
+	}
+	
+	// split along the side with more space left, so the larger free rectangle stays whole
+	int dw = this->width - width;
+	int dh = this->height - height;
+	if(dw > dh) {
+		child[0] = new TextureAtlasNode(x, y, width, this->height);
+		child[1] = new TextureAtlasNode(x+width, y, dw, this->height);
+	} else {
+		child[0] = new TextureAtlasNode(x, y, this->width, height);
+		child[1] = new TextureAtlasNode(x, y+height, this->width, dh);
+	}
+	return child[0]->insert(width, height);
+}
+
+TextureAtlas::TextureAtlas(int pageWidth, int pageHeight, int padding, bool extrudeEdges, bool allowRotation) {
+	this->pageWidth = pageWidth;
+	this->pageHeight = pageHeight;
+	this->padding = padding;
+	this->extrudeEdges = extrudeEdges;
+	this->allowRotation = allowRotation;
+}
+
+TextureAtlas::~TextureAtlas() {
+	for(int i=0; i < pendingImages.size(); i++) {
+		if(pendingImages[i].ownsImage)
+			delete pendingImages[i].image;
+	}
+	
+	for(map<wstring, TextureAtlasRegion*>::iterator it = regions.begin(); it != regions.end(); it++) {
+		delete it->second;
+	}
+	
+	for(int i=0; i < pages.size(); i++) {
+		CoreServices::getInstance()->getMaterialManager()->deleteTexture(pages[i]);
+		delete pageImages[i];
+		delete pageTrees[i];
+	}
+}
+
+void TextureAtlas::addImage(String name, Image *image) {
+	PendingImage pending;
+	pending.name = name;
+	pending.image = image;
+	pending.ownsImage = false;
+	pendingImages.push_back(pending);
+}
+
+bool TextureAtlas::addImageFromFile(String fileName) {
+	Image *image = new Image(fileName);
+	if(!image->isLoaded()) {
+		Logger::log("Error loading atlas image %s\n", fileName.c_str());
+		delete image;
+		return false;
+	}
+	
+	PendingImage pending;
+	pending.name = fileName;
+	pending.image = image;
+	pending.ownsImage = true;
+	pendingImages.push_back(pending);
+	return true;
+}
+
+bool TextureAtlas::cmpPendingImageSize(const PendingImage &left, const PendingImage &right) {
+	int leftSize = std::max(left.image->getWidth(), left.image->getHeight());
+	int rightSize = std::max(right.image->getWidth(), right.image->getHeight());
+	return leftSize > rightSize;
+}
+
+TextureAtlasNode *TextureAtlas::findSpace(int width, int height, unsigned int *pageIndex) {
+	for(int i=0; i < pageTrees.size(); i++) {
+		TextureAtlasNode *node = pageTrees[i]->insert(width, height);
+		if(node) {
+			*pageIndex = i;
+			return node;
+		}
+	}
+	return NULL;
+}
+
+void TextureAtlas::addPage() {
+	Image *pageImage = new Image(pageWidth, pageHeight, Image::IMAGE_RGBA);
+	pageImage->fill(0,0,0,0);
+	pageImages.push_back(pageImage);
+	// not created from the image, so the page gets no mipmaps that would blend neighbouring regions
+	pages.push_back(CoreServices::getInstance()->getMaterialManager()->createTexture(pageWidth, pageHeight, pageImage->getPixels(), true, Image::IMAGE_RGBA));
+	pageTrees.push_back(new TextureAtlasNode(0, 0, pageWidth, pageHeight));
+	dirtyPages.push_back(false);
+}
+
+void TextureAtlas::build() {
+	// packing the largest images first leaves the small ones to fill the gaps
+	std::stable_sort(pendingImages.begin(), pendingImages.end(), cmpPendingImageSize);
+	
+	for(int i=0; i < pendingImages.size(); i++) {
+		PendingImage &pending = pendingImages[i];
+		int width = pending.image->getWidth();
+		int height = pending.image->getHeight();
+		int cellWidth = width + padding*2;
+		int cellHeight = height + padding*2;
+		
+		if(regions.find(pending.name.contents) != regions.end()) {
+			Logger::log("Texture atlas already has an image named %s\n", pending.name.c_str());
+		} else if((cellWidth > pageWidth || cellHeight > pageHeight) && (!allowRotation || cellHeight > pageWidth || cellWidth > pageHeight)) {
+			Logger::log("Image %s (%dx%d) does not fit into a %dx%d atlas page\n", pending.name.c_str(), width, height, pageWidth, pageHeight);
+		} else {
+			unsigned int pageIndex = 0;
+			bool rotated = false;
+			TextureAtlasNode *node = findSpace(cellWidth, cellHeight, &pageIndex);
+			if(!node && allowRotation && width != height) {
+				node = findSpace(cellHeight, cellWidth, &pageIndex);
+				rotated = (node != NULL);
+			}
+			if(!node) {
+				addPage();
+				pageIndex = pageTrees.size()-1;
+				node = pageTrees[pageIndex]->insert(cellWidth, cellHeight);
+				if(!node) {
+					node = pageTrees[pageIndex]->insert(cellHeight, cellWidth);
+					rotated = true;
+				}
+			}
+			
+			int x = node->x + padding;
+			int y = node->y + padding;
+			copyImage(pending.image, pageImages[pageIndex], x, y, rotated);
+			if(extrudeEdges) {
+				if(rotated)
+					extrudeImageEdges(pageImages[pageIndex], x, y, height, width);
+				else
+					extrudeImageEdges(pageImages[pageIndex], x, y, width, height);
+			}
+			dirtyPages[pageIndex] = true;
+			
+			TextureAtlasRegion *region = new TextureAtlasRegion(pages[pageIndex], pageIndex, x, y, width, height, rotated);
+			vector<String> bits = pending.name.split("/");
+			region->setResourcePath(bits[bits.size()-1]);
+			regions[pending.name.contents] = region;
+		}
+		
+		if(pending.ownsImage)
+			delete pending.image;
+	}
+	pendingImages.clear();
+	
+	for(int i=0; i < pages.size(); i++) {
+		if(dirtyPages[i]) {
+			pages[i]->setImageData(pageImages[i]);
+			dirtyPages[i] = false;
+		}
+	}
+}
+
+void TextureAtlas::copyImage(Image *source, Image *page, int x, int y, bool rotated) {
+	int width = source->getWidth();
+	int height = source->getHeight();
+	int sourcePixelSize = (source->getType() == Image::IMAGE_RGB) ? 3 : 4;
+	unsigned char *sourcePixels = (unsigned char*)source->getPixels();
+	unsigned char *pagePixels = (unsigned char*)page->getPixels();
+	
+	for(int sy=0; sy < height; sy++) {
+		for(int sx=0; sx < width; sx++) {
+			unsigned char *src = sourcePixels + ((sy*width)+sx)*sourcePixelSize;
+			int dx, dy;
+			if(rotated) {
+				dx = x + sy;
+				dy = y + (width-1-sx);
+			} else {
+				dx = x + sx;
+				dy = y + sy;
+			}
+			unsigned char *dst = pagePixels + ((dy*pageWidth)+dx)*4;
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = (sourcePixelSize == 4) ? src[3] : 255;
+		}
+	}
+}
+
+void TextureAtlas::extrudeImageEdges(Image *page, int x, int y, int width, int height) {
+	unsigned int *pagePixels = (unsigned int*)page->getPixels();
+	
+	for(int py=y; py < y+height; py++) {
+		unsigned int *row = pagePixels + (py*pageWidth);
+		for(int p=1; p <= padding; p++) {
+			row[x-p] = row[x];
+			row[x+width-1+p] = row[x+width-1];
+		}
+	}
+	
+	// the top and bottom rows include the side padding, which fills the corners
+	unsigned int *top = pagePixels + (y*pageWidth) + x - padding;
+	unsigned int *bottom = pagePixels + ((y+height-1)*pageWidth) + x - padding;
+	for(int p=1; p <= padding; p++) {
+		memcpy(top - (p*pageWidth), top, (width+padding*2)*sizeof(unsigned int));
+		memcpy(bottom + (p*pageWidth), bottom, (width+padding*2)*sizeof(unsigned int));
+	}
+}
+
+TextureAtlasRegion *TextureAtlas::getRegion(const String &name) {
+	map<wstring, TextureAtlasRegion*>::iterator it = regions.find(name.contents);
+	if(it == regions.end())
+		return NULL;
+	return it->second;
+}
+
+unsigned int TextureAtlas::getNumRegions() {
+	return regions.size();
+}
+
+unsigned int TextureAtlas::getNumPages() {
+	return pages.size();
+}
+
+Texture *TextureAtlas::getPage(unsigned int index) {
+	if(index >= pages.size())
+		return NULL;
+	return pages[index];
+}
+
+Image *TextureAtlas::getPageImage(unsigned int index) {
+	if(index >= pageImages.size())
+		return NULL;
+	return pageImages[index];
+}
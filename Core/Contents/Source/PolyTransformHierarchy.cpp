@@ -0,0 +1,369 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyTransformHierarchy.h"
+#include "PolyLogger.h"
+#include "PolyJobSystem.h"
+#include <limits.h>
+
+using namespace Polycode;
+
+TransformHierarchy::TransformHierarchy() {
+	firstRoot = -1;
+	numNodes = 0;
+	updateStamp = 0;
+	dirtyBegin = INT_MAX;
+	dirtyEnd = 0;
+	orderDirty = false;
+	sweepForbidden = false;
+}
+
+TransformHierarchy::~TransformHierarchy() {
+}
+
+void TransformHierarchy::clear() {
+	nodes.clear();
+	freeNodes.clear();
+	firstRoot = -1;
+	numNodes = 0;
+	
+	localMatrices.clear();
+	worldMatrices.clear();
+	parentIndices.clear();
+	subtreeEnds.clear();
+	nodeIDs.clear();
+	dirtyFlags.clear();
+	updateStamps.clear();
+	updateStamp = 0;
+	
+	dirtyBegin = INT_MAX;
+	dirtyEnd = 0;
+	orderDirty = false;
+}
+
+int TransformHierarchy::createNode(int parentID) {
+	int nodeID;
+	if(freeNodes.size() > 0) {
+		nodeID = freeNodes[freeNodes.size()-1];
+		freeNodes.pop_back();
+	} else {
+		nodeID = nodes.size();
+		nodes.push_back(TransformHierarchyNode());
+	}
+	
+	nodes[nodeID].prevSibling = -1;
+	nodes[nodeID].nextSibling = -1;
+	nodes[nodeID].firstChild = -1;
+	linkNode(nodeID, parentID);
+	
+	// new nodes always go to the end of the arrays, which keeps parents in
+	// front of their children
+	int index = localMatrices.size();
+	int parentIndex = -1;
+	if(parentID != -1)
+		parentIndex = nodes[parentID].index;
+	
+	nodes[nodeID].index = index;
+	localMatrices.push_back(Matrix4());
+	worldMatrices.push_back(Matrix4());
+	parentIndices.push_back(parentIndex);
+	subtreeEnds.push_back(index+1);
+	nodeIDs.push_back(nodeID);
+	dirtyFlags.push_back(1);
+	updateStamps.push_back(0);
+	numNodes++;
+	
+	// the subtree of the parent only stays contiguous if it already ends at
+	// the back of the arrays, which is the case when building depth first
+	if(parentIndex != -1 && !orderDirty) {
+		if(subtreeEnds[parentIndex] == index) {
+			for(int i=parentIndex; i != -1; i = parentIndices[i]) {
+				subtreeEnds[i] = index+1;
+			}
+		} else {
+			orderDirty = true;
+		}
+	}
+	
+	markDirty(index);
+	return nodeID;
+}
+
+void TransformHierarchy::destroyNode(int nodeID) {
+	int childID = nodes[nodeID].firstChild;
+	while(childID != -1) {
+		int nextID = nodes[childID].nextSibling;
+		unlinkNode(childID);
+		linkNode(childID, -1);
+		parentIndices[nodes[childID].index] = -1;
+		markDirty(nodes[childID].index);
+		childID = nextID;
+	}
+	unlinkNode(nodeID);
+	
+	// the slot stays in the arrays as a parentless clean node, which the
+	// sweep skips, until the order is rebuilt
+	int index = nodes[nodeID].index;
+	parentIndices[index] = -1;
+	dirtyFlags[index] = 0;
+	nodeIDs[index] = -1;
+	
+	nodes[nodeID].index = -1;
+	freeNodes.push_back(nodeID);
+	numNodes--;
+	
+	if(localMatrices.size() > 2 * numNodes) {
+		orderDirty = true;
+	}
+}
+
+void TransformHierarchy::setParent(int nodeID, int parentID) {
+	if(nodes[nodeID].parent == parentID)
+		return;
+	
+	for(int ancestorID = parentID; ancestorID != -1; ancestorID = nodes[ancestorID].parent) {
+		if(ancestorID == nodeID) {
+			Logger::log("TransformHierarchy: cannot parent a node to its own descendant\n");
+			return;
+		}
+	}
+	
+	unlinkNode(nodeID);
+	linkNode(nodeID, parentID);
+	
+	int index = nodes[nodeID].index;
+	if(parentID == -1) {
+		parentIndices[index] = -1;
+	} else {
+		int parentIndex = nodes[parentID].index;
+		parentIndices[index] = parentIndex;
+		// staying inside the range of the new parent keeps the order valid,
+		// anything else needs a rebuild
+		if(parentIndex > index || subtreeEnds[parentIndex] < subtreeEnds[index]) {
+			orderDirty = true;
+		}
+	}
+	markDirty(index);
+}
+
+int TransformHierarchy::getParent(int nodeID) const {
+	return nodes[nodeID].parent;
+}
+
+bool TransformHierarchy::isNode(int nodeID) const {
+	return nodeID >= 0 && nodeID < (int)nodes.size() && nodes[nodeID].index != -1;
+}
+
+int TransformHierarchy::getNumNodes() const {
+	return numNodes;
+}
+
+void TransformHierarchy::setLocalMatrix(int nodeID, const Matrix4 &matrix) {
+	int index = nodes[nodeID].index;
+	localMatrices[index] = matrix;
+	markDirty(index);
+}
+
+const Matrix4 &TransformHierarchy::getLocalMatrix(int nodeID) const {
+	return localMatrices[nodes[nodeID].index];
+}
+
+const Matrix4 &TransformHierarchy::getWorldMatrix(int nodeID) {
+	if(needsUpdate())
+		updateWorldMatrices();
+	return worldMatrices[nodes[nodeID].index];
+}
+
+const Matrix4 &TransformHierarchy::getCachedWorldMatrix(int nodeID) const {
+	return worldMatrices[nodes[nodeID].index];
+}
+
+bool TransformHierarchy::needsUpdate() const {
+	return orderDirty || dirtyBegin < dirtyEnd;
+}
+
+void TransformHierarchy::setSweepForbidden(bool forbidden) {
+	sweepForbidden = forbidden;
+}
+
+bool TransformHierarchy::isSweepForbidden() const {
+	return sweepForbidden;
+}
+
+void TransformHierarchy::markDirty(int index) {
+	dirtyFlags[index] = 1;
+	if(orderDirty)
+		return;
+	
+	// subtrees are contiguous, so the dirty nodes and everything below them
+	// always fit in a single range. Parallel entity updates can get here from
+	// several threads at once, so the range is only ever widened atomically.
+	int current = dirtyBegin;
+	while(index < current) {
+		int previous = JobSystem::atomicCompareAndSwap(&dirtyBegin, current, index);
+		if(previous == current)
+			break;
+		current = previous;
+	}
+	
+	int end = subtreeEnds[index];
+	current = dirtyEnd;
+	while(end > current) {
+		int previous = JobSystem::atomicCompareAndSwap(&dirtyEnd, current, end);
+		if(previous == current)
+			break;
+		current = previous;
+	}
+}
+
+void TransformHierarchy::updateWorldMatrices() {
+	if(orderDirty)
+		rebuildOrder();
+	
+	int begin = dirtyBegin;
+	int end = dirtyEnd;
+	if(begin >= end)
+		return;
+	
+	updateStamp++;
+	if(updateStamp == 0) {
+		for(int i=0; i < updateStamps.size(); i++) {
+			updateStamps[i] = 0;
+		}
+		updateStamp = 1;
+	}
+	
+	// parents come first, so a node's parent is always final by the time the
+	// node is reached. A node needs updating if it changed itself or if its
+	// parent was updated in this sweep.
+	const Matrix4 *local = &localMatrices[0];
+	Matrix4 *world = &worldMatrices[0];
+	const int *parents = &parentIndices[0];
+	char *dirty = &dirtyFlags[0];
+	unsigned int *stamps = &updateStamps[0];
+	
+	for(int i=begin; i < end; i++) {
+		int parent = parents[i];
+		if(!dirty[i] && (parent == -1 || stamps[parent] != updateStamp))
+			continue;
+		
+		if(parent == -1)
+			world[i] = local[i];
+		else
+			world[i] = local[i] * world[parent];
+		
+		dirty[i] = 0;
+		stamps[i] = updateStamp;
+	}
+	
+	dirtyBegin = INT_MAX;
+	dirtyEnd = 0;
+}
+
+void TransformHierarchy::linkNode(int nodeID, int parentID) {
+	int *head;
+	if(parentID == -1)
+		head = &firstRoot;
+	else
+		head = &nodes[parentID].firstChild;
+	
+	nodes[nodeID].parent = parentID;
+	nodes[nodeID].prevSibling = -1;
+	nodes[nodeID].nextSibling = *head;
+	if(*head != -1)
+		nodes[*head].prevSibling = nodeID;
+	*head = nodeID;
+}
+
+void TransformHierarchy::unlinkNode(int nodeID) {
+	TransformHierarchyNode &node = nodes[nodeID];
+	if(node.prevSibling != -1) {
+		nodes[node.prevSibling].nextSibling = node.nextSibling;
+	} else if(node.parent != -1) {
+		nodes[node.parent].firstChild = node.nextSibling;
+	} else {
+		firstRoot = node.nextSibling;
+	}
+	
+	if(node.nextSibling != -1)
+		nodes[node.nextSibling].prevSibling = node.prevSibling;
+	
+	node.parent = -1;
+	node.prevSibling = -1;
+	node.nextSibling = -1;
+}
+
+void TransformHierarchy::rebuildOrder() {
+	vector<Matrix4> newLocalMatrices;
+	vector<int> newParentIndices;
+	vector<int> newNodeIDs;
+	newLocalMatrices.reserve(numNodes);
+	newParentIndices.reserve(numNodes);
+	newNodeIDs.reserve(numNodes);
+	
+	// depth first walk over the topology, storing every subtree contiguously
+	int nodeID = firstRoot;
+	while(nodeID != -1) {
+		TransformHierarchyNode &node = nodes[nodeID];
+		newLocalMatrices.push_back(localMatrices[node.index]);
+		newNodeIDs.push_back(nodeID);
+		node.index = newNodeIDs.size()-1;
+		if(node.parent == -1)
+			newParentIndices.push_back(-1);
+		else
+			newParentIndices.push_back(nodes[node.parent].index);
+		
+		if(node.firstChild != -1) {
+			nodeID = node.firstChild;
+			continue;
+		}
+		while(nodeID != -1 && nodes[nodeID].nextSibling == -1) {
+			nodeID = nodes[nodeID].parent;
+		}
+		if(nodeID != -1)
+			nodeID = nodes[nodeID].nextSibling;
+	}
+	
+	int count = newNodeIDs.size();
+	localMatrices.swap(newLocalMatrices);
+	parentIndices.swap(newParentIndices);
+	nodeIDs.swap(newNodeIDs);
+	
+	worldMatrices.resize(count);
+	dirtyFlags.assign(count, 1);
+	updateStamps.assign(count, 0);
+	updateStamp = 0;
+	
+	subtreeEnds.resize(count);
+	for(int i=0; i < count; i++) {
+		subtreeEnds[i] = i+1;
+	}
+	for(int i=count-1; i >= 0; i--) {
+		int parent = parentIndices[i];
+		if(parent != -1 && subtreeEnds[i] > subtreeEnds[parent])
+			subtreeEnds[parent] = subtreeEnds[i];
+	}
+	
+	orderDirty = false;
+	dirtyBegin = 0;
+	dirtyEnd = count;
+}
@@ -28,8 +28,10 @@ THE SOFTWARE.
 #include "btBulletCollisionCommon.h"
 #include "PolyVector3.h"
 #include <vector>
+#include <map>
 
 using std::vector;
+using std::map;
 
 namespace Polycode {
 
@@ -87,10 +89,23 @@ struct CollisionResult {
 		
 			virtual CollisionSceneEntity *addCollisionChild(SceneEntity *newEntity, bool autoCollide=false, int type=0, int group=0);
 			CollisionSceneEntity *trackCollision(SceneEntity *newEntity, bool autoCollide, int type=0, int group=0);
+			
+			/**
+			* Moves an entity out of the objects it collides with, using the contacts found in the last update.
+			*/
 			void adjustForCollision(CollisionSceneEntity *collisionEntity);
 		protected:
 		
+			/**
+			* Walks Bullet's contact manifolds once and records the contacts of every tracked entity.
+			*/
+			void updateContacts();
+			void addContact(CollisionSceneEntity *cEnt, CollisionSceneEntity *other, btPersistentManifold *manifold);
+			void applyCollisionResult(CollisionSceneEntity *collisionEntity, const CollisionResult &result);
+		
 			vector<CollisionSceneEntity*> collisionChildren;
+			map<SceneEntity*, CollisionSceneEntity*> collisionEntityMap;
+			int numMeshChildren;
 			btCollisionWorld *world;
 	};
 
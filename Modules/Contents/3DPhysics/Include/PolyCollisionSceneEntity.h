@@ -27,9 +27,34 @@ THE SOFTWARE.
 #include "btBulletCollisionCommon.h"
 #include "PolyCoreServices.h"
 #include "PolySceneMesh.h"
+#include <vector>
 
 namespace Polycode {
 
+	class CollisionSceneEntity;
+
+	/**
+	* Contact information between two collision entities, gathered by CollisionScene from Bullet's contact manifolds once per update.
+	*/
+	struct CollisionContact {
+		/**
+		* The other entity.
+		*/
+		CollisionSceneEntity *entity;
+		
+		/**
+		* Normal of the first contact point.
+		*/
+		Vector3 firstNormal;
+		
+		/**
+		* Sum of the normals and distances of all penetrating contact points.
+		*/
+		Vector3 normalSum;
+		Number distanceSum;
+		int numPenetrating;
+	};
+
 	class _PolyExport CollisionSceneEntity {
 		public:
 			CollisionSceneEntity(SceneEntity *entity, bool autoCollide, int type);
@@ -51,6 +76,11 @@ namespace Polycode {
 			Number gravityStrength;
 		
 			Vector3 lastPosition;
+			
+			/**
+			* Contacts with other entities found in the last CollisionScene update.
+			*/
+			std::vector<CollisionContact> contacts;
 		
 		static const int SHAPE_BOX = 0;
 		static const int SHAPE_TERRAIN = 1;
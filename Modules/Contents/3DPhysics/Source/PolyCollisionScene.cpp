@@ -33,6 +33,7 @@ CollisionScene::CollisionScene(bool virtualScene) : Scene(virtualScene) {
 }
 
 void CollisionScene::initCollisionScene() {
+	numMeshChildren = 0;
 	
 	btVector3	worldAabbMin(-1000,-1000,-1000);
 	btVector3	worldAabbMax(1000,1000,1000);
@@ -52,6 +53,8 @@ void CollisionScene::Update() {
 	}
 	
 	world->performDiscreteCollisionDetection();	
+	updateContacts();
+	
 	for(int i=0; i < collisionChildren.size(); i++) {
 		if(collisionChildren[i]->enabled) {		
 			if(collisionChildren[i]->autoCollide) {
@@ -74,47 +77,97 @@ void CollisionScene::enableCollision(SceneEntity *entity, bool val) {
 	}
 }
 
-void CollisionScene::adjustForCollision(CollisionSceneEntity *collisionEntity) {
-	CollisionResult result;
-//	Number elapsed = CoreServices::getInstance()->getCore()->getElapsed();
-	result.collided = false;
+void CollisionScene::updateContacts() {
 	for(int i=0; i < collisionChildren.size(); i++) {
-		if(collisionChildren[i] != collisionEntity) {
-			result = testCollisionOnCollisionChild(collisionEntity, collisionChildren[i]);
-			if(result.collided) {
-				if(result.setOldPosition) {
-					collisionEntity->getSceneEntity()->setPosition(result.newPos);
-					collisionEntity->gVelocity.set(0,0,0);					
-				} else {
-//				printf("colnormal: %f %f %f %f\n", result.colNormal.x, result.colNormal.y, result.colNormal.z,result.colDist);
-				collisionEntity->getSceneEntity()->Translate(result.colNormal.x*result.colDist, result.colNormal.y*result.colDist, result.colNormal.z*result.colDist);
-//				Logger::log("colnormal: %f,%f,%f\n",result.colNormal.x,result.colNormal.y,result.colNormal.z);
-				if(result.colNormal.x > 0 && collisionEntity->gVelocity.x > 0)
-					collisionEntity->gVelocity.x = 0;
-				if(result.colNormal.x < 0 && collisionEntity->gVelocity.x < 0)
-					collisionEntity->gVelocity.x = 0;
-				if(result.colNormal.y > 0 && collisionEntity->gVelocity.y > 0)
-					collisionEntity->gVelocity.y = 0;
-				if(result.colNormal.y < 0 && collisionEntity->gVelocity.y < 0)
-					collisionEntity->gVelocity.y = 0;
-				if(result.colNormal.z > 0 && collisionEntity->gVelocity.z > 0)
-					collisionEntity->gVelocity.z = 0;
-				if(result.colNormal.z < 0 && collisionEntity->gVelocity.z < 0)
-					collisionEntity->gVelocity.z = 0;
-				collisionEntity->gVelocity.set(0,0,0);
-				}
-			}
+		collisionChildren[i]->contacts.clear();
+	}
+	
+	int numManifolds = world->getDispatcher()->getNumManifolds();
+	for (int i=0;i<numManifolds;i++)
+	{
+		btPersistentManifold* contactManifold = world->getDispatcher()->getManifoldByIndexInternal(i);
+		if(contactManifold->getNumContacts() == 0)
+			continue;
+		
+		btCollisionObject* obA = static_cast<btCollisionObject*>(contactManifold->getBody0());
+		btCollisionObject* obB = static_cast<btCollisionObject*>(contactManifold->getBody1());
+		CollisionSceneEntity *cEntA = getCollisionEntityByObject(obA);
+		CollisionSceneEntity *cEntB = getCollisionEntityByObject(obB);
+		if(!cEntA || !cEntB)
+			continue;
+		
+		addContact(cEntA, cEntB, contactManifold);
+		addContact(cEntB, cEntA, contactManifold);
+	}
+}
+
+void CollisionScene::addContact(CollisionSceneEntity *cEnt, CollisionSceneEntity *other, btPersistentManifold *manifold) {
+	CollisionContact *contact = NULL;
+	for(int i=0; i < cEnt->contacts.size(); i++) {
+		if(cEnt->contacts[i].entity == other) {
+			contact = &cEnt->contacts[i];
+			break;
+		}
+	}
+	
+	if(!contact) {
+		CollisionContact newContact;
+		newContact.entity = other;
+		btVector3 vec = manifold->getContactPoint(0).m_normalWorldOnB;
+		newContact.firstNormal = Vector3(vec.getX(), vec.getY(), vec.getZ());
+		newContact.normalSum.set(0,0,0);
+		newContact.distanceSum = 0;
+		newContact.numPenetrating = 0;
+		cEnt->contacts.push_back(newContact);
+		contact = &cEnt->contacts[cEnt->contacts.size()-1];
+	}
+	
+	for(int j=0; j < manifold->getNumContacts(); j++) {
+		if(manifold->getContactPoint(j).getDistance() <= btScalar(0.0)) {
+			btVector3 vec = manifold->getContactPoint(j).m_normalWorldOnB;
+			contact->normalSum += Vector3(vec.getX(), vec.getY(), vec.getZ());
+			contact->distanceSum += manifold->getContactPoint(j).getDistance();
+			contact->numPenetrating++;
 		}
 	}
+}
+
+void CollisionScene::adjustForCollision(CollisionSceneEntity *collisionEntity) {
+	for(int i=0; i < collisionEntity->contacts.size(); i++) {
+		CollisionSceneEntity *other = collisionEntity->contacts[i].entity;
+		if(other->getType() == CollisionSceneEntity::SHAPE_MESH)
+			continue;
+		CollisionResult result = testCollisionOnCollisionChild_Convex(collisionEntity, other);
+		if(result.collided)
+			applyCollisionResult(collisionEntity, result);
+	}
+	
+	// the sweep test runs against the whole world, so one test covers all mesh colliders
+	int otherMeshChildren = numMeshChildren;
+	if(collisionEntity->getType() == CollisionSceneEntity::SHAPE_MESH)
+		otherMeshChildren--;
+	if(otherMeshChildren > 0) {
+		CollisionResult result = testCollisionOnCollisionChild_RayTest(collisionEntity, NULL);
+		if(result.collided)
+			applyCollisionResult(collisionEntity, result);
+	}
+}
+
+void CollisionScene::applyCollisionResult(CollisionSceneEntity *collisionEntity, const CollisionResult &result) {
+	if(result.setOldPosition) {
+		collisionEntity->getSceneEntity()->setPosition(result.newPos);
+		collisionEntity->gVelocity.set(0,0,0);					
+	} else {
+		collisionEntity->getSceneEntity()->Translate(result.colNormal.x*result.colDist, result.colNormal.y*result.colDist, result.colNormal.z*result.colDist);
+		collisionEntity->gVelocity.set(0,0,0);
+	}
 }	
 
 CollisionSceneEntity *CollisionScene::getCollisionByScreenEntity(SceneEntity *ent) {
-	for(int i=0; i<collisionChildren.size();i++) {
-		if(collisionChildren[i]->getSceneEntity() == ent)
-			return collisionChildren[i];
-	}	
+	map<SceneEntity*, CollisionSceneEntity*>::iterator it = collisionEntityMap.find(ent);
+	if(it != collisionEntityMap.end())
+		return it->second;
 	return NULL;
-
 }
 
 void CollisionScene::applyVelocity(SceneEntity *entity, Number x, Number y, Number z) {
@@ -127,20 +180,9 @@ void CollisionScene::applyVelocity(SceneEntity *entity, Number x, Number y, Numb
 }
 
 Vector3 CollisionScene::getCollisionNormalFromCollisionEnts(CollisionSceneEntity *cEnt1, CollisionSceneEntity *cEnt2) {
-
-	int numManifolds = world->getDispatcher()->getNumManifolds();
-	for (int i=0;i<numManifolds;i++)
-	{
-		btPersistentManifold* contactManifold = world->getDispatcher()->getManifoldByIndexInternal(i);
-		btCollisionObject* obA = static_cast<btCollisionObject*>(contactManifold->getBody0());
-		btCollisionObject* obB = static_cast<btCollisionObject*>(contactManifold->getBody1());
- 		if((obA == cEnt1->collisionObject && obB == cEnt2->collisionObject) ||
-		 (obA == cEnt2->collisionObject && obB == cEnt1->collisionObject)) {
-			if(contactManifold->getNumContacts() > 0) {
-				btVector3 vec = contactManifold->getContactPoint(0).m_normalWorldOnB;
-				return Vector3(vec.getX(), vec.getY(), vec.getZ());
-			}
-		}
+	for(int i=0; i < cEnt1->contacts.size(); i++) {
+		if(cEnt1->contacts[i].entity == cEnt2)
+			return cEnt1->contacts[i].firstNormal;
 	}
 	return Vector3(0,0,0);
 }
@@ -158,51 +200,23 @@ CollisionResult CollisionScene::testCollisionOnCollisionChild_Convex(CollisionSc
 	CollisionResult result;
 	result.collided = false;
 	result.setOldPosition = false;
-	
-	Vector3 collNormal;
 	result.colNormal.set(0,0,0);									
 	result.colDist = 0; 	
 	
-	int numAdds = 0;
-	
-	int numManifolds = world->getDispatcher()->getNumManifolds();
-	for (int i=0;i<numManifolds;i++)
-	{
-		btPersistentManifold* contactManifold = world->getDispatcher()->getManifoldByIndexInternal(i);
-		btCollisionObject* obA = static_cast<btCollisionObject*>(contactManifold->getBody0());
-		btCollisionObject* obB = static_cast<btCollisionObject*>(contactManifold->getBody1());
- 		if((obA == cEnt1->collisionObject && obB == cEnt2->collisionObject) ||
-		   (obA == cEnt2->collisionObject && obB == cEnt1->collisionObject)) {
-//			contactManifold->refreshContactPoints(obA->getWorldTransform(), obB->getWorldTransform());
-			if(contactManifold->getNumContacts() > 0) {
-				for(int j=0; j < contactManifold->getNumContacts(); j++) {
-					if(contactManifold->getContactPoint(j).getDistance() <= btScalar(0.0)) {
-						btVector3 vec = contactManifold->getContactPoint(j).m_normalWorldOnB;
-						result.colNormal += Vector3(vec.getX(), vec.getY(), vec.getZ());	
-						result.colDist += contactManifold->getContactPoint(j).getDistance(); 
-						numAdds++;
-					}
-				}
-				
-				//				btVector3 vec = contactManifold->getContactPoint(0).m_normalWorldOnB;
-				//				result.colNormal.set(vec.getX(), vec.getY(), vec.getZ());
-				//				result.colDist = contactManifold->getContactPoint(0).getDistance(); 
-				
-				result.collided = true;
-				//				return result;
-			}
+	for(int i=0; i < cEnt1->contacts.size(); i++) {
+		const CollisionContact &contact = cEnt1->contacts[i];
+		if(contact.entity != cEnt2)
+			continue;
+		
+		result.collided = true;
+		if(contact.numPenetrating > 0) {
+			result.colNormal = contact.normalSum / (Number)contact.numPenetrating;
+			result.colDist  = contact.distanceSum / (Number)contact.numPenetrating;
 		}
-	}
-	
-	if(numAdds > 0) {
-		result.colNormal = result.colNormal / (Number)numAdds;
-		//		result.colNormal = Vector3(0,1,0);
-		//		result.colNormal.Normalize();
-		result.colDist  = result.colDist / (Number)numAdds;
+		break;
 	}
 	
 	return result;
-	//	return cEnt1->collisionObject->checkCollideWith(cEnt2->collisionObject);
 }
 
 RayTestResult CollisionScene::getFirstEntityInRay(const Vector3 &origin,  const Vector3 &dest) {
@@ -230,12 +244,8 @@ RayTestResult CollisionScene::getFirstEntityInRay(const Vector3 &origin,  const
 }
 
 CollisionSceneEntity *CollisionScene::getCollisionEntityByObject(btCollisionObject *collisionObject) {
-	for(int i=0; i <collisionChildren.size(); i++) {
-		if(collisionChildren[i]->collisionObject == collisionObject) {
-			return collisionChildren[i];
-		}
-	}
-	return NULL;
+	// tracked collision objects point back to their entity
+	return static_cast<CollisionSceneEntity*>(collisionObject->getUserPointer());
 }
 
 CollisionResult CollisionScene::testCollisionOnCollisionChild_RayTest(CollisionSceneEntity *cEnt1, CollisionSceneEntity *cEnt2) {
@@ -334,15 +344,29 @@ void CollisionScene::loadCollisionChild(SceneEntity *entity, bool autoCollide, i
 
 void CollisionScene::stopTrackingCollision(SceneEntity *entity) {
 	CollisionSceneEntity *cEnt = getCollisionByScreenEntity(entity);	
+	if(!cEnt)
+		return;
 	world->removeCollisionObject(cEnt->collisionObject);
+	collisionEntityMap.erase(entity);
+	if(cEnt->getType() == CollisionSceneEntity::SHAPE_MESH)
+		numMeshChildren--;
+	
 	for(int i=0; i < collisionChildren.size(); i++) {
 		if(collisionChildren[i] == cEnt) {
 			collisionChildren.erase(collisionChildren.begin() + i);
-			delete cEnt;
-			
-			return;
+			i--;
+			continue;
+		}
+		// drop stale contacts until the next update
+		vector<CollisionContact> &contacts = collisionChildren[i]->contacts;
+		for(int j=0; j < contacts.size(); j++) {
+			if(contacts[j].entity == cEnt) {
+				contacts.erase(contacts.begin() + j);
+				break;
+			}
 		}
 	}
+	delete cEnt;
 }
 
 CollisionSceneEntity *CollisionScene::trackCollision(SceneEntity *newEntity, bool autoCollide, int type, int group) {
@@ -355,6 +379,9 @@ CollisionSceneEntity *CollisionScene::trackCollision(SceneEntity *newEntity, boo
 //	}
 	
 	collisionChildren.push_back(newCollisionEntity);
+	collisionEntityMap[newEntity] = newCollisionEntity;
+	if(type == CollisionSceneEntity::SHAPE_MESH)
+		numMeshChildren++;
 //	newCollisionEntity->Update();
 	return newCollisionEntity;
 }
@@ -42,6 +42,7 @@ CollisionSceneEntity::CollisionSceneEntity(SceneEntity *entity, bool autoCollide
 	
 	collisionObject = new btCollisionObject();
 	collisionObject->getWorldTransform().setBasis(basisA);
+	collisionObject->setUserPointer(this);
 	
 
 	shape = createCollisionShape(entity, type);;
@@ -344,7 +344,7 @@ bool CGShaderModule::applyShaderMaterial(Renderer *renderer, Material *material,
 	//			Logger::log("applying %s (%s %s)\n", material->getShader()->getName().c_str(), cgShader->vp->getResourceName().c_str(), cgShader->fp->getResourceName().c_str());
 	
 	for(int i=0; i < cgBinding->textures.size(); i++) {
-		cgGLSetTextureParameter(cgBinding->textures[i].vpParam, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());
+		cgGLSetTextureParameter(cgBinding->textures[i].vpParam, ((OpenGLTexture*)cgBinding->textures[i].texture->getPageTexture())->getTextureID());
 		cgGLEnableTextureParameter(cgBinding->textures[i].vpParam);
 	}
 	
@@ -355,7 +355,7 @@ bool CGShaderModule::applyShaderMaterial(Renderer *renderer, Material *material,
 	
 	cgBinding = (CGShaderBinding*)localOptions;
 	for(int i=0; i < cgBinding->textures.size(); i++) {
-		cgGLSetTextureParameter(cgBinding->textures[i].vpParam, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());
+		cgGLSetTextureParameter(cgBinding->textures[i].vpParam, ((OpenGLTexture*)cgBinding->textures[i].texture->getPageTexture())->getTextureID());
 		cgGLEnableTextureParameter(cgBinding->textures[i].vpParam);
 	}			
 	
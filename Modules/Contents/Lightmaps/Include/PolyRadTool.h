@@ -38,10 +38,14 @@ namespace Polycode {
 			void doRadiosityPass();
 			void radLumel(Lumel *lumel,Image *image);
 					
+			void buildWorldTriangles();
 			bool worldRayTest(Vector3 origin, Vector3 destination, Polygon *hitPolygon);
 			static bool rayTriangleIntersect(Vector3 ray_origin, Vector3 ray_direction, Vector3 vert0, Vector3 vert1, Vector3 vert2, Vector3 *hitPoint);
 		
 			GenericScene *scene;
 			LightmapPacker *packer;
+			
+			vector<float> worldTriangles;
+			vector<Polygon*> worldTrianglePolygons;
 	};
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 
 #include "PolyRadTool.h"
+#include "PolyBatchTransform.h"
 
 using namespace Polycode;
 
@@ -21,6 +22,8 @@ void RadTool::fiatLux(int radPasses) {
 
 	Vector3 baseAmbient(0.033f, 0.033f, 0.033f);
 	
+	buildWorldTriangles();
+	
 	Color col;	
 	for(int i=0; i < packer->lumels.size(); i++) {
 		packer->lumels[i]->rEnergy.set(baseAmbient.x, baseAmbient.y, baseAmbient.z);
@@ -100,26 +103,50 @@ bool RadTool::rayTriangleIntersect(Vector3 ray_origin, Vector3 ray_direction, Ve
 }
 
 
-bool RadTool::worldRayTest(Vector3 origin, Vector3 destination,Poly::Polygon *hitPolygon) {
-	Vector3 hitPoint,dirVec;
-	dirVec = destination-origin;
+void RadTool::buildWorldTriangles() {
+	// the scene does not move while it is lit, so the faces are moved to world space once instead of for every ray
+	worldTriangles.clear();
+	worldTrianglePolygons.clear();
 	
+	vector<float> localTriangles;
 	for(int i= 0; i < packer->lightmapMeshes.size(); i++) {
 		Matrix4 meshMatrix = packer->lightmapMeshes[i]->mesh->getConcatenatedMatrix();
+		localTriangles.clear();
 		for(int j=0; j < packer->lightmapMeshes[i]->faces.size(); j++) {
-			if(rayTriangleIntersect(origin, dirVec,
-				meshMatrix*(*packer->lightmapMeshes[i]->faces[j]->meshPolygon->getVertex(0)),
-				meshMatrix*(*packer->lightmapMeshes[i]->faces[j]->meshPolygon->getVertex(1)),
-				meshMatrix*(*packer->lightmapMeshes[i]->faces[j]->meshPolygon->getVertex(2)),
-				&hitPoint)) {
-					float dist =  hitPoint.distance(origin);
-					if(dist < destination.distance(origin) && dist > 1.3f) {
-						hitPolygon = packer->lightmapMeshes[i]->faces[j]->meshPolygon;
-						return true;
-					}
+			Polygon *polygon = packer->lightmapMeshes[i]->faces[j]->meshPolygon;
+			for(int k=0; k < 3; k++) {
+				Vertex *vertex = polygon->getVertex(k);
+				localTriangles.push_back(vertex->x);
+				localTriangles.push_back(vertex->y);
+				localTriangles.push_back(vertex->z);
 			}
+			worldTrianglePolygons.push_back(polygon);
 		}
 		
+		unsigned int first = worldTriangles.size();
+		worldTriangles.resize(first + localTriangles.size());
+		if(localTriangles.size() > 0)
+			BatchTransform::transformPoints(meshMatrix, &localTriangles[0], 3, &worldTriangles[first], 3, localTriangles.size() / 3);
+	}
+}
+
+bool RadTool::worldRayTest(Vector3 origin, Vector3 destination,Poly::Polygon *hitPolygon) {
+	Vector3 hitPoint,dirVec;
+	dirVec = destination-origin;
+	
+	for(int i=0; i < worldTrianglePolygons.size(); i++) {
+		const float *triangle = &worldTriangles[i * 9];
+		if(rayTriangleIntersect(origin, dirVec,
+			Vector3(triangle[0], triangle[1], triangle[2]),
+			Vector3(triangle[3], triangle[4], triangle[5]),
+			Vector3(triangle[6], triangle[7], triangle[8]),
+			&hitPoint)) {
+				float dist =  hitPoint.distance(origin);
+				if(dist < destination.distance(origin) && dist > 1.3f) {
+					hitPolygon = worldTrianglePolygons[i];
+					return true;
+				}
+		}
 	}
 	return false;
 }
@@ -13,6 +13,7 @@
 #include "PolyLogger.h"
 #include "PolyGlobals.h"
 #include "PolyPeer.h"
+#include "PolySnapshot.h"
 #include "PolyTimer.h"
 #include "PolyEvent.h"
 
@@ -48,11 +49,18 @@ namespace Polycode {
 		
 		void sendReliableDataToServer(char *data, unsigned int size, unsigned short type);
 		
-		void handlePacket(Packet *packet, PeerConnection *connection);
+		bool handlePacket(Packet *packet, PeerConnection *connection);
 		
 		void handleEvent(Event *event);
 	private:
 		
+		/**
+		* Decodes a world snapshot and dispatches it. Returns false if it could not be decoded, so it is not acknowledged and the server never uses it as a baseline.
+		*/
+		bool handleWorldSnapshot(Packet *packet);
+		
+		SnapshotHistory snapshots;
+		
 		int clientID;
 		
 		void *data;
@@ -43,13 +43,23 @@ namespace Polycode {
 	
 	class _PolyExport PeerConnection {
 	public:
-		PeerConnection() { localSequence = 0; remoteSequence = 0; reliableID = 1;}
+		PeerConnection() { localSequence = 0; remoteSequence = 0; ackBitfield = 0; reliableID = 1;}
 		~PeerConnection(){}
 		
-		void ackPackets(unsigned int ack);
+		void ackPackets(unsigned int ack, unsigned int ackBitfield);
+		
+		/**
+		* Records a received packet sequence in remoteSequence and ackBitfield.
+		*/
+		void receiveSequence(unsigned int sequence);
 		
 		unsigned int localSequence;
 		unsigned int remoteSequence;
+		
+		/**
+		* Bit n is set if packet remoteSequence-n-1 was received.
+		*/
+		unsigned int ackBitfield;
 		unsigned int reliableID;
 		
 		vector<SentPacketEntry> reliablePacketQueue;
@@ -64,7 +74,10 @@ namespace Polycode {
 		
 			void handleEvent(Event *event);
 
-			virtual void handlePacket(Packet *packet, PeerConnection *connection){};
+			/**
+			* Called for every new packet from a connection. The packet's sequence is only acknowledged to the sender if this returns true, so a packet that could not be used is treated as lost.
+			*/
+			virtual bool handlePacket(Packet *packet, PeerConnection *connection){ return true; };
 			virtual void handlePeerConnection(PeerConnection *connection){};
 		
 			Packet *createPacket(const Address &target, char *data, unsigned int size, unsigned short type);
@@ -15,6 +15,7 @@
 #include "PolyPeer.h"
 #include "PolyEvent.h"
 #include "PolyServerWorld.h"
+#include "PolySnapshot.h"
 #include <vector>
 
 using std::vector;
@@ -42,6 +43,12 @@ namespace Polycode {
 		
 		unsigned int clientID;
 		PeerConnection *connection;
+		
+		/**
+		* World states recently sent to this client.
+		*/
+		SnapshotHistory snapshots;
+		unsigned int nextSnapshotID;
 	};
 		
 	class _PolyExport ServerEvent : public Event {
@@ -65,8 +72,13 @@ namespace Polycode {
 			ServerClient *getConnectedClient(PeerConnection *connection);
 		
 			void sendReliableDataToClient(ServerClient *client, char *data, unsigned int size, unsigned short type);
+			
+			/**
+			* Sends a world state to a client. The state is delta encoded against the newest state the client acknowledged, or sent in full if there is no such state left in the client's snapshot history or the delta wouldn't be smaller.
+			*/
+			void sendWorldState(ServerClient *client, char *worldData, unsigned int worldDataSize);
 		
-			void handlePacket(Packet *packet, PeerConnection *connection);
+			bool handlePacket(Packet *packet, PeerConnection *connection);
 		
 	protected:
 		
@@ -0,0 +1,106 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+// @package Network
+
+#pragma once
+
+#include "PolyGlobals.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	typedef struct {
+		unsigned int snapshotID;
+		/**
+		* Snapshot the data is delta encoded against, or 0 if the packet carries a full state.
+		*/
+		unsigned int baselineID;
+		unsigned short stateSize;
+	} SnapshotHeader;
+
+	/**
+	* A world state sent to or received from a server.
+	*/
+	class _PolyExport WorldSnapshot {
+	public:
+		WorldSnapshot();
+		
+		unsigned int snapshotID;
+		
+		/**
+		* Sequence number of the packet the snapshot was sent in.
+		*/
+		unsigned int sequence;
+		bool acked;
+		vector<char> state;
+	};
+
+	/**
+	* Ring of the most recent world snapshots of one connection, along with the word level delta encoding used to send them. A delta starts with a bitmask with one bit per 32 bit word of the state, followed by the new contents of every word whose bit is set.
+	*/
+	class _PolyExport SnapshotHistory {
+	public:
+		SnapshotHistory();
+		
+		/**
+		* Stores a snapshot, replacing the oldest one.
+		*/
+		WorldSnapshot *storeSnapshot(unsigned int snapshotID, const char *data, unsigned int size);
+		
+		/**
+		* Returns a snapshot if it is still in the history, NULL otherwise.
+		*/
+		WorldSnapshot *getSnapshot(unsigned int snapshotID);
+		
+		/**
+		* Returns the newest snapshot that was acknowledged by the remote peer, or NULL if none of the stored ones were.
+		*/
+		WorldSnapshot *getNewestAckedSnapshot();
+		
+		/**
+		* Marks the snapshots sent in acknowledged packets.
+		* @param ack Newest packet sequence received by the remote peer.
+		* @param ackBitfield Bit n is set if packet ack-n-1 was received as well.
+		*/
+		void ackSequence(unsigned int ack, unsigned int ackBitfield);
+		
+		/**
+		* Delta encodes a state against a baseline of the same size.
+		* @return Size of the encoded delta, or 0 if it doesn't fit in maxSize bytes.
+		*/
+		static unsigned int encodeDelta(const vector<char> &baseline, const char *state, unsigned int stateSize, char *out, unsigned int maxSize);
+		
+		/**
+		* Applies a delta to a baseline.
+		* @return False if the delta is malformed.
+		*/
+		static bool decodeDelta(const vector<char> &baseline, const char *delta, unsigned int deltaSize, char *out);
+		
+		static const int HISTORY_SIZE = 32;
+		
+	protected:
+		WorldSnapshot snapshots[HISTORY_SIZE];
+	};
+}
@@ -41,7 +41,7 @@ void Client::sendReliableDataToServer(char *data, unsigned int size, unsigned sh
 	sendReliableData(serverAddress, data, size, type);
 }
 
-void Client::handlePacket(Packet *packet, PeerConnection *connection) {
+bool Client::handlePacket(Packet *packet, PeerConnection *connection) {
 	if(connection->address == serverAddress) {
 		switch(packet->header.type) {
 			case PACKET_TYPE_SETCLIENT_ID: {
@@ -50,6 +50,8 @@ void Client::handlePacket(Packet *packet, PeerConnection *connection) {
 				dispatchEvent(newEvent, ClientEvent::EVENT_CLIENT_READY);
 				sendReliableData(serverAddress, (char*)&clientID, sizeof(unsigned short), PACKET_TYPE_CLIENT_READY);
 			} break;
+			case PACKET_TYPE_WORLD_SNAPSHOT:
+				return handleWorldSnapshot(packet);
 			default: {
 				ClientEvent *newEvent = new ClientEvent();
 				newEvent->dataSize = packet->header.size;
@@ -60,6 +62,41 @@ void Client::handlePacket(Packet *packet, PeerConnection *connection) {
 			break;
 		}
 	}
+	return true;
+}
+
+bool Client::handleWorldSnapshot(Packet *packet) {
+	SnapshotHeader header;
+	if(packet->header.size < sizeof(SnapshotHeader))
+		return false;
+	memcpy(&header, packet->data, sizeof(SnapshotHeader));
+	
+	char *body = packet->data + sizeof(SnapshotHeader);
+	unsigned int bodySize = packet->header.size - sizeof(SnapshotHeader);
+	
+	ClientEvent *newEvent = new ClientEvent();
+	newEvent->dataType = PACKET_TYPE_USERDATA;
+	newEvent->dataSize = header.stateSize;
+	
+	if(header.baselineID == 0) {
+		if(bodySize != header.stateSize) {
+			delete newEvent;
+			return false;
+		}
+		memcpy(newEvent->data, body, bodySize);
+	} else {
+		// the server only deltas against states we acknowledged, so this means the stream is broken
+		WorldSnapshot *baseline = snapshots.getSnapshot(header.baselineID);
+		if(!baseline || baseline->state.size() != header.stateSize || !SnapshotHistory::decodeDelta(baseline->state, body, bodySize, newEvent->data)) {
+			Logger::log("Dropping world snapshot %d, baseline %d is missing\n", header.snapshotID, header.baselineID);
+			delete newEvent;
+			return false;
+		}
+	}
+	
+	snapshots.storeSnapshot(header.snapshotID, newEvent->data, newEvent->dataSize);
+	dispatchEvent(newEvent, ClientEvent::EVENT_SERVER_DATA);
+	return true;
 }
 
 void Client::setPersistentData(void *data, unsigned int size) {
@@ -11,15 +11,38 @@
 
 using namespace Polycode;
 
-void PeerConnection::ackPackets(unsigned int ack) {
+void PeerConnection::ackPackets(unsigned int ack, unsigned int ackBitfield) {
 	for(int i=0; i < reliablePacketQueue.size(); i++) {
-		if(reliablePacketQueue[i].packet->header.sequence == ack) {
+		unsigned int sequence = reliablePacketQueue[i].packet->header.sequence;
+		if(sequence > ack)
+			continue;
+		unsigned int age = ack - sequence;
+		if(age == 0 || (age <= 32 && (ackBitfield & (1u << (age-1))))) {
 			delete reliablePacketQueue[i].packet;
 			reliablePacketQueue.erase(reliablePacketQueue.begin()+i);
+			i--;
 		}
 	}
 }
 
+void PeerConnection::receiveSequence(unsigned int sequence) {
+	if(sequence > remoteSequence) {
+		unsigned int shift = sequence - remoteSequence;
+		if(shift > 32) {
+			ackBitfield = 0;
+		} else {
+			// shifting a 32 bit value by 32 is undefined
+			ackBitfield = (shift == 32) ? 0 : (ackBitfield << shift);
+			ackBitfield |= 1u << (shift-1);
+		}
+		remoteSequence = sequence;
+	} else if(sequence < remoteSequence) {
+		unsigned int age = remoteSequence - sequence;
+		if(age <= 32)
+			ackBitfield |= 1u << (age-1);
+	}
+}
+
 Peer::Peer(unsigned int port) : EventDispatcher(), Threaded() {
 	socket = new Socket(port);
 	socket->addEventListener(this, SocketEvent::EVENT_DATA_RECEIVED);
@@ -64,7 +87,7 @@ Packet *Peer::createPacket(const Address &target, char *data, unsigned int size,
 	packet->header.headerHash = 20;
 	packet->header.reliableID = 0;	
 	packet->header.ack = connection->remoteSequence;
-	packet->header.ackBitfield = 0;
+	packet->header.ackBitfield = connection->ackBitfield;
 	packet->header.size = size;	
 	packet->header.type = type;
 	if(size > 0)
@@ -111,9 +134,7 @@ void Peer::sendPacket(const Address &target, Packet *packet) {
 
 bool Peer::checkPacketAcks(PeerConnection *connection, Packet *packet) {
 	bool retVal = true;
-	if(packet->header.sequence > connection->remoteSequence)
-		connection->remoteSequence = packet->header.sequence;
-	else // ignore old packets
+	if(packet->header.sequence <= connection->remoteSequence) // ignore old packets
 		retVal = false;
 	
 	// if this is a reliable packet, check if it was recently received	
@@ -132,10 +153,7 @@ bool Peer::checkPacketAcks(PeerConnection *connection, Packet *packet) {
 		}		
 	}
 	
-	for(int i=0; i < peerConnections.size(); i++) {
-		peerConnections[i]->ackPackets(packet->header.ack);
-	}
-	
+	connection->ackPackets(packet->header.ack, packet->header.ackBitfield);
 	return retVal;
 }
 
@@ -147,8 +165,11 @@ void Peer::handleEvent(Event *event) {
 				PeerConnection *connection = getPeerConnection(socketEvent->fromAddress);
 				if(!connection)
 					connection = addPeerConnection(socketEvent->fromAddress);				
-				if(checkPacketAcks(connection, (Packet*)socketEvent->data))
-					handlePacket((Packet*)socketEvent->data, connection);
+				// only acknowledge packets that are actually handled
+				if(checkPacketAcks(connection, (Packet*)socketEvent->data)) {
+					if(handlePacket((Packet*)socketEvent->data, connection))
+						connection->receiveSequence(((Packet*)socketEvent->data)->header.sequence);
+				}
 			break;
 		}
 	} else if(event->getDispatcher() == updateTimer) {
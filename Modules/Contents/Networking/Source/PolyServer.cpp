@@ -12,7 +12,7 @@
 using namespace Polycode;
 
 ServerClient::ServerClient() {
-	
+	nextSnapshotID = 1;
 }
 
 ServerClient::~ServerClient() {
@@ -57,13 +57,46 @@ void Server::handleEvent(Event *event) {
 			unsigned int worldDataSize;
 			char *worldData;
 			world->getWorldState(client, &worldData, &worldDataSize);			
-			sendData(client->connection->address, (char*)worldData, worldDataSize, PACKET_TYPE_USERDATA);			
+			sendWorldState(client, worldData, worldDataSize);
 		}
 	}	
 	
 	Peer::handleEvent(event);
 }
 
+void Server::sendWorldState(ServerClient *client, char *worldData, unsigned int worldDataSize) {
+	char packetData[MAX_PACKET_SIZE];
+	SnapshotHeader header;
+	unsigned int maxBodySize = MAX_PACKET_SIZE - sizeof(SnapshotHeader);
+	
+	if(worldDataSize > maxBodySize) {
+		Logger::log("World state of %d bytes doesn't fit in a packet\n", worldDataSize);
+		return;
+	}
+	
+	header.snapshotID = client->nextSnapshotID++;
+	header.baselineID = 0;
+	header.stateSize = worldDataSize;
+	
+	unsigned int bodySize = 0;
+	WorldSnapshot *baseline = client->snapshots.getNewestAckedSnapshot();
+	if(baseline) {
+		bodySize = SnapshotHistory::encodeDelta(baseline->state, worldData, worldDataSize, packetData + sizeof(SnapshotHeader), worldDataSize);
+		if(bodySize > 0)
+			header.baselineID = baseline->snapshotID;
+	}
+	
+	if(header.baselineID == 0) {
+		memcpy(packetData + sizeof(SnapshotHeader), worldData, worldDataSize);
+		bodySize = worldDataSize;
+	}
+	memcpy(packetData, &header, sizeof(SnapshotHeader));
+	
+	WorldSnapshot *snapshot = client->snapshots.storeSnapshot(header.snapshotID, worldData, worldDataSize);
+	snapshot->sequence = client->connection->localSequence;
+	sendData(client->connection->address, packetData, sizeof(SnapshotHeader) + bodySize, PACKET_TYPE_WORLD_SNAPSHOT);
+}
+
 void Server::sendReliableDataToClient(ServerClient *client, char *data, unsigned int size, unsigned short type) {
 	sendReliableData(client->connection->address, data, size, type);	
 }
@@ -79,8 +112,11 @@ void Server::handlePeerConnection(PeerConnection *connection) {
 
 }
 
-void Server::handlePacket(Packet *packet, PeerConnection *connection) {
+bool Server::handlePacket(Packet *packet, PeerConnection *connection) {
 	ServerClient *client = getConnectedClient(connection);
+	if(client)
+		client->snapshots.ackSequence(packet->header.ack, packet->header.ackBitfield);
+	
 	if(packet->header.type == PACKET_TYPE_CLIENT_READY && client) {
 		ServerEvent *event = new ServerEvent();
 		event->client = client;
@@ -91,4 +127,5 @@ void Server::handlePacket(Packet *packet, PeerConnection *connection) {
 		} else {
 		}
 	}
+	return true;
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolySnapshot.h"
+#include <string.h>
+
+using namespace Polycode;
+
+WorldSnapshot::WorldSnapshot() {
+	snapshotID = 0;
+	sequence = 0;
+	acked = false;
+}
+
+SnapshotHistory::SnapshotHistory() {
+
+}
+
+WorldSnapshot *SnapshotHistory::storeSnapshot(unsigned int snapshotID, const char *data, unsigned int size) {
+	WorldSnapshot *snapshot = &snapshots[snapshotID % HISTORY_SIZE];
+	snapshot->snapshotID = snapshotID;
+	snapshot->sequence = 0;
+	snapshot->acked = false;
+	snapshot->state.assign(data, data + size);
+	return snapshot;
+}
+
+WorldSnapshot *SnapshotHistory::getSnapshot(unsigned int snapshotID) {
+	WorldSnapshot *snapshot = &snapshots[snapshotID % HISTORY_SIZE];
+	if(snapshotID == 0 || snapshot->snapshotID != snapshotID)
+		return NULL;
+	return snapshot;
+}
+
+WorldSnapshot *SnapshotHistory::getNewestAckedSnapshot() {
+	WorldSnapshot *newest = NULL;
+	for(int i=0; i < HISTORY_SIZE; i++) {
+		if(snapshots[i].snapshotID != 0 && snapshots[i].acked) {
+			if(!newest || snapshots[i].snapshotID > newest->snapshotID)
+				newest = &snapshots[i];
+		}
+	}
+	return newest;
+}
+
+void SnapshotHistory::ackSequence(unsigned int ack, unsigned int ackBitfield) {
+	for(int i=0; i < HISTORY_SIZE; i++) {
+		WorldSnapshot *snapshot = &snapshots[i];
+		if(snapshot->snapshotID == 0 || snapshot->acked || snapshot->sequence > ack)
+			continue;
+		unsigned int age = ack - snapshot->sequence;
+		if(age == 0 || (age <= 32 && (ackBitfield & (1u << (age-1)))))
+			snapshot->acked = true;
+	}
+}
+
+unsigned int SnapshotHistory::encodeDelta(const vector<char> &baseline, const char *state, unsigned int stateSize, char *out, unsigned int maxSize) {
+	if(baseline.size() != stateSize || stateSize == 0)
+		return 0;
+	
+	unsigned int numWords = (stateSize + 3) / 4;
+	unsigned int maskSize = (numWords + 7) / 8;
+	if(maskSize > maxSize)
+		return 0;
+	
+	unsigned char *mask = (unsigned char*)out;
+	memset(mask, 0, maskSize);
+	unsigned int size = maskSize;
+	
+	for(unsigned int w=0; w < numWords; w++) {
+		unsigned int offset = w * 4;
+		unsigned int length = stateSize - offset;
+		if(length > 4)
+			length = 4;
+		if(memcmp(&baseline[offset], state + offset, length) != 0) {
+			if(size + length > maxSize)
+				return 0;
+			mask[w >> 3] |= 1 << (w & 7);
+			memcpy(out + size, state + offset, length);
+			size += length;
+		}
+	}
+	return size;
+}
+
+bool SnapshotHistory::decodeDelta(const vector<char> &baseline, const char *delta, unsigned int deltaSize, char *out) {
+	unsigned int stateSize = baseline.size();
+	unsigned int numWords = (stateSize + 3) / 4;
+	unsigned int maskSize = (numWords + 7) / 8;
+	if(stateSize == 0 || deltaSize < maskSize)
+		return false;
+	
+	memcpy(out, &baseline[0], stateSize);
+	
+	const unsigned char *mask = (const unsigned char*)delta;
+	unsigned int position = maskSize;
+	for(unsigned int w=0; w < numWords; w++) {
+		if(!(mask[w >> 3] & (1 << (w & 7))))
+			continue;
+		unsigned int offset = w * 4;
+		unsigned int length = stateSize - offset;
+		if(length > 4)
+			length = 4;
+		if(position + length > deltaSize)
+			return false;
+		memcpy(out + offset, delta + position, length);
+		position += length;
+	}
+	return position == deltaSize;
+}
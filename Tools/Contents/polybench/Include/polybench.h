@@ -0,0 +1,14 @@
+
+#pragma once
+
+#include "stdio.h"
+#include "PolyString.h"
+#include "PolyMatrix4.h"
+#include "PolyAABBTree.h"
+#include "PolyBatchTransform.h"
+#include "PolyMesh.h"
+#include <time.h>
+#include <math.h>
+#include <vector>
+
+using namespace Polycode;
@@ -0,0 +1,203 @@
+
+#include "polybench.h"
+
+// Micro-benchmark for BatchTransform. Runs every transform on every path the CPU supports and prints
+// millions of elements per second, next to a loop calling Matrix4::operator* per point. The results of
+// the SIMD paths are checked against the scalar path, and the largest relative difference is printed.
+// Returns 1 if any path is off by more than maxRelativeError.
+//
+// usage: polybench [vertex count] [repeats]
+
+// rsqrt with one Newton step and a different order of operations leave a few units in the last place
+static const double maxRelativeError = 1e-5;
+
+static float randomValue() {
+	return ((rand() / (float)RAND_MAX) * 2.0f) - 1.0f;
+}
+
+static double elementsPerSecond(clock_t start, unsigned int elements) {
+	double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	if(seconds <= 0)
+		return 0;
+	return (elements / seconds) / 1000000.0;
+}
+
+static double relativeError(double value, double reference) {
+	double scale = fabs(reference);
+	if(scale < 1.0)
+		scale = 1.0;
+	return fabs(value - reference) / scale;
+}
+
+// compares the first three floats of every element, the rest of the stream is not written
+static double maxError(const std::vector<float> &values, const std::vector<float> &reference, unsigned int offset) {
+	double error = 0;
+	for(unsigned int i=offset; i < values.size(); i += Mesh::VERTEX_STREAM_STRIDE) {
+		for(int j=0; j < 3; j++) {
+			double e = relativeError(values[i+j], reference[i+j]);
+			if(e > error)
+				error = e;
+		}
+	}
+	return error;
+}
+
+static double maxError(const std::vector<AABB> &values, const std::vector<AABB> &reference) {
+	double error = 0;
+	for(unsigned int i=0; i < values.size(); i++) {
+		double e[6] = {
+			relativeError(values[i].min.x, reference[i].min.x), relativeError(values[i].min.y, reference[i].min.y), relativeError(values[i].min.z, reference[i].min.z),
+			relativeError(values[i].max.x, reference[i].max.x), relativeError(values[i].max.y, reference[i].max.y), relativeError(values[i].max.z, reference[i].max.z)
+		};
+		for(int j=0; j < 6; j++) {
+			if(e[j] > error)
+				error = e[j];
+		}
+	}
+	return error;
+}
+
+// one run of every transform on the current path, into separate buffers
+class BenchResults {
+	public:
+		BenchResults(unsigned int count) : points(count * Mesh::VERTEX_STREAM_STRIDE), normals(count * Mesh::VERTEX_STREAM_STRIDE), skinnedPoints(count * Mesh::VERTEX_STREAM_STRIDE), skinnedNormals(count * Mesh::VERTEX_STREAM_STRIDE), aabbs(count) {}
+		
+		void run(const Matrix4 &matrix, const std::vector<Matrix4> &matrices, const std::vector<float> &vertices, const std::vector<AABB> &boxes) {
+			unsigned int count = aabbs.size();
+			BatchTransform::transformPoints(matrix, &vertices[0], Mesh::VERTEX_STREAM_STRIDE, &points[0], Mesh::VERTEX_STREAM_STRIDE, count);
+			BatchTransform::transformNormals(matrix, &vertices[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, &normals[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, count, true);
+			BatchTransform::transformPoints(&matrices[0], &vertices[0], Mesh::VERTEX_STREAM_STRIDE, &skinnedPoints[0], Mesh::VERTEX_STREAM_STRIDE, count);
+			BatchTransform::transformNormals(&matrices[0], &vertices[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, &skinnedNormals[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, count, true);
+			BatchTransform::transformAABBs(matrix, &boxes[0], &aabbs[0], count);
+		}
+		
+		double maxErrorTo(const BenchResults &reference) const {
+			double errors[5] = {
+				maxError(points, reference.points, 0),
+				maxError(normals, reference.normals, Mesh::VERTEX_STREAM_NORMAL_OFFSET),
+				maxError(skinnedPoints, reference.skinnedPoints, 0),
+				maxError(skinnedNormals, reference.skinnedNormals, Mesh::VERTEX_STREAM_NORMAL_OFFSET),
+				maxError(aabbs, reference.aabbs)
+			};
+			double error = 0;
+			for(int i=0; i < 5; i++) {
+				if(errors[i] > error)
+					error = errors[i];
+			}
+			return error;
+		}
+		
+		std::vector<float> points;
+		std::vector<float> normals;
+		std::vector<float> skinnedPoints;
+		std::vector<float> skinnedNormals;
+		std::vector<AABB> aabbs;
+};
+
+int main(int argc, char **argv) {
+	unsigned int count = 10000;
+	unsigned int repeats = 500;
+	if(argc > 1)
+		count = atoi(argv[1]);
+	if(argc > 2)
+		repeats = atoi(argv[2]);
+	if(count == 0 || repeats == 0) {
+		printf("usage: polybench [vertex count] [repeats]\n");
+		return 1;
+	}
+	
+	// interleaved like a mesh vertex stream
+	std::vector<float> vertices(count * Mesh::VERTEX_STREAM_STRIDE);
+	std::vector<float> output(count * Mesh::VERTEX_STREAM_STRIDE);
+	for(unsigned int i=0; i < vertices.size(); i++) {
+		vertices[i] = randomValue() * 10.0f;
+	}
+	
+	Matrix4 matrix;
+	for(int i=0; i < 12; i++) {
+		matrix.ml[i] = randomValue();
+	}
+	matrix.setPosition(3, -2, 5);
+	
+	std::vector<Matrix4> matrices(count);
+	std::vector<AABB> boxes(count);
+	for(unsigned int i=0; i < count; i++) {
+		for(int j=0; j < 12; j++) {
+			matrices[i].ml[j] = randomValue();
+		}
+		Vector3 corner(randomValue(), randomValue(), randomValue());
+		boxes[i] = AABB(corner, corner + Vector3(1, 1, 1));
+	}
+	std::vector<AABB> outputBoxes(count);
+	
+	unsigned int elements = count * repeats;
+	printf("%u elements, %u repeats, best path: %s\n", count, repeats, BatchTransform::getPathName(BatchTransform::getBestPath()).c_str());
+	printf("%-8s %10s %10s %10s %10s %10s %10s\n", "path", "points", "normals", "skinned", "normals2", "aabbs", "max error");
+	
+	BatchTransform::setPath(BatchTransform::PATH_SCALAR);
+	BenchResults reference(count);
+	reference.run(matrix, matrices, vertices, boxes);
+	bool failed = false;
+	
+	for(int path=BatchTransform::PATH_SCALAR; path <= BatchTransform::getBestPath(); path++) {
+		BatchTransform::setPath(path);
+		
+		BenchResults results(count);
+		results.run(matrix, matrices, vertices, boxes);
+		double error = results.maxErrorTo(reference);
+		if(error > maxRelativeError)
+			failed = true;
+		
+		clock_t start = clock();
+		for(unsigned int r=0; r < repeats; r++) {
+			BatchTransform::transformPoints(matrix, &vertices[0], Mesh::VERTEX_STREAM_STRIDE, &output[0], Mesh::VERTEX_STREAM_STRIDE, count);
+		}
+		double points = elementsPerSecond(start, elements);
+		
+		start = clock();
+		for(unsigned int r=0; r < repeats; r++) {
+			BatchTransform::transformNormals(matrix, &vertices[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, &output[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, count, true);
+		}
+		double normals = elementsPerSecond(start, elements);
+		
+		start = clock();
+		for(unsigned int r=0; r < repeats; r++) {
+			BatchTransform::transformPoints(&matrices[0], &vertices[0], Mesh::VERTEX_STREAM_STRIDE, &output[0], Mesh::VERTEX_STREAM_STRIDE, count);
+		}
+		double skinnedPoints = elementsPerSecond(start, elements);
+		
+		start = clock();
+		for(unsigned int r=0; r < repeats; r++) {
+			BatchTransform::transformNormals(&matrices[0], &vertices[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, &output[Mesh::VERTEX_STREAM_NORMAL_OFFSET], Mesh::VERTEX_STREAM_STRIDE, count, true);
+		}
+		double skinnedNormals = elementsPerSecond(start, elements);
+		
+		start = clock();
+		for(unsigned int r=0; r < repeats; r++) {
+			BatchTransform::transformAABBs(matrix, &boxes[0], &outputBoxes[0], count);
+		}
+		double aabbs = elementsPerSecond(start, elements);
+		
+		printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1e%s\n", BatchTransform::getPathName(path).c_str(), points, normals, skinnedPoints, skinnedNormals, aabbs, error, error > maxRelativeError ? " FAILED" : "");
+	}
+	
+	clock_t start = clock();
+	for(unsigned int r=0; r < repeats; r++) {
+		for(unsigned int i=0; i < count; i++) {
+			float *v = &vertices[i * Mesh::VERTEX_STREAM_STRIDE];
+			Vector3 p = matrix * Vector3(v[0], v[1], v[2]);
+			float *o = &output[i * Mesh::VERTEX_STREAM_STRIDE];
+			o[0] = p.x;
+			o[1] = p.y;
+			o[2] = p.z;
+		}
+	}
+	printf("%-8s %10.1f\n", "operator", elementsPerSecond(start, elements));
+	printf("(millions per second)\n");
+	
+	if(failed) {
+		printf("SIMD results differ from the scalar path by more than %g\n", maxRelativeError);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "stdio.h"
+#include "PolyGlobals.h"
+#include "PolyImage.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace Polycode;
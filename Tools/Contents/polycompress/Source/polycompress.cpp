@@ -0,0 +1,402 @@
+#include "polycompress.h"
+
+// Checks the CPU texture encoders without a GPU. Test images are encoded with Image::createCompressedData,
+// decoded again the way the hardware would and compared with the source pixels:
+// - BC1 and BC3 color error, as RMS over smooth images and as the worst channel error on solid blocks
+// - BC3 alpha error against the spacing of the eight alpha values of each block
+// - BC1 punch-through alpha, which has to match the source alpha thresholded at 128 exactly
+// It also checks that Image::createMipmap weights color by alpha, so transparent pixels do not bleed in.
+//
+// usage: polycompress [image size] [seed]
+// Returns 1 if any check is over its limit.
+
+// RMS over smooth images with features about 64 pixels wide, in 0-255 units. The inset bounding box
+// encoder typically stays between 3 and 5.
+#define SMOOTH_RMS_LIMIT 6.0
+// 565 quantization of a solid color, rounded to nearest
+#define SOLID_RED_BLUE_LIMIT 4
+#define SOLID_GREEN_LIMIT 2
+
+struct CompressionCheck {
+	const char *name;
+	double limit;
+	double worst;
+	unsigned int failures;
+};
+
+static void addResult(CompressionCheck &check, double error) {
+	if(error > check.worst)
+		check.worst = error;
+	if(error > check.limit)
+		check.failures++;
+}
+
+static int randomByte() {
+	return rand() % 256;
+}
+
+static void unpackColor565(unsigned short packed, int *color) {
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Decodes a BC1 color block into 16 RGBA pixels. The color block of BC3 always uses the four color mode.
+static void decodeColorBlock(const unsigned char *block, bool alwaysFourColors, unsigned char *pixels) {
+	unsigned short color0 = block[0] | (block[1] << 8);
+	unsigned short color1 = block[2] | (block[3] << 8);
+	int palette[4][4];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+	palette[2][3] = 255;
+	palette[3][3] = 255;
+	for(int c=0; c < 3; c++) {
+		if(alwaysFourColors || color0 > color1) {
+			palette[2][c] = ((2 * palette[0][c]) + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + (2 * palette[1][c])) / 3;
+		} else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if(!alwaysFourColors && color0 <= color1)
+		palette[3][3] = 0;
+	
+	unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+	for(int i=0; i < 16; i++) {
+		int *color = palette[(indices >> (i * 2)) & 3];
+		for(int c=0; c < 4; c++) {
+			pixels[(i * 4) + c] = color[c];
+		}
+	}
+}
+
+static void decodeAlphaBlock(const unsigned char *block, unsigned char *pixels) {
+	int alpha0 = block[0];
+	int alpha1 = block[1];
+	int palette[8];
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+	if(alpha0 > alpha1) {
+		for(int i=2; i < 8; i++) {
+			palette[i] = (((8 - i) * alpha0) + ((i - 1) * alpha1)) / 7;
+		}
+	} else {
+		for(int i=2; i < 6; i++) {
+			palette[i] = (((6 - i) * alpha0) + ((i - 1) * alpha1)) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	
+	for(int group=0; group < 2; group++) {
+		const unsigned char *bytes = block + 2 + (group * 3);
+		unsigned int indices = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+		for(int i=0; i < 8; i++) {
+			pixels[(((group * 8) + i) * 4) + 3] = palette[(indices >> (i * 3)) & 7];
+		}
+	}
+}
+
+// Decodes compressed data into RGBA pixels of the given size.
+static void decompress(const unsigned char *data, unsigned int width, unsigned int height, int format, std::vector<unsigned char> &pixels) {
+	unsigned int blocksX = (width + 3) / 4;
+	unsigned int blocksY = (height + 3) / 4;
+	unsigned int blockSize = (format == Image::COMPRESSION_BC1) ? 8 : 16;
+	pixels.resize(width * height * 4);
+	
+	unsigned char block[64];
+	for(unsigned int by=0; by < blocksY; by++) {
+		for(unsigned int bx=0; bx < blocksX; bx++) {
+			const unsigned char *source = data + (((by * blocksX) + bx) * blockSize);
+			if(format == Image::COMPRESSION_BC3) {
+				decodeColorBlock(source + 8, true, block);
+				decodeAlphaBlock(source, block);
+			} else {
+				decodeColorBlock(source, false, block);
+			}
+			for(unsigned int y=0; y < 4; y++) {
+				for(unsigned int x=0; x < 4; x++) {
+					unsigned int px = (bx * 4) + x;
+					unsigned int py = (by * 4) + y;
+					if(px >= width || py >= height)
+						continue;
+					memcpy(&pixels[((py * width) + px) * 4], block + (((y * 4) + x) * 4), 4);
+				}
+			}
+		}
+	}
+}
+
+static bool roundTrip(Image *image, int format, std::vector<unsigned char> &pixels) {
+	unsigned int dataSize = 0;
+	char *data = image->createCompressedData(format, &dataSize);
+	if(!data || dataSize != Image::getCompressedDataSize(image->getWidth(), image->getHeight(), format)) {
+		free(data);
+		return false;
+	}
+	decompress((unsigned char*)data, image->getWidth(), image->getHeight(), format, pixels);
+	free(data);
+	return true;
+}
+
+static Image *createSmoothImage(unsigned int size, int type, bool binaryAlpha) {
+	int pixelSize = (type == Image::IMAGE_RGBA) ? 4 : 3;
+	std::vector<unsigned char> pixels(size * size * pixelSize);
+	double phase[4];
+	for(int c=0; c < 4; c++) {
+		phase[c] = (rand() / (double)RAND_MAX) * 6.28;
+	}
+	for(unsigned int y=0; y < size; y++) {
+		for(unsigned int x=0; x < size; x++) {
+			unsigned char *pixel = &pixels[((y * size) + x) * pixelSize];
+			double u = ((double)x) / 64.0;
+			double v = ((double)y) / 64.0;
+			pixel[0] = (unsigned char)(127.5 + (127.5 * sin((u * 3.0) + phase[0])));
+			pixel[1] = (unsigned char)(127.5 + (127.5 * sin((v * 2.0) + phase[1])));
+			pixel[2] = (unsigned char)(127.5 + (127.5 * cos(((u + v) * 2.0) + phase[2])));
+			if(pixelSize == 4) {
+				unsigned char alpha = (unsigned char)(127.5 + (127.5 * sin(((u - v) * 5.0) + phase[3])));
+				if(binaryAlpha)
+					alpha = (randomByte() < 128) ? 0 : 255;
+				pixel[3] = alpha;
+			}
+		}
+	}
+	return new Image((char*)&pixels[0], size, size, type);
+}
+
+static double colorRMS(Image *image, int pixelSize, const std::vector<unsigned char> &decoded, bool skipTransparent) {
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	unsigned int count = image->getWidth() * image->getHeight();
+	double sum = 0;
+	unsigned int samples = 0;
+	for(unsigned int i=0; i < count; i++) {
+		const unsigned char *source = pixels + (i * pixelSize);
+		if(skipTransparent && source[3] < 128)
+			continue;
+		for(int c=0; c < 3; c++) {
+			double difference = ((double)source[c]) - decoded[(i * 4) + c];
+			sum += difference * difference;
+			samples++;
+		}
+	}
+	if(samples == 0)
+		return 0;
+	return sqrt(sum / samples);
+}
+
+// Every block of BC3 alpha can reach any value in its range within half the step between its eight values.
+static void checkAlpha(Image *image, const std::vector<unsigned char> &decoded, CompressionCheck &check) {
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	unsigned int width = image->getWidth();
+	unsigned int height = image->getHeight();
+	for(unsigned int by=0; by < height; by += 4) {
+		for(unsigned int bx=0; bx < width; bx += 4) {
+			int minAlpha = 255;
+			int maxAlpha = 0;
+			for(unsigned int y=by; y < std::min(by+4, height); y++) {
+				for(unsigned int x=bx; x < std::min(bx+4, width); x++) {
+					int alpha = pixels[(((y * width) + x) * 4) + 3];
+					minAlpha = std::min(minAlpha, alpha);
+					maxAlpha = std::max(maxAlpha, alpha);
+				}
+			}
+			double bound = ((maxAlpha - minAlpha) / 14.0) + 1.0;
+			for(unsigned int y=by; y < std::min(by+4, height); y++) {
+				for(unsigned int x=bx; x < std::min(bx+4, width); x++) {
+					unsigned int i = (y * width) + x;
+					// reported relative to the bound, so the limit is 1
+					addResult(check, fabs(((double)pixels[(i * 4) + 3]) - decoded[(i * 4) + 3]) / bound);
+				}
+			}
+		}
+	}
+}
+
+static void checkSolidColors(unsigned int count, CompressionCheck &check) {
+	std::vector<unsigned char> decoded;
+	for(unsigned int n=0; n < count; n++) {
+		Image image(4, 4, Image::IMAGE_RGBA);
+		int color[4] = {randomByte(), randomByte(), randomByte(), 255};
+		unsigned char *pixels = (unsigned char*)image.getPixels();
+		for(int i=0; i < 16; i++) {
+			for(int c=0; c < 4; c++) {
+				pixels[(i * 4) + c] = color[c];
+			}
+		}
+		
+		for(int format=Image::COMPRESSION_BC1; format <= Image::COMPRESSION_BC3; format++) {
+			if(!roundTrip(&image, format, decoded)) {
+				check.failures++;
+				continue;
+			}
+			for(int i=0; i < 16; i++) {
+				double redBlue = std::max(abs(color[0] - decoded[(i * 4)]), abs(color[2] - decoded[(i * 4) + 2]));
+				double green = abs(color[1] - decoded[(i * 4) + 1]);
+				// reported relative to the quantization step, so the limit is 1
+				addResult(check, std::max(redBlue / SOLID_RED_BLUE_LIMIT, green / SOLID_GREEN_LIMIT));
+				if(decoded[(i * 4) + 3] != 255)
+					check.failures++;
+			}
+		}
+	}
+}
+
+// BC1 with alpha stores one bit, every pixel below 128 has to decode fully transparent and every other one opaque.
+static void checkPunchThrough(Image *image, const std::vector<unsigned char> &decoded, CompressionCheck &check) {
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	unsigned int count = image->getWidth() * image->getHeight();
+	for(unsigned int i=0; i < count; i++) {
+		unsigned char expected = (pixels[(i * 4) + 3] < 128) ? 0 : 255;
+		addResult(check, abs(((int)expected) - decoded[(i * 4) + 3]));
+	}
+}
+
+static void checkMipmapPixel(Image *mipmap, const int *expected, int tolerance, CompressionCheck &check) {
+	unsigned char *pixel = (unsigned char*)mipmap->getPixels();
+	for(int c=0; c < 4; c++) {
+		int error = abs(((int)pixel[c]) - expected[c]);
+		addResult(check, error > tolerance ? error : 0);
+	}
+}
+
+static void setPixels(Image *image, const int *pixels) {
+	unsigned char *dest = (unsigned char*)image->getPixels();
+	for(int i=0; i < image->getWidth() * image->getHeight() * 4; i++) {
+		dest[i] = pixels[i];
+	}
+}
+
+// One opaque red pixel next to three transparent green ones has to filter to red at a quarter alpha,
+// a transparent area keeps its color, and an opaque solid color survives the sRGB round trip in RGBA
+// and RGB images.
+static void checkMipmapWeighting(CompressionCheck &check) {
+	const int edge[16] = {255, 0, 0, 255,  0, 255, 0, 0,  0, 255, 0, 0,  0, 255, 0, 0};
+	const int edgeExpected[4] = {255, 0, 0, 64};
+	const int transparent[16] = {40, 80, 120, 0,  40, 80, 120, 0,  40, 80, 120, 0,  40, 80, 120, 0};
+	const int transparentExpected[4] = {40, 80, 120, 0};
+	const int solid[16] = {200, 100, 30, 255,  200, 100, 30, 255,  200, 100, 30, 255,  200, 100, 30, 255};
+	const int solidExpected[4] = {200, 100, 30, 255};
+	
+	for(int gamma=0; gamma < 2; gamma++) {
+		for(int filter=Image::MIPMAP_FILTER_BOX; filter <= Image::MIPMAP_FILTER_TENT; filter++) {
+			Image image(2, 2, Image::IMAGE_RGBA);
+			
+			setPixels(&image, edge);
+			Image *mipmap = image.createMipmap(filter, gamma == 1);
+			checkMipmapPixel(mipmap, edgeExpected, 0, check);
+			delete mipmap;
+			
+			setPixels(&image, transparent);
+			mipmap = image.createMipmap(filter, gamma == 1);
+			checkMipmapPixel(mipmap, transparentExpected, 0, check);
+			delete mipmap;
+			
+			setPixels(&image, solid);
+			mipmap = image.createMipmap(filter, gamma == 1);
+			checkMipmapPixel(mipmap, solidExpected, 1, check);
+			delete mipmap;
+			
+			char rgb[5 * 3 * 3];
+			for(int i=0; i < 5 * 3; i++) {
+				rgb[(i * 3)] = solid[0];
+				rgb[(i * 3) + 1] = solid[1];
+				rgb[(i * 3) + 2] = solid[2];
+			}
+			Image rgbImage(rgb, 5, 3, Image::IMAGE_RGB);
+			vector<Image*> levels = rgbImage.createMipmapChain(filter, gamma == 1);
+			if(levels.size() != 2)
+				check.failures++;
+			for(int l=0; l < levels.size(); l++) {
+				unsigned char *pixel = (unsigned char*)levels[l]->getPixels();
+				for(int c=0; c < 3; c++) {
+					int error = abs(((int)pixel[c]) - solidExpected[c]);
+					addResult(check, error > 1 ? error : 0);
+				}
+				delete levels[l];
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	unsigned int size = 64;
+	unsigned int seed = 1;
+	if(argc > 1)
+		size = atoi(argv[1]);
+	if(argc > 2)
+		seed = atoi(argv[2]);
+	if(size == 0) {
+		printf("usage: polycompress [image size] [seed]\n");
+		return 1;
+	}
+	srand(seed);
+	
+	CompressionCheck bc1Color = {"bc1 color", SMOOTH_RMS_LIMIT, 0, 0};
+	CompressionCheck bc3Color = {"bc3 color", SMOOTH_RMS_LIMIT, 0, 0};
+	CompressionCheck bc3Alpha = {"bc3 alpha", 1.0, 0, 0};
+	CompressionCheck solidColor = {"solid", 1.0, 0, 0};
+	CompressionCheck punchThrough = {"bc1 alpha", 0, 0, 0};
+	CompressionCheck mipmapWeighting = {"mipmap", 0, 0, 0};
+	
+	std::vector<unsigned char> decoded;
+	
+	// one size that is not a multiple of the block size, to cover the edge padding
+	unsigned int sizes[2] = {size, size + 3};
+	for(int s=0; s < 2; s++) {
+		Image *rgb = createSmoothImage(sizes[s], Image::IMAGE_RGB, false);
+		if(roundTrip(rgb, Image::COMPRESSION_BC1, decoded))
+			addResult(bc1Color, colorRMS(rgb, 3, decoded, false));
+		else
+			bc1Color.failures++;
+		delete rgb;
+		
+		Image *rgba = createSmoothImage(sizes[s], Image::IMAGE_RGBA, false);
+		if(roundTrip(rgba, Image::COMPRESSION_BC3, decoded)) {
+			addResult(bc3Color, colorRMS(rgba, 4, decoded, false));
+			checkAlpha(rgba, decoded, bc3Alpha);
+		} else {
+			bc3Color.failures++;
+		}
+		delete rgba;
+		
+		Image *cutout = createSmoothImage(sizes[s], Image::IMAGE_RGBA, true);
+		if(roundTrip(cutout, Image::COMPRESSION_BC1, decoded)) {
+			checkPunchThrough(cutout, decoded, punchThrough);
+			addResult(bc1Color, colorRMS(cutout, 4, decoded, true));
+		} else {
+			punchThrough.failures++;
+		}
+		delete cutout;
+		
+		// alpha between the two levels has to end up on the right side of the threshold as well
+		Image *blended = createSmoothImage(sizes[s], Image::IMAGE_RGBA, false);
+		if(roundTrip(blended, Image::COMPRESSION_BC1, decoded))
+			checkPunchThrough(blended, decoded, punchThrough);
+		else
+			punchThrough.failures++;
+		delete blended;
+	}
+	
+	checkSolidColors(1000, solidColor);
+	checkMipmapWeighting(mipmapWeighting);
+	
+	CompressionCheck *checks[6] = {&bc1Color, &bc3Color, &bc3Alpha, &solidColor, &punchThrough, &mipmapWeighting};
+	bool passed = true;
+	printf("%-10s %10s %10s %8s\n", "check", "worst", "limit", "result");
+	for(int i=0; i < 6; i++) {
+		CompressionCheck *check = checks[i];
+		printf("%-10s %10.3f %10.3f %8s\n", check->name, check->worst, check->limit, check->failures ? "FAIL" : "ok");
+		if(check->failures)
+			passed = false;
+	}
+	printf("(color is RMS in 0-255 units, bc3 alpha and solid relative to their bounds, bc1 alpha and mipmap exact)\n");
+	
+	return passed ? 0 : 1;
+}
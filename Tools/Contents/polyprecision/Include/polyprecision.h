@@ -0,0 +1,12 @@
+#pragma once
+
+#include "stdio.h"
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include "PolyVector3.h"
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <stdlib.h>
+
+using namespace Polycode;
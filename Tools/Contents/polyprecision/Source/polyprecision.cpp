@@ -0,0 +1,271 @@
+#include "polyprecision.h"
+
+// Checks Matrix4 against a plain double reference, so the results of a POLYCODE_SINGLE_PRECISION build
+// (with or without SSE) can be compared with the double build. Errors are measured in units of the
+// epsilon of Number and scaled by the magnitude of the terms that were summed, so the same limits hold
+// for both builds. The inverse error is scaled by the condition number of the matrix as well.
+//
+// usage: polyprecision [matrix count] [seed]
+// Returns 1 if any check is over its limit.
+
+#define MULTIPLY_LIMIT 8.0
+#define VECTOR_LIMIT 8.0
+#define INVERSE_LIMIT 16.0
+
+struct PrecisionCheck {
+	const char *name;
+	double limit;
+	double worst;
+	double worstAbsolute;
+	unsigned int failures;
+};
+
+static double randomValue() {
+	return ((rand() / (double)RAND_MAX) * 2.0) - 1.0;
+}
+
+static void addResult(PrecisionCheck &check, double absolute, double scale) {
+	double error = absolute;
+	if(scale > 0)
+		error = absolute / scale;
+	if(error > check.worst)
+		check.worst = error;
+	if(absolute > check.worstAbsolute)
+		check.worstAbsolute = absolute;
+	if(error > check.limit)
+		check.failures++;
+}
+
+static void toDouble(const Matrix4 &matrix, double *values) {
+	for(int i=0; i < 16; i++) {
+		values[i] = matrix.ml[i];
+	}
+}
+
+static void multiplyReference(const double *a, const double *b, double *result) {
+	for(int i=0; i < 4; i++) {
+		for(int j=0; j < 4; j++) {
+			result[(i*4)+j] = 0;
+			for(int k=0; k < 4; k++) {
+				result[(i*4)+j] += a[(i*4)+k] * b[(k*4)+j];
+			}
+		}
+	}
+}
+
+// Gauss-Jordan elimination with partial pivoting
+static bool invertReference(const double *matrix, double *result) {
+	double a[16];
+	for(int i=0; i < 16; i++) {
+		a[i] = matrix[i];
+		result[i] = (i % 5) == 0 ? 1.0 : 0.0;
+	}
+
+	for(int column=0; column < 4; column++) {
+		int pivot = column;
+		for(int row=column+1; row < 4; row++) {
+			if(fabs(a[(row*4)+column]) > fabs(a[(pivot*4)+column]))
+				pivot = row;
+		}
+		if(a[(pivot*4)+column] == 0)
+			return false;
+
+		for(int j=0; j < 4; j++) {
+			double t = a[(column*4)+j];
+			a[(column*4)+j] = a[(pivot*4)+j];
+			a[(pivot*4)+j] = t;
+			t = result[(column*4)+j];
+			result[(column*4)+j] = result[(pivot*4)+j];
+			result[(pivot*4)+j] = t;
+		}
+
+		double scale = 1.0 / a[(column*4)+column];
+		for(int j=0; j < 4; j++) {
+			a[(column*4)+j] *= scale;
+			result[(column*4)+j] *= scale;
+		}
+
+		for(int row=0; row < 4; row++) {
+			if(row == column)
+				continue;
+			double factor = a[(row*4)+column];
+			for(int j=0; j < 4; j++) {
+				a[(row*4)+j] -= factor * a[(column*4)+j];
+				result[(row*4)+j] -= factor * result[(column*4)+j];
+			}
+		}
+	}
+	return true;
+}
+
+static double infinityNorm(const double *matrix) {
+	double norm = 0;
+	for(int i=0; i < 4; i++) {
+		double rowSum = fabs(matrix[i*4]) + fabs(matrix[(i*4)+1]) + fabs(matrix[(i*4)+2]) + fabs(matrix[(i*4)+3]);
+		if(rowSum > norm)
+			norm = rowSum;
+	}
+	return norm;
+}
+
+// alternates between general matrices and scale, rotation and translation transforms
+static Matrix4 randomMatrix(bool affine) {
+	Matrix4 matrix;
+	if(!affine) {
+		for(int i=0; i < 16; i++) {
+			matrix.ml[i] = randomValue() * 4.0;
+		}
+		return matrix;
+	}
+
+	double axis[3] = {randomValue(), randomValue(), randomValue()};
+	double length = sqrt((axis[0]*axis[0]) + (axis[1]*axis[1]) + (axis[2]*axis[2]));
+	if(length == 0) {
+		axis[1] = 1;
+		length = 1;
+	}
+	for(int i=0; i < 3; i++) {
+		axis[i] /= length;
+	}
+	double angle = randomValue() * PI;
+	double c = cos(angle);
+	double s = sin(angle);
+	double t = 1.0 - c;
+	double rotation[9] = {
+		(t*axis[0]*axis[0]) + c, (t*axis[0]*axis[1]) + (s*axis[2]), (t*axis[0]*axis[2]) - (s*axis[1]),
+		(t*axis[0]*axis[1]) - (s*axis[2]), (t*axis[1]*axis[1]) + c, (t*axis[1]*axis[2]) + (s*axis[0]),
+		(t*axis[0]*axis[2]) + (s*axis[1]), (t*axis[1]*axis[2]) - (s*axis[0]), (t*axis[2]*axis[2]) + c
+	};
+
+	for(int i=0; i < 3; i++) {
+		double scale = pow(10.0, randomValue());
+		for(int j=0; j < 3; j++) {
+			matrix.m[i][j] = rotation[(i*3)+j] * scale;
+		}
+		matrix.m[i][3] = 0;
+		matrix.m[3][i] = randomValue() * 100.0;
+	}
+	matrix.m[3][3] = 1;
+	return matrix;
+}
+
+int main(int argc, char **argv) {
+	unsigned int count = 100000;
+	unsigned int seed = 1;
+	if(argc > 1)
+		count = atoi(argv[1]);
+	if(argc > 2)
+		seed = atoi(argv[2]);
+	if(count == 0) {
+		printf("usage: polyprecision [matrix count] [seed]\n");
+		return 1;
+	}
+	srand(seed);
+
+	double epsilon = std::numeric_limits<Number>::epsilon();
+#if defined(POLYCODE_USE_SSE)
+	const char *build = "single precision, SSE";
+#elif defined(POLYCODE_SINGLE_PRECISION)
+	const char *build = "single precision";
+#else
+	const char *build = "double precision";
+#endif
+	printf("%s build, epsilon %g, %u matrices\n", build, epsilon, count);
+
+	PrecisionCheck multiply = {"multiply", MULTIPLY_LIMIT, 0, 0, 0};
+	PrecisionCheck transpose = {"transpose", 0, 0, 0, 0};
+	PrecisionCheck inverse = {"inverse", INVERSE_LIMIT, 0, 0, 0};
+	PrecisionCheck transform = {"transform", VECTOR_LIMIT, 0, 0, 0};
+	PrecisionCheck rotate = {"rotate", VECTOR_LIMIT, 0, 0, 0};
+	double worstResidual = 0;
+	unsigned int skipped = 0;
+
+	for(unsigned int n=0; n < count; n++) {
+		Matrix4 a = randomMatrix((n % 2) == 1);
+		Matrix4 b = randomMatrix((n % 4) < 2);
+
+		// the reference works on the rounded inputs, so only the arithmetic error is measured
+		double da[16];
+		double db[16];
+		double reference[16];
+		double values[16];
+		toDouble(a, da);
+		toDouble(b, db);
+
+		toDouble(a * b, values);
+		multiplyReference(da, db, reference);
+		for(int i=0; i < 4; i++) {
+			for(int j=0; j < 4; j++) {
+				double magnitude = 0;
+				for(int k=0; k < 4; k++) {
+					magnitude += fabs(da[(i*4)+k] * db[(k*4)+j]);
+				}
+				addResult(multiply, fabs(values[(i*4)+j] - reference[(i*4)+j]), magnitude * epsilon);
+			}
+		}
+
+		Matrix4 transposed = a.transpose();
+		for(int i=0; i < 4; i++) {
+			for(int j=0; j < 4; j++) {
+				addResult(transpose, fabs((double)transposed.m[i][j] - da[(j*4)+i]), 0);
+			}
+		}
+
+		Vector3 v(randomValue() * 10.0, randomValue() * 10.0, randomValue() * 10.0);
+		double dv[3] = {v.x, v.y, v.z};
+		Vector3 transformed = a * v;
+		Vector3 rotated = a.rotateVector(v);
+		double transformedValues[3] = {transformed.x, transformed.y, transformed.z};
+		double rotatedValues[3] = {rotated.x, rotated.y, rotated.z};
+		for(int j=0; j < 3; j++) {
+			double sum = 0;
+			double magnitude = 0;
+			for(int k=0; k < 3; k++) {
+				sum += dv[k] * da[(k*4)+j];
+				magnitude += fabs(dv[k] * da[(k*4)+j]);
+			}
+			addResult(rotate, fabs(rotatedValues[j] - sum), magnitude * epsilon);
+			addResult(transform, fabs(transformedValues[j] - (sum + da[12+j])), (magnitude + fabs(da[12+j])) * epsilon);
+		}
+
+		// matrices too badly conditioned for the precision of Number have no meaningful inverse to compare
+		if(!invertReference(da, reference)) {
+			skipped++;
+			continue;
+		}
+		double condition = infinityNorm(da) * infinityNorm(reference);
+		if(condition * epsilon > 0.1) {
+			skipped++;
+			continue;
+		}
+
+		toDouble(a.inverse(), values);
+		double worstDifference = 0;
+		double largest = 0;
+		for(int i=0; i < 16; i++) {
+			worstDifference = std::max(worstDifference, fabs(values[i] - reference[i]));
+			largest = std::max(largest, fabs(reference[i]));
+		}
+		addResult(inverse, worstDifference, largest * condition * epsilon);
+
+		double identity[16];
+		multiplyReference(da, values, identity);
+		for(int i=0; i < 16; i++) {
+			worstResidual = std::max(worstResidual, fabs(identity[i] - ((i % 5) == 0 ? 1.0 : 0.0)));
+		}
+	}
+
+	PrecisionCheck *checks[5] = {&multiply, &transpose, &inverse, &transform, &rotate};
+	bool passed = true;
+	printf("%-10s %14s %14s %14s %8s\n", "check", "worst (eps)", "limit (eps)", "worst error", "result");
+	for(int i=0; i < 5; i++) {
+		PrecisionCheck *check = checks[i];
+		printf("%-10s %14.3f %14.3f %14.3g %8s\n", check->name, check->worst, check->limit, check->worstAbsolute, check->failures ? "FAIL" : "ok");
+		if(check->failures)
+			passed = false;
+	}
+	printf("inverse identity residual %g, %u badly conditioned matrices skipped\n", worstResidual, skipped);
+	printf("(multiply and vector errors are relative to the summed terms, inverse errors also to the condition number)\n");
+
+	return passed ? 0 : 1;
+}